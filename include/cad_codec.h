@@ -0,0 +1,70 @@
+#pragma once
+
+/* ============================================================================
+   cad_codec.h
+   Big-endian record codec for .cad files
+   
+   Converts arrays of CadObject/CadPolygon/CadPoint between native structs
+   and the big-endian record images stored on disk (the original struct
+   layout with 16-bit links, including padding, multi-byte fields
+   big-endian). Byte order is resolved at compile time; whole arrays are
+   swapped with SSE2/AVX2 when available.
+   ============================================================================ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cad_file.h"
+
+/* ----------------------------------------------------------------------------
+   Record images
+   ---------------------------------------------------------------------------- */
+typedef struct {
+    uint8_t  flags;
+    uint8_t  selectFlag;
+    int16_t  parentObject;
+    int16_t  nextBrother;
+    int16_t  childObject;
+    int16_t  firstPolygon;
+    double   offsetx;
+    double   offsety;
+    double   offsetz;
+} CadObjectRecord;
+
+typedef struct {
+    uint8_t  flags;
+    uint8_t  selectFlag;
+    int16_t  nextPolygon;
+    int16_t  firstPoint;
+    int16_t  animation;
+    int16_t  both;
+    uint8_t  side;
+    uint8_t  color;
+    uint8_t  npoints;
+} CadPolygonRecord;
+
+typedef struct {
+    uint8_t  flags;
+    uint8_t  selectFlag;
+    int16_t  nextPoint;
+    double   pointx;
+    double   pointy;
+    double   pointz;
+} CadPointRecord;
+
+#define CAD_OBJECT_RECORD_SIZE  sizeof(CadObjectRecord)
+#define CAD_POLYGON_RECORD_SIZE sizeof(CadPolygonRecord)
+#define CAD_POINT_RECORD_SIZE   sizeof(CadPointRecord)
+
+/* Record images -> native structs (links are sign-extended) */
+void CadCodec_DecodeObjects(CadObject* dst, const void* src, size_t count);
+void CadCodec_DecodePolygons(CadPolygon* dst, const void* src, size_t count);
+void CadCodec_DecodePoints(CadPoint* dst, const void* src, size_t count);
+
+/* Native structs -> record images (links are truncated to 16 bits, so the
+   model must pass CadFile_FitsLegacy) */
+void CadCodec_EncodeObjects(void* dst, const CadObject* src, size_t count);
+void CadCodec_EncodePolygons(void* dst, const CadPolygon* src, size_t count);
+void CadCodec_EncodePoints(void* dst, const CadPoint* src, size_t count);
+
+/* Name of the swap path compiled in ("avx2", "sse2", "scalar" or "native") */
+const char* CadCodec_Backend(void);
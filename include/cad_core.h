@@ -23,16 +23,236 @@ typedef enum {
     CAD_MODE_EDIT_POLYGON = 11
 } CadEditMode;
 
+/* ----------------------------------------------------------------------------
+   Index sets
+   One bit per record index, grown on demand; count is kept up to date so
+   the population is O(1) to read.
+   ---------------------------------------------------------------------------- */
+typedef struct {
+    uint32_t* words;
+    int wordCount;
+    int count;               /* Set bits */
+} CadBitset;
+
+void CadBitset_Init(CadBitset* set);
+void CadBitset_Free(CadBitset* set);
+void CadBitset_Clear(CadBitset* set);
+int CadBitset_Test(const CadBitset* set, CadIndex index);
+
+/* Returns 1 if the bit was newly set, 0 if it was already set or the set
+   could not grow */
+int CadBitset_Set(CadBitset* set, CadIndex index);
+
+/* Returns 1 if the bit was set */
+int CadBitset_Reset(CadBitset* set, CadIndex index);
+int CadBitset_Count(const CadBitset* set);
+
+/* dst |= src (0 if dst could not grow), dst &= src, and flip [0, size) */
+int CadBitset_Union(CadBitset* dst, const CadBitset* src);
+void CadBitset_Intersect(CadBitset* dst, const CadBitset* src);
+int CadBitset_Invert(CadBitset* set, int size);
+
+/* First set bit at or after from, or -1:
+   for (CadIndex i = CadBitset_Next(s, 0); i >= 0; i = CadBitset_Next(s, i + 1)) */
+CadIndex CadBitset_Next(const CadBitset* set, CadIndex from);
+
 /* ----------------------------------------------------------------------------
    Selection state
+   The bitsets are the selection; each record's selectFlag mirrors its bit
+   so files keep saving it. The Make tool needs the order points were picked
+   in, which is only recorded while ordered is set.
    ---------------------------------------------------------------------------- */
 typedef struct {
-    int16_t selectedPoints[CAD_MAX_POINTS];
-    int16_t selectedPolygons[CAD_MAX_POLYGONS];
-    int pointCount;
-    int polygonCount;
+    CadBitset points;
+    CadBitset polygons;
+    int ordered;
+    CadIndex* orderedPoints;      /* Selected points in selection order (while ordered) */
+    int orderedCount;
+    int orderedCapacity;
 } CadSelection;
 
+/* ----------------------------------------------------------------------------
+   Free slot maps
+   One bit per slot of the table's capacity, set while the slot is free.
+   Slots are handed out lowest index first, as the old linear scan did, and
+   *Low is the first word that may still hold a free bit, so adding and
+   deleting are amortized O(1). A full table is grown and the map rebuilt.
+   ---------------------------------------------------------------------------- */
+#define CAD_SLOT_WORDS(n) (((n) + 31) / 32)
+
+typedef struct {
+    uint32_t* points;
+    uint32_t* polygons;
+    uint32_t* objects;
+    int pointWords;
+    int polygonWords;
+    int objectWords;
+    int pointLow;
+    int polygonLow;
+    int objectLow;
+    int valid;               /* 0 = rebuild from the record flags before next use */
+} CadFreeSlots;
+
+/* ----------------------------------------------------------------------------
+   Point streams
+   Structure-of-arrays mirror of the point table for passes that sweep every
+   point (projection, grid checks and merges): x, y and z each in their own
+   contiguous stream, with the flags and links packed beside them. The core
+   keeps it in step with its own edits; after writing core->data.points
+   directly, call CadCore_InvalidatePointStreams (or use the point setters).
+   ---------------------------------------------------------------------------- */
+typedef struct {
+    double*   x;
+    double*   y;
+    double*   z;
+    uint8_t*  flags;
+    CadIndex* next;
+    int count;               /* Mirrors core->data.pointCount */
+    int capacity;
+    int valid;               /* 0 = rebuild from core->data.points before next use */
+} CadPointStreams;
+
+/* ----------------------------------------------------------------------------
+   Point adjacency
+   For each point, how many polygons reach it by walking their chains the way
+   CadCore_IsPointConnected describes, so connectivity is a lookup, and which
+   ones: a list per point, its entries kept in one shared pool. Editing a
+   point re-counts just the polygons on its list, however many share it.
+   While a polygon is longer than its walk, a point it reaches may be missing
+   from the lists, and point edits leave the merge state to be rebuilt.
+   ---------------------------------------------------------------------------- */
+typedef struct {
+    CadIndex polygon;
+    int32_t next;            /* Next entry for the same point (-1 = end) */
+} CadOwnerLink;
+
+typedef struct {
+    int32_t* owners;         /* Per point slot: polygons reaching it */
+    int32_t* ownerHead;      /* Per point slot: first entry in links (-1 = none) */
+    int capacity;
+    CadOwnerLink* links;
+    int linkCount;           /* Entries ever used */
+    int linkCapacity;
+    int freeLink;            /* Released entries, chained through next (-1 = none) */
+    int danglingWalks;       /* Walks stopped by a link past the point table */
+    int longPolygons;        /* Polygons with more points than the walk covers */
+    CadIndex* changing;      /* Owners of the point being edited, between
+                                point_changing and point_changed */
+    int changingCapacity;
+    int valid;               /* 0 = rebuild from the polygons before next use */
+} CadPointAdjacency;
+
+/* ----------------------------------------------------------------------------
+   Polygon vertices
+   Every polygon's points in order, packed into one index array (compressed
+   sparse rows) so renderers, exporters and checks read a slice instead of
+   chasing nextPoint through the point records. Polygon i owns
+   indices[offsets[i]] up to indices[offsets[i + 1]]: its chain from
+   firstPoint, at most npoints points, up to a deleted point, a link past the
+   point table or a point already taken (empty below two points). The chains
+   stay the stored form; edits re-walk the polygons they touch in place, like
+   the adjacency.
+   ---------------------------------------------------------------------------- */
+typedef struct {
+    int32_t* offsets;        /* polygonCount + 1 entries */
+    CadIndex* indices;
+    int polygonCount;        /* Polygon slots covered */
+    int offsetCapacity;
+    int indexCapacity;
+    int valid;               /* 0 = rebuild from the polygons before next use */
+} CadPolygonVertices;
+
+/* ----------------------------------------------------------------------------
+   Model statistics
+   Live record counts and merge state, kept up to date by the core operations
+   so the statistics and merge queries are O(1). Editing a point re-checks
+   the polygons the adjacency lists for it. Without the adjacency, or while
+   a polygon is longer than its walk, the unmerged polygon count goes stale
+   instead and is recounted on the next query.
+   ---------------------------------------------------------------------------- */
+typedef struct {
+    int points;              /* Live records */
+    int polygons;
+    int objects;
+    int offGridPoints;       /* Live points failing CadCore_IsPointOnGrid */
+    int offGridObjects;      /* Live objects with a non-integer offset */
+    int unmergedPolygons;    /* Live polygons failing CadCore_IsPolygonMerged */
+    int unmergedValid;       /* 0 = recount unmergedPolygons before next use */
+    int valid;               /* 0 = rebuild everything before next use */
+} CadModelStats;
+
+/* ----------------------------------------------------------------------------
+   Change tracking
+   Every core operation that changes a table bumps its generation and widens
+   its dirty range, then tells the subscribers which indices changed, so a
+   cache can compare generations or redo just the range instead of
+   recomputing everything. Point changes cover the nextPoint links as well as
+   the coordinates; a whole-table change (Clear, LoadFile) is reported once,
+   after it, from 0 to the last slot the table had before or has after.
+   ---------------------------------------------------------------------------- */
+typedef enum {
+    CAD_CHANGE_POINTS = 0,
+    CAD_CHANGE_POLYGONS = 1,
+    CAD_CHANGE_OBJECTS = 2,
+    CAD_CHANGE_POINT_SELECTION = 3,   /* Indices are points */
+    CAD_CHANGE_POLYGON_SELECTION = 4, /* Indices are polygons */
+    CAD_CHANGE_KINDS = 5
+} CadChangeKind;
+
+typedef struct {
+    uint32_t generation;     /* Bumped by every change */
+    CadIndex dirtyFirst;     /* Indices changed since the range was last cleared */
+    CadIndex dirtyLast;      /* (both INVALID_INDEX when nothing changed) */
+} CadChangeRange;
+
+/* Called after the records first..last of kind have changed */
+typedef void (*CadChangeFunc)(void* user, CadChangeKind kind, CadIndex first, CadIndex last);
+
+typedef struct {
+    CadChangeFunc func;
+    void* user;
+    int id;
+} CadChangeSubscriber;
+
+typedef struct {
+    CadChangeRange ranges[CAD_CHANGE_KINDS];
+    CadChangeSubscriber* subscribers;
+    int subscriberCount;
+    int subscriberCapacity;
+    int nextId;
+} CadChangeLog;
+
+/* ----------------------------------------------------------------------------
+   Batched edits
+   Between CadCore_BeginBatch and CadCore_CommitBatch the derived indexes
+   (point streams, adjacency, polygon vertices, statistics) are not kept up
+   to date record by record and change notifications are held back. The
+   commit rebuilds the indexes that were live when the batch began in one
+   pass and reports each changed table once, so bulk edits such as imports
+   stay linear. Batches nest; only the outermost commit applies.
+   ---------------------------------------------------------------------------- */
+typedef struct {
+    int depth;               /* Open BeginBatch calls */
+    int streamsValid;        /* Indexes to rebuild on commit */
+    int adjacencyValid;
+    int verticesValid;
+    int statsValid;
+    CadIndex pendingFirst[CAD_CHANGE_KINDS]; /* Held back changes (INVALID_INDEX if none) */
+    CadIndex pendingLast[CAD_CHANGE_KINDS];
+} CadBatch;
+
+/* ----------------------------------------------------------------------------
+   Background save status
+   ---------------------------------------------------------------------------- */
+typedef enum {
+    CAD_SAVE_IDLE = 0,       /* No save in flight */
+    CAD_SAVE_RUNNING = 1,    /* Worker is still writing */
+    CAD_SAVE_SUCCEEDED = 2,  /* Finished; file was replaced */
+    CAD_SAVE_FAILED = 3      /* Finished; original file left untouched */
+} CadSaveStatus;
+
+typedef struct CadSaveJob CadSaveJob;
+
 /* ----------------------------------------------------------------------------
    Core CAD state
    ---------------------------------------------------------------------------- */
@@ -46,15 +266,46 @@ typedef struct {
     /* Selection */
     CadSelection selection;
     
+    /* Free record slots */
+    CadFreeSlots freeSlots;
+    
+    /* Coordinates as structure of arrays */
+    CadPointStreams pointStreams;
+    
+    /* Polygons reaching each point */
+    CadPointAdjacency adjacency;
+    
+    /* Points of each polygon */
+    CadPolygonVertices polygonVertices;
+    
+    /* Counts behind the statistics and merge queries */
+    CadModelStats stats;
+    
+    /* Generations, dirty ranges and change subscribers */
+    CadChangeLog changes;
+    
+    /* Bulk edit in progress */
+    CadBatch batch;
+    
     /* Active editing */
-    int16_t newPoint;         /* Most recently registered point */
-    int16_t newPolygon;       /* Most recently registered polygon */
-    int16_t rootPolygon;      /* Previously registered polygon */
-    int16_t creatingPoint;   /* Previously registered point */
-    int16_t firstPoint;       /* First point */
+    CadIndex newPoint;         /* Most recently registered point */
+    CadIndex newPolygon;       /* Most recently registered polygon */
+    CadIndex rootPolygon;      /* Previously registered polygon */
+    CadIndex creatingPoint;   /* Previously registered point */
+    CadIndex firstPoint;       /* First point */
     
     /* Dirty flag */
     int isDirty;             /* Has unsaved changes */
+    
+    /* Background save in flight (NULL if none) */
+    CadSaveJob* saveJob;
+    
+    /* Journaled saves: what journalFile holds on disk (NULL until an
+       incremental save reads it back) */
+    CadFileData* journalBase;
+    char journalFile[260];
+    int journalRecords;      /* Records this core appended since the file was last compacted */
+    int journalLoadedRecords; /* Records the file already carried when it was loaded */
 } CadCore;
 
 /* ----------------------------------------------------------------------------
@@ -64,49 +315,115 @@ void CadCore_Init(CadCore* core);
 void CadCore_Destroy(CadCore* core);
 void CadCore_Clear(CadCore* core);
 
+/* Call after writing core->data directly (flags, or a whole model), so the
+   free slot maps are rebuilt from the records before the next add */
+void CadCore_InvalidateFreeSlots(CadCore* core);
+
 /* ----------------------------------------------------------------------------
    File operations
    ---------------------------------------------------------------------------- */
 int CadCore_LoadFile(CadCore* core, const char* filename);
 int CadCore_SaveFile(CadCore* core, const char* filename);
 
+/* Snapshot the model and save it on a worker thread.
+   The file is written to a temporary, flushed and renamed over filename;
+   isDirty is cleared by CadCore_PollSave once the rename has succeeded. */
+int CadCore_BeginSaveFile(CadCore* core, const char* filename);
+
+/* Non-blocking: returns RUNNING while in flight, then SUCCEEDED/FAILED once, then IDLE */
+CadSaveStatus CadCore_PollSave(CadCore* core);
+
+/* Blocking: wait for the save in flight (if any) and finish it like CadCore_PollSave */
+CadSaveStatus CadCore_WaitSave(CadCore* core);
+
+int CadCore_IsSaving(CadCore* core);
+
+/* Save by appending only the changed records to filename's journal.
+   Falls back to a full save when filename is not the file last loaded or
+   saved, and compacts once the journal outgrows the live model. */
+int CadCore_SaveFileIncremental(CadCore* core, const char* filename);
+
+/* Fold the journal back into a plain .cad (no-op unless this core appended
+   to it). Call when closing a model that was saved incrementally; loading a
+   journaled file and destroying the core never rewrites it. */
+int CadCore_CompactFile(CadCore* core);
+
 /* ----------------------------------------------------------------------------
    Point operations
    ---------------------------------------------------------------------------- */
-int16_t CadCore_AddPoint(CadCore* core, double x, double y, double z);
-int CadCore_DeletePoint(CadCore* core, int16_t pointIndex);
-CadPoint* CadCore_GetPoint(CadCore* core, int16_t index);
-int CadCore_IsPointValid(CadCore* core, int16_t index);
+CadIndex CadCore_AddPoint(CadCore* core, double x, double y, double z);
+int CadCore_DeletePoint(CadCore* core, CadIndex pointIndex);
+CadPoint* CadCore_GetPoint(CadCore* core, CadIndex index);
+int CadCore_IsPointValid(CadCore* core, CadIndex index);
+
+/* Point edits that keep the point streams in step (writing through
+   CadCore_GetPoint needs a CadCore_InvalidatePointStreams afterwards) */
+int CadCore_SetPointPosition(CadCore* core, CadIndex pointIndex, double x, double y, double z);
+int CadCore_SetNextPoint(CadCore* core, CadIndex pointIndex, CadIndex nextPoint);
+
+/* Move every point in the set (e.g. selection.points) by (dx, dy, dz) */
+void CadCore_TranslatePoints(CadCore* core, const CadBitset* points, double dx, double dy, double dz);
+
+/* The point streams, rebuilt first if they were invalidated
+   (NULL if they could not be allocated) */
+const CadPointStreams* CadCore_GetPointStreams(CadCore* core);
+void CadCore_InvalidatePointStreams(CadCore* core);
 
 /* ----------------------------------------------------------------------------
    Polygon operations
    ---------------------------------------------------------------------------- */
-int16_t CadCore_AddPolygon(CadCore* core, int16_t firstPoint, uint8_t color, uint8_t npoints);
-int CadCore_DeletePolygon(CadCore* core, int16_t polygonIndex);
-CadPolygon* CadCore_GetPolygon(CadCore* core, int16_t index);
-int CadCore_IsPolygonValid(CadCore* core, int16_t index);
-int CadCore_AddPointToPolygon(CadCore* core, int16_t polygonIndex, int16_t pointIndex);
+CadIndex CadCore_AddPolygon(CadCore* core, CadIndex firstPoint, uint8_t color, uint8_t npoints);
+int CadCore_DeletePolygon(CadCore* core, CadIndex polygonIndex);
+CadPolygon* CadCore_GetPolygon(CadCore* core, CadIndex index);
+int CadCore_IsPolygonValid(CadCore* core, CadIndex index);
+int CadCore_AddPointToPolygon(CadCore* core, CadIndex polygonIndex, CadIndex pointIndex);
+
+/* The polygon vertex table, rebuilt first if it was invalidated
+   (NULL if it could not be allocated) */
+const CadPolygonVertices* CadCore_GetPolygonVertices(CadCore* core);
+
+/* One polygon's slice of it; NULL with *count 0 for an index past the table
+   or if the table could not be allocated */
+const CadIndex* CadCore_GetPolygonPoints(CadCore* core, CadIndex polygonIndex, int* count);
+
+/* Call after relinking points or polygons in core->data directly */
+void CadCore_InvalidatePolygonVertices(CadCore* core);
 
 /* ----------------------------------------------------------------------------
    Object operations
    ---------------------------------------------------------------------------- */
-int16_t CadCore_AddObject(CadCore* core, int16_t parentObject, double ox, double oy, double oz);
-int CadCore_DeleteObject(CadCore* core, int16_t objectIndex);
-CadObject* CadCore_GetObject(CadCore* core, int16_t index);
-int CadCore_IsObjectValid(CadCore* core, int16_t index);
+CadIndex CadCore_AddObject(CadCore* core, CadIndex parentObject, double ox, double oy, double oz);
+int CadCore_DeleteObject(CadCore* core, CadIndex objectIndex);
+CadObject* CadCore_GetObject(CadCore* core, CadIndex index);
+int CadCore_IsObjectValid(CadCore* core, CadIndex index);
 
 /* ----------------------------------------------------------------------------
    Selection operations
    ---------------------------------------------------------------------------- */
 void CadCore_ClearSelection(CadCore* core);
-void CadCore_SelectPoint(CadCore* core, int16_t pointIndex);
-void CadCore_SelectPolygon(CadCore* core, int16_t polygonIndex);
-void CadCore_DeselectPoint(CadCore* core, int16_t pointIndex);
-void CadCore_DeselectPolygon(CadCore* core, int16_t polygonIndex);
-int CadCore_IsPointSelected(CadCore* core, int16_t pointIndex);
-int CadCore_IsPolygonSelected(CadCore* core, int16_t polygonIndex);
+void CadCore_SelectPoint(CadCore* core, CadIndex pointIndex);
+void CadCore_SelectPolygon(CadCore* core, CadIndex polygonIndex);
+void CadCore_DeselectPoint(CadCore* core, CadIndex pointIndex);
+void CadCore_DeselectPolygon(CadCore* core, CadIndex polygonIndex);
+int CadCore_IsPointSelected(CadCore* core, CadIndex pointIndex);
+int CadCore_IsPolygonSelected(CadCore* core, CadIndex polygonIndex);
 void CadCore_SelectAll(CadCore* core);
 
+/* Select everything that is not selected and deselect the rest
+   (points or polygons, following selectModeFlag like CadCore_SelectAll) */
+void CadCore_InvertSelection(CadCore* core);
+
+/* Add the valid records of a set to the selection (e.g. a box select), or
+   keep only the selected records that are also in it */
+void CadCore_SelectPointSet(CadCore* core, const CadBitset* points);
+void CadCore_SelectPolygonSet(CadCore* core, const CadBitset* polygons);
+void CadCore_IntersectPointSelection(CadCore* core, const CadBitset* points);
+void CadCore_IntersectPolygonSelection(CadCore* core, const CadBitset* polygons);
+
+/* Start or stop recording selection.orderedPoints; starting seeds it with
+   the current selection in index order */
+void CadCore_SetSelectionOrdered(CadCore* core, int ordered);
+
 /* ----------------------------------------------------------------------------
    Edit mode
    ---------------------------------------------------------------------------- */
@@ -116,16 +433,19 @@ CadEditMode CadCore_GetEditMode(CadCore* core);
 /* ----------------------------------------------------------------------------
    Linked list helpers
    ---------------------------------------------------------------------------- */
-int16_t CadCore_GetFirstPointOfPolygon(CadCore* core, int16_t polygonIndex);
-int16_t CadCore_GetNextPoint(CadCore* core, int16_t pointIndex);
-int16_t CadCore_GetNextPolygon(CadCore* core, int16_t polygonIndex);
-int16_t CadCore_GetFirstPolygonOfObject(CadCore* core, int16_t objectIndex);
+
+/* The stored chains one link at a time (CadCore_GetPolygonPoints gives a
+   polygon's points at once) */
+CadIndex CadCore_GetFirstPointOfPolygon(CadCore* core, CadIndex polygonIndex);
+CadIndex CadCore_GetNextPoint(CadCore* core, CadIndex pointIndex);
+CadIndex CadCore_GetNextPolygon(CadCore* core, CadIndex polygonIndex);
+CadIndex CadCore_GetFirstPolygonOfObject(CadCore* core, CadIndex objectIndex);
 
 /* ----------------------------------------------------------------------------
    Validation
    ---------------------------------------------------------------------------- */
-int CadCore_ValidatePolygon(CadCore* core, int16_t polygonIndex);
-int CadCore_ValidatePoint(CadCore* core, int16_t pointIndex);
+int CadCore_ValidatePolygon(CadCore* core, CadIndex polygonIndex);
+int CadCore_ValidatePoint(CadCore* core, CadIndex pointIndex);
 
 /* ----------------------------------------------------------------------------
    Statistics
@@ -134,6 +454,35 @@ int CadCore_GetActivePointCount(CadCore* core);
 int CadCore_GetActivePolygonCount(CadCore* core);
 int CadCore_GetActiveObjectCount(CadCore* core);
 
+/* All of the counts at once (NULL only without a core) */
+const CadModelStats* CadCore_GetModelStats(CadCore* core);
+
+/* Call after changing records in core->data directly */
+void CadCore_InvalidateModelStats(CadCore* core);
+
+/* ----------------------------------------------------------------------------
+   Change tracking
+   ---------------------------------------------------------------------------- */
+uint32_t CadCore_GetGeneration(CadCore* core, CadChangeKind kind);
+
+/* Indices of kind changed since the range was last cleared; returns 0 if none */
+int CadCore_GetDirtyRange(CadCore* core, CadChangeKind kind, CadIndex* first, CadIndex* last);
+void CadCore_ClearDirtyRange(CadCore* core, CadChangeKind kind);
+
+/* Call func after every change. Returns an id for CadCore_Unsubscribe, or 0
+   if out of memory. Callbacks must not subscribe or unsubscribe. */
+int CadCore_Subscribe(CadCore* core, CadChangeFunc func, void* user);
+void CadCore_Unsubscribe(CadCore* core, int id);
+
+/* Record a change made by writing core->data directly */
+void CadCore_NotifyChange(CadCore* core, CadChangeKind kind, CadIndex first, CadIndex last);
+
+/* Group many edits (see Batched edits above); every BeginBatch needs a
+   CommitBatch */
+void CadCore_BeginBatch(CadCore* core);
+void CadCore_CommitBatch(CadCore* core);
+int CadCore_IsBatching(CadCore* core);
+
 /* ----------------------------------------------------------------------------
    Merge detection
    ---------------------------------------------------------------------------- */
@@ -144,13 +493,45 @@ int CadCore_ConvertCoordinate(double coord);
 /* Check if coordinates are merged (all coordinates are integers) */
 int CadCore_AreCoordinatesMerged(CadCore* core);
 
+/* Per-point form of the coordinate check */
+int CadCore_IsPointOnGrid(CadCore* core, CadIndex pointIndex);
+
 /* Check if points are merged (no duplicate points at same grid location) */
 int CadCore_ArePointsMerged(CadCore* core);
 
+/* Per-polygon form of the point check */
+int CadCore_IsPolygonMerged(CadCore* core, CadIndex polygonIndex);
+
 /* Check if all merge operations have been applied */
 int CadCore_IsFullyMerged(CadCore* core);
 
-/* Check if a point is connected to any polygon (not orphaned) */
-int CadCore_IsPointConnected(CadCore* core, int16_t pointIndex);
+/* Check if a point is connected to any polygon (not orphaned): some polygon
+   of two or more points reaches it following nextPoint from its firstPoint,
+   stopping at a deleted point, a repeated point or after 64 points */
+int CadCore_IsPointConnected(CadCore* core, CadIndex pointIndex);
+
+/* Call after relinking points or polygons in core->data directly */
+void CadCore_InvalidateAdjacency(CadCore* core);
 
+/* ----------------------------------------------------------------------------
+   Merge operations
+   ---------------------------------------------------------------------------- */
+
+/* Grid merge: round all point coordinates and object offsets to integers
+   (returns the number of points/objects that moved) */
+int CadCore_GridMerge(CadCore* core);
 
+/* Point merge: remove consecutive points of a polygon that share a grid
+   location, including a last point equal to the first (returns points removed) */
+int CadCore_PointMerge(CadCore* core);
+
+/* ----------------------------------------------------------------------------
+   Consistency checks
+   Only built with CAD_CHECK_INDEXES defined, for test drivers such as
+   tools/cadcheck: every derived index that is currently live is rebuilt
+   from the records and compared with the one the core kept up to date.
+   Returns the number of indexes that disagree, each reported on stderr.
+   ---------------------------------------------------------------------------- */
+#ifdef CAD_CHECK_INDEXES
+int CadCore_CheckIndexes(CadCore* core);
+#endif
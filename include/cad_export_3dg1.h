@@ -1,7 +1,14 @@
 #pragma once
 
 #include "cad_core.h"
+#include <stdio.h>
+
+/* Bump whenever the exporter's output changes, so cached conversions are redone */
+#define CAD_EXPORT_3DG1_VERSION 1
 
 /* Export CAD data to Fundoshi-Kun format */
 int CadExport_3DG1(const CadCore* core, const char* filename);
 
+/* Same, written to an already open stream (e.g. stdout) */
+int CadExport_3DG1Stream(const CadCore* core, FILE* fp);
+
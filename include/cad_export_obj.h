@@ -1,7 +1,11 @@
 #pragma once
 
 #include "cad_core.h"
+#include <stdio.h>
 
 /* Export CAD data to OBJ format */
 int CadExport_OBJ(const CadCore* core, const char* filename);
 
+/* Same, written to already open streams. fp_mtl may be NULL (no material
+   library); mtl_name is the mtllib reference (NULL to omit the line). */
+int CadExport_OBJStream(const CadCore* core, FILE* fp_obj, FILE* fp_mtl, const char* mtl_name);
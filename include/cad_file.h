@@ -8,6 +8,7 @@
    ============================================================================ */
 
 #include <stdint.h>
+#include <stddef.h>
 
 /* ----------------------------------------------------------------------------
    Minimum counts
@@ -17,18 +18,42 @@
 
 /* ----------------------------------------------------------------------------
    Maximum counts
+   The record tables grow on demand up to CAD_MAX_SLOTS. The legacy and
+   indexed containers store 16-bit links and keep the original limits; a
+   model that does not fit them is saved in the compact container.
    ---------------------------------------------------------------------------- */
-#define CAD_MAX_OBJECTS     256     /* max objects */
-#define CAD_MAX_POINTS     1024    /* max points */
-#define CAD_MAX_POLYGONS   1024    /* max polygons */
+#define CAD_LEGACY_MAX_OBJECTS   256     /* max objects */
+#define CAD_LEGACY_MAX_POINTS   1024    /* max points */
+#define CAD_LEGACY_MAX_POLYGONS 1024    /* max polygons */
+#define CAD_MAX_SLOTS       0x1000000   /* max records of one kind (16M) */
 #define CAD_MAX_FACE_POINTS 12      /* max face points */
 
+/* Record index (slot number); links use INVALID_INDEX (-1) for "none" */
+typedef int32_t CadIndex;
+
 /* ----------------------------------------------------------------------------
    File format tags
    ---------------------------------------------------------------------------- */
 #define CAD_TAG_OBJECT     0       /* Object record */
 #define CAD_TAG_POLYGON    1       /* Polygon record */
 #define CAD_TAG_POINT      2       /* Point record */
+#define CAD_TAG_JOURNAL    3       /* Journal segment (journaled files only) */
+
+/* ----------------------------------------------------------------------------
+   Container formats
+   CadFile_Load detects the format by its leading bytes. A compressed save
+   fails if the image it wraps is larger than CAD_COMPRESSED_MAX_IMAGE, the
+   most the loader inflates; such models have to be saved uncompressed.
+   ---------------------------------------------------------------------------- */
+#define CAD_COMPRESSED_MAX_IMAGE (64u * 1024u * 1024u)
+
+typedef enum {
+    CAD_FORMAT_LEGACY = 0,   /* Tag/index/record stream (original format) */
+    CAD_FORMAT_INDEXED,      /* v2: "CAD2" header + per-slot record offset table */
+    CAD_FORMAT_COMPACT,      /* "CADC": varint links, int16 coordinates when all are integers */
+    
+    CAD_FORMAT_COMPRESSED = 0x10  /* Flag: wrap any of the above in "CADZ" LZ blocks */
+} CadFileFormat;
 
 /* ----------------------------------------------------------------------------
    Point record (vertex)
@@ -36,7 +61,7 @@
 typedef struct {
     uint8_t  flags;          /* Flags */
     uint8_t  selectFlag;     /* Selection flag */
-    int16_t  nextPoint;      /* Index to next point in polygon (-1 = end) */
+    CadIndex nextPoint;      /* Index to next point in polygon (-1 = end) */
     double   pointx;         /* X coordinate */
     double   pointy;         /* Y coordinate */
     double   pointz;         /* Z coordinate */
@@ -48,10 +73,10 @@ typedef struct {
 typedef struct {
     uint8_t  flags;          /* Flags */
     uint8_t  selectFlag;     /* Selection flag */
-    int16_t  nextPolygon;    /* Index to next polygon in same group (-1 = end) */
-    int16_t  firstPoint;     /* Index to first vertex of polygon */
+    CadIndex nextPolygon;    /* Index to next polygon in same group (-1 = end) */
+    CadIndex firstPoint;     /* Index to first vertex of polygon */
     int16_t  animation;      /* Animation frame index */
-    int16_t  both;           /* Opposite side index (double-sided polygon) */
+    CadIndex both;           /* Opposite side index (double-sided polygon) */
     uint8_t  side;           /* Front/back flag */
     uint8_t  color;          /* Polygon color */
     uint8_t  npoints;        /* Vertex count */
@@ -63,10 +88,10 @@ typedef struct {
 typedef struct {
     uint8_t  flags;          /* Flags */
     uint8_t  selectFlag;     /* Selection flag */
-    int16_t  parentObject;   /* Index to parent object (-1 = root) */
-    int16_t  nextBrother;    /* Index to next sibling object (-1 = end) */
-    int16_t  childObject;    /* Index to first child object (-1 = none) */
-    int16_t  firstPolygon;   /* Index to first polygon (-1 = none) */
+    CadIndex parentObject;   /* Index to parent object (-1 = root) */
+    CadIndex nextBrother;    /* Index to next sibling object (-1 = end) */
+    CadIndex childObject;    /* Index to first child object (-1 = none) */
+    CadIndex firstPolygon;   /* Index to first polygon (-1 = none) */
     double   offsetx;        /* Offset X relative to parent */
     double   offsety;        /* Offset Y relative to parent */
     double   offsetz;        /* Offset Z relative to parent */
@@ -76,13 +101,20 @@ typedef struct {
    CAD file data structure
    ---------------------------------------------------------------------------- */
 typedef struct {
-    CadObject  objects[CAD_MAX_OBJECTS];
-    CadPolygon polygons[CAD_MAX_POLYGONS];
-    CadPoint   points[CAD_MAX_POINTS];
+    CadObject*  objects;     /* objectCapacity slots, free slots zeroed */
+    CadPolygon* polygons;
+    CadPoint*   points;
+    int objectCapacity;
+    int polygonCapacity;
+    int pointCapacity;
     
-    int objectCount;
+    int objectCount;         /* Slots in use: one past the highest ever filled */
     int polygonCount;
     int pointCount;
+    
+    CadFileFormat format;    /* Container the last load read (saves keep it) */
+    int journalSegments;     /* Journal segments replayed by the last load */
+    int journalRecords;      /* Records those segments carried */
 } CadFileData;
 
 /* ----------------------------------------------------------------------------
@@ -92,22 +124,117 @@ typedef struct {
 /* Load a .cad file */
 int CadFile_Load(const char* filename, CadFileData* data);
 
+/* Decode a .cad image that is already in memory */
+int CadFile_LoadFromBuffer(const void* buffer, size_t size, CadFileData* data);
+
 /* Save a .cad file */
 int CadFile_Save(const char* filename, const CadFileData* data);
 
-/* Initialize empty CAD data */
+/* Number of bytes CadFile_EncodeToBuffer will produce */
+size_t CadFile_GetSaveSize(const CadFileData* data);
+
+/* Encode into a caller-provided buffer (returns bytes written, 0 if it does not fit) */
+size_t CadFile_EncodeToBuffer(const CadFileData* data, void* buffer, size_t capacity);
+
+/* Encode into a new contiguous big-endian buffer (free with CadFile_FreeBuffer) */
+int CadFile_SaveToBuffer(const CadFileData* data, uint8_t** out_buffer, size_t* out_size);
+void CadFile_FreeBuffer(uint8_t* buffer);
+
+/* Write to "<filename>.tmp", flush it to disk, then rename it over filename */
+int CadFile_WriteBufferAtomic(const char* filename, const void* buffer, size_t size);
+
+/* Save a .cad file through CadFile_WriteBufferAtomic */
+int CadFile_SaveAtomic(const char* filename, const CadFileData* data);
+
+/* Encode in the given container format (free with CadFile_FreeBuffer) */
+int CadFile_SaveToBufferEx(const CadFileData* data, CadFileFormat format, uint8_t** out_buffer, size_t* out_size);
+
+/* Save atomically in the given container format */
+int CadFile_SaveEx(const char* filename, const CadFileData* data, CadFileFormat format);
+
+/* Parse "legacy", "indexed" or "compact", optionally followed by "+z" for
+   LZ compression (returns 0 if the name is not recognised) */
+int CadFile_ParseFormat(const char* name, CadFileFormat* out_format);
+
+/* Load one object with its polygons, their points and its child objects.
+   Records keep their file indices; every other slot is left empty. v2 files
+   are read through the offset table without decoding the other records. */
+int CadFile_LoadObject(const char* filename, int objectIndex, CadFileData* data);
+
+/* ----------------------------------------------------------------------------
+   Streaming record access
+   ---------------------------------------------------------------------------- */
+
+/* Callbacks for CadFile_ForEachRecord (any may be NULL; return 0 to stop) */
+typedef struct {
+    int (*object)(void* user, int index, const CadObject* obj);
+    int (*polygon)(void* user, int index, const CadPolygon* poly);
+    int (*point)(void* user, int index, const CadPoint* pt);
+} CadRecordVisitor;
+
+/* Summary gathered by CadFile_GetStats */
+typedef struct {
+    int objectCount;         /* Live records */
+    int polygonCount;
+    int pointCount;
+    double minx, miny, minz; /* Bounding box of live points (all 0 if none) */
+    double maxx, maxy, maxz;
+    int colorCount;          /* Distinct polygon colors */
+    uint8_t colorUsed[256];  /* Nonzero for each color at least one polygon uses */
+} CadFileStats;
+
+/* Decode records one at a time from the mapped file and pass them to visitor,
+   in file order, without filling a CadFileData. Journaled files report a
+   slot again each time a segment rewrites it (deletions have flags 0).
+   Returns 0 on read or format errors; stopping early still returns 1. */
+int CadFile_ForEachRecord(const char* filename, const CadRecordVisitor* visitor, void* user);
+
+/* Counts, bounds and colors through CadFile_ForEachRecord. For journaled
+   files the bounds may include coordinates a later segment replaced. */
+int CadFile_GetStats(const char* filename, CadFileStats* stats);
+
+/* Journaled .cad files are a normal record stream followed by appended
+   journal segments (CAD_TAG_JOURNAL, length, checksum, triples). Loading
+   replays the segments in order; a torn final segment is ignored. */
+
+/* Append the records that differ between base (what the file holds) and data.
+   Returns the number of records appended (0 = nothing changed), -1 on error. */
+int CadFile_AppendJournal(const char* filename, const CadFileData* base, const CadFileData* data);
+
+/* Fold a journaled file back into a plain .cad (no-op for plain files) */
+int CadFile_Compact(const char* filename);
+
+/* Initialize empty CAD data (no storage yet). Every CadFileData must be
+   initialized before it is loaded into, and released with CadFile_Free. */
 void CadFile_Init(CadFileData* data);
 
-/* Clear all data */
+/* Clear all data, keeping the storage for reuse */
 void CadFile_Clear(CadFileData* data);
 
+/* Release the record storage and reinitialize */
+void CadFile_Free(CadFileData* data);
+
+/* Make room for at least this many slots of each kind. Capacities grow
+   geometrically and new slots are free; returns 0 on allocation failure
+   or past CAD_MAX_SLOTS. */
+int CadFile_Reserve(CadFileData* data, int objects, int polygons, int points);
+
+/* Deep copy src into dst (dst must be initialized) */
+int CadFile_Copy(CadFileData* dst, const CadFileData* src);
+
+/* Same slot counts and identical records */
+int CadFile_Equal(const CadFileData* a, const CadFileData* b);
+
+/* Does the model fit the legacy/indexed containers (16-bit links, original limits)? */
+int CadFile_FitsLegacy(const CadFileData* data);
+
 /* Get point by index (returns NULL if invalid) */
-CadPoint* CadFile_GetPoint(CadFileData* data, int16_t index);
+CadPoint* CadFile_GetPoint(CadFileData* data, CadIndex index);
 
 /* Get polygon by index (returns NULL if invalid) */
-CadPolygon* CadFile_GetPolygon(CadFileData* data, int16_t index);
+CadPolygon* CadFile_GetPolygon(CadFileData* data, CadIndex index);
 
 /* Get object by index (returns NULL if invalid) */
-CadObject* CadFile_GetObject(CadFileData* data, int16_t index);
+CadObject* CadFile_GetObject(CadFileData* data, CadIndex index);
 
 
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "cad_core.h"
+#include <stddef.h>
 
 /* Import CAD data from Fundoshi-Kun format (.3dg1) */
 int CadImport_3DG1(CadCore* core, const char* filename);
+
+/* Same, from 3DG1 text already in memory (text[size] must be '\0') */
+int CadImport_3DG1FromBuffer(CadCore* core, const char* text, size_t size);
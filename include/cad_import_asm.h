@@ -0,0 +1,61 @@
+#pragma once
+
+/* ============================================================================
+   cad_import_asm.h
+   Import Star Fox (SuperFX) shapes from the game's ASM source
+
+   A shape is a ShapeHdr line naming its points and faces sections, points
+   given with pb/pw/pbd2/pwd2 (PointsXb/PointsXw sections are mirrored in X)
+   and Face2..Face5 records. Coordinates and sizes may be symbolic, so a
+   constant table loaded from the INC folder is needed to resolve them.
+   ============================================================================ */
+
+#include "cad_core.h"
+#include <stddef.h>
+
+/* Symbolic constants used by ASM shapes (name equ value / name = value) */
+typedef struct CadAsmConstants CadAsmConstants;
+
+CadAsmConstants* CadAsmConstants_Create(void);
+
+/* Empty table whose lookups fall back to base (which it never modifies) */
+CadAsmConstants* CadAsmConstants_CreateOverlay(const CadAsmConstants* base);
+void CadAsmConstants_Destroy(CadAsmConstants* constants);
+void CadAsmConstants_Clear(CadAsmConstants* constants);
+int CadAsmConstants_GetCount(const CadAsmConstants* constants);
+
+/* Add the definitions found in ASM/INC source text */
+void CadAsmConstants_LoadText(CadAsmConstants* constants, const char* text, size_t size);
+
+/* Load the INC folder next to shapes_folder plus the shape ASM files,
+   replacing whatever the table held */
+void CadAsmConstants_LoadFolder(CadAsmConstants* constants, const char* shapes_folder);
+
+/* An ASM file split into lines and indexed by ShapeHdr once, so several
+   shapes can be imported from it (also from several threads at once) */
+typedef struct CadAsmSource CadAsmSource;
+
+CadAsmSource* CadAsmSource_Create(const char* text, size_t size);
+CadAsmSource* CadAsmSource_Load(const char* filename);
+void CadAsmSource_Destroy(CadAsmSource* source);
+int CadAsmSource_GetShapeCount(const CadAsmSource* source);
+const char* CadAsmSource_GetShapeName(const CadAsmSource* source, int index);
+
+/* Import shape_name from a parsed source. Returns 0 if the source does not
+   define the shape. constants may be NULL and is only read: constants
+   defined next to the shape are scoped to that shape. */
+int CadImport_AsmShapeFromSource(CadCore* core, const CadAsmSource* source,
+                                 const char* shape_name, const CadAsmConstants* constants);
+
+/* Same, for ASM source text already in memory */
+int CadImport_AsmShapeFromBuffer(CadCore* core, const char* text, size_t size,
+                                 const char* shape_name, const CadAsmConstants* constants);
+
+/* Find shape_name among the *.asm files in folder_path (using the
+   Shapes.SFEOPTIM shape-to-file map when present) and import it */
+int CadImport_AsmShape(CadCore* core, const char* shape_name, const char* folder_path,
+                       const CadAsmConstants* constants);
+
+/* Name of the first shape defined in the text (the label before the first
+   ShapeHdr); returns 0 if there is none */
+int CadAsm_FirstShapeName(const char* text, size_t size, char* name, size_t cap);
@@ -1,11 +1,16 @@
 #pragma once
 
 #include "cad_core.h"
+#include <stddef.h>
 
 /* Import CAD data from Wavefront OBJ format (.obj)
    Note: Limited support due to SuperFX engine constraints
    - Supports vertices (v) and faces (f)
    - Ignores materials, normals, texture coordinates
-   - Maximum 8192 vertices, 4096 polygons
+   - Up to CAD_MAX_SLOTS points and polygons; each face gets its own
+     copy of its vertices
 */
 int CadImport_OBJ(CadCore* core, const char* filename);
+
+/* Same, from OBJ text already in memory (e.g. read from stdin) */
+int CadImport_OBJFromBuffer(CadCore* core, const char* text, size_t size);
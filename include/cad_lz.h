@@ -0,0 +1,20 @@
+#pragma once
+
+/* ============================================================================
+   cad_lz.h
+   Small self-contained LZ77 block codec used by compressed .cad files
+   
+   A block is a sequence of literal runs and back-references (LZ4-style
+   token/literal/offset layout). Blocks are independent of each other.
+   ============================================================================ */
+
+#include <stddef.h>
+
+/* Largest compressed size for srcSize input bytes */
+size_t CadLz_CompressBound(size_t srcSize);
+
+/* Compress one block (returns compressed size, 0 if it does not fit dstCapacity) */
+size_t CadLz_Compress(const void* src, size_t srcSize, void* dst, size_t dstCapacity);
+
+/* Decompress one block that expands to exactly dstSize bytes (returns 1 on success) */
+int CadLz_Decompress(const void* src, size_t srcSize, void* dst, size_t dstSize);
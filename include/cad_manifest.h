@@ -0,0 +1,48 @@
+#pragma once
+
+/* ============================================================================
+   cad_manifest.h
+   Persistent conversion manifest for incremental batch exports
+
+   Each entry maps an input path to the 64-bit FNV-1a hash of its contents,
+   a hash of the exporter version and options that produced the output, and
+   the output path. An input whose hashes still match (and whose output
+   still exists) does not need to be converted again.
+
+   The manifest is a text file, one entry per line:
+       <content hash> <config hash> <input path>\t<output path>
+   ============================================================================ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct CadManifest CadManifest;
+
+/* Load filename (a missing file gives an empty manifest; NULL on error) */
+CadManifest* CadManifest_Load(const char* filename);
+
+/* Write the manifest back to the file it was loaded from (atomic) */
+int CadManifest_Save(const CadManifest* manifest);
+
+void CadManifest_Destroy(CadManifest* manifest);
+
+/* FNV-1a 64-bit; pass CAD_MANIFEST_HASH_SEED to start, the result to continue */
+#define CAD_MANIFEST_HASH_SEED 14695981039346656037ull
+uint64_t CadManifest_HashBytes(const void* bytes, size_t size, uint64_t hash);
+uint64_t CadManifest_HashString(const char* text, uint64_t hash);
+
+/* Hash a file's contents (returns 0 if it could not be read) */
+int CadManifest_HashFile(const char* filename, uint64_t* out_hash);
+
+/* 1 if input was last converted from the same contents with the same
+   config into output, and output still exists. Safe to call from workers. */
+int CadManifest_IsCurrent(CadManifest* manifest, const char* input,
+                          uint64_t contentHash, uint64_t configHash, const char* output);
+
+/* Record a successful conversion (replaces any earlier entry for input).
+   Safe to call from workers. */
+int CadManifest_Update(CadManifest* manifest, const char* input,
+                       uint64_t contentHash, uint64_t configHash, const char* output);
+
+/* Number of entries */
+int CadManifest_GetCount(const CadManifest* manifest);
@@ -0,0 +1,38 @@
+#pragma once
+
+/* ============================================================================
+   cad_script.h
+   Headless command scripts: the menu operations, run against a CadCore
+   without a window or GL context
+
+   Commands are separated by newlines or ';', '#' starts a comment and
+   arguments containing spaces can be double-quoted. $name or ${name} is
+   replaced by the value of a script variable.
+
+       load <file>                     .obj, .3dg1/.txt or .cad (by extension)
+       load shape <name> <folder>      ASM shape from a SHAPES folder
+       save <file> [legacy|indexed|compact[+z]]
+       export 3dg1|obj <file>
+       select all|none
+       grid merge | point merge | all merge
+       clear | stats | echo <text>
+
+   A script stops at the first command that fails.
+   ============================================================================ */
+
+#include "cad_core.h"
+#include <stddef.h>
+
+/* A $name substitution */
+typedef struct {
+    const char* name;
+    const char* value;
+} CadScriptVar;
+
+/* Run script text (name is used in messages). Returns 1 if every command succeeded. */
+int CadScript_Run(CadCore* core, const char* text, size_t size, const char* name,
+                  const CadScriptVar* vars, int var_count);
+
+/* Same, reading the script from filename */
+int CadScript_RunFile(CadCore* core, const char* filename,
+                      const CadScriptVar* vars, int var_count);
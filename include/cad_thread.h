@@ -0,0 +1,25 @@
+#pragma once
+
+/* ============================================================================
+   cad_thread.h
+   Minimal portable threads and mutexes (Win32 threads / pthreads)
+   ============================================================================ */
+
+typedef struct CadThread CadThread;
+typedef struct CadMutex CadMutex;
+
+/* Thread entry point */
+typedef void (*CadThreadFunc)(void* arg);
+
+/* Start a thread running func(arg) (returns NULL on failure) */
+CadThread* CadThread_Create(CadThreadFunc func, void* arg);
+
+/* Wait for the thread to finish and release it */
+void CadThread_Join(CadThread* thread);
+
+/* Create/destroy a mutex (returns NULL on failure) */
+CadMutex* CadMutex_Create(void);
+void CadMutex_Destroy(CadMutex* mutex);
+
+void CadMutex_Lock(CadMutex* mutex);
+void CadMutex_Unlock(CadMutex* mutex);
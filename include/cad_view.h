@@ -49,15 +49,21 @@ void CadView_Pan3DVertical(CadView* view, double dy); /* Pan 3D view up/down rel
 void CadView_ProjectPoint(const CadView* view, double x, double y, double z, 
                          int* out_x, int* out_y, int viewport_w, int viewport_h);
 
+/* Project count points given as coordinate streams (e.g. CadPointStreams).
+   Outputs are screen positions before the truncation to int that
+   CadView_ProjectPoint applies, so slots holding junk can be skipped after. */
+void CadView_ProjectPoints(const CadView* view, const double* xs, const double* ys, const double* zs,
+                           int count, double* out_x, double* out_y, int viewport_w, int viewport_h);
+
 /* ----------------------------------------------------------------------------
    Point selection (find nearest point to screen coordinates)
    Returns point index or -1 if none found within threshold
    ---------------------------------------------------------------------------- */
-int16_t CadView_FindNearestPoint(const CadView* view, const CadCore* core,
-                                 int screen_x, int screen_y,
-                                 int viewport_x, int viewport_y,
-                                 int viewport_w, int viewport_h,
-                                 int threshold_pixels);
+CadIndex CadView_FindNearestPoint(const CadView* view, const CadCore* core,
+                                  int screen_x, int screen_y,
+                                  int viewport_x, int viewport_y,
+                                  int viewport_w, int viewport_h,
+                                  int threshold_pixels);
 
 /* ----------------------------------------------------------------------------
    Find all points at the same location as the nearest point
@@ -70,7 +76,7 @@ int CadView_FindPointsAtLocation(const CadView* view, const CadCore* core,
                                  int viewport_w, int viewport_h,
                                  int threshold_pixels,
                                  double world_threshold,
-                                 int16_t* out_indices, int max_count);
+                                 CadIndex* out_indices, int max_count);
 
 /* ----------------------------------------------------------------------------
    Unproject screen delta to 3D world delta
@@ -0,0 +1,382 @@
+#include "cad_codec.h"
+#include <stdint.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <stdlib.h>
+#endif
+
+/* ----------------------------------------------------------------------------
+   Compile-time configuration
+   ---------------------------------------------------------------------------- */
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define CAD_CODEC_NATIVE_BIG_ENDIAN 1   /* Record images are already native */
+#else
+#define CAD_CODEC_NATIVE_BIG_ENDIAN 0
+#endif
+
+#if !CAD_CODEC_NATIVE_BIG_ENDIAN && defined(__AVX2__)
+#define CAD_CODEC_AVX2 1
+#include <immintrin.h>
+#elif !CAD_CODEC_NATIVE_BIG_ENDIAN && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define CAD_CODEC_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/* ----------------------------------------------------------------------------
+   Record layouts
+   Offsets of the multi-byte fields; everything else is copied as is.
+   ---------------------------------------------------------------------------- */
+typedef struct {
+    uint8_t offset;
+    uint8_t width;           /* 2 or 8 */
+} CodecField;
+
+typedef struct {
+    size_t size;
+    int fieldCount;
+    CodecField fields[8];
+} RecordLayout;
+
+static const RecordLayout OBJECT_LAYOUT = {
+    sizeof(CadObjectRecord), 7, {
+        { offsetof(CadObjectRecord, parentObject), 2 },
+        { offsetof(CadObjectRecord, nextBrother), 2 },
+        { offsetof(CadObjectRecord, childObject), 2 },
+        { offsetof(CadObjectRecord, firstPolygon), 2 },
+        { offsetof(CadObjectRecord, offsetx), 8 },
+        { offsetof(CadObjectRecord, offsety), 8 },
+        { offsetof(CadObjectRecord, offsetz), 8 },
+    }
+};
+
+static const RecordLayout POLYGON_LAYOUT = {
+    sizeof(CadPolygonRecord), 4, {
+        { offsetof(CadPolygonRecord, nextPolygon), 2 },
+        { offsetof(CadPolygonRecord, firstPoint), 2 },
+        { offsetof(CadPolygonRecord, animation), 2 },
+        { offsetof(CadPolygonRecord, both), 2 },
+    }
+};
+
+static const RecordLayout POINT_LAYOUT = {
+    sizeof(CadPointRecord), 4, {
+        { offsetof(CadPointRecord, nextPoint), 2 },
+        { offsetof(CadPointRecord, pointx), 8 },
+        { offsetof(CadPointRecord, pointy), 8 },
+        { offsetof(CadPointRecord, pointz), 8 },
+    }
+};
+
+/* ----------------------------------------------------------------------------
+   Scalar path
+   ---------------------------------------------------------------------------- */
+#if !CAD_CODEC_NATIVE_BIG_ENDIAN
+static inline uint16_t bswap16(uint16_t value) {
+    return (uint16_t)((value << 8) | (value >> 8));
+}
+
+static inline uint64_t bswap64(uint64_t value) {
+#if defined(__GNUC__)
+    return __builtin_bswap64(value);
+#elif defined(_MSC_VER)
+    return _byteswap_uint64(value);
+#else
+    value = ((value & 0x00FF00FF00FF00FFULL) << 8) | ((value >> 8) & 0x00FF00FF00FF00FFULL);
+    value = ((value & 0x0000FFFF0000FFFFULL) << 16) | ((value >> 16) & 0x0000FFFF0000FFFFULL);
+    return (value << 32) | (value >> 32);
+#endif
+}
+
+static void swap_records_scalar(uint8_t* dst, const uint8_t* src, size_t count, const RecordLayout* layout) {
+    for (size_t r = 0; r < count; r++) {
+        memmove(dst, src, layout->size);
+        for (int f = 0; f < layout->fieldCount; f++) {
+            uint8_t* field = dst + layout->fields[f].offset;
+            if (layout->fields[f].width == 2) {
+                uint16_t v;
+                memcpy(&v, field, sizeof(v));
+                v = bswap16(v);
+                memcpy(field, &v, sizeof(v));
+            } else {
+                uint64_t v;
+                memcpy(&v, field, sizeof(v));
+                v = bswap64(v);
+                memcpy(field, &v, sizeof(v));
+            }
+        }
+        dst += layout->size;
+        src += layout->size;
+    }
+}
+#endif
+
+/* ----------------------------------------------------------------------------
+   SIMD path
+   Each vector is byte-swapped per 16-bit word (w) and per 64-bit lane (q),
+   then the original bytes, w and q are blended with masks that repeat every
+   lcm(record size, vector size) bytes. 8-byte fields sit on 8-byte offsets
+   in every record, so they never straddle a 64-bit lane.
+   ---------------------------------------------------------------------------- */
+#if defined(CAD_CODEC_AVX2) || defined(CAD_CODEC_SSE2)
+
+#ifdef CAD_CODEC_AVX2
+#define VEC_BYTES 32
+typedef __m256i Vec;
+#define vec_load(p)        _mm256_loadu_si256((const __m256i*)(p))
+#define vec_store(p, v)    _mm256_storeu_si256((__m256i*)(p), (v))
+#define vec_and            _mm256_and_si256
+#define vec_andnot         _mm256_andnot_si256
+#define vec_or             _mm256_or_si256
+#define vec_swap16(x)      _mm256_or_si256(_mm256_slli_epi16((x), 8), _mm256_srli_epi16((x), 8))
+#define vec_rev_words(x)   _mm256_shufflehi_epi16(_mm256_shufflelo_epi16((x), 0x1B), 0x1B)
+#else
+#define VEC_BYTES 16
+typedef __m128i Vec;
+#define vec_load(p)        _mm_loadu_si128((const __m128i*)(p))
+#define vec_store(p, v)    _mm_storeu_si128((__m128i*)(p), (v))
+#define vec_and            _mm_and_si128
+#define vec_andnot         _mm_andnot_si128
+#define vec_or             _mm_or_si128
+#define vec_swap16(x)      _mm_or_si128(_mm_slli_epi16((x), 8), _mm_srli_epi16((x), 8))
+#define vec_rev_words(x)   _mm_shufflehi_epi16(_mm_shufflelo_epi16((x), 0x1B), 0x1B)
+#endif
+
+/* Largest period: lcm(14, 32) = 224 bytes */
+#define MAX_PERIOD_BYTES 224
+
+static size_t gcd_size(size_t a, size_t b) {
+    while (b) {
+        size_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static void swap_records_simd(uint8_t* dst, const uint8_t* src, size_t count, const RecordLayout* layout) {
+    size_t period = layout->size / gcd_size(layout->size, VEC_BYTES) * VEC_BYTES;
+    size_t records_per_period = period / layout->size;
+    
+    /* Too short for a full period - not worth building the masks */
+    if (period > MAX_PERIOD_BYTES || count < records_per_period) {
+        swap_records_scalar(dst, src, count, layout);
+        return;
+    }
+    
+    uint8_t mask16[MAX_PERIOD_BYTES];
+    uint8_t mask64[MAX_PERIOD_BYTES];
+    memset(mask16, 0, period);
+    memset(mask64, 0, period);
+    for (size_t r = 0; r < records_per_period; r++) {
+        for (int f = 0; f < layout->fieldCount; f++) {
+            uint8_t* mask = layout->fields[f].width == 2 ? mask16 : mask64;
+            memset(mask + r * layout->size + layout->fields[f].offset, 0xFF, layout->fields[f].width);
+        }
+    }
+    
+    Vec m16[MAX_PERIOD_BYTES / VEC_BYTES];
+    Vec m64[MAX_PERIOD_BYTES / VEC_BYTES];
+    size_t vectors = period / VEC_BYTES;
+    for (size_t v = 0; v < vectors; v++) {
+        m16[v] = vec_load(mask16 + v * VEC_BYTES);
+        m64[v] = vec_load(mask64 + v * VEC_BYTES);
+    }
+    
+    size_t periods = count / records_per_period;
+    for (size_t p = 0; p < periods; p++) {
+        for (size_t v = 0; v < vectors; v++) {
+            Vec x = vec_load(src);
+            Vec w = vec_swap16(x);
+            Vec q = vec_rev_words(w);
+            Vec keep = vec_andnot(vec_or(m16[v], m64[v]), x);
+            vec_store(dst, vec_or(keep, vec_or(vec_and(w, m16[v]), vec_and(q, m64[v]))));
+            src += VEC_BYTES;
+            dst += VEC_BYTES;
+        }
+    }
+    
+    swap_records_scalar(dst, src, count - periods * records_per_period, layout);
+}
+#endif
+
+/* ----------------------------------------------------------------------------
+   Public API
+   ---------------------------------------------------------------------------- */
+static void swap_records(void* dst, const void* src, size_t count, const RecordLayout* layout) {
+    if (count == 0) return;
+#if CAD_CODEC_NATIVE_BIG_ENDIAN
+    memmove(dst, src, count * layout->size);
+#elif defined(CAD_CODEC_AVX2) || defined(CAD_CODEC_SSE2)
+    swap_records_simd((uint8_t*)dst, (const uint8_t*)src, count, layout);
+#else
+    swap_records_scalar((uint8_t*)dst, (const uint8_t*)src, count, layout);
+#endif
+}
+
+/* Native structs differ from the images in their link widths, so records
+   are swapped through a small buffer of images and converted field by field.
+   Decoded structs are zeroed first so their padding compares equal. */
+#define CODEC_CHUNK 128
+
+void CadCodec_DecodeObjects(CadObject* dst, const void* src, size_t count) {
+    CadObjectRecord chunk[CODEC_CHUNK];
+    const uint8_t* in = (const uint8_t*)src;
+    while (count > 0) {
+        size_t n = count < CODEC_CHUNK ? count : CODEC_CHUNK;
+        swap_records(chunk, in, n, &OBJECT_LAYOUT);
+        memset(dst, 0, n * sizeof(CadObject));
+        for (size_t i = 0; i < n; i++) {
+            const CadObjectRecord* r = &chunk[i];
+            CadObject* obj = &dst[i];
+            obj->flags = r->flags;
+            obj->selectFlag = r->selectFlag;
+            obj->parentObject = r->parentObject;
+            obj->nextBrother = r->nextBrother;
+            obj->childObject = r->childObject;
+            obj->firstPolygon = r->firstPolygon;
+            obj->offsetx = r->offsetx;
+            obj->offsety = r->offsety;
+            obj->offsetz = r->offsetz;
+        }
+        in += n * sizeof(CadObjectRecord);
+        dst += n;
+        count -= n;
+    }
+}
+
+void CadCodec_DecodePolygons(CadPolygon* dst, const void* src, size_t count) {
+    CadPolygonRecord chunk[CODEC_CHUNK];
+    const uint8_t* in = (const uint8_t*)src;
+    while (count > 0) {
+        size_t n = count < CODEC_CHUNK ? count : CODEC_CHUNK;
+        swap_records(chunk, in, n, &POLYGON_LAYOUT);
+        memset(dst, 0, n * sizeof(CadPolygon));
+        for (size_t i = 0; i < n; i++) {
+            const CadPolygonRecord* r = &chunk[i];
+            CadPolygon* poly = &dst[i];
+            poly->flags = r->flags;
+            poly->selectFlag = r->selectFlag;
+            poly->nextPolygon = r->nextPolygon;
+            poly->firstPoint = r->firstPoint;
+            poly->animation = r->animation;
+            poly->both = r->both;
+            poly->side = r->side;
+            poly->color = r->color;
+            poly->npoints = r->npoints;
+        }
+        in += n * sizeof(CadPolygonRecord);
+        dst += n;
+        count -= n;
+    }
+}
+
+void CadCodec_DecodePoints(CadPoint* dst, const void* src, size_t count) {
+    CadPointRecord chunk[CODEC_CHUNK];
+    const uint8_t* in = (const uint8_t*)src;
+    while (count > 0) {
+        size_t n = count < CODEC_CHUNK ? count : CODEC_CHUNK;
+        swap_records(chunk, in, n, &POINT_LAYOUT);
+        memset(dst, 0, n * sizeof(CadPoint));
+        for (size_t i = 0; i < n; i++) {
+            const CadPointRecord* r = &chunk[i];
+            CadPoint* pt = &dst[i];
+            pt->flags = r->flags;
+            pt->selectFlag = r->selectFlag;
+            pt->nextPoint = r->nextPoint;
+            pt->pointx = r->pointx;
+            pt->pointy = r->pointy;
+            pt->pointz = r->pointz;
+        }
+        in += n * sizeof(CadPointRecord);
+        dst += n;
+        count -= n;
+    }
+}
+
+/* Images are built in zeroed records so padding bytes are written as 0 */
+void CadCodec_EncodeObjects(void* dst, const CadObject* src, size_t count) {
+    CadObjectRecord chunk[CODEC_CHUNK];
+    uint8_t* out = (uint8_t*)dst;
+    while (count > 0) {
+        size_t n = count < CODEC_CHUNK ? count : CODEC_CHUNK;
+        memset(chunk, 0, n * sizeof(CadObjectRecord));
+        for (size_t i = 0; i < n; i++) {
+            const CadObject* obj = &src[i];
+            CadObjectRecord* r = &chunk[i];
+            r->flags = obj->flags;
+            r->selectFlag = obj->selectFlag;
+            r->parentObject = (int16_t)obj->parentObject;
+            r->nextBrother = (int16_t)obj->nextBrother;
+            r->childObject = (int16_t)obj->childObject;
+            r->firstPolygon = (int16_t)obj->firstPolygon;
+            r->offsetx = obj->offsetx;
+            r->offsety = obj->offsety;
+            r->offsetz = obj->offsetz;
+        }
+        swap_records(out, chunk, n, &OBJECT_LAYOUT);
+        out += n * sizeof(CadObjectRecord);
+        src += n;
+        count -= n;
+    }
+}
+
+void CadCodec_EncodePolygons(void* dst, const CadPolygon* src, size_t count) {
+    CadPolygonRecord chunk[CODEC_CHUNK];
+    uint8_t* out = (uint8_t*)dst;
+    while (count > 0) {
+        size_t n = count < CODEC_CHUNK ? count : CODEC_CHUNK;
+        memset(chunk, 0, n * sizeof(CadPolygonRecord));
+        for (size_t i = 0; i < n; i++) {
+            const CadPolygon* poly = &src[i];
+            CadPolygonRecord* r = &chunk[i];
+            r->flags = poly->flags;
+            r->selectFlag = poly->selectFlag;
+            r->nextPolygon = (int16_t)poly->nextPolygon;
+            r->firstPoint = (int16_t)poly->firstPoint;
+            r->animation = poly->animation;
+            r->both = (int16_t)poly->both;
+            r->side = poly->side;
+            r->color = poly->color;
+            r->npoints = poly->npoints;
+        }
+        swap_records(out, chunk, n, &POLYGON_LAYOUT);
+        out += n * sizeof(CadPolygonRecord);
+        src += n;
+        count -= n;
+    }
+}
+
+void CadCodec_EncodePoints(void* dst, const CadPoint* src, size_t count) {
+    CadPointRecord chunk[CODEC_CHUNK];
+    uint8_t* out = (uint8_t*)dst;
+    while (count > 0) {
+        size_t n = count < CODEC_CHUNK ? count : CODEC_CHUNK;
+        memset(chunk, 0, n * sizeof(CadPointRecord));
+        for (size_t i = 0; i < n; i++) {
+            const CadPoint* pt = &src[i];
+            CadPointRecord* r = &chunk[i];
+            r->flags = pt->flags;
+            r->selectFlag = pt->selectFlag;
+            r->nextPoint = (int16_t)pt->nextPoint;
+            r->pointx = pt->pointx;
+            r->pointy = pt->pointy;
+            r->pointz = pt->pointz;
+        }
+        swap_records(out, chunk, n, &POINT_LAYOUT);
+        out += n * sizeof(CadPointRecord);
+        src += n;
+        count -= n;
+    }
+}
+
+const char* CadCodec_Backend(void) {
+#if CAD_CODEC_NATIVE_BIG_ENDIAN
+    return "native";
+#elif defined(CAD_CODEC_AVX2)
+    return "avx2";
+#elif defined(CAD_CODEC_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
@@ -1,13 +1,24 @@
 #define _CRT_SECURE_NO_WARNINGS
 
 #include "cad_core.h"
+#include "cad_thread.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <stdarg.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 #define INVALID_INDEX -1
 
+static void set_journal_file(CadCore* core, const char* filename);
+static void drop_journal_base(CadCore* core);
+static void seed_selection(CadCore* core);
+static void reset_dirty_ranges(CadCore* core);
+static void note_all_changed(CadCore* core, int points, int polygons, int objects);
+
 /* ----------------------------------------------------------------------------
    Initialization and cleanup
    ---------------------------------------------------------------------------- */
@@ -25,26 +36,64 @@ void CadCore_Init(CadCore* core) {
     core->rootPolygon = INVALID_INDEX;
     core->creatingPoint = INVALID_INDEX;
     core->firstPoint = INVALID_INDEX;
-    
-    /* Initialize selection arrays to invalid */
-    for (int i = 0; i < CAD_MAX_POINTS; i++) {
-        core->selection.selectedPoints[i] = INVALID_INDEX;
-    }
-    for (int i = 0; i < CAD_MAX_POLYGONS; i++) {
-        core->selection.selectedPolygons[i] = INVALID_INDEX;
-    }
+    reset_dirty_ranges(core);
 }
 
 void CadCore_Destroy(CadCore* core) {
     if (!core) return;
+    /* The subscribers are dropped first, as they may already be gone */
+    free(core->changes.subscribers);
+    core->changes.subscribers = NULL;
+    core->changes.subscriberCount = 0;
+    core->changes.subscriberCapacity = 0;
+    CadCore_WaitSave(core);
     CadCore_Clear(core);
+    
+    CadFile_Free(&core->data);
+    CadBitset_Free(&core->selection.points);
+    CadBitset_Free(&core->selection.polygons);
+    free(core->selection.orderedPoints);
+    free(core->freeSlots.points);
+    free(core->freeSlots.polygons);
+    free(core->freeSlots.objects);
+    free(core->pointStreams.x);
+    free(core->pointStreams.y);
+    free(core->pointStreams.z);
+    free(core->pointStreams.flags);
+    free(core->pointStreams.next);
+    free(core->adjacency.owners);
+    free(core->adjacency.ownerHead);
+    free(core->adjacency.links);
+    free(core->adjacency.changing);
+    free(core->polygonVertices.offsets);
+    free(core->polygonVertices.indices);
+    memset(&core->selection, 0, sizeof(core->selection));
+    memset(&core->freeSlots, 0, sizeof(core->freeSlots));
+    memset(&core->pointStreams, 0, sizeof(core->pointStreams));
+    memset(&core->adjacency, 0, sizeof(core->adjacency));
+    memset(&core->polygonVertices, 0, sizeof(core->polygonVertices));
+    memset(&core->stats, 0, sizeof(core->stats));
 }
 
-void CadCore_Clear(CadCore* core) {
-    if (!core) return;
+/* Empty the model without notifying: the callers report the whole change
+   once, when the model is in its final state */
+static void clear_model(CadCore* core) {
+    /* A save still running would set the journal base cleared below */
+    CadCore_WaitSave(core);
+    CadBitset_Clear(&core->selection.points);
+    CadBitset_Clear(&core->selection.polygons);
+    core->selection.orderedCount = 0;
     CadFile_Clear(&core->data);
-    CadCore_ClearSelection(core);
     core->isDirty = 0;
+    core->freeSlots.valid = 0;
+    core->pointStreams.valid = 0;
+    core->adjacency.valid = 0;
+    core->polygonVertices.valid = 0;
+    core->stats.valid = 0;
+    core->journalFile[0] = '\0';
+    core->journalRecords = 0;
+    core->journalLoadedRecords = 0;
+    drop_journal_base(core);
     core->newPoint = INVALID_INDEX;
     core->newPolygon = INVALID_INDEX;
     core->rootPolygon = INVALID_INDEX;
@@ -52,6 +101,922 @@ void CadCore_Clear(CadCore* core) {
     core->firstPoint = INVALID_INDEX;
 }
 
+void CadCore_Clear(CadCore* core) {
+    if (!core) return;
+    int points = core->data.pointCount;
+    int polygons = core->data.polygonCount;
+    int objects = core->data.objectCount;
+    clear_model(core);
+    note_all_changed(core, points, polygons, objects);
+}
+
+/* ----------------------------------------------------------------------------
+   Free slot maps
+   ---------------------------------------------------------------------------- */
+
+static int lowest_bit(uint32_t word) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, word);
+    return (int)index;
+#elif defined(__GNUC__)
+    return __builtin_ctz(word);
+#else
+    int index = 0;
+    while (!(word & 1u)) {
+        word >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+static int popcount32(uint32_t word) {
+#if defined(_MSC_VER)
+    return (int)__popcnt(word);
+#elif defined(__GNUC__)
+    return __builtin_popcount(word);
+#else
+    int count = 0;
+    for (; word; word &= word - 1) count++;
+    return count;
+#endif
+}
+
+/* Take the lowest free slot (-1 if none) */
+static int slot_take(uint32_t* words, int nwords, int* low) {
+    for (int w = *low; w < nwords; w++) {
+        if (words[w]) {
+            int bit = lowest_bit(words[w]);
+            words[w] &= ~(1u << bit);
+            *low = w;
+            return w * 32 + bit;
+        }
+    }
+    *low = nwords;
+    return INVALID_INDEX;
+}
+
+static void slot_release(uint32_t* words, int* low, int index) {
+    words[index / 32] |= 1u << (index % 32);
+    if (index / 32 < *low) *low = index / 32;
+}
+
+/* Size one map for capacity slots, all marked used */
+static int reset_map(uint32_t** words, int* nwords, int* low, int capacity) {
+    int needed = CAD_SLOT_WORDS(capacity);
+    if (needed > *nwords) {
+        uint32_t* bigger = (uint32_t*)realloc(*words, (size_t)needed * sizeof(uint32_t));
+        if (!bigger) return 0;
+        *words = bigger;
+        *nwords = needed;
+    }
+    if (*nwords > 0) memset(*words, 0, (size_t)*nwords * sizeof(uint32_t));
+    *low = *nwords;
+    return 1;
+}
+
+static int rebuild_free_slots(CadCore* core) {
+    CadFreeSlots* slots = &core->freeSlots;
+    const CadFileData* data = &core->data;
+    slots->valid = 0;
+    if (!reset_map(&slots->points, &slots->pointWords, &slots->pointLow, data->pointCapacity) ||
+        !reset_map(&slots->polygons, &slots->polygonWords, &slots->polygonLow, data->polygonCapacity) ||
+        !reset_map(&slots->objects, &slots->objectWords, &slots->objectLow, data->objectCapacity)) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 0;
+    }
+    for (int i = 0; i < data->pointCapacity; i++) {
+        if (data->points[i].flags == 0) slot_release(slots->points, &slots->pointLow, i);
+    }
+    for (int i = 0; i < data->polygonCapacity; i++) {
+        if (data->polygons[i].flags == 0) slot_release(slots->polygons, &slots->polygonLow, i);
+    }
+    for (int i = 0; i < data->objectCapacity; i++) {
+        if (data->objects[i].flags == 0) slot_release(slots->objects, &slots->objectLow, i);
+    }
+    slots->valid = 1;
+    return 1;
+}
+
+static CadFreeSlots* free_slots(CadCore* core) {
+    if (!core->freeSlots.valid && !rebuild_free_slots(core)) return NULL;
+    return &core->freeSlots;
+}
+
+/* Lowest free slot of one table, growing the table when it is full */
+static int take_point_slot(CadCore* core) {
+    CadFreeSlots* slots = free_slots(core);
+    if (!slots) return INVALID_INDEX;
+    int i = slot_take(slots->points, slots->pointWords, &slots->pointLow);
+    if (i != INVALID_INDEX && i < core->data.pointCapacity) return i;
+    if (!CadFile_Reserve(&core->data, 0, 0, core->data.pointCapacity + 1) || !rebuild_free_slots(core)) {
+        return INVALID_INDEX;
+    }
+    return slot_take(slots->points, slots->pointWords, &slots->pointLow);
+}
+
+static int take_polygon_slot(CadCore* core) {
+    CadFreeSlots* slots = free_slots(core);
+    if (!slots) return INVALID_INDEX;
+    int i = slot_take(slots->polygons, slots->polygonWords, &slots->polygonLow);
+    if (i != INVALID_INDEX && i < core->data.polygonCapacity) return i;
+    if (!CadFile_Reserve(&core->data, 0, core->data.polygonCapacity + 1, 0) || !rebuild_free_slots(core)) {
+        return INVALID_INDEX;
+    }
+    return slot_take(slots->polygons, slots->polygonWords, &slots->polygonLow);
+}
+
+static int take_object_slot(CadCore* core) {
+    CadFreeSlots* slots = free_slots(core);
+    if (!slots) return INVALID_INDEX;
+    int i = slot_take(slots->objects, slots->objectWords, &slots->objectLow);
+    if (i != INVALID_INDEX && i < core->data.objectCapacity) return i;
+    if (!CadFile_Reserve(&core->data, core->data.objectCapacity + 1, 0, 0) || !rebuild_free_slots(core)) {
+        return INVALID_INDEX;
+    }
+    return slot_take(slots->objects, slots->objectWords, &slots->objectLow);
+}
+
+void CadCore_InvalidateFreeSlots(CadCore* core) {
+    if (core) core->freeSlots.valid = 0;
+}
+
+/* ----------------------------------------------------------------------------
+   Point streams
+   ---------------------------------------------------------------------------- */
+
+static int reserve_streams(CadPointStreams* streams, int capacity) {
+    if (capacity <= streams->capacity) return 1;
+    int new_capacity = streams->capacity > 0 ? streams->capacity : 64;
+    while (new_capacity < capacity) new_capacity *= 2;
+    
+    /* Each stream keeps its block if a later one fails to grow */
+    double* x = (double*)realloc(streams->x, (size_t)new_capacity * sizeof(double));
+    if (x) streams->x = x;
+    double* y = (double*)realloc(streams->y, (size_t)new_capacity * sizeof(double));
+    if (y) streams->y = y;
+    double* z = (double*)realloc(streams->z, (size_t)new_capacity * sizeof(double));
+    if (z) streams->z = z;
+    uint8_t* flags = (uint8_t*)realloc(streams->flags, (size_t)new_capacity);
+    if (flags) streams->flags = flags;
+    CadIndex* next = (CadIndex*)realloc(streams->next, (size_t)new_capacity * sizeof(CadIndex));
+    if (next) streams->next = next;
+    if (!x || !y || !z || !flags || !next) return 0;
+    
+    streams->capacity = new_capacity;
+    return 1;
+}
+
+static void store_stream_point(CadPointStreams* streams, const CadPoint* pt, int i) {
+    streams->x[i] = pt->pointx;
+    streams->y[i] = pt->pointy;
+    streams->z[i] = pt->pointz;
+    streams->flags[i] = pt->flags;
+    streams->next[i] = pt->nextPoint;
+}
+
+static int rebuild_point_streams(CadCore* core) {
+    CadPointStreams* streams = &core->pointStreams;
+    const CadFileData* data = &core->data;
+    streams->valid = 0;
+    if (!reserve_streams(streams, data->pointCount)) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 0;
+    }
+    for (int i = 0; i < data->pointCount; i++) {
+        store_stream_point(streams, &data->points[i], i);
+    }
+    streams->count = data->pointCount;
+    streams->valid = 1;
+    return 1;
+}
+
+/* Copy point i to the streams after the core changed it (and pick up any
+   slots the point table grew by) */
+static void sync_point_stream(CadCore* core, int i) {
+    CadPointStreams* streams = &core->pointStreams;
+    if (!streams->valid) return;
+    if (!reserve_streams(streams, core->data.pointCount)) {
+        streams->valid = 0;
+        return;
+    }
+    for (int k = streams->count; k < core->data.pointCount; k++) {
+        store_stream_point(streams, &core->data.points[k], k);
+    }
+    streams->count = core->data.pointCount;
+    store_stream_point(streams, &core->data.points[i], i);
+}
+
+const CadPointStreams* CadCore_GetPointStreams(CadCore* core) {
+    if (!core) return NULL;
+    if (!core->pointStreams.valid && !rebuild_point_streams(core)) return NULL;
+    return &core->pointStreams;
+}
+
+void CadCore_InvalidatePointStreams(CadCore* core) {
+    if (core) core->pointStreams.valid = 0;
+}
+
+/* ----------------------------------------------------------------------------
+   Point adjacency
+   ---------------------------------------------------------------------------- */
+
+#define CAD_WALK_MAX 64
+
+/* The points CadCore_IsPointConnected reaches from one polygon: its chain,
+   cycle-safe and capped at CAD_WALK_MAX, including a deleted point it stops
+   on (that slot counts again if a new point reuses it). *dangling is set if
+   the walk stopped at a link past the end of the point table. */
+static int polygon_walk(const CadCore* core, const CadPolygon* poly, CadIndex walk[CAD_WALK_MAX], int* dangling) {
+    int count = 0;
+    *dangling = 0;
+    if (poly->flags == 0 || poly->npoints < 2) return 0;
+    
+    CadIndex current = poly->firstPoint;
+    while (current >= 0 && current < core->data.pointCount && count < CAD_WALK_MAX) {
+        int seen = 0;
+        for (int v = 0; v < count; v++) {
+            if (walk[v] == current) {
+                seen = 1;
+                break;
+            }
+        }
+        if (seen) break;
+        walk[count++] = current;
+        
+        const CadPoint* pt = &core->data.points[current];
+        if (pt->flags == 0) break;
+        current = pt->nextPoint;
+    }
+    if (count < CAD_WALK_MAX && current >= core->data.pointCount) *dangling = 1;
+    return count;
+}
+
+static int reserve_owners(CadPointAdjacency* adjacency, int capacity) {
+    if (capacity <= adjacency->capacity) return 1;
+    int grown = adjacency->capacity > 0 ? adjacency->capacity : 64;
+    while (grown < capacity) grown *= 2;
+    int32_t* owners = (int32_t*)realloc(adjacency->owners, (size_t)grown * sizeof(int32_t));
+    if (owners) adjacency->owners = owners;
+    int32_t* ownerHead = (int32_t*)realloc(adjacency->ownerHead, (size_t)grown * sizeof(int32_t));
+    if (ownerHead) adjacency->ownerHead = ownerHead;
+    if (!owners || !ownerHead) return 0;
+    memset(owners + adjacency->capacity, 0, (size_t)(grown - adjacency->capacity) * sizeof(int32_t));
+    for (int i = adjacency->capacity; i < grown; i++) ownerHead[i] = -1;
+    adjacency->capacity = grown;
+    return 1;
+}
+
+/* List polygonIndex as reaching pointIndex */
+static int owner_link(CadPointAdjacency* adjacency, CadIndex pointIndex, CadIndex polygonIndex) {
+    int link = adjacency->freeLink;
+    if (link >= 0) {
+        adjacency->freeLink = adjacency->links[link].next;
+    } else {
+        if (adjacency->linkCount == adjacency->linkCapacity) {
+            int grown = adjacency->linkCapacity > 0 ? adjacency->linkCapacity * 2 : 256;
+            CadOwnerLink* links = (CadOwnerLink*)realloc(adjacency->links, (size_t)grown * sizeof(CadOwnerLink));
+            if (!links) return 0;
+            adjacency->links = links;
+            adjacency->linkCapacity = grown;
+        }
+        link = adjacency->linkCount++;
+    }
+    adjacency->links[link].polygon = polygonIndex;
+    adjacency->links[link].next = adjacency->ownerHead[pointIndex];
+    adjacency->ownerHead[pointIndex] = link;
+    return 1;
+}
+
+static void owner_unlink(CadPointAdjacency* adjacency, CadIndex pointIndex, CadIndex polygonIndex) {
+    int32_t* at = &adjacency->ownerHead[pointIndex];
+    while (*at >= 0 && adjacency->links[*at].polygon != polygonIndex) {
+        at = &adjacency->links[*at].next;
+    }
+    if (*at < 0) return;
+    int link = *at;
+    *at = adjacency->links[link].next;
+    adjacency->links[link].next = adjacency->freeLink;
+    adjacency->freeLink = link;
+}
+
+/* Count (delta = 1) or uncount (delta = -1) one polygon's walk */
+static void adjacency_apply(CadCore* core, CadIndex polygonIndex, int delta) {
+    CadPointAdjacency* adjacency = &core->adjacency;
+    if (!adjacency->valid) return;
+    
+    const CadPolygon* poly = &core->data.polygons[polygonIndex];
+    CadIndex walk[CAD_WALK_MAX];
+    int dangling;
+    int count = polygon_walk(core, poly, walk, &dangling);
+    for (int i = 0; i < count; i++) {
+        adjacency->owners[walk[i]] += delta;
+        if (delta < 0) {
+            owner_unlink(adjacency, walk[i], polygonIndex);
+        } else if (!owner_link(adjacency, walk[i], polygonIndex)) {
+            adjacency->valid = 0;
+            return;
+        }
+    }
+    adjacency->danglingWalks += dangling * delta;
+    if (poly->flags != 0 && poly->npoints > CAD_WALK_MAX) adjacency->longPolygons += delta;
+}
+
+static int rebuild_adjacency(CadCore* core) {
+    CadPointAdjacency* adjacency = &core->adjacency;
+    adjacency->valid = 0;
+    if (!reserve_owners(adjacency, core->data.pointCount)) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 0;
+    }
+    if (adjacency->capacity > 0) {
+        memset(adjacency->owners, 0, (size_t)adjacency->capacity * sizeof(int32_t));
+        memset(adjacency->ownerHead, 0xff, (size_t)adjacency->capacity * sizeof(int32_t));
+    }
+    adjacency->linkCount = 0;
+    adjacency->freeLink = -1;
+    adjacency->danglingWalks = 0;
+    adjacency->longPolygons = 0;
+    adjacency->valid = 1;
+    for (int i = 0; i < core->data.polygonCount; i++) {
+        adjacency_apply(core, (CadIndex)i, 1);
+    }
+    if (!adjacency->valid) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 0;
+    }
+    return 1;
+}
+
+/* The point table grew to pointCount slots */
+static void adjacency_points_added(CadCore* core) {
+    CadPointAdjacency* adjacency = &core->adjacency;
+    if (!adjacency->valid) return;
+    if (adjacency->danglingWalks > 0 || !reserve_owners(adjacency, core->data.pointCount)) {
+        adjacency->valid = 0;
+    }
+}
+
+void CadCore_InvalidateAdjacency(CadCore* core) {
+    if (core) core->adjacency.valid = 0;
+}
+
+/* ----------------------------------------------------------------------------
+   Polygon vertices
+   ---------------------------------------------------------------------------- */
+
+#define CAD_POLYGON_POINTS_MAX 256 /* npoints is 8-bit */
+
+/* One polygon's points in order: its chain from firstPoint, at most npoints
+   of them, up to a deleted point, a link past the point table or a point
+   already taken. Like the adjacency walk it skips polygons of fewer than two
+   points, which are not faces. */
+static int polygon_vertex_walk(const CadCore* core, const CadPolygon* poly, CadIndex walk[CAD_POLYGON_POINTS_MAX]) {
+    int count = 0;
+    if (poly->flags == 0 || poly->npoints < 2) return 0;
+    
+    CadIndex current = poly->firstPoint;
+    while (current >= 0 && current < core->data.pointCount && count < poly->npoints) {
+        const CadPoint* pt = &core->data.points[current];
+        if (pt->flags == 0) break;
+        
+        int seen = 0;
+        for (int v = 0; v < count; v++) {
+            if (walk[v] == current) {
+                seen = 1;
+                break;
+            }
+        }
+        if (seen) break;
+        walk[count++] = current;
+        current = pt->nextPoint;
+    }
+    return count;
+}
+
+static int reserve_vertex_offsets(CadPolygonVertices* vertices, int polygons) {
+    if (polygons + 1 <= vertices->offsetCapacity) return 1;
+    int grown = vertices->offsetCapacity > 0 ? vertices->offsetCapacity : 64;
+    while (grown < polygons + 1) grown *= 2;
+    int32_t* bigger = (int32_t*)realloc(vertices->offsets, (size_t)grown * sizeof(int32_t));
+    if (!bigger) return 0;
+    vertices->offsets = bigger;
+    vertices->offsetCapacity = grown;
+    return 1;
+}
+
+static int reserve_vertex_indices(CadPolygonVertices* vertices, int count) {
+    if (count <= vertices->indexCapacity) return 1;
+    int grown = vertices->indexCapacity > 0 ? vertices->indexCapacity : 256;
+    while (grown < count) grown *= 2;
+    CadIndex* bigger = (CadIndex*)realloc(vertices->indices, (size_t)grown * sizeof(CadIndex));
+    if (!bigger) return 0;
+    vertices->indices = bigger;
+    vertices->indexCapacity = grown;
+    return 1;
+}
+
+static int rebuild_polygon_vertices(CadCore* core) {
+    CadPolygonVertices* vertices = &core->polygonVertices;
+    vertices->valid = 0;
+    
+    int total = 0;
+    for (int i = 0; i < core->data.polygonCount; i++) {
+        const CadPolygon* poly = &core->data.polygons[i];
+        if (poly->flags != 0) total += poly->npoints;
+    }
+    if (!reserve_vertex_offsets(vertices, core->data.polygonCount) ||
+        !reserve_vertex_indices(vertices, total)) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 0;
+    }
+    
+    int used = 0;
+    for (int i = 0; i < core->data.polygonCount; i++) {
+        vertices->offsets[i] = used;
+        used += polygon_vertex_walk(core, &core->data.polygons[i], vertices->indices + used);
+    }
+    vertices->offsets[core->data.polygonCount] = used;
+    vertices->polygonCount = core->data.polygonCount;
+    vertices->valid = 1;
+    return 1;
+}
+
+/* Walk one polygon again into its slice, moving the slices after it when
+   its length changes */
+static void polygon_vertices_changed(CadCore* core, CadIndex polygonIndex) {
+    CadPolygonVertices* vertices = &core->polygonVertices;
+    if (!vertices->valid) return;
+    
+    if (polygonIndex >= vertices->polygonCount) {
+        if (!reserve_vertex_offsets(vertices, polygonIndex + 1)) {
+            vertices->valid = 0;
+            core->stats.unmergedValid = 0;
+            return;
+        }
+        int end = vertices->offsets[vertices->polygonCount];
+        for (int i = vertices->polygonCount + 1; i <= polygonIndex + 1; i++) {
+            vertices->offsets[i] = end;
+        }
+        vertices->polygonCount = polygonIndex + 1;
+    }
+    
+    CadIndex walk[CAD_POLYGON_POINTS_MAX];
+    int count = polygon_vertex_walk(core, &core->data.polygons[polygonIndex], walk);
+    int start = vertices->offsets[polygonIndex];
+    int old_end = vertices->offsets[polygonIndex + 1];
+    int total = vertices->offsets[vertices->polygonCount];
+    int shift = count - (old_end - start);
+    
+    if (shift != 0) {
+        if (!reserve_vertex_indices(vertices, total + shift)) {
+            vertices->valid = 0;
+            core->stats.unmergedValid = 0;
+            return;
+        }
+        memmove(vertices->indices + old_end + shift, vertices->indices + old_end,
+                (size_t)(total - old_end) * sizeof(CadIndex));
+        for (int i = polygonIndex + 1; i <= vertices->polygonCount; i++) {
+            vertices->offsets[i] += shift;
+        }
+    }
+    memcpy(vertices->indices + start, walk, (size_t)count * sizeof(CadIndex));
+}
+
+const CadPolygonVertices* CadCore_GetPolygonVertices(CadCore* core) {
+    if (!core) return NULL;
+    if (!core->polygonVertices.valid && !rebuild_polygon_vertices(core)) return NULL;
+    return &core->polygonVertices;
+}
+
+const CadIndex* CadCore_GetPolygonPoints(CadCore* core, CadIndex polygonIndex, int* count) {
+    *count = 0;
+    if (!core || polygonIndex < 0 || polygonIndex >= core->data.polygonCount) return NULL;
+    
+    const CadPolygonVertices* vertices = CadCore_GetPolygonVertices(core);
+    if (!vertices) return NULL;
+    *count = vertices->offsets[polygonIndex + 1] - vertices->offsets[polygonIndex];
+    return vertices->indices + vertices->offsets[polygonIndex];
+}
+
+void CadCore_InvalidatePolygonVertices(CadCore* core) {
+    if (core) core->polygonVertices.valid = 0;
+}
+
+/* ----------------------------------------------------------------------------
+   Model statistics
+   ---------------------------------------------------------------------------- */
+
+static int on_grid(double x, double y, double z);
+
+/* Count (delta = 1) or uncount (delta = -1) one live point */
+static void stats_point(CadCore* core, CadIndex pointIndex, int delta) {
+    CadModelStats* stats = &core->stats;
+    if (!stats->valid) return;
+    
+    const CadPoint* pt = &core->data.points[pointIndex];
+    stats->points += delta;
+    if (!on_grid(pt->pointx, pt->pointy, pt->pointz)) stats->offGridPoints += delta;
+}
+
+static void stats_polygon(CadCore* core, CadIndex polygonIndex, int delta) {
+    CadModelStats* stats = &core->stats;
+    if (!stats->valid) return;
+    
+    stats->polygons += delta;
+    if (stats->unmergedValid && !CadCore_IsPolygonMerged(core, polygonIndex)) {
+        stats->unmergedPolygons += delta;
+    }
+}
+
+static void stats_object(CadCore* core, CadIndex objectIndex, int delta) {
+    CadModelStats* stats = &core->stats;
+    if (!stats->valid) return;
+    
+    const CadObject* obj = &core->data.objects[objectIndex];
+    stats->objects += delta;
+    if (!on_grid(obj->offsetx, obj->offsety, obj->offsetz)) stats->offGridObjects += delta;
+}
+
+static void recount_unmerged(CadCore* core) {
+    CadModelStats* stats = &core->stats;
+    
+    /* Keep the adjacency current too, so later point edits can tell whether
+       they touch a polygon */
+    if (!core->adjacency.valid) rebuild_adjacency(core);
+    
+    stats->unmergedPolygons = 0;
+    for (int i = 0; i < core->data.polygonCount; i++) {
+        if (core->data.polygons[i].flags == 0) continue;
+        if (!CadCore_IsPolygonMerged(core, (CadIndex)i)) stats->unmergedPolygons++;
+    }
+    stats->unmergedValid = 1;
+}
+
+static void rebuild_stats(CadCore* core) {
+    CadModelStats* stats = &core->stats;
+    memset(stats, 0, sizeof(CadModelStats));
+    stats->valid = 1;
+    
+    for (int i = 0; i < core->data.pointCount; i++) {
+        if (core->data.points[i].flags != 0) stats_point(core, (CadIndex)i, 1);
+    }
+    for (int i = 0; i < core->data.polygonCount; i++) {
+        if (core->data.polygons[i].flags != 0) stats_polygon(core, (CadIndex)i, 1);
+    }
+    for (int i = 0; i < core->data.objectCount; i++) {
+        if (core->data.objects[i].flags != 0) stats_object(core, (CadIndex)i, 1);
+    }
+    recount_unmerged(core);
+}
+
+const CadModelStats* CadCore_GetModelStats(CadCore* core) {
+    if (!core) return NULL;
+    
+    if (!core->stats.valid) {
+        rebuild_stats(core);
+    } else if (!core->stats.unmergedValid) {
+        recount_unmerged(core);
+    }
+    return &core->stats;
+}
+
+void CadCore_InvalidateModelStats(CadCore* core) {
+    if (core) core->stats.valid = 0;
+}
+
+/* ----------------------------------------------------------------------------
+   Change tracking
+   ---------------------------------------------------------------------------- */
+
+static void reset_dirty_ranges(CadCore* core) {
+    for (int kind = 0; kind < CAD_CHANGE_KINDS; kind++) {
+        core->changes.ranges[kind].dirtyFirst = INVALID_INDEX;
+        core->changes.ranges[kind].dirtyLast = INVALID_INDEX;
+        core->batch.pendingFirst[kind] = INVALID_INDEX;
+        core->batch.pendingLast[kind] = INVALID_INDEX;
+    }
+}
+
+static void note_change(CadCore* core, CadChangeKind kind, CadIndex first, CadIndex last) {
+    CadBatch* batch = &core->batch;
+    if (batch->depth > 0) {
+        /* Reported once, by CadCore_CommitBatch */
+        if (batch->pendingFirst[kind] == INVALID_INDEX || first < batch->pendingFirst[kind]) batch->pendingFirst[kind] = first;
+        if (batch->pendingLast[kind] == INVALID_INDEX || last > batch->pendingLast[kind]) batch->pendingLast[kind] = last;
+        return;
+    }
+    
+    CadChangeRange* range = &core->changes.ranges[kind];
+    range->generation++;
+    if (range->dirtyFirst == INVALID_INDEX || first < range->dirtyFirst) range->dirtyFirst = first;
+    if (range->dirtyLast == INVALID_INDEX || last > range->dirtyLast) range->dirtyLast = last;
+    
+    for (int i = 0; i < core->changes.subscriberCount; i++) {
+        CadChangeSubscriber* sub = &core->changes.subscribers[i];
+        sub->func(sub->user, kind, first, last);
+    }
+}
+
+/* Every table at once, for operations that replace the whole model; the
+   counts are the slots each table had before or has now, whichever is more */
+static void note_all_changed(CadCore* core, int points, int polygons, int objects) {
+    if (core->data.pointCount > points) points = core->data.pointCount;
+    if (core->data.polygonCount > polygons) polygons = core->data.polygonCount;
+    if (core->data.objectCount > objects) objects = core->data.objectCount;
+    if (points > 0) {
+        note_change(core, CAD_CHANGE_POINTS, 0, points - 1);
+        note_change(core, CAD_CHANGE_POINT_SELECTION, 0, points - 1);
+    }
+    if (polygons > 0) {
+        note_change(core, CAD_CHANGE_POLYGONS, 0, polygons - 1);
+        note_change(core, CAD_CHANGE_POLYGON_SELECTION, 0, polygons - 1);
+    }
+    if (objects > 0) note_change(core, CAD_CHANGE_OBJECTS, 0, objects - 1);
+}
+
+uint32_t CadCore_GetGeneration(CadCore* core, CadChangeKind kind) {
+    if (!core || kind < 0 || kind >= CAD_CHANGE_KINDS) return 0;
+    return core->changes.ranges[kind].generation;
+}
+
+int CadCore_GetDirtyRange(CadCore* core, CadChangeKind kind, CadIndex* first, CadIndex* last) {
+    if (!core || kind < 0 || kind >= CAD_CHANGE_KINDS) return 0;
+    const CadChangeRange* range = &core->changes.ranges[kind];
+    if (first) *first = range->dirtyFirst;
+    if (last) *last = range->dirtyLast;
+    return range->dirtyFirst != INVALID_INDEX;
+}
+
+void CadCore_ClearDirtyRange(CadCore* core, CadChangeKind kind) {
+    if (!core || kind < 0 || kind >= CAD_CHANGE_KINDS) return;
+    core->changes.ranges[kind].dirtyFirst = INVALID_INDEX;
+    core->changes.ranges[kind].dirtyLast = INVALID_INDEX;
+}
+
+int CadCore_Subscribe(CadCore* core, CadChangeFunc func, void* user) {
+    if (!core || !func) return 0;
+    CadChangeLog* changes = &core->changes;
+    
+    if (changes->subscriberCount >= changes->subscriberCapacity) {
+        int grown = changes->subscriberCapacity > 0 ? changes->subscriberCapacity * 2 : 4;
+        CadChangeSubscriber* bigger = (CadChangeSubscriber*)realloc(changes->subscribers,
+                                                                    (size_t)grown * sizeof(CadChangeSubscriber));
+        if (!bigger) return 0;
+        changes->subscribers = bigger;
+        changes->subscriberCapacity = grown;
+    }
+    
+    CadChangeSubscriber* sub = &changes->subscribers[changes->subscriberCount++];
+    sub->func = func;
+    sub->user = user;
+    sub->id = ++changes->nextId;
+    return sub->id;
+}
+
+void CadCore_Unsubscribe(CadCore* core, int id) {
+    if (!core || id <= 0) return;
+    CadChangeLog* changes = &core->changes;
+    
+    for (int i = 0; i < changes->subscriberCount; i++) {
+        if (changes->subscribers[i].id == id) {
+            memmove(&changes->subscribers[i], &changes->subscribers[i + 1],
+                    (size_t)(changes->subscriberCount - i - 1) * sizeof(CadChangeSubscriber));
+            changes->subscriberCount--;
+            return;
+        }
+    }
+}
+
+void CadCore_NotifyChange(CadCore* core, CadChangeKind kind, CadIndex first, CadIndex last) {
+    if (!core || kind < 0 || kind >= CAD_CHANGE_KINDS) return;
+    if (first < 0 || last < first) return;
+    note_change(core, kind, first, last);
+}
+
+/* ----------------------------------------------------------------------------
+   Batched edits
+   ---------------------------------------------------------------------------- */
+
+void CadCore_BeginBatch(CadCore* core) {
+    if (!core) return;
+    CadBatch* batch = &core->batch;
+    if (batch->depth++ > 0) return;
+    
+    /* Left invalid, the per-record updates become no-ops */
+    batch->streamsValid = core->pointStreams.valid;
+    batch->adjacencyValid = core->adjacency.valid;
+    batch->verticesValid = core->polygonVertices.valid;
+    batch->statsValid = core->stats.valid;
+    core->pointStreams.valid = 0;
+    core->adjacency.valid = 0;
+    core->polygonVertices.valid = 0;
+    core->stats.valid = 0;
+}
+
+void CadCore_CommitBatch(CadCore* core) {
+    if (!core || core->batch.depth <= 0) return;
+    CadBatch* batch = &core->batch;
+    if (--batch->depth > 0) return;
+    
+    /* A query during the batch may have rebuilt an index already */
+    if (batch->streamsValid && !core->pointStreams.valid) rebuild_point_streams(core);
+    if (batch->adjacencyValid && !core->adjacency.valid) rebuild_adjacency(core);
+    if (batch->verticesValid && !core->polygonVertices.valid) rebuild_polygon_vertices(core);
+    if (batch->statsValid && !core->stats.valid) rebuild_stats(core);
+    
+    for (int kind = 0; kind < CAD_CHANGE_KINDS; kind++) {
+        CadIndex first = batch->pendingFirst[kind];
+        CadIndex last = batch->pendingLast[kind];
+        if (first == INVALID_INDEX) continue;
+        batch->pendingFirst[kind] = INVALID_INDEX;
+        batch->pendingLast[kind] = INVALID_INDEX;
+        note_change(core, (CadChangeKind)kind, first, last);
+    }
+}
+
+int CadCore_IsBatching(CadCore* core) {
+    return core && core->batch.depth > 0;
+}
+
+/* ----------------------------------------------------------------------------
+   Point edits
+   ---------------------------------------------------------------------------- */
+
+/* A point's position (relink = 0) or its link or flags (relink = 1) are
+   about to change, and with them the merge state and, for a relink, the walk
+   and vertices of the polygons reaching it. Those polygons are uncounted
+   here and kept for point_changed to count again; the number kept is
+   returned for it. */
+static int point_changing(CadCore* core, CadIndex pointIndex, int relink) {
+    CadPointAdjacency* adjacency = &core->adjacency;
+    CadModelStats* stats = &core->stats;
+    
+    /* Without the adjacency, or with a polygon longer than its walk, the
+       point may be reached unseen */
+    if (!adjacency->valid || adjacency->longPolygons > 0) {
+        stats->unmergedValid = 0;
+        if (relink) core->polygonVertices.valid = 0;
+        if (!adjacency->valid) return 0;
+    }
+    int count = adjacency->owners[pointIndex];
+    if (count == 0) return 0;
+    if (count > adjacency->changingCapacity) {
+        CadIndex* changing = (CadIndex*)realloc(adjacency->changing, (size_t)count * sizeof(CadIndex));
+        if (!changing) {
+            stats->unmergedValid = 0;
+            if (relink) {
+                adjacency->valid = 0;
+                core->polygonVertices.valid = 0;
+            }
+            return 0;
+        }
+        adjacency->changing = changing;
+        adjacency->changingCapacity = count;
+    }
+    
+    /* Copy the list first: uncounting a polygon unlinks it */
+    int n = 0;
+    for (int link = adjacency->ownerHead[pointIndex]; link >= 0; link = adjacency->links[link].next) {
+        adjacency->changing[n++] = adjacency->links[link].polygon;
+    }
+    for (int i = 0; i < n; i++) {
+        stats_polygon(core, adjacency->changing[i], -1);
+        if (relink) adjacency_apply(core, adjacency->changing[i], -1);
+    }
+    return n;
+}
+
+static void point_changed(CadCore* core, int owners, int relink) {
+    CadPointAdjacency* adjacency = &core->adjacency;
+    for (int i = 0; i < owners; i++) {
+        CadIndex owner = adjacency->changing[i];
+        if (relink) {
+            adjacency_apply(core, owner, 1);
+            polygon_vertices_changed(core, owner);
+        }
+        stats_polygon(core, owner, 1);
+    }
+}
+
+/* The point table is about to grow: walks stopped by a link past its end
+   may now go on */
+static void points_adding(CadCore* core) {
+    if (!core->adjacency.valid || core->adjacency.danglingWalks > 0) {
+        core->stats.unmergedValid = 0;
+        core->polygonVertices.valid = 0;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   Index sets
+   ---------------------------------------------------------------------------- */
+
+void CadBitset_Init(CadBitset* set) {
+    if (set) memset(set, 0, sizeof(CadBitset));
+}
+
+void CadBitset_Free(CadBitset* set) {
+    if (!set) return;
+    free(set->words);
+    memset(set, 0, sizeof(CadBitset));
+}
+
+void CadBitset_Clear(CadBitset* set) {
+    if (!set || set->count == 0) return;
+    memset(set->words, 0, (size_t)set->wordCount * sizeof(uint32_t));
+    set->count = 0;
+}
+
+static int reserve_bits(CadBitset* set, int words) {
+    if (words <= set->wordCount) return 1;
+    int grown = set->wordCount > 0 ? set->wordCount : 2;
+    while (grown < words) grown *= 2;
+    uint32_t* bigger = (uint32_t*)realloc(set->words, (size_t)grown * sizeof(uint32_t));
+    if (!bigger) return 0;
+    memset(bigger + set->wordCount, 0, (size_t)(grown - set->wordCount) * sizeof(uint32_t));
+    set->words = bigger;
+    set->wordCount = grown;
+    return 1;
+}
+
+int CadBitset_Test(const CadBitset* set, CadIndex index) {
+    if (!set || index < 0 || index / 32 >= set->wordCount) return 0;
+    return (set->words[index / 32] >> (index % 32)) & 1u;
+}
+
+int CadBitset_Set(CadBitset* set, CadIndex index) {
+    if (!set || index < 0 || !reserve_bits(set, index / 32 + 1)) return 0;
+    uint32_t bit = 1u << (index % 32);
+    if (set->words[index / 32] & bit) return 0;
+    set->words[index / 32] |= bit;
+    set->count++;
+    return 1;
+}
+
+int CadBitset_Reset(CadBitset* set, CadIndex index) {
+    if (!CadBitset_Test(set, index)) return 0;
+    set->words[index / 32] &= ~(1u << (index % 32));
+    set->count--;
+    return 1;
+}
+
+int CadBitset_Count(const CadBitset* set) {
+    return set ? set->count : 0;
+}
+
+int CadBitset_Union(CadBitset* dst, const CadBitset* src) {
+    if (!dst || !src) return 0;
+    int words = src->wordCount;
+    while (words > 0 && src->words[words - 1] == 0) words--;
+    if (!reserve_bits(dst, words)) return 0;
+    for (int w = 0; w < words; w++) {
+        uint32_t added = src->words[w] & ~dst->words[w];
+        dst->words[w] |= added;
+        dst->count += popcount32(added);
+    }
+    return 1;
+}
+
+void CadBitset_Intersect(CadBitset* dst, const CadBitset* src) {
+    if (!dst || !src) return;
+    for (int w = 0; w < dst->wordCount; w++) {
+        uint32_t removed = dst->words[w] & ~(w < src->wordCount ? src->words[w] : 0u);
+        dst->words[w] &= ~removed;
+        dst->count -= popcount32(removed);
+    }
+}
+
+int CadBitset_Invert(CadBitset* set, int size) {
+    if (!set || size <= 0) return set != NULL;
+    if (!reserve_bits(set, (size + 31) / 32)) return 0;
+    for (int w = 0; w < size / 32; w++) {
+        set->count += 32 - 2 * popcount32(set->words[w]);
+        set->words[w] = ~set->words[w];
+    }
+    if (size % 32) {
+        uint32_t mask = (1u << (size % 32)) - 1u;
+        uint32_t* word = &set->words[size / 32];
+        set->count += popcount32(mask) - 2 * popcount32(*word & mask);
+        *word ^= mask;
+    }
+    return 1;
+}
+
+CadIndex CadBitset_Next(const CadBitset* set, CadIndex from) {
+    if (!set) return INVALID_INDEX;
+    if (from < 0) from = 0;
+    int w = from / 32;
+    if (w >= set->wordCount) return INVALID_INDEX;
+    uint32_t word = set->words[w] & (~0u << (from % 32));
+    for (;;) {
+        if (word) return w * 32 + lowest_bit(word);
+        if (++w >= set->wordCount) return INVALID_INDEX;
+        word = set->words[w];
+    }
+}
+
 /* ----------------------------------------------------------------------------
    File operations
    ---------------------------------------------------------------------------- */
@@ -59,12 +1024,29 @@ void CadCore_Clear(CadCore* core) {
 int CadCore_LoadFile(CadCore* core, const char* filename) {
     if (!core || !filename) return 0;
     
-    CadCore_Clear(core);
+    /* Clearing finishes a save in flight first, or it would later make the
+       saved file's snapshot the journal base of the one loaded here */
+    int points = core->data.pointCount;
+    int polygons = core->data.polygonCount;
+    int objects = core->data.objectCount;
+    clear_model(core);
     
-    if (!CadFile_Load(filename, &core->data)) {
+    int loaded = CadFile_Load(filename, &core->data);
+    CadCore_InvalidateFreeSlots(core);
+    CadCore_InvalidatePointStreams(core);
+    CadCore_InvalidateAdjacency(core);
+    CadCore_InvalidatePolygonVertices(core);
+    CadCore_InvalidateModelStats(core);
+    seed_selection(core);
+    note_all_changed(core, points, polygons, objects);
+    if (!loaded) {
         return 0;
     }
     
+    /* Only journals this core appends to are compacted, so loading (e.g. for
+       an audit or a conversion) never rewrites the file */
+    set_journal_file(core, filename);
+    core->journalLoadedRecords = core->data.journalRecords;
     core->isDirty = 0;
     return 1;
 }
@@ -72,66 +1054,354 @@ int CadCore_LoadFile(CadCore* core, const char* filename) {
 int CadCore_SaveFile(CadCore* core, const char* filename) {
     if (!core || !filename) return 0;
     
-    if (!CadFile_Save(filename, &core->data)) {
+    /* Don't race a background save to the same file */
+    CadCore_WaitSave(core);
+    
+    if (!CadFile_SaveEx(filename, &core->data, core->data.format)) {
         return 0;
     }
     
+    set_journal_file(core, filename);
     core->isDirty = 0;
     return 1;
 }
 
+/* ----------------------------------------------------------------------------
+   Journaled saves
+   ---------------------------------------------------------------------------- */
+
+/* Remember that filename holds the model, so the next save can append a
+   diff. The base it diffs against is only read back when an incremental
+   save needs it: loads for conversions and audits never journal, and
+   should not hold a second copy of the model. */
+static void set_journal_file(CadCore* core, const char* filename) {
+    core->journalRecords = 0;
+    core->journalLoadedRecords = 0;
+    drop_journal_base(core);
+    if (strlen(filename) >= sizeof(core->journalFile)) {
+        core->journalFile[0] = '\0';
+        return;
+    }
+    strcpy(core->journalFile, filename);
+}
+
+static void drop_journal_base(CadCore* core) {
+    if (!core->journalBase) return;
+    CadFile_Free(core->journalBase);
+    free(core->journalBase);
+    core->journalBase = NULL;
+}
+
+/* Read journalFile back as the base (0 if it could not be) */
+static int load_journal_base(CadCore* core) {
+    if (core->journalBase) return 1;
+    
+    CadFileData* base = (CadFileData*)malloc(sizeof(CadFileData));
+    if (!base) return 0;
+    CadFile_Init(base);
+    if (!CadFile_Load(core->journalFile, base)) {
+        CadFile_Free(base);
+        free(base);
+        return 0;
+    }
+    core->journalBase = base;
+    return 1;
+}
+
+static int live_record_count(const CadFileData* data) {
+    int count = 0;
+    for (int i = 0; i < data->objectCount; i++) if (data->objects[i].flags != 0) count++;
+    for (int i = 0; i < data->polygonCount; i++) if (data->polygons[i].flags != 0) count++;
+    for (int i = 0; i < data->pointCount; i++) if (data->points[i].flags != 0) count++;
+    return count;
+}
+
+int CadCore_SaveFileIncremental(CadCore* core, const char* filename) {
+    if (!core || !filename) return 0;
+    
+    CadCore_WaitSave(core);
+    
+    /* Journal records have 16-bit indices, so larger models are saved whole */
+    if (core->journalFile[0] == '\0' || strcmp(core->journalFile, filename) != 0 ||
+        !CadFile_FitsLegacy(&core->data) || !load_journal_base(core) ||
+        !CadFile_FitsLegacy(core->journalBase)) {
+        return CadCore_SaveFile(core, filename);
+    }
+    
+    int appended = CadFile_AppendJournal(filename, core->journalBase, &core->data);
+    if (appended < 0) {
+        return 0;
+    }
+    
+    if (!CadFile_Copy(core->journalBase, &core->data)) {
+        /* Base unknown - read it back before the next append */
+        drop_journal_base(core);
+    }
+    core->journalRecords += appended;
+    core->isDirty = 0;
+    
+    /* Replaying more records than a full save would write costs more than it saves */
+    if (core->journalRecords + core->journalLoadedRecords > live_record_count(&core->data)) {
+        CadCore_CompactFile(core);
+    }
+    return 1;
+}
+
+int CadCore_CompactFile(CadCore* core) {
+    if (!core) return 0;
+    
+    CadCore_WaitSave(core);
+    
+    if (core->journalFile[0] == '\0' || core->journalRecords == 0) {
+        return 1;
+    }
+    if (!load_journal_base(core) ||
+        !CadFile_SaveEx(core->journalFile, core->journalBase, core->journalBase->format)) {
+        return 0;
+    }
+    core->journalRecords = 0;
+    core->journalLoadedRecords = 0;
+    return 1;
+}
+
+/* ----------------------------------------------------------------------------
+   Background save
+   ---------------------------------------------------------------------------- */
+
+struct CadSaveJob {
+    CadThread* thread;
+    CadMutex* lock;
+    int finished;            /* Set by the worker under lock */
+    int result;              /* 1 = file replaced */
+    char filename[520];
+    CadFileData snapshot;    /* Model as it was when the save started */
+};
+
+static void save_job_run(void* arg) {
+    CadSaveJob* job = (CadSaveJob*)arg;
+    
+    int result = CadFile_SaveEx(job->filename, &job->snapshot, job->snapshot.format);
+    
+    CadMutex_Lock(job->lock);
+    job->result = result;
+    job->finished = 1;
+    CadMutex_Unlock(job->lock);
+}
+
+static void save_job_free(CadSaveJob* job) {
+    if (!job) return;
+    CadMutex_Destroy(job->lock);
+    CadFile_Free(&job->snapshot);
+    free(job);
+}
+
+/* Join the finished worker and apply its result to the core */
+static CadSaveStatus save_job_finish(CadCore* core) {
+    CadSaveJob* job = core->saveJob;
+    CadThread_Join(job->thread);
+    
+    CadSaveStatus status = job->result ? CAD_SAVE_SUCCEEDED : CAD_SAVE_FAILED;
+    
+    /* Only clear the dirty flag if nothing was edited while the worker ran */
+    if (job->result && CadFile_Equal(&job->snapshot, &core->data)) {
+        core->isDirty = 0;
+    }
+    if (job->result) {
+        set_journal_file(core, job->filename);
+        
+        /* The snapshot is what the file now holds: keep it as the base
+           instead of reading the file back */
+        CadFileData* base = (CadFileData*)malloc(sizeof(CadFileData));
+        if (base && core->journalFile[0] != '\0') {
+            *base = job->snapshot;
+            CadFile_Init(&job->snapshot);
+            core->journalBase = base;
+        } else {
+            free(base);
+        }
+    }
+    
+    core->saveJob = NULL;
+    save_job_free(job);
+    return status;
+}
+
+int CadCore_BeginSaveFile(CadCore* core, const char* filename) {
+    if (!core || !filename) return 0;
+    
+    /* One save at a time - finish the previous one first */
+    CadCore_WaitSave(core);
+    
+    if (strlen(filename) >= sizeof(((CadSaveJob*)0)->filename)) {
+        fprintf(stderr, "Error: File name too long: '%s'\n", filename);
+        return 0;
+    }
+    
+    CadSaveJob* job = (CadSaveJob*)calloc(1, sizeof(CadSaveJob));
+    if (!job) return 0;
+    
+    CadFile_Init(&job->snapshot);
+    job->lock = CadMutex_Create();
+    if (!job->lock || !CadFile_Copy(&job->snapshot, &core->data)) {
+        save_job_free(job);
+        return 0;
+    }
+    strcpy(job->filename, filename);
+    
+    job->thread = CadThread_Create(save_job_run, job);
+    if (!job->thread) {
+        save_job_free(job);
+        /* Fall back to saving on this thread */
+        return CadCore_SaveFile(core, filename);
+    }
+    
+    core->saveJob = job;
+    return 1;
+}
+
+CadSaveStatus CadCore_PollSave(CadCore* core) {
+    if (!core || !core->saveJob) return CAD_SAVE_IDLE;
+    
+    CadMutex_Lock(core->saveJob->lock);
+    int finished = core->saveJob->finished;
+    CadMutex_Unlock(core->saveJob->lock);
+    
+    if (!finished) return CAD_SAVE_RUNNING;
+    return save_job_finish(core);
+}
+
+CadSaveStatus CadCore_WaitSave(CadCore* core) {
+    if (!core || !core->saveJob) return CAD_SAVE_IDLE;
+    return save_job_finish(core);
+}
+
+int CadCore_IsSaving(CadCore* core) {
+    return core && core->saveJob != NULL;
+}
+
 /* ----------------------------------------------------------------------------
    Point operations
    ---------------------------------------------------------------------------- */
 
-int16_t CadCore_AddPoint(CadCore* core, double x, double y, double z) {
-    if (!core) return INVALID_INDEX;
+CadIndex CadCore_AddPoint(CadCore* core, double x, double y, double z) {
+    if (!core) return INVALID_INDEX;
+    
+    /* Lowest free slot */
+    int i = take_point_slot(core);
+    if (i == INVALID_INDEX) return INVALID_INDEX; /* No free slots */
+    
+    /* A reused slot may be where some polygon's walk stopped */
+    int owners = 0;
+    if (i < core->data.pointCount) owners = point_changing(core, i, 1);
+    
+    CadPoint* pt = &core->data.points[i];
+    pt->flags = 1;
+    pt->selectFlag = 0;
+    pt->nextPoint = INVALID_INDEX;
+    pt->pointx = x;
+    pt->pointy = y;
+    pt->pointz = z;
+    
+    if (i >= core->data.pointCount) {
+        points_adding(core);
+        core->data.pointCount = i + 1;
+        adjacency_points_added(core);
+    }
+    sync_point_stream(core, i);
+    stats_point(core, i, 1);
+    point_changed(core, owners, 1);
+    
+    note_change(core, CAD_CHANGE_POINTS, i, i);
+    
+    core->newPoint = (CadIndex)i;
+    core->isDirty = 1;
+    return (CadIndex)i;
+}
+
+int CadCore_DeletePoint(CadCore* core, CadIndex pointIndex) {
+    if (!core || !CadCore_IsPointValid(core, pointIndex)) return 0;
+    
+    /* Remove from selection if selected */
+    CadCore_DeselectPoint(core, pointIndex);
+    int owners = point_changing(core, pointIndex, 1);
+    stats_point(core, pointIndex, -1);
+    
+    /* Mark as deleted (set flags to 0) */
+    core->data.points[pointIndex].flags = 0;
+    core->data.points[pointIndex].selectFlag = 0;
+    if (core->freeSlots.valid) {
+        slot_release(core->freeSlots.points, &core->freeSlots.pointLow, pointIndex);
+    }
+    sync_point_stream(core, pointIndex);
+    point_changed(core, owners, 1);
+    note_change(core, CAD_CHANGE_POINTS, pointIndex, pointIndex);
+    
+    core->isDirty = 1;
+    return 1;
+}
+
+CadPoint* CadCore_GetPoint(CadCore* core, CadIndex index) {
+    if (!core || !CadCore_IsPointValid(core, index)) return NULL;
+    return &core->data.points[index];
+}
+
+int CadCore_SetPointPosition(CadCore* core, CadIndex pointIndex, double x, double y, double z) {
+    if (!core || !CadCore_IsPointValid(core, pointIndex)) return 0;
     
-    /* Find first free slot */
-    for (int16_t i = 0; i < CAD_MAX_POINTS; i++) {
-        if (core->data.points[i].flags == 0) {
-            CadPoint* pt = &core->data.points[i];
-            pt->flags = 1;
-            pt->selectFlag = 0;
-            pt->nextPoint = INVALID_INDEX;
-            pt->pointx = x;
-            pt->pointy = y;
-            pt->pointz = z;
-            
-            if (i >= core->data.pointCount) {
-                core->data.pointCount = i + 1;
-            }
-            
-            core->newPoint = i;
-            core->isDirty = 1;
-            return i;
-        }
-    }
+    int owners = point_changing(core, pointIndex, 0);
+    stats_point(core, pointIndex, -1);
+    CadPoint* pt = &core->data.points[pointIndex];
+    pt->pointx = x;
+    pt->pointy = y;
+    pt->pointz = z;
+    sync_point_stream(core, pointIndex);
+    stats_point(core, pointIndex, 1);
+    point_changed(core, owners, 0);
+    note_change(core, CAD_CHANGE_POINTS, pointIndex, pointIndex);
     
-    return INVALID_INDEX; /* No free slots */
+    core->isDirty = 1;
+    return 1;
 }
 
-int CadCore_DeletePoint(CadCore* core, int16_t pointIndex) {
+int CadCore_SetNextPoint(CadCore* core, CadIndex pointIndex, CadIndex nextPoint) {
     if (!core || !CadCore_IsPointValid(core, pointIndex)) return 0;
+    if (core->data.points[pointIndex].nextPoint == nextPoint) return 1;
     
-    /* Mark as deleted (set flags to 0) */
-    core->data.points[pointIndex].flags = 0;
-    core->data.points[pointIndex].selectFlag = 0;
-    
-    /* Remove from selection if selected */
-    CadCore_DeselectPoint(core, pointIndex);
+    int owners = point_changing(core, pointIndex, 1);
+    core->data.points[pointIndex].nextPoint = nextPoint;
+    sync_point_stream(core, pointIndex);
+    point_changed(core, owners, 1);
+    note_change(core, CAD_CHANGE_POINTS, pointIndex, pointIndex);
     
     core->isDirty = 1;
     return 1;
 }
 
-CadPoint* CadCore_GetPoint(CadCore* core, int16_t index) {
-    if (!core || !CadCore_IsPointValid(core, index)) return NULL;
-    return &core->data.points[index];
+void CadCore_TranslatePoints(CadCore* core, const CadBitset* points, double dx, double dy, double dz) {
+    if (!core || !points) return;
+    
+    CadIndex first = INVALID_INDEX, last = INVALID_INDEX;
+    for (CadIndex index = CadBitset_Next(points, 0); index >= 0; index = CadBitset_Next(points, index + 1)) {
+        if (!CadCore_IsPointValid(core, index)) continue;
+        
+        int owners = point_changing(core, index, 0);
+        stats_point(core, index, -1);
+        CadPoint* pt = &core->data.points[index];
+        pt->pointx += dx;
+        pt->pointy += dy;
+        pt->pointz += dz;
+        sync_point_stream(core, index);
+        stats_point(core, index, 1);
+        point_changed(core, owners, 0);
+        if (first == INVALID_INDEX) first = index;
+        last = index;
+        core->isDirty = 1;
+    }
+    if (first != INVALID_INDEX) note_change(core, CAD_CHANGE_POINTS, first, last);
 }
 
-int CadCore_IsPointValid(CadCore* core, int16_t index) {
-    if (!core || index < 0 || index >= CAD_MAX_POINTS) return 0;
+int CadCore_IsPointValid(CadCore* core, CadIndex index) {
+    if (!core || index < 0 || index >= core->data.pointCount) return 0;
     return core->data.points[index].flags != 0;
 }
 
@@ -139,84 +1409,136 @@ int CadCore_IsPointValid(CadCore* core, int16_t index) {
    Polygon operations
    ---------------------------------------------------------------------------- */
 
-int16_t CadCore_AddPolygon(CadCore* core, int16_t firstPoint, uint8_t color, uint8_t npoints) {
+CadIndex CadCore_AddPolygon(CadCore* core, CadIndex firstPoint, uint8_t color, uint8_t npoints) {
     if (!core || !CadCore_IsPointValid(core, firstPoint) || npoints < 2) {
         return INVALID_INDEX;
     }
     
-    /* Find first free slot */
-    for (int16_t i = 0; i < CAD_MAX_POLYGONS; i++) {
-        if (core->data.polygons[i].flags == 0) {
-            CadPolygon* poly = &core->data.polygons[i];
-            poly->flags = 1;
-            poly->selectFlag = 0;
-            poly->nextPolygon = INVALID_INDEX;
-            poly->firstPoint = firstPoint;
-            poly->animation = 0;
-            poly->both = INVALID_INDEX;
-            poly->side = 0;
-            poly->color = color;
-            poly->npoints = npoints;
-            
-            if (i >= core->data.polygonCount) {
-                core->data.polygonCount = i + 1;
-            }
-            
-            core->newPolygon = i;
-            core->isDirty = 1;
-            return i;
-        }
+    /* Lowest free slot */
+    int i = take_polygon_slot(core);
+    if (i == INVALID_INDEX) return INVALID_INDEX; /* No free slots */
+    
+    CadPolygon* poly = &core->data.polygons[i];
+    poly->flags = 1;
+    poly->selectFlag = 0;
+    poly->nextPolygon = INVALID_INDEX;
+    poly->firstPoint = firstPoint;
+    poly->animation = 0;
+    poly->both = INVALID_INDEX;
+    poly->side = 0;
+    poly->color = color;
+    poly->npoints = npoints;
+    
+    if (i >= core->data.polygonCount) {
+        core->data.polygonCount = i + 1;
     }
+    adjacency_apply(core, i, 1);
+    polygon_vertices_changed(core, i);
+    stats_polygon(core, i, 1);
     
-    return INVALID_INDEX; /* No free slots */
+    note_change(core, CAD_CHANGE_POLYGONS, i, i);
+    
+    core->newPolygon = (CadIndex)i;
+    core->isDirty = 1;
+    return (CadIndex)i;
 }
 
-int CadCore_DeletePolygon(CadCore* core, int16_t polygonIndex) {
+int CadCore_DeletePolygon(CadCore* core, CadIndex polygonIndex) {
     if (!core || !CadCore_IsPolygonValid(core, polygonIndex)) return 0;
     
+    /* Remove from selection if selected */
+    CadCore_DeselectPolygon(core, polygonIndex);
+    adjacency_apply(core, polygonIndex, -1);
+    stats_polygon(core, polygonIndex, -1);
+    
     /* Mark as deleted */
     core->data.polygons[polygonIndex].flags = 0;
     core->data.polygons[polygonIndex].selectFlag = 0;
-    
-    /* Remove from selection if selected */
-    CadCore_DeselectPolygon(core, polygonIndex);
+    if (core->freeSlots.valid) {
+        slot_release(core->freeSlots.polygons, &core->freeSlots.polygonLow, polygonIndex);
+    }
+    polygon_vertices_changed(core, polygonIndex);
+    note_change(core, CAD_CHANGE_POLYGONS, polygonIndex, polygonIndex);
     
     core->isDirty = 1;
     return 1;
 }
 
-CadPolygon* CadCore_GetPolygon(CadCore* core, int16_t index) {
+CadPolygon* CadCore_GetPolygon(CadCore* core, CadIndex index) {
     if (!core || !CadCore_IsPolygonValid(core, index)) return NULL;
     return &core->data.polygons[index];
 }
 
-int CadCore_IsPolygonValid(CadCore* core, int16_t index) {
-    if (!core || index < 0 || index >= CAD_MAX_POLYGONS) return 0;
+int CadCore_IsPolygonValid(CadCore* core, CadIndex index) {
+    if (!core || index < 0 || index >= core->data.polygonCount) return 0;
     return core->data.polygons[index].flags != 0;
 }
 
-int CadCore_AddPointToPolygon(CadCore* core, int16_t polygonIndex, int16_t pointIndex) {
+/* Last point of the chain from first (INVALID_INDEX for an empty chain).
+   The walk is bounded by the point table, so it returns 0 instead of
+   looping on a cycle or reading past the table on a bad link. */
+static int chain_tail(const CadCore* core, CadIndex first, CadIndex* tail) {
+    *tail = INVALID_INDEX;
+    int steps = 0;
+    for (CadIndex current = first; current != INVALID_INDEX; current = core->data.points[current].nextPoint) {
+        if (current < 0 || current >= core->data.pointCount || ++steps > core->data.pointCount) return 0;
+        *tail = current;
+    }
+    return 1;
+}
+
+int CadCore_AddPointToPolygon(CadCore* core, CadIndex polygonIndex, CadIndex pointIndex) {
     if (!core || !CadCore_IsPolygonValid(core, polygonIndex) || !CadCore_IsPointValid(core, pointIndex)) {
         return 0;
     }
     
     CadPolygon* poly = &core->data.polygons[polygonIndex];
     
-    /* Find the last point in the polygon's chain */
-    int16_t current = poly->firstPoint;
+    /* Find the last point in the polygon's chain, and make sure linking the
+       new point (and whatever follows it) still ends the chain */
+    CadIndex current;
+    if (!chain_tail(core, poly->firstPoint, &current)) {
+        fprintf(stderr, "Error: Polygon %d has a broken point chain\n", polygonIndex);
+        return 0;
+    }
+    if (current != INVALID_INDEX) {
+        if (poly->npoints == UINT8_MAX) {
+            fprintf(stderr, "Error: Polygon %d already has %d points\n", polygonIndex, UINT8_MAX);
+            return 0;
+        }
+        CadIndex end;
+        core->data.points[current].nextPoint = pointIndex;
+        int ok = chain_tail(core, poly->firstPoint, &end);
+        core->data.points[current].nextPoint = INVALID_INDEX;
+        if (!ok) {
+            fprintf(stderr, "Error: Adding point %d would close polygon %d's chain into a loop\n",
+                    pointIndex, polygonIndex);
+            return 0;
+        }
+    }
+    
+    /* Recount this polygon's walk once it is extended; the tail only needs a
+       rebuild if other polygons reach it too */
+    adjacency_apply(core, polygonIndex, -1);
+    stats_polygon(core, polygonIndex, -1);
+    
     if (current == INVALID_INDEX) {
         /* First point */
         poly->firstPoint = pointIndex;
         poly->npoints = 1;
     } else {
-        /* Traverse to end of chain */
-        while (core->data.points[current].nextPoint != INVALID_INDEX) {
-            current = core->data.points[current].nextPoint;
-        }
         /* Link new point */
+        int owners = point_changing(core, current, 1);
         core->data.points[current].nextPoint = pointIndex;
+        sync_point_stream(core, current);
+        point_changed(core, owners, 1);
+        note_change(core, CAD_CHANGE_POINTS, current, current);
         poly->npoints++;
     }
+    adjacency_apply(core, polygonIndex, 1);
+    polygon_vertices_changed(core, polygonIndex);
+    stats_polygon(core, polygonIndex, 1);
+    note_change(core, CAD_CHANGE_POLYGONS, polygonIndex, polygonIndex);
     
     core->isDirty = 1;
     return 1;
@@ -226,53 +1548,58 @@ int CadCore_AddPointToPolygon(CadCore* core, int16_t polygonIndex, int16_t point
    Object operations
    ---------------------------------------------------------------------------- */
 
-int16_t CadCore_AddObject(CadCore* core, int16_t parentObject, double ox, double oy, double oz) {
+CadIndex CadCore_AddObject(CadCore* core, CadIndex parentObject, double ox, double oy, double oz) {
     if (!core) return INVALID_INDEX;
     
-    /* Find first free slot */
-    for (int16_t i = 0; i < CAD_MAX_OBJECTS; i++) {
-        if (core->data.objects[i].flags == 0) {
-            CadObject* obj = &core->data.objects[i];
-            obj->flags = 1;
-            obj->selectFlag = 0;
-            obj->parentObject = parentObject;
-            obj->nextBrother = INVALID_INDEX;
-            obj->childObject = INVALID_INDEX;
-            obj->firstPolygon = INVALID_INDEX;
-            obj->offsetx = ox;
-            obj->offsety = oy;
-            obj->offsetz = oz;
-            
-            if (i >= core->data.objectCount) {
-                core->data.objectCount = i + 1;
-            }
-            
-            core->isDirty = 1;
-            return i;
-        }
+    /* Lowest free slot */
+    int i = take_object_slot(core);
+    if (i == INVALID_INDEX) return INVALID_INDEX;
+    
+    CadObject* obj = &core->data.objects[i];
+    obj->flags = 1;
+    obj->selectFlag = 0;
+    obj->parentObject = parentObject;
+    obj->nextBrother = INVALID_INDEX;
+    obj->childObject = INVALID_INDEX;
+    obj->firstPolygon = INVALID_INDEX;
+    obj->offsetx = ox;
+    obj->offsety = oy;
+    obj->offsetz = oz;
+    
+    if (i >= core->data.objectCount) {
+        core->data.objectCount = i + 1;
     }
+    stats_object(core, i, 1);
+    note_change(core, CAD_CHANGE_OBJECTS, i, i);
     
-    return INVALID_INDEX;
+    core->isDirty = 1;
+    return (CadIndex)i;
 }
 
-int CadCore_DeleteObject(CadCore* core, int16_t objectIndex) {
+int CadCore_DeleteObject(CadCore* core, CadIndex objectIndex) {
     if (!core || !CadCore_IsObjectValid(core, objectIndex)) return 0;
     
+    stats_object(core, objectIndex, -1);
+    
     /* Mark as deleted */
     core->data.objects[objectIndex].flags = 0;
     core->data.objects[objectIndex].selectFlag = 0;
+    if (core->freeSlots.valid) {
+        slot_release(core->freeSlots.objects, &core->freeSlots.objectLow, objectIndex);
+    }
+    note_change(core, CAD_CHANGE_OBJECTS, objectIndex, objectIndex);
     
     core->isDirty = 1;
     return 1;
 }
 
-CadObject* CadCore_GetObject(CadCore* core, int16_t index) {
+CadObject* CadCore_GetObject(CadCore* core, CadIndex index) {
     if (!core || !CadCore_IsObjectValid(core, index)) return NULL;
     return &core->data.objects[index];
 }
 
-int CadCore_IsObjectValid(CadCore* core, int16_t index) {
-    if (!core || index < 0 || index >= CAD_MAX_OBJECTS) return 0;
+int CadCore_IsObjectValid(CadCore* core, CadIndex index) {
+    if (!core || index < 0 || index >= core->data.objectCount) return 0;
     return core->data.objects[index].flags != 0;
 }
 
@@ -282,101 +1609,111 @@ int CadCore_IsObjectValid(CadCore* core, int16_t index) {
 
 void CadCore_ClearSelection(CadCore* core) {
     if (!core) return;
+    CadSelection* sel = &core->selection;
+    
+    /* Only the selected records carry a selection flag */
+    CadIndex firstPoint = INVALID_INDEX, lastPoint = INVALID_INDEX;
+    for (CadIndex i = CadBitset_Next(&sel->points, 0); i >= 0; i = CadBitset_Next(&sel->points, i + 1)) {
+        if (i < core->data.pointCount) core->data.points[i].selectFlag = 0;
+        if (firstPoint == INVALID_INDEX) firstPoint = i;
+        lastPoint = i;
+    }
+    CadIndex firstPolygon = INVALID_INDEX, lastPolygon = INVALID_INDEX;
+    for (CadIndex i = CadBitset_Next(&sel->polygons, 0); i >= 0; i = CadBitset_Next(&sel->polygons, i + 1)) {
+        if (i < core->data.polygonCount) core->data.polygons[i].selectFlag = 0;
+        if (firstPolygon == INVALID_INDEX) firstPolygon = i;
+        lastPolygon = i;
+    }
     
-    /* Clear all selection flags */
+    CadBitset_Clear(&sel->points);
+    CadBitset_Clear(&sel->polygons);
+    sel->orderedCount = 0;
+    if (firstPoint != INVALID_INDEX) note_change(core, CAD_CHANGE_POINT_SELECTION, firstPoint, lastPoint);
+    if (firstPolygon != INVALID_INDEX) note_change(core, CAD_CHANGE_POLYGON_SELECTION, firstPolygon, lastPolygon);
+}
+
+/* Take over the selection flags a loaded file carries */
+static void seed_selection(CadCore* core) {
     for (int i = 0; i < core->data.pointCount; i++) {
-        if (CadCore_IsPointValid(core, i)) {
-            core->data.points[i].selectFlag = 0;
+        if (core->data.points[i].flags != 0 && core->data.points[i].selectFlag != 0) {
+            CadBitset_Set(&core->selection.points, i);
         }
     }
     for (int i = 0; i < core->data.polygonCount; i++) {
-        if (CadCore_IsPolygonValid(core, i)) {
-            core->data.polygons[i].selectFlag = 0;
+        if (core->data.polygons[i].flags != 0 && core->data.polygons[i].selectFlag != 0) {
+            CadBitset_Set(&core->selection.polygons, i);
         }
     }
-    
-    /* Clear selection arrays */
-    for (int i = 0; i < CAD_MAX_POINTS; i++) {
-        core->selection.selectedPoints[i] = INVALID_INDEX;
+}
+
+static void append_ordered(CadSelection* sel, CadIndex pointIndex) {
+    if (sel->orderedCount >= sel->orderedCapacity) {
+        int grown = sel->orderedCapacity > 0 ? sel->orderedCapacity * 2 : 16;
+        CadIndex* bigger = (CadIndex*)realloc(sel->orderedPoints, (size_t)grown * sizeof(CadIndex));
+        if (!bigger) return;
+        sel->orderedPoints = bigger;
+        sel->orderedCapacity = grown;
     }
-    for (int i = 0; i < CAD_MAX_POLYGONS; i++) {
-        core->selection.selectedPolygons[i] = INVALID_INDEX;
+    sel->orderedPoints[sel->orderedCount++] = pointIndex;
+}
+
+/* The ordered list only holds the few points the Make tool picks, so a
+   linear removal is fine */
+static void remove_ordered(CadSelection* sel, CadIndex pointIndex) {
+    for (int i = 0; i < sel->orderedCount; i++) {
+        if (sel->orderedPoints[i] == pointIndex) {
+            memmove(&sel->orderedPoints[i], &sel->orderedPoints[i + 1],
+                    (size_t)(sel->orderedCount - i - 1) * sizeof(CadIndex));
+            sel->orderedCount--;
+            return;
+        }
     }
-    
-    core->selection.pointCount = 0;
-    core->selection.polygonCount = 0;
 }
 
-void CadCore_SelectPoint(CadCore* core, int16_t pointIndex) {
+void CadCore_SelectPoint(CadCore* core, CadIndex pointIndex) {
     if (!core || !CadCore_IsPointValid(core, pointIndex)) return;
-    if (CadCore_IsPointSelected(core, pointIndex)) return; /* Already selected */
+    if (!CadBitset_Set(&core->selection.points, pointIndex)) return; /* Already selected */
     
     core->data.points[pointIndex].selectFlag = 1;
-    
-    /* Add to selection array */
-    if (core->selection.pointCount < CAD_MAX_POINTS) {
-        core->selection.selectedPoints[core->selection.pointCount++] = pointIndex;
-    }
+    if (core->selection.ordered) append_ordered(&core->selection, pointIndex);
+    note_change(core, CAD_CHANGE_POINT_SELECTION, pointIndex, pointIndex);
 }
 
-void CadCore_SelectPolygon(CadCore* core, int16_t polygonIndex) {
+void CadCore_SelectPolygon(CadCore* core, CadIndex polygonIndex) {
     if (!core || !CadCore_IsPolygonValid(core, polygonIndex)) return;
-    if (CadCore_IsPolygonSelected(core, polygonIndex)) return; /* Already selected */
+    if (!CadBitset_Set(&core->selection.polygons, polygonIndex)) return; /* Already selected */
     
     core->data.polygons[polygonIndex].selectFlag = 1;
-    
-    /* Add to selection array */
-    if (core->selection.polygonCount < CAD_MAX_POLYGONS) {
-        core->selection.selectedPolygons[core->selection.polygonCount++] = polygonIndex;
-    }
+    note_change(core, CAD_CHANGE_POLYGON_SELECTION, polygonIndex, polygonIndex);
 }
 
-void CadCore_DeselectPoint(CadCore* core, int16_t pointIndex) {
+void CadCore_DeselectPoint(CadCore* core, CadIndex pointIndex) {
     if (!core || !CadCore_IsPointValid(core, pointIndex)) return;
     
     core->data.points[pointIndex].selectFlag = 0;
+    if (!CadBitset_Reset(&core->selection.points, pointIndex)) return; /* Was not selected */
     
-    /* Remove from selection array */
-    for (int i = 0; i < core->selection.pointCount; i++) {
-        if (core->selection.selectedPoints[i] == pointIndex) {
-            /* Shift remaining elements */
-            for (int j = i; j < core->selection.pointCount - 1; j++) {
-                core->selection.selectedPoints[j] = core->selection.selectedPoints[j + 1];
-            }
-            core->selection.selectedPoints[core->selection.pointCount - 1] = INVALID_INDEX;
-            core->selection.pointCount--;
-            break;
-        }
-    }
+    if (core->selection.ordered) remove_ordered(&core->selection, pointIndex);
+    note_change(core, CAD_CHANGE_POINT_SELECTION, pointIndex, pointIndex);
 }
 
-void CadCore_DeselectPolygon(CadCore* core, int16_t polygonIndex) {
+void CadCore_DeselectPolygon(CadCore* core, CadIndex polygonIndex) {
     if (!core || !CadCore_IsPolygonValid(core, polygonIndex)) return;
     
     core->data.polygons[polygonIndex].selectFlag = 0;
+    if (!CadBitset_Reset(&core->selection.polygons, polygonIndex)) return; /* Was not selected */
     
-    /* Remove from selection array */
-    for (int i = 0; i < core->selection.polygonCount; i++) {
-        if (core->selection.selectedPolygons[i] == polygonIndex) {
-            /* Shift remaining elements */
-            for (int j = i; j < core->selection.polygonCount - 1; j++) {
-                core->selection.selectedPolygons[j] = core->selection.selectedPolygons[j + 1];
-            }
-            core->selection.selectedPolygons[core->selection.polygonCount - 1] = INVALID_INDEX;
-            core->selection.polygonCount--;
-            break;
-        }
-    }
+    note_change(core, CAD_CHANGE_POLYGON_SELECTION, polygonIndex, polygonIndex);
 }
 
-int CadCore_IsPointSelected(CadCore* core, int16_t pointIndex) {
+int CadCore_IsPointSelected(CadCore* core, CadIndex pointIndex) {
     if (!core || !CadCore_IsPointValid(core, pointIndex)) return 0;
-    return core->data.points[pointIndex].selectFlag != 0;
+    return CadBitset_Test(&core->selection.points, pointIndex);
 }
 
-int CadCore_IsPolygonSelected(CadCore* core, int16_t polygonIndex) {
+int CadCore_IsPolygonSelected(CadCore* core, CadIndex polygonIndex) {
     if (!core || !CadCore_IsPolygonValid(core, polygonIndex)) return 0;
-    return core->data.polygons[polygonIndex].selectFlag != 0;
+    return CadBitset_Test(&core->selection.polygons, polygonIndex);
 }
 
 void CadCore_SelectAll(CadCore* core) {
@@ -399,6 +1736,72 @@ void CadCore_SelectAll(CadCore* core) {
     }
 }
 
+void CadCore_InvertSelection(CadCore* core) {
+    if (!core) return;
+    
+    if (core->selectModeFlag == 1) {
+        for (int i = 0; i < core->data.pointCount; i++) {
+            if (!CadCore_IsPointValid(core, i)) continue;
+            if (CadBitset_Test(&core->selection.points, i)) {
+                CadCore_DeselectPoint(core, i);
+            } else {
+                CadCore_SelectPoint(core, i);
+            }
+        }
+    } else {
+        for (int i = 0; i < core->data.polygonCount; i++) {
+            if (!CadCore_IsPolygonValid(core, i)) continue;
+            if (CadBitset_Test(&core->selection.polygons, i)) {
+                CadCore_DeselectPolygon(core, i);
+            } else {
+                CadCore_SelectPolygon(core, i);
+            }
+        }
+    }
+}
+
+void CadCore_SelectPointSet(CadCore* core, const CadBitset* points) {
+    if (!core || !points) return;
+    for (CadIndex i = CadBitset_Next(points, 0); i >= 0; i = CadBitset_Next(points, i + 1)) {
+        CadCore_SelectPoint(core, i);
+    }
+}
+
+void CadCore_SelectPolygonSet(CadCore* core, const CadBitset* polygons) {
+    if (!core || !polygons) return;
+    for (CadIndex i = CadBitset_Next(polygons, 0); i >= 0; i = CadBitset_Next(polygons, i + 1)) {
+        CadCore_SelectPolygon(core, i);
+    }
+}
+
+void CadCore_IntersectPointSelection(CadCore* core, const CadBitset* points) {
+    if (!core || !points) return;
+    CadBitset* sel = &core->selection.points;
+    for (CadIndex i = CadBitset_Next(sel, 0); i >= 0; i = CadBitset_Next(sel, i + 1)) {
+        if (!CadBitset_Test(points, i)) CadCore_DeselectPoint(core, i);
+    }
+}
+
+void CadCore_IntersectPolygonSelection(CadCore* core, const CadBitset* polygons) {
+    if (!core || !polygons) return;
+    CadBitset* sel = &core->selection.polygons;
+    for (CadIndex i = CadBitset_Next(sel, 0); i >= 0; i = CadBitset_Next(sel, i + 1)) {
+        if (!CadBitset_Test(polygons, i)) CadCore_DeselectPolygon(core, i);
+    }
+}
+
+void CadCore_SetSelectionOrdered(CadCore* core, int ordered) {
+    if (!core) return;
+    CadSelection* sel = &core->selection;
+    if (ordered && !sel->ordered) {
+        sel->orderedCount = 0;
+        for (CadIndex i = CadBitset_Next(&sel->points, 0); i >= 0; i = CadBitset_Next(&sel->points, i + 1)) {
+            append_ordered(sel, i);
+        }
+    }
+    sel->ordered = ordered != 0;
+}
+
 /* ----------------------------------------------------------------------------
    Edit mode
    ---------------------------------------------------------------------------- */
@@ -424,22 +1827,22 @@ CadEditMode CadCore_GetEditMode(CadCore* core) {
    Linked list helpers
    ---------------------------------------------------------------------------- */
 
-int16_t CadCore_GetFirstPointOfPolygon(CadCore* core, int16_t polygonIndex) {
+CadIndex CadCore_GetFirstPointOfPolygon(CadCore* core, CadIndex polygonIndex) {
     if (!core || !CadCore_IsPolygonValid(core, polygonIndex)) return INVALID_INDEX;
     return core->data.polygons[polygonIndex].firstPoint;
 }
 
-int16_t CadCore_GetNextPoint(CadCore* core, int16_t pointIndex) {
+CadIndex CadCore_GetNextPoint(CadCore* core, CadIndex pointIndex) {
     if (!core || !CadCore_IsPointValid(core, pointIndex)) return INVALID_INDEX;
     return core->data.points[pointIndex].nextPoint;
 }
 
-int16_t CadCore_GetNextPolygon(CadCore* core, int16_t polygonIndex) {
+CadIndex CadCore_GetNextPolygon(CadCore* core, CadIndex polygonIndex) {
     if (!core || !CadCore_IsPolygonValid(core, polygonIndex)) return INVALID_INDEX;
     return core->data.polygons[polygonIndex].nextPolygon;
 }
 
-int16_t CadCore_GetFirstPolygonOfObject(CadCore* core, int16_t objectIndex) {
+CadIndex CadCore_GetFirstPolygonOfObject(CadCore* core, CadIndex objectIndex) {
     if (!core || !CadCore_IsObjectValid(core, objectIndex)) return INVALID_INDEX;
     return core->data.objects[objectIndex].firstPolygon;
 }
@@ -448,7 +1851,7 @@ int16_t CadCore_GetFirstPolygonOfObject(CadCore* core, int16_t objectIndex) {
    Validation
    ---------------------------------------------------------------------------- */
 
-int CadCore_ValidatePolygon(CadCore* core, int16_t polygonIndex) {
+int CadCore_ValidatePolygon(CadCore* core, CadIndex polygonIndex) {
     if (!core || !CadCore_IsPolygonValid(core, polygonIndex)) return 0;
     
     CadPolygon* poly = &core->data.polygons[polygonIndex];
@@ -456,20 +1859,13 @@ int CadCore_ValidatePolygon(CadCore* core, int16_t polygonIndex) {
     /* Check minimum vertex count */
     if (poly->npoints < 2) return 0;
     
-    /* Verify all points in chain are valid */
-    int16_t current = poly->firstPoint;
-    int count = 0;
-    while (current != INVALID_INDEX && count < poly->npoints) {
-        if (!CadCore_IsPointValid(core, current)) return 0;
-        current = core->data.points[current].nextPoint;
-        count++;
-    }
-    
-    /* Check if we got the expected number of points */
+    /* The chain must give npoints distinct valid points */
+    int count;
+    CadCore_GetPolygonPoints(core, polygonIndex, &count);
     return count == poly->npoints;
 }
 
-int CadCore_ValidatePoint(CadCore* core, int16_t pointIndex) {
+int CadCore_ValidatePoint(CadCore* core, CadIndex pointIndex) {
     if (!core || !CadCore_IsPointValid(core, pointIndex)) return 0;
     return 1; /* Point is valid if it exists */
 }
@@ -479,33 +1875,18 @@ int CadCore_ValidatePoint(CadCore* core, int16_t pointIndex) {
    ---------------------------------------------------------------------------- */
 
 int CadCore_GetActivePointCount(CadCore* core) {
-    if (!core) return 0;
-    
-    int count = 0;
-    for (int i = 0; i < core->data.pointCount; i++) {
-        if (CadCore_IsPointValid(core, i)) count++;
-    }
-    return count;
+    const CadModelStats* stats = CadCore_GetModelStats(core);
+    return stats ? stats->points : 0;
 }
 
 int CadCore_GetActivePolygonCount(CadCore* core) {
-    if (!core) return 0;
-    
-    int count = 0;
-    for (int i = 0; i < core->data.polygonCount; i++) {
-        if (CadCore_IsPolygonValid(core, i)) count++;
-    }
-    return count;
+    const CadModelStats* stats = CadCore_GetModelStats(core);
+    return stats ? stats->polygons : 0;
 }
 
 int CadCore_GetActiveObjectCount(CadCore* core) {
-    if (!core) return 0;
-    
-    int count = 0;
-    for (int i = 0; i < core->data.objectCount; i++) {
-        if (CadCore_IsObjectValid(core, i)) count++;
-    }
-    return count;
+    const CadModelStats* stats = CadCore_GetModelStats(core);
+    return stats ? stats->objects : 0;
 }
 
 /* ----------------------------------------------------------------------------
@@ -531,210 +1912,441 @@ static int convert_coordinate(double coord) {
     return CadCore_ConvertCoordinate(coord);
 }
 
+/* Integer grid test shared by the point and object checks */
+static int on_grid(double x, double y, double z) {
+    /* Convert and check if result matches original (within small epsilon) */
+    const double epsilon = 1e-9;
+    return fabs(x - (double)convert_coordinate(x)) <= epsilon &&
+           fabs(y - (double)convert_coordinate(y)) <= epsilon &&
+           fabs(z - (double)convert_coordinate(z)) <= epsilon;
+}
+
+/* Check if a point's coordinates are integers */
+int CadCore_IsPointOnGrid(CadCore* core, CadIndex pointIndex) {
+    if (!core || pointIndex < 0 || pointIndex >= core->data.pointCount) return 0;
+    CadPoint* pt = &core->data.points[pointIndex];
+    return on_grid(pt->pointx, pt->pointy, pt->pointz);
+}
+
 /* Check if coordinates are merged (all coordinates are integers) */
 int CadCore_AreCoordinatesMerged(CadCore* core) {
+    const CadModelStats* stats = CadCore_GetModelStats(core);
+    return stats && stats->offGridPoints == 0 && stats->offGridObjects == 0;
+}
+
+static int same_grid_position(const CadCore* core, CadIndex a, CadIndex b) {
+    const CadPoint* pa = &core->data.points[a];
+    const CadPoint* pb = &core->data.points[b];
+    return convert_coordinate(pa->pointx) == convert_coordinate(pb->pointx) &&
+           convert_coordinate(pa->pointy) == convert_coordinate(pb->pointy) &&
+           convert_coordinate(pa->pointz) == convert_coordinate(pb->pointz);
+}
+
+/* A polygon's points (count of them, in order) hold no consecutive duplicates */
+static int points_merged(const CadCore* core, const CadPolygon* poly, const CadIndex* points, int count) {
+    if (count == 0) return 1;
+    
+    /* Check first point against last point (closed polygon check) */
+    if (poly->npoints > 1 && same_grid_position(core, points[0], points[count - 1])) {
+        return 0; /* Found duplicate: first and last point are same */
+    }
+    
+    /* Check consecutive points in polygon */
+    for (int i = 1; i < count; i++) {
+        if (same_grid_position(core, points[i - 1], points[i])) {
+            return 0; /* Found duplicate consecutive points */
+        }
+    }
+    
+    return 1; /* No duplicate points found */
+}
+
+/* Check one polygon for consecutive duplicate points */
+int CadCore_IsPolygonMerged(CadCore* core, CadIndex polygonIndex) {
+    if (!core || polygonIndex < 0 || polygonIndex >= core->data.polygonCount) return 0;
+    
+    CadPolygon* poly = &core->data.polygons[polygonIndex];
+    if (poly->flags == 0) return 1; /* Skip invalid polygons */
+    
+    int count;
+    const CadIndex* points = CadCore_GetPolygonPoints(core, polygonIndex, &count);
+    return points_merged(core, poly, points, count);
+}
+
+/* Check if points are merged (no duplicate points at same grid location) */
+int CadCore_ArePointsMerged(CadCore* core) {
+    const CadModelStats* stats = CadCore_GetModelStats(core);
+    return stats && stats->unmergedPolygons == 0;
+}
+
+/* Check if all merge operations have been applied */
+int CadCore_IsFullyMerged(CadCore* core) {
     if (!core) return 0;
     
-    /* Check all valid points */
-    for (int i = 0; i < core->data.pointCount && i < CAD_MAX_POINTS; i++) {
-        CadPoint* pt = &core->data.points[i];
-        if (pt->flags == 0) continue; /* Skip invalid points */
-        
-        /* Check if coordinates are integers (within epsilon) */
-        double x = pt->pointx;
-        double y = pt->pointy;
-        double z = pt->pointz;
-        
-        /* Convert and check if result matches original (within small epsilon) */
-        int conv_x = convert_coordinate(x);
-        int conv_y = convert_coordinate(y);
-        int conv_z = convert_coordinate(z);
+    return CadCore_AreCoordinatesMerged(core) && CadCore_ArePointsMerged(core);
+}
+
+/* ----------------------------------------------------------------------------
+   Merge operations
+   ---------------------------------------------------------------------------- */
+
+/* Round every point coordinate and object offset to the integer grid */
+int CadCore_GridMerge(CadCore* core) {
+    if (!core) return 0;
+    
+    if (!CadCore_GetPointStreams(core)) return 0;
+    CadPointStreams* streams = &core->pointStreams;
+    
+    int changed = 0;
+    CadIndex first = INVALID_INDEX, last = INVALID_INDEX;
+    for (int i = 0; i < streams->count; i++) {
+        if (streams->flags[i] == 0) continue;
         
-        const double epsilon = 1e-9;
-        if (fabs(x - (double)conv_x) > epsilon ||
-            fabs(y - (double)conv_y) > epsilon ||
-            fabs(z - (double)conv_z) > epsilon) {
-            return 0; /* Found non-integer coordinate */
+        double x = (double)convert_coordinate(streams->x[i]);
+        double y = (double)convert_coordinate(streams->y[i]);
+        double z = (double)convert_coordinate(streams->z[i]);
+        if (x != streams->x[i] || y != streams->y[i] || z != streams->z[i]) {
+            int owners = point_changing(core, i, 0);
+            stats_point(core, i, -1);
+            CadPoint* pt = &core->data.points[i];
+            pt->pointx = streams->x[i] = x;
+            pt->pointy = streams->y[i] = y;
+            pt->pointz = streams->z[i] = z;
+            stats_point(core, i, 1);
+            point_changed(core, owners, 0);
+            if (first == INVALID_INDEX) first = i;
+            last = i;
+            changed++;
         }
     }
+    if (first != INVALID_INDEX) note_change(core, CAD_CHANGE_POINTS, first, last);
     
-    /* Also check object offsets */
-    for (int i = 0; i < core->data.objectCount && i < CAD_MAX_OBJECTS; i++) {
+    first = last = INVALID_INDEX;
+    for (int i = 0; i < core->data.objectCount; i++) {
         CadObject* obj = &core->data.objects[i];
-        if (obj->flags == 0) continue; /* Skip invalid objects */
-        
-        double ox = obj->offsetx;
-        double oy = obj->offsety;
-        double oz = obj->offsetz;
+        if (obj->flags == 0) continue;
         
-        int conv_ox = convert_coordinate(ox);
-        int conv_oy = convert_coordinate(oy);
-        int conv_oz = convert_coordinate(oz);
-        
-        const double epsilon = 1e-9;
-        if (fabs(ox - (double)conv_ox) > epsilon ||
-            fabs(oy - (double)conv_oy) > epsilon ||
-            fabs(oz - (double)conv_oz) > epsilon) {
-            return 0; /* Found non-integer offset */
+        double ox = (double)convert_coordinate(obj->offsetx);
+        double oy = (double)convert_coordinate(obj->offsety);
+        double oz = (double)convert_coordinate(obj->offsetz);
+        if (ox != obj->offsetx || oy != obj->offsety || oz != obj->offsetz) {
+            stats_object(core, i, -1);
+            obj->offsetx = ox;
+            obj->offsety = oy;
+            obj->offsetz = oz;
+            stats_object(core, i, 1);
+            if (first == INVALID_INDEX) first = i;
+            last = i;
+            changed++;
         }
     }
+    if (first != INVALID_INDEX) note_change(core, CAD_CHANGE_OBJECTS, first, last);
     
-    return 1; /* All coordinates are integers */
+    if (changed) core->isDirty = 1;
+    return changed;
 }
 
-/* Check if points are merged (no duplicate points at same grid location) */
-int CadCore_ArePointsMerged(CadCore* core) {
+/* Same grid location, using the rule CadCore_ArePointsMerged checks */
+static int same_grid_point(const CadPointStreams* streams, CadIndex a, CadIndex b) {
+    return convert_coordinate(streams->x[a]) == convert_coordinate(streams->x[b]) &&
+           convert_coordinate(streams->y[a]) == convert_coordinate(streams->y[b]) &&
+           convert_coordinate(streams->z[a]) == convert_coordinate(streams->z[b]);
+}
+
+/* Drop consecutive duplicate points (and a last point equal to the first)
+   from every polygon chain */
+int CadCore_PointMerge(CadCore* core) {
     if (!core) return 0;
+    const CadPointStreams* streams = CadCore_GetPointStreams(core);
+    if (!streams) return 0;
     
-    /* For each polygon, check for consecutive duplicate points */
-    for (int poly_idx = 0; poly_idx < core->data.polygonCount && poly_idx < CAD_MAX_POLYGONS; poly_idx++) {
+    int removed = 0;
+    for (int poly_idx = 0; poly_idx < core->data.polygonCount; poly_idx++) {
         CadPolygon* poly = &core->data.polygons[poly_idx];
-        if (poly->flags == 0) continue; /* Skip invalid polygons */
-        
-        int16_t point = poly->firstPoint;
-        if (point == INVALID_INDEX) continue;
-        
-        int count = poly->npoints;
-        int16_t visited[64];
-        int visited_count = 0;
+        if (poly->flags == 0) continue;
         
-        /* Declare variables for point traversal */
-        int16_t current;
-        int checked;
+        /* The points the checker sees (walked here rather than read from the
+           vertex table, which relinking a shared point invalidates) */
+        CadIndex chain[CAD_POLYGON_POINTS_MAX];
+        int chain_count = polygon_vertex_walk(core, poly, chain);
+        if (chain_count < 2) continue;
+        CadIndex chain_tail = streams->next[chain[chain_count - 1]];
         
-        /* Check first point against last point (closed polygon check) */
-        if (count > 1) {
-            int16_t first_point = poly->firstPoint;
-            int16_t last_point = point;
-            
-            /* Find last point */
-            current = point;
-            checked = 0;
-            while (current != INVALID_INDEX && current < CAD_MAX_POINTS && checked < count) {
-                CadPoint* pt = &core->data.points[current];
-                if (pt->flags == 0) break;
-                last_point = current;
-                current = pt->nextPoint;
-                checked++;
-            }
-            
-            if (first_point != INVALID_INDEX && last_point != INVALID_INDEX &&
-                first_point < CAD_MAX_POINTS && last_point < CAD_MAX_POINTS) {
-                CadPoint* first_pt = &core->data.points[first_point];
-                CadPoint* last_pt = &core->data.points[last_point];
-                
-                if (first_pt->flags != 0 && last_pt->flags != 0) {
-                    int first_x = convert_coordinate(first_pt->pointx);
-                    int first_y = convert_coordinate(first_pt->pointy);
-                    int first_z = convert_coordinate(first_pt->pointz);
-                    int last_x = convert_coordinate(last_pt->pointx);
-                    int last_y = convert_coordinate(last_pt->pointy);
-                    int last_z = convert_coordinate(last_pt->pointz);
-                    
-                    if (first_x == last_x && first_y == last_y && first_z == last_z) {
-                        return 0; /* Found duplicate: first and last point are same */
-                    }
-                }
+        /* Every chain point is either kept or dropped, so both lists are
+           bounded by the walk's limit */
+        CadIndex kept[CAD_POLYGON_POINTS_MAX];
+        int kept_count = 0;
+        CadIndex dropped[CAD_POLYGON_POINTS_MAX];
+        int dropped_count = 0;
+        for (int i = 0; i < chain_count; i++) {
+            if (kept_count > 0 && same_grid_point(streams, kept[kept_count - 1], chain[i])) {
+                dropped[dropped_count++] = chain[i];
+            } else {
+                kept[kept_count++] = chain[i];
             }
         }
+        while (kept_count > 1 && same_grid_point(streams, kept[kept_count - 1], kept[0])) {
+            dropped[dropped_count++] = kept[--kept_count];
+        }
+        if (dropped_count == 0) continue;
         
-        /* Check consecutive points in polygon */
-        current = point;
-        int16_t prev_point = INVALID_INDEX;
-        checked = 0;
+        /* Relink the surviving points (the links of points only this polygon
+           reaches can then change without a rebuild) */
+        adjacency_apply(core, poly_idx, -1);
+        stats_polygon(core, poly_idx, -1);
+        poly->firstPoint = kept[0];
+        for (int i = 0; i + 1 < kept_count; i++) {
+            CadCore_SetNextPoint(core, kept[i], kept[i + 1]);
+        }
+        CadCore_SetNextPoint(core, kept[kept_count - 1], chain_tail);
+        poly->npoints = (uint8_t)kept_count;
+        adjacency_apply(core, poly_idx, 1);
+        polygon_vertices_changed(core, poly_idx);
+        stats_polygon(core, poly_idx, 1);
+        note_change(core, CAD_CHANGE_POLYGONS, poly_idx, poly_idx);
         
-        while (current != INVALID_INDEX && current < CAD_MAX_POINTS && checked < count) {
-            /* Cycle detection */
-            int already_visited = 0;
-            for (int v = 0; v < visited_count && v < 64; v++) {
-                if (visited[v] == current) {
-                    already_visited = 1;
-                    break;
-                }
-            }
-            if (already_visited) break;
-            if (visited_count < 64) {
-                visited[visited_count++] = current;
+        /* Free dropped points unless another polygon still uses them */
+        for (int i = 0; i < dropped_count; i++) {
+            CadCore_SetNextPoint(core, dropped[i], INVALID_INDEX);
+            if (!CadCore_IsPointConnected(core, dropped[i])) {
+                CadCore_DeletePoint(core, dropped[i]);
             }
-            
-            CadPoint* pt = &core->data.points[current];
-            if (pt->flags == 0) break;
-            
-            if (prev_point != INVALID_INDEX && prev_point < CAD_MAX_POINTS) {
-                CadPoint* prev_pt = &core->data.points[prev_point];
-                
-                /* Check if converted coordinates match */
-                int prev_x = convert_coordinate(prev_pt->pointx);
-                int prev_y = convert_coordinate(prev_pt->pointy);
-                int prev_z = convert_coordinate(prev_pt->pointz);
-                int curr_x = convert_coordinate(pt->pointx);
-                int curr_y = convert_coordinate(pt->pointy);
-                int curr_z = convert_coordinate(pt->pointz);
-                
-                if (prev_x == curr_x && prev_y == curr_y && prev_z == curr_z) {
-                    return 0; /* Found duplicate consecutive points */
-                }
-            }
-            
-            prev_point = current;
-            current = pt->nextPoint;
-            checked++;
-            if (checked > 1000) break; /* Safety limit */
         }
+        removed += dropped_count;
     }
     
-    return 1; /* No duplicate points found */
+    if (removed) core->isDirty = 1;
+    return removed;
 }
 
-/* Check if all merge operations have been applied */
-int CadCore_IsFullyMerged(CadCore* core) {
-    if (!core) return 0;
+/* ----------------------------------------------------------------------------
+   Check if a point is connected to any polygon
+   ---------------------------------------------------------------------------- */
+int CadCore_IsPointConnected(CadCore* core, CadIndex pointIndex) {
+    if (!core || pointIndex < 0 || pointIndex >= core->data.pointCount) return 0;
+    if (!CadCore_IsPointValid(core, pointIndex)) return 0;
+    if (!core->adjacency.valid && !rebuild_adjacency(core)) return 0;
     
-    return CadCore_AreCoordinatesMerged(core) && CadCore_ArePointsMerged(core);
+    return core->adjacency.owners[pointIndex] > 0;
 }
 
 /* ----------------------------------------------------------------------------
-   Check if a point is connected to any polygon
+   Consistency checks
    ---------------------------------------------------------------------------- */
-int CadCore_IsPointConnected(CadCore* core, int16_t pointIndex) {
-    if (!core || pointIndex < 0 || pointIndex >= CAD_MAX_POINTS) return 0;
-    if (!CadCore_IsPointValid(core, pointIndex)) return 0;
+#ifdef CAD_CHECK_INDEXES
+
+static int check_failed(const char* index, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "Error: %s out of step: ", index);
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    return 1;
+}
+
+/* The entries listed for a point, or -1 if the list runs on past every
+   entry in the pool */
+static int owner_list_length(const CadPointAdjacency* adjacency, CadIndex pointIndex) {
+    int length = 0;
+    for (int link = adjacency->ownerHead[pointIndex]; link >= 0; link = adjacency->links[link].next) {
+        if (link >= adjacency->linkCount || ++length > adjacency->linkCount) return -1;
+    }
+    return length;
+}
+
+static int owner_listed(const CadPointAdjacency* adjacency, CadIndex pointIndex, CadIndex polygonIndex) {
+    for (int link = adjacency->ownerHead[pointIndex]; link >= 0; link = adjacency->links[link].next) {
+        if (adjacency->links[link].polygon == polygonIndex) return 1;
+    }
+    return 0;
+}
+
+static int check_adjacency(CadCore* core) {
+    const CadPointAdjacency* adjacency = &core->adjacency;
+    if (!adjacency->valid) return 0;
+    
+    int count = core->data.pointCount;
+    if (adjacency->capacity < count) {
+        return check_failed("adjacency", "capacity %d below %d points", adjacency->capacity, count);
+    }
+    int32_t* owners = (int32_t*)calloc((size_t)count + 1, sizeof(int32_t));
+    if (!owners) return check_failed("adjacency", "no memory to rebuild it");
+    
+    int danglingWalks = 0, longPolygons = 0;
+    for (int i = 0; i < core->data.polygonCount; i++) {
+        const CadPolygon* poly = &core->data.polygons[i];
+        CadIndex walk[CAD_WALK_MAX];
+        int dangling;
+        int steps = polygon_walk(core, poly, walk, &dangling);
+        for (int k = 0; k < steps; k++) owners[walk[k]]++;
+        danglingWalks += dangling;
+        if (poly->flags != 0 && poly->npoints > CAD_WALK_MAX) longPolygons++;
+    }
+    
+    /* Lists as long as the rebuilt counts, each naming every polygon that
+       reaches its point, hold exactly those polygons */
+    int failed = 0;
+    for (int p = 0; p < count && !failed; p++) {
+        int length = owner_list_length(adjacency, p);
+        if (adjacency->owners[p] != owners[p] || length != owners[p]) {
+            failed = check_failed("adjacency", "point %d has %d owners (%d listed), rebuilt %d",
+                                  p, adjacency->owners[p], length, owners[p]);
+        }
+    }
+    for (int i = 0; i < core->data.polygonCount && !failed; i++) {
+        CadIndex walk[CAD_WALK_MAX];
+        int dangling;
+        int steps = polygon_walk(core, &core->data.polygons[i], walk, &dangling);
+        for (int k = 0; k < steps && !failed; k++) {
+            if (!owner_listed(adjacency, walk[k], i)) {
+                failed = check_failed("adjacency", "polygon %d reaches point %d but is not listed for it", i, walk[k]);
+            }
+        }
+    }
+    if (!failed && (adjacency->danglingWalks != danglingWalks || adjacency->longPolygons != longPolygons)) {
+        failed = check_failed("adjacency", "%d dangling / %d long walks, rebuilt %d / %d",
+                              adjacency->danglingWalks, adjacency->longPolygons, danglingWalks, longPolygons);
+    }
+    free(owners);
+    return failed;
+}
+
+/* Recount from the records alone: the unmerged count walks the chains
+   rather than reading the polygon vertices, which may be stale themselves */
+static int check_stats(CadCore* core) {
+    const CadModelStats* stats = &core->stats;
+    if (!stats->valid) return 0;
     
-    /* Check all polygons to see if this point is used */
+    CadModelStats counted;
+    memset(&counted, 0, sizeof(CadModelStats));
+    for (int i = 0; i < core->data.pointCount; i++) {
+        const CadPoint* pt = &core->data.points[i];
+        if (pt->flags == 0) continue;
+        counted.points++;
+        if (!on_grid(pt->pointx, pt->pointy, pt->pointz)) counted.offGridPoints++;
+    }
     for (int i = 0; i < core->data.polygonCount; i++) {
-        CadPolygon* poly = CadCore_GetPolygon(core, i);
-        if (!poly || poly->flags == 0) continue;
-        if (poly->npoints < 2) continue;
+        const CadPolygon* poly = &core->data.polygons[i];
+        if (poly->flags == 0) continue;
+        counted.polygons++;
         
-        /* Traverse the polygon's point linked list */
-        int16_t current = poly->firstPoint;
-        int visited_count = 0;
-        int16_t visited[64]; /* Cycle detection */
+        CadIndex walk[CAD_POLYGON_POINTS_MAX];
+        int count = polygon_vertex_walk(core, poly, walk);
+        if (!points_merged(core, poly, walk, count)) counted.unmergedPolygons++;
+    }
+    for (int i = 0; i < core->data.objectCount; i++) {
+        const CadObject* obj = &core->data.objects[i];
+        if (obj->flags == 0) continue;
+        counted.objects++;
+        if (!on_grid(obj->offsetx, obj->offsety, obj->offsetz)) counted.offGridObjects++;
+    }
+    
+    if (stats->points != counted.points || stats->polygons != counted.polygons ||
+        stats->objects != counted.objects) {
+        return check_failed("statistics", "%d/%d/%d points/polygons/objects, recounted %d/%d/%d",
+                            stats->points, stats->polygons, stats->objects,
+                            counted.points, counted.polygons, counted.objects);
+    }
+    if (stats->offGridPoints != counted.offGridPoints || stats->offGridObjects != counted.offGridObjects) {
+        return check_failed("statistics", "%d/%d points/objects off grid, recounted %d/%d",
+                            stats->offGridPoints, stats->offGridObjects,
+                            counted.offGridPoints, counted.offGridObjects);
+    }
+    if (stats->unmergedValid && stats->unmergedPolygons != counted.unmergedPolygons) {
+        return check_failed("statistics", "%d unmerged polygons, recounted %d",
+                            stats->unmergedPolygons, counted.unmergedPolygons);
+    }
+    return 0;
+}
+
+static int check_polygon_vertices(CadCore* core) {
+    const CadPolygonVertices* vertices = &core->polygonVertices;
+    if (!vertices->valid) return 0;
+    
+    if (vertices->polygonCount < core->data.polygonCount) {
+        return check_failed("polygon vertices", "%d polygons covered of %d",
+                            vertices->polygonCount, core->data.polygonCount);
+    }
+    if (vertices->offsets[0] != 0) {
+        return check_failed("polygon vertices", "first slice starts at %d", vertices->offsets[0]);
+    }
+    for (int i = 0; i < vertices->polygonCount; i++) {
+        int start = vertices->offsets[i];
+        int count = vertices->offsets[i + 1] - start;
+        if (count < 0 || vertices->offsets[i + 1] > vertices->indexCapacity) {
+            return check_failed("polygon vertices", "polygon %d has slice %d..%d", i, start, start + count);
+        }
         
-        while (current >= 0 && current < CAD_MAX_POINTS && visited_count < 64) {
-            /* Check for cycles */
-            int already_visited = 0;
-            for (int v = 0; v < visited_count; v++) {
-                if (visited[v] == current) {
-                    already_visited = 1;
-                    break;
-                }
-            }
-            if (already_visited) break;
-            visited[visited_count++] = current;
-            
-            /* If this point matches, it's connected */
-            if (current == pointIndex) {
-                return 1;
+        /* Slices past the polygon table must be empty */
+        CadIndex walk[CAD_POLYGON_POINTS_MAX];
+        int walked = 0;
+        if (i < core->data.polygonCount) {
+            walked = polygon_vertex_walk(core, &core->data.polygons[i], walk);
+        }
+        if (count != walked) {
+            return check_failed("polygon vertices", "polygon %d has %d points, walked %d", i, count, walked);
+        }
+        for (int k = 0; k < count; k++) {
+            if (vertices->indices[start + k] != walk[k]) {
+                return check_failed("polygon vertices", "polygon %d point %d is %d, walked %d",
+                                    i, k, vertices->indices[start + k], walk[k]);
             }
-            
-            CadPoint* pt = CadCore_GetPoint(core, current);
-            if (!pt || pt->flags == 0) break;
-            
-            current = pt->nextPoint;
         }
     }
+    return 0;
+}
+
+/* Whether the notified ranges cover every change is for the caller to
+   check (it can diff the records); here only their shape */
+static int check_change_log(CadCore* core) {
+    const CadChangeLog* changes = &core->changes;
+    for (int kind = 0; kind < CAD_CHANGE_KINDS; kind++) {
+        const CadChangeRange* range = &changes->ranges[kind];
+        int clean = range->dirtyFirst == INVALID_INDEX && range->dirtyLast == INVALID_INDEX;
+        if (!clean && (range->dirtyFirst < 0 || range->dirtyLast < range->dirtyFirst ||
+                       range->dirtyLast >= CAD_MAX_SLOTS)) {
+            return check_failed("change log", "kind %d has dirty range %d..%d",
+                                kind, range->dirtyFirst, range->dirtyLast);
+        }
+    }
+    if (changes->subscriberCount < 0 || changes->subscriberCount > changes->subscriberCapacity) {
+        return check_failed("change log", "%d subscribers in %d slots",
+                            changes->subscriberCount, changes->subscriberCapacity);
+    }
+    for (int i = 0; i < changes->subscriberCount; i++) {
+        const CadChangeSubscriber* sub = &changes->subscribers[i];
+        if (!sub->func || sub->id <= 0 || sub->id > changes->nextId) {
+            return check_failed("change log", "subscriber %d has id %d", i, sub->id);
+        }
+    }
+    return 0;
+}
+
+/* Outside a batch nothing may be held back */
+static int check_batch(CadCore* core) {
+    const CadBatch* batch = &core->batch;
+    if (batch->depth < 0) return check_failed("batch", "depth %d", batch->depth);
+    if (batch->depth > 0) return 0;
     
-    return 0; /* Not found in any polygon */
+    for (int kind = 0; kind < CAD_CHANGE_KINDS; kind++) {
+        if (batch->pendingFirst[kind] != INVALID_INDEX || batch->pendingLast[kind] != INVALID_INDEX) {
+            return check_failed("batch", "kind %d still holds %d..%d after the commit",
+                                kind, batch->pendingFirst[kind], batch->pendingLast[kind]);
+        }
+    }
+    return 0;
+}
+
+int CadCore_CheckIndexes(CadCore* core) {
+    if (!core) return 0;
+    int failed = 0;
+    failed += check_adjacency(core);
+    failed += check_stats(core);
+    failed += check_polygon_vertices(core);
+    failed += check_change_log(core);
+    failed += check_batch(core);
+    return failed;
 }
 
+#endif
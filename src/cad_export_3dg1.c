@@ -18,6 +18,8 @@
 #endif
 #endif
 
+static int write_3dg1(const CadCore* core, FILE* fp_obj, int* out_vertex_count, int* out_color_count);
+
 /* Export CAD data to Fundoshi-Kun format */
 int CadExport_3DG1(const CadCore* core, const char* filename) {
     if (!core || !filename) return 0;
@@ -47,11 +49,44 @@ int CadExport_3DG1(const CadCore* core, const char* filename) {
         return 0;
     }
 
+    int vertex_count = 0;
+    int color_count = 0;
+    if (!write_3dg1(core, fp_obj, &vertex_count, &color_count)) {
+        fclose(fp_obj);
+        return 0;
+    }
+    fclose(fp_obj);
+    fprintf(stdout, "Exported 3DG1 file: %s (%d vertices, %d faces, %d materials)\n", 
+            filename, vertex_count, core->data.polygonCount, color_count);
+    return 1;
+}
+
+/* Write Fundoshi-Kun text to an open stream (e.g. stdout) */
+int CadExport_3DG1Stream(const CadCore* core, FILE* fp) {
+    if (!core || !fp) return 0;
+    
+    int vertex_count = 0;
+    int color_count = 0;
+    if (!write_3dg1(core, fp, &vertex_count, &color_count)) return 0;
+    return !ferror(fp);
+}
+
+/* Write the 3DG1 body; reports the counts the file exporter logs.
+   Returns 0 if the vertex table or the index map could not be allocated. */
+static int write_3dg1(const CadCore* core, FILE* fp_obj, int* out_vertex_count, int* out_color_count) {
+    /* Polygon points come from the core's vertex table, filled on demand */
+    const CadPolygonVertices* vertices = CadCore_GetPolygonVertices((CadCore*)core);
+    if (!vertices) return 0;
+    
     /* Step 1: Collect all valid points and create index mapping */
-    int point_to_vertex[CAD_MAX_POINTS];
+    int* point_to_vertex = (int*)malloc((size_t)(core->data.pointCount > 0 ? core->data.pointCount : 1) * sizeof(int));
     int vertex_count = 0;
+    if (!point_to_vertex) {
+        fprintf(stderr, "Error: Out of memory exporting %d points\n", core->data.pointCount);
+        return 0;
+    }
     
-    for (int i = 0; i < core->data.pointCount && i < CAD_MAX_POINTS; i++) {
+    for (int i = 0; i < core->data.pointCount; i++) {
         const CadPoint* pt = &core->data.points[i];
         if (pt->flags != 0) {
             point_to_vertex[i] = vertex_count + 1; /* 3DG1 uses 1-based indexing */
@@ -66,7 +101,7 @@ int CadExport_3DG1(const CadCore* core, const char* filename) {
     fprintf(fp_obj, "%d\n", vertex_count); // total points in this shape (1-index)
     
     /* Step 2: Write all vertices */
-    for (int i = 0; i < core->data.pointCount && i < CAD_MAX_POINTS; i++) {
+    for (int i = 0; i < core->data.pointCount; i++) {
         const CadPoint* pt = &core->data.points[i];
         if (pt->flags != 0) {
             //fprintf(fp_obj, "%.6f %.6f %.6f\n", pt->pointx, pt->pointy, pt->pointz);
@@ -85,7 +120,7 @@ int CadExport_3DG1(const CadCore* core, const char* filename) {
     }
     
     /* Find all unique colors used in polygons */
-    for (int i = 0; i < core->data.polygonCount && i < CAD_MAX_POLYGONS; i++) {
+    for (int i = 0; i < core->data.polygonCount; i++) {
         const CadPolygon* poly = &core->data.polygons[i];
         if (poly->flags == 0 || poly->npoints < CAD_MIN_FACE_POINTS) continue; // Star Fox allows faces with at least 2 points (colored lines) 
         
@@ -99,7 +134,7 @@ int CadExport_3DG1(const CadCore* core, const char* filename) {
     /* Step 4: Write all faces (polygons) with material assignments */
     uint8_t current_material = 255; /* Invalid, will force first material to be set */
     
-    for (int i = 0; i < core->data.polygonCount && i < CAD_MAX_POLYGONS; i++) {
+    for (int i = 0; i < core->data.polygonCount; i++) {
         const CadPolygon* poly = &core->data.polygons[i];
         if (poly->flags == 0 || poly->npoints < CAD_MIN_FACE_POINTS) continue; // Star Fox allows faces with at least 2 points (colored lines) 
         
@@ -109,22 +144,16 @@ int CadExport_3DG1(const CadCore* core, const char* filename) {
         }
         
         /* Collect polygon vertices */
-        int16_t point_indices[256];
+        int point_indices[256];
         int point_count = 0;
-        int16_t current = poly->firstPoint;
+        const CadIndex* points = vertices->indices + vertices->offsets[i];
+        int npoints = vertices->offsets[i + 1] - vertices->offsets[i];
         
-        while (current >= 0 && current < CAD_MAX_POINTS && point_count < 256) {
-            if (current >= core->data.pointCount) break;
-            const CadPoint* pt = &core->data.points[current];
-            if (pt->flags == 0) break;
-            
-            int vertex_idx = point_to_vertex[current];
+        for (int k = 0; k < npoints; k++) {
+            int vertex_idx = point_to_vertex[points[k]];
             if (vertex_idx > 0) {
-                point_indices[point_count++] = (int16_t)vertex_idx;
+                point_indices[point_count++] = vertex_idx;
             }
-            
-            current = pt->nextPoint;
-            if (point_count > 1000) break; /* Safety limit */
         }
         
         /* Write face if we have at least 2 vertices */
@@ -140,9 +169,9 @@ int CadExport_3DG1(const CadCore* core, const char* filename) {
         }
     }
     fprintf(fp_obj, "\x1a"); // End-of-File marker
-    fclose(fp_obj);
-    fprintf(stdout, "Exported 3DG1 file: %s (%d vertices, %d faces, %d materials)\n", 
-            filename, vertex_count, core->data.polygonCount, color_count);
+    free(point_to_vertex);
+    *out_vertex_count = vertex_count;
+    *out_color_count = color_count;
     return 1;
 }
 
@@ -10,13 +10,13 @@
 #ifdef _WIN32
 #include <windows.h>
 #include <io.h>
-#ifndef MAX_PATH
-#define MAX_PATH 260
-#endif
 #ifndef CP_UTF8
 #define CP_UTF8 65001
 #endif
 #endif
+#ifndef MAX_PATH
+#define MAX_PATH 260
+#endif
 
 /* Convert color index (0-255) to RGB values */
 static void color_index_to_rgb(uint8_t color_idx, float* r, float* g, float* b) {
@@ -51,6 +51,9 @@ static void color_index_to_rgb(uint8_t color_idx, float* r, float* g, float* b)
     }
 }
 
+static int write_obj(const CadCore* core, FILE* fp_obj, FILE* fp_mtl, const char* mtl_basename,
+                     int* out_vertex_count, int* out_color_count);
+
 /* Export CAD data to OBJ format with MTL materials */
 int CadExport_OBJ(const CadCore* core, const char* filename) {
     if (!core || !filename) return 0;
@@ -123,22 +126,62 @@ int CadExport_OBJ(const CadCore* core, const char* filename) {
         return 0;
     }
     
+    int vertex_count = 0;
+    int color_count = 0;
+    int ok = write_obj(core, fp_obj, fp_mtl, mtl_basename, &vertex_count, &color_count);
+    fclose(fp_mtl);
+    fclose(fp_obj);
+    if (!ok) return 0;
+    fprintf(stdout, "Exported OBJ file: %s (%d vertices, %d faces, %d materials)\n", 
+            filename, vertex_count, core->data.polygonCount, color_count);
+    fprintf(stdout, "Exported MTL file: %s\n", mtl_filename);
+    return 1;
+}
+
+/* Write OBJ text to an open stream (e.g. stdout) */
+int CadExport_OBJStream(const CadCore* core, FILE* fp_obj, FILE* fp_mtl, const char* mtl_name) {
+    if (!core || !fp_obj) return 0;
+    
+    int vertex_count = 0;
+    int color_count = 0;
+    if (!write_obj(core, fp_obj, fp_mtl, mtl_name, &vertex_count, &color_count)) return 0;
+    return !ferror(fp_obj) && !(fp_mtl && ferror(fp_mtl));
+}
+
+/* Write the OBJ body (and the MTL library when fp_mtl is set); reports the
+   counts the file exporter logs. Returns 0 if the index map or the vertex
+   table could not be allocated. */
+static int write_obj(const CadCore* core, FILE* fp_obj, FILE* fp_mtl, const char* mtl_basename,
+                     int* out_vertex_count, int* out_color_count) {
+    /* Polygon points come from the core's vertex table, filled on demand */
+    const CadPolygonVertices* vertices = CadCore_GetPolygonVertices((CadCore*)core);
+    if (!vertices) return 0;
+    
+    int* point_to_vertex = (int*)malloc((size_t)(core->data.pointCount > 0 ? core->data.pointCount : 1) * sizeof(int));
+    if (!point_to_vertex) {
+        fprintf(stderr, "Error: Out of memory exporting %d points\n", core->data.pointCount);
+        return 0;
+    }
+
     /* Write OBJ header */
     fprintf(fp_obj, "# OBJ file exported from 3DCadGui\n");
     fprintf(fp_obj, "# Points: %d, Polygons: %d\n", core->data.pointCount, core->data.polygonCount);
-    fprintf(fp_obj, "mtllib %s\n", mtl_basename);
+    if (mtl_basename) {
+        fprintf(fp_obj, "mtllib %s\n", mtl_basename);
+    }
     fprintf(fp_obj, "\n");
     
     /* Write MTL header */
-    fprintf(fp_mtl, "# MTL file exported from 3DCadGui\n");
-    fprintf(fp_mtl, "# Material library for %s\n", mtl_basename);
-    fprintf(fp_mtl, "\n");
+    if (fp_mtl) {
+        fprintf(fp_mtl, "# MTL file exported from 3DCadGui\n");
+        fprintf(fp_mtl, "# Material library for %s\n", mtl_basename ? mtl_basename : "stream");
+        fprintf(fp_mtl, "\n");
+    }
     
     /* Step 1: Collect all valid points and create index mapping */
-    int point_to_vertex[CAD_MAX_POINTS];
     int vertex_count = 0;
     
-    for (int i = 0; i < core->data.pointCount && i < CAD_MAX_POINTS; i++) {
+    for (int i = 0; i < core->data.pointCount; i++) {
         const CadPoint* pt = &core->data.points[i];
         if (pt->flags != 0) {
             point_to_vertex[i] = vertex_count + 1; /* OBJ uses 1-based indexing */
@@ -149,7 +192,7 @@ int CadExport_OBJ(const CadCore* core, const char* filename) {
     }
     
     /* Step 2: Write all vertices */
-    for (int i = 0; i < core->data.pointCount && i < CAD_MAX_POINTS; i++) {
+    for (int i = 0; i < core->data.pointCount; i++) {
         const CadPoint* pt = &core->data.points[i];
         if (pt->flags != 0) {
             fprintf(fp_obj, "v %.6f %.6f %.6f\n", pt->pointx, pt->pointy, pt->pointz);
@@ -169,7 +212,7 @@ int CadExport_OBJ(const CadCore* core, const char* filename) {
     }
     
     /* Find all unique colors used in polygons */
-    for (int i = 0; i < core->data.polygonCount && i < CAD_MAX_POLYGONS; i++) {
+    for (int i = 0; i < core->data.polygonCount; i++) {
         const CadPolygon* poly = &core->data.polygons[i];
         if (poly->flags == 0 || poly->npoints < CAD_MIN_FACE_POINTS) continue;
         
@@ -181,7 +224,7 @@ int CadExport_OBJ(const CadCore* core, const char* filename) {
     }
     
     /* Write materials to MTL file */
-    for (int i = 0; i < color_count; i++) {
+    for (int i = 0; fp_mtl && i < color_count; i++) {
         uint8_t color_idx = used_colors[i];
         float r, g, b;
         color_index_to_rgb(color_idx, &r, &g, &b);
@@ -195,12 +238,10 @@ int CadExport_OBJ(const CadCore* core, const char* filename) {
         fprintf(fp_mtl, "\n");
     }
     
-    fclose(fp_mtl);
-    
     /* Step 4: Write all faces (polygons) with material assignments */
     uint8_t current_material = 255; /* Invalid, will force first material to be set */
     
-    for (int i = 0; i < core->data.polygonCount && i < CAD_MAX_POLYGONS; i++) {
+    for (int i = 0; i < core->data.polygonCount; i++) {
         const CadPolygon* poly = &core->data.polygons[i];
         if (poly->flags == 0 || poly->npoints < CAD_MIN_FACE_POINTS) continue;
         
@@ -211,22 +252,16 @@ int CadExport_OBJ(const CadCore* core, const char* filename) {
         }
         
         /* Collect polygon vertices */
-        int16_t point_indices[256];
+        int point_indices[256];
         int point_count = 0;
-        int16_t current = poly->firstPoint;
+        const CadIndex* points = vertices->indices + vertices->offsets[i];
+        int npoints = vertices->offsets[i + 1] - vertices->offsets[i];
         
-        while (current >= 0 && current < CAD_MAX_POINTS && point_count < 256) {
-            if (current >= core->data.pointCount) break;
-            const CadPoint* pt = &core->data.points[current];
-            if (pt->flags == 0) break;
-            
-            int vertex_idx = point_to_vertex[current];
+        for (int k = 0; k < npoints; k++) {
+            int vertex_idx = point_to_vertex[points[k]];
             if (vertex_idx > 0) {
-                point_indices[point_count++] = (int16_t)vertex_idx;
+                point_indices[point_count++] = vertex_idx;
             }
-            
-            current = pt->nextPoint;
-            if (point_count > 1000) break; /* Safety limit */
         }
         
         /* Write face if we have at least 2 vertices */
@@ -239,10 +274,9 @@ int CadExport_OBJ(const CadCore* core, const char* filename) {
         }
     }
     
-    fclose(fp_obj);
-    fprintf(stdout, "Exported OBJ file: %s (%d vertices, %d faces, %d materials)\n", 
-            filename, vertex_count, core->data.polygonCount, color_count);
-    fprintf(stdout, "Exported MTL file: %s\n", mtl_filename);
+    free(point_to_vertex);
+    *out_vertex_count = vertex_count;
+    *out_color_count = color_count;
     return 1;
 }
 
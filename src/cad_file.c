@@ -1,403 +1,1948 @@
 #define _CRT_SECURE_NO_WARNINGS
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
 
 #include "cad_file.h"
+#include "cad_lz.h"
+#include "cad_codec.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #ifdef _WIN32
 #include <windows.h>
 #include <io.h>
-#ifndef MAX_PATH
-#define MAX_PATH 260
-#endif
 #ifndef CP_UTF8
 #define CP_UTF8 65001
 #endif
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #endif
+#ifndef MAX_PATH
+#define MAX_PATH 260
+#endif
+
+void CadFile_Init(CadFileData* data) {
+    if (!data) return;
+    memset(data, 0, sizeof(CadFileData));
+}
 
-/* Endianness conversion helpers */
-static inline int16_t swap_int16(int16_t value) {
-    return (int16_t)(((value & 0xFF) << 8) | ((value & 0xFF00) >> 8));
+void CadFile_Clear(CadFileData* data) {
+    if (!data) return;
+    /* Only the slots ever used can be nonzero */
+    if (data->objects) memset(data->objects, 0, (size_t)data->objectCount * sizeof(CadObject));
+    if (data->polygons) memset(data->polygons, 0, (size_t)data->polygonCount * sizeof(CadPolygon));
+    if (data->points) memset(data->points, 0, (size_t)data->pointCount * sizeof(CadPoint));
+    data->objectCount = 0;
+    data->polygonCount = 0;
+    data->pointCount = 0;
+    data->format = CAD_FORMAT_LEGACY;
+    data->journalSegments = 0;
+    data->journalRecords = 0;
 }
 
-static inline uint16_t swap_uint16(uint16_t value) {
-    return (uint16_t)(((value & 0xFF) << 8) | ((value & 0xFF00) >> 8));
+void CadFile_Free(CadFileData* data) {
+    if (!data) return;
+    free(data->objects);
+    free(data->polygons);
+    free(data->points);
+    CadFile_Init(data);
 }
 
-static inline double swap_double(double value) {
-    union { double d; uint64_t i; } u;
-    u.d = value;
-    u.i = ((u.i & 0xFF00000000000000ULL) >> 56) |
-          ((u.i & 0x00FF000000000000ULL) >> 40) |
-          ((u.i & 0x0000FF0000000000ULL) >> 24) |
-          ((u.i & 0x000000FF00000000ULL) >> 8)  |
-          ((u.i & 0x00000000FF000000ULL) << 8)  |
-          ((u.i & 0x0000000000FF0000ULL) << 24) |
-          ((u.i & 0x000000000000FF00ULL) << 40) |
-          ((u.i & 0x00000000000000FFULL) << 56);
-    return u.d;
+/* Grow one record table to hold at least needed slots (new slots zeroed) */
+static int grow_table(void** table, int* capacity, int needed, size_t record_size) {
+    if (needed <= *capacity) return 1;
+    if (needed > CAD_MAX_SLOTS) {
+        fprintf(stderr, "Error: More than %d records of one kind\n", CAD_MAX_SLOTS);
+        return 0;
+    }
+    int grown = *capacity > 0 ? *capacity : 64;
+    while (grown < needed) grown = grown > CAD_MAX_SLOTS / 2 ? CAD_MAX_SLOTS : grown * 2;
+    
+    void* bigger = realloc(*table, (size_t)grown * record_size);
+    if (!bigger) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 0;
+    }
+    memset((uint8_t*)bigger + (size_t)*capacity * record_size, 0, (size_t)(grown - *capacity) * record_size);
+    *table = bigger;
+    *capacity = grown;
+    return 1;
 }
 
-/* Check if system is little-endian (Windows/x86 is little-endian) */
-static inline int is_little_endian(void) {
-    union { uint16_t i; uint8_t c[2]; } u;
-    u.i = 0x0102;
-    return u.c[0] == 0x02; /* Little-endian: LSB first */
+int CadFile_Reserve(CadFileData* data, int objects, int polygons, int points) {
+    if (!data) return 0;
+    return grow_table((void**)&data->objects, &data->objectCapacity, objects, sizeof(CadObject)) &&
+           grow_table((void**)&data->polygons, &data->polygonCapacity, polygons, sizeof(CadPolygon)) &&
+           grow_table((void**)&data->points, &data->pointCapacity, points, sizeof(CadPoint));
 }
 
-void CadFile_Init(CadFileData* data) {
-    if (!data) return;
-    memset(data, 0, sizeof(CadFileData));
+int CadFile_Copy(CadFileData* dst, const CadFileData* src) {
+    if (!dst || !src) return 0;
+    if (dst == src) return 1;
+    CadFile_Clear(dst);
+    if (!CadFile_Reserve(dst, src->objectCount, src->polygonCount, src->pointCount)) return 0;
+    if (src->objectCount) memcpy(dst->objects, src->objects, (size_t)src->objectCount * sizeof(CadObject));
+    if (src->polygonCount) memcpy(dst->polygons, src->polygons, (size_t)src->polygonCount * sizeof(CadPolygon));
+    if (src->pointCount) memcpy(dst->points, src->points, (size_t)src->pointCount * sizeof(CadPoint));
+    dst->objectCount = src->objectCount;
+    dst->polygonCount = src->polygonCount;
+    dst->pointCount = src->pointCount;
+    dst->format = src->format;
+    dst->journalSegments = src->journalSegments;
+    dst->journalRecords = src->journalRecords;
+    return 1;
 }
 
-void CadFile_Clear(CadFileData* data) {
-    if (!data) return;
-    CadFile_Init(data);
+int CadFile_Equal(const CadFileData* a, const CadFileData* b) {
+    if (!a || !b) return 0;
+    if (a->objectCount != b->objectCount || a->polygonCount != b->polygonCount ||
+        a->pointCount != b->pointCount) {
+        return 0;
+    }
+    return (a->objectCount == 0 || memcmp(a->objects, b->objects, (size_t)a->objectCount * sizeof(CadObject)) == 0) &&
+           (a->polygonCount == 0 || memcmp(a->polygons, b->polygons, (size_t)a->polygonCount * sizeof(CadPolygon)) == 0) &&
+           (a->pointCount == 0 || memcmp(a->points, b->points, (size_t)a->pointCount * sizeof(CadPoint)) == 0);
+}
+
+int CadFile_FitsLegacy(const CadFileData* data) {
+    if (!data) return 0;
+    return data->objectCount <= CAD_LEGACY_MAX_OBJECTS && data->polygonCount <= CAD_LEGACY_MAX_POLYGONS &&
+           data->pointCount <= CAD_LEGACY_MAX_POINTS;
 }
 
-CadPoint* CadFile_GetPoint(CadFileData* data, int16_t index) {
-    if (!data || index < 0 || index >= CAD_MAX_POINTS) return NULL;
+CadPoint* CadFile_GetPoint(CadFileData* data, CadIndex index) {
+    if (!data || index < 0 || index >= data->pointCount) return NULL;
     return &data->points[index];
 }
 
-CadPolygon* CadFile_GetPolygon(CadFileData* data, int16_t index) {
-    if (!data || index < 0 || index >= CAD_MAX_POLYGONS) return NULL;
+CadPolygon* CadFile_GetPolygon(CadFileData* data, CadIndex index) {
+    if (!data || index < 0 || index >= data->polygonCount) return NULL;
     return &data->polygons[index];
 }
 
-CadObject* CadFile_GetObject(CadFileData* data, int16_t index) {
-    if (!data || index < 0 || index >= CAD_MAX_OBJECTS) return NULL;
+CadObject* CadFile_GetObject(CadFileData* data, CadIndex index) {
+    if (!data || index < 0 || index >= data->objectCount) return NULL;
     return &data->objects[index];
 }
 
-int CadFile_Load(const char* filename, CadFileData* data) {
-    if (!filename || !data) {
-        fprintf(stderr, "Error: Invalid parameters to CadFile_Load\n");
+#ifdef _WIN32
+/* Convert UTF-8 filename to wide string for Windows */
+static int to_wide_path(const char* filename, wchar_t* wfilename, int wcount) {
+    int wlen = MultiByteToWideChar(CP_UTF8, 0, filename, -1, wfilename, wcount);
+    if (wlen <= 0) {
+        fprintf(stderr, "Error: Failed to convert filename to wide string: '%s'\n", filename);
         return 0;
     }
-    
-    /* Convert UTF-8 filename to wide string for Windows */
+    return 1;
+}
+#endif
+
+/* ----------------------------------------------------------------------------
+   Whole-file view
+   The loader maps the file and decodes the records straight out of memory,
+   so only the pages actually touched are read.
+   ---------------------------------------------------------------------------- */
+typedef struct {
+    const uint8_t* bytes;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    void* map;
+#endif
+} FileView;
+
+static void close_file_view(FileView* view) {
+    if (!view) return;
+#ifdef _WIN32
+    if (view->bytes) UnmapViewOfFile(view->bytes);
+    if (view->mapping) CloseHandle(view->mapping);
+    if (view->file && view->file != INVALID_HANDLE_VALUE) CloseHandle(view->file);
+#else
+    if (view->map) munmap(view->map, view->size);
+#endif
+    memset(view, 0, sizeof(FileView));
+}
+
+/* Returns 1 on success, 0 if the file could not be opened, -1 if it is empty */
+static int open_file_view(const char* filename, FileView* view) {
+    memset(view, 0, sizeof(FileView));
+#ifdef _WIN32
     wchar_t wfilename[MAX_PATH * 2] = {0};
-    int wlen = MultiByteToWideChar(CP_UTF8, 0, filename, -1, wfilename, sizeof(wfilename) / sizeof(wfilename[0]));
-    if (wlen <= 0) {
-        fprintf(stderr, "Error: Failed to convert filename to wide string: '%s'\n", filename);
+    if (!to_wide_path(filename, wfilename, sizeof(wfilename) / sizeof(wfilename[0]))) return 0;
+    
+    view->file = CreateFileW(wfilename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (view->file == INVALID_HANDLE_VALUE) return 0;
+    
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(view->file, &file_size)) {
+        close_file_view(view);
         return 0;
     }
+    if (file_size.QuadPart == 0) {
+        close_file_view(view);
+        return -1;
+    }
     
-    FILE* fp = _wfopen(wfilename, L"rb");
-    if (!fp) {
-        fprintf(stderr, "Error: Could not open file '%s' for reading\n", filename);
+    view->mapping = CreateFileMappingW(view->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!view->mapping) {
+        close_file_view(view);
+        return 0;
+    }
+    view->bytes = (const uint8_t*)MapViewOfFile(view->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view->bytes) {
+        close_file_view(view);
         return 0;
     }
+    view->size = (size_t)file_size.QuadPart;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return 0;
     
-    CadFile_Init(data);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return 0;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return -1;
+    }
     
-    uint8_t tag;
-    int16_t index;
-    size_t bytes_read = 0;
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 0;
     
-    /* Check file size */
-    fseek(fp, 0, SEEK_END);
-    long file_size = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
+    view->map = map;
+    view->bytes = (const uint8_t*)map;
+    view->size = (size_t)st.st_size;
+#endif
+    return 1;
+}
+
+/* Map a stored record index to an array slot.
+   The file format appears to store some indices as byte offsets from the base
+   address, so fall back to dividing by the record size, then to the unsigned
+   16-bit interpretation. Returns -1 if no interpretation fits. */
+static int resolve_record_index(int16_t index, int max_count, int record_size) {
+    /* Check if it's a valid direct index first */
+    if (index >= 0 && index < max_count) return index;
     
-    if (file_size == 0) {
-        fprintf(stderr, "Error: File is empty\n");
-        fclose(fp);
-        return 0;
+    /* Try interpreting as byte offset - divide by structure size */
+    if (index > 0 && (index % record_size) == 0) {
+        int actual_index = index / record_size;
+        return actual_index < max_count ? actual_index : -1;
     }
     
-    fprintf(stdout, "Loading CAD file (size: %ld bytes)...\n", file_size);
+    /* Try as unsigned 16-bit value */
+    uint16_t uindex = (uint16_t)index;
+    return uindex < max_count ? (int)uindex : -1;
+}
+
+static inline uint16_t read_be_uint16(const uint8_t* p) {
+    return (uint16_t)(((unsigned)p[0] << 8) | (unsigned)p[1]);
+}
+
+static inline int16_t read_be_int16(const uint8_t* p) {
+    return (int16_t)read_be_uint16(p);
+}
+
+static inline uint32_t read_be_uint32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline uint8_t* put_be_uint32(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)(value >> 24);
+    out[1] = (uint8_t)(value >> 16);
+    out[2] = (uint8_t)(value >> 8);
+    out[3] = (uint8_t)value;
+    return out + 4;
+}
+
+/* FNV-1a, used to detect torn journal appends */
+static uint32_t journal_checksum(const uint8_t* bytes, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Decode one big-endian record image */
+static void decode_object(const uint8_t* record, CadObject* obj) {
+    CadCodec_DecodeObjects(obj, record, 1);
+}
+
+static void decode_polygon(const uint8_t* record, CadPolygon* poly) {
+    CadCodec_DecodePolygons(poly, record, 1);
+}
+
+static void decode_point(const uint8_t* record, CadPoint* pt) {
+    CadCodec_DecodePoints(pt, record, 1);
+}
+
+/* ----------------------------------------------------------------------------
+   Record sink
+   Decoders hand every record to a sink, which either stores it in a
+   CadFileData or passes it to a CadRecordVisitor. Sink calls return 0 once
+   the visitor has asked to stop.
+   ---------------------------------------------------------------------------- */
+typedef struct {
+    CadFileData* data;
+    const CadRecordVisitor* visitor;
+    void* user;
+    int stopped;
+    int failed;              /* The tables could not grow; data is incomplete */
+} RecordSink;
+
+/* Room for slot index (or a slot count) in the CadFileData being filled */
+static int sink_reserve(RecordSink* sink, int objects, int polygons, int points) {
+    if (CadFile_Reserve(sink->data, objects, polygons, points)) return 1;
+    sink->stopped = 1;
+    sink->failed = 1;
+    return 0;
+}
+
+static int sink_object(RecordSink* sink, int index, const CadObject* obj) {
+    if (sink->data) {
+        if (!sink_reserve(sink, index + 1, 0, 0)) return 0;
+        sink->data->objects[index] = *obj;
+        if (index >= sink->data->objectCount) sink->data->objectCount = index + 1;
+    } else if (sink->visitor->object && !sink->visitor->object(sink->user, index, obj)) {
+        sink->stopped = 1;
+    }
+    return !sink->stopped;
+}
+
+static int sink_polygon(RecordSink* sink, int index, const CadPolygon* poly) {
+    if (sink->data) {
+        if (!sink_reserve(sink, 0, index + 1, 0)) return 0;
+        sink->data->polygons[index] = *poly;
+        if (index >= sink->data->polygonCount) sink->data->polygonCount = index + 1;
+    } else if (sink->visitor->polygon && !sink->visitor->polygon(sink->user, index, poly)) {
+        sink->stopped = 1;
+    }
+    return !sink->stopped;
+}
+
+static int sink_point(RecordSink* sink, int index, const CadPoint* pt) {
+    if (sink->data) {
+        if (!sink_reserve(sink, 0, 0, index + 1)) return 0;
+        sink->data->points[index] = *pt;
+        if (index >= sink->data->pointCount) sink->data->pointCount = index + 1;
+    } else if (sink->visitor->point && !sink->visitor->point(sink->user, index, pt)) {
+        sink->stopped = 1;
+    }
+    return !sink->stopped;
+}
+
+/* Slot counts from a container header (they may include trailing free slots) */
+static void sink_counts(RecordSink* sink, int objects, int polygons, int points) {
+    if (!sink->data || !sink_reserve(sink, objects, polygons, points)) return;
+    if (objects > sink->data->objectCount) sink->data->objectCount = objects;
+    if (polygons > sink->data->polygonCount) sink->data->polygonCount = polygons;
+    if (points > sink->data->pointCount) sink->data->pointCount = points;
+}
+
+static void sink_format(RecordSink* sink, CadFileFormat format) {
+    if (sink->data) sink->data->format = format;
+}
+
+/* Journal segment: tag, big-endian payload length, big-endian checksum, payload */
+#define CAD_JOURNAL_HEADER_SIZE (1 + 4 + 4)
+
+static int is_indexed_image(const uint8_t* bytes, size_t size);
+static int decode_indexed(const uint8_t* bytes, size_t size, RecordSink* sink);
+static int is_compact_image(const uint8_t* bytes, size_t size);
+static int decode_compact(const uint8_t* bytes, size_t size, RecordSink* sink);
+static int is_compressed_image(const uint8_t* bytes, size_t size);
+static int decode_compressed(const uint8_t* bytes, size_t size, RecordSink* sink);
+static int decode_image(const uint8_t* bytes, size_t size, RecordSink* sink);
+
+/* Decode tag/index/record triples; top-level streams may carry journal segments */
+static int decode_stream(const uint8_t* bytes, size_t size, RecordSink* sink, int in_journal) {
+    size_t pos = 0;
     
-    while (fread(&tag, sizeof(uint8_t), 1, fp) == 1) {
-        bytes_read++;
-        switch (tag) {
-        case CAD_TAG_OBJECT:
-            if (fread(&index, sizeof(int16_t), 1, fp) != 1) {
-                fprintf(stderr, "Error: Unexpected end of file while reading object index (at byte %zu)\n", bytes_read);
-                fclose(fp);
-                return 0;
-            }
-            /* Convert from big-endian if needed (file format appears to be big-endian) */
-            if (is_little_endian()) {
-                index = swap_int16(index);
-            }
-            /* Debug: print first few indices to understand format */
-            if (data->objectCount < 5) {
-                fprintf(stdout, "Debug: Object tag, index=%d (0x%04X) at byte %zu\n", index, (unsigned short)index, bytes_read);
-            }
-            if (index >= 0 && index < CAD_MAX_OBJECTS) {
-                CadObject temp_obj;
-                if (fread(&temp_obj, sizeof(CadObject), 1, fp) != 1) {
-                    fprintf(stderr, "Error: Failed to read object data for index %d (at byte %zu)\n", index, bytes_read);
-                    fclose(fp);
-                    return 0;
-                }
-                /* Convert endianness for multi-byte fields */
-                if (is_little_endian()) {
-                    temp_obj.parentObject = swap_int16(temp_obj.parentObject);
-                    temp_obj.nextBrother = swap_int16(temp_obj.nextBrother);
-                    temp_obj.childObject = swap_int16(temp_obj.childObject);
-                    temp_obj.firstPolygon = swap_int16(temp_obj.firstPolygon);
-                    temp_obj.offsetx = swap_double(temp_obj.offsetx);
-                    temp_obj.offsety = swap_double(temp_obj.offsety);
-                    temp_obj.offsetz = swap_double(temp_obj.offsetz);
-                }
-                data->objects[index] = temp_obj;
-                if (index >= data->objectCount) data->objectCount = index + 1;
-            } else {
-                fprintf(stderr, "Warning: Object index %d out of bounds (0-%d), skipping\n", index, CAD_MAX_OBJECTS - 1);
-                /* Skip the data for this invalid index */
-                fseek(fp, sizeof(CadObject), SEEK_CUR);
-            }
-            break;
-            
-        case CAD_TAG_POLYGON: {
-            if (fread(&index, sizeof(int16_t), 1, fp) != 1) {
-                fprintf(stderr, "Error: Unexpected end of file while reading polygon index (at byte %zu)\n", bytes_read);
-                fclose(fp);
-                return 0;
-            }
-            /* Convert from big-endian if needed (file format appears to be big-endian) */
-            if (is_little_endian()) {
-                index = swap_int16(index);
-            }
-            /* The file format appears to store indices as byte offsets from base address */
-            /* Convert byte offset to array index */
-            int actual_index = -1;
-            
-            /* Check if it's a valid direct index first */
-            if (index >= 0 && index < CAD_MAX_POLYGONS) {
-                actual_index = index;
-            } else {
-                /* Try interpreting as byte offset - divide by structure size */
-                /* CadPolygon is typically 16 bytes with alignment */
-                const int poly_size = sizeof(CadPolygon);
-                if (index > 0 && (index % poly_size) == 0) {
-                    actual_index = index / poly_size;
-                    if (actual_index >= CAD_MAX_POLYGONS) {
-                        actual_index = -1; /* Still out of bounds */
-                    }
-                } else {
-                    /* Try as unsigned 16-bit value */
-                    uint16_t uindex = (uint16_t)index;
-                    if (uindex < CAD_MAX_POLYGONS) {
-                        actual_index = uindex;
-                    }
-                }
-            }
-            
-            if (actual_index >= 0 && actual_index < CAD_MAX_POLYGONS) {
-                index = actual_index;
-                CadPolygon temp_poly;
-                if (fread(&temp_poly, sizeof(CadPolygon), 1, fp) != 1) {
-                    fprintf(stderr, "Error: Failed to read polygon data for index %d (at byte %zu)\n", index, bytes_read);
-                    fclose(fp);
-                    return 0;
-                }
-                /* Convert endianness for multi-byte fields */
-                if (is_little_endian()) {
-                    temp_poly.nextPolygon = swap_int16(temp_poly.nextPolygon);
-                    temp_poly.firstPoint = swap_int16(temp_poly.firstPoint);
-                    temp_poly.animation = swap_int16(temp_poly.animation);
-                    temp_poly.both = swap_int16(temp_poly.both);
-                }
-                data->polygons[index] = temp_poly;
-                if (index >= data->polygonCount) data->polygonCount = index + 1;
-            } else {
-                fprintf(stderr, "Warning: Polygon index %d out of bounds (0-%d), skipping\n", index, CAD_MAX_POLYGONS - 1);
-                /* Skip the data for this invalid index */
-                fseek(fp, sizeof(CadPolygon), SEEK_CUR);
-            }
-            break;
-        }
-            
-        case CAD_TAG_POINT: {
-            if (fread(&index, sizeof(int16_t), 1, fp) != 1) {
-                fprintf(stderr, "Error: Unexpected end of file while reading point index (at byte %zu)\n", bytes_read);
-                fclose(fp);
-                return 0;
-            }
-            /* Convert from big-endian if needed (file format appears to be big-endian) */
-            if (is_little_endian()) {
-                index = swap_int16(index);
-            }
-            /* The file format appears to store indices as byte offsets from base address */
-            /* Convert byte offset to array index */
-            int actual_index = -1;
-            
-            /* Check if it's a valid direct index first */
-            if (index >= 0 && index < CAD_MAX_POINTS) {
-                actual_index = index;
-            } else {
-                /* Try interpreting as byte offset - divide by structure size */
-                /* CadPoint is typically 32 bytes with alignment (2+2+2+8+8+8 = 30, aligned to 32) */
-                const int point_size = sizeof(CadPoint);
-                if (index > 0 && (index % point_size) == 0) {
-                    actual_index = index / point_size;
-                    if (actual_index >= CAD_MAX_POINTS) {
-                        actual_index = -1; /* Still out of bounds */
-                    }
-                } else {
-                    /* Try as unsigned 16-bit value */
-                    uint16_t uindex = (uint16_t)index;
-                    if (uindex < CAD_MAX_POINTS) {
-                        actual_index = uindex;
-                    }
-                }
+    while (pos < size) {
+        uint8_t tag = bytes[pos];
+        size_t tag_pos = pos;
+        size_t record_size;
+        
+        if (tag == CAD_TAG_JOURNAL && !in_journal) {
+            /* A segment cut short by a crash is dropped along with anything after it */
+            if (size - pos < CAD_JOURNAL_HEADER_SIZE) {
+                fprintf(stderr, "Warning: Ignoring incomplete journal segment at byte %zu\n", tag_pos + 1);
+                break;
             }
-            
-            if (actual_index >= 0 && actual_index < CAD_MAX_POINTS) {
-                index = actual_index;
-                CadPoint temp_point;
-                if (fread(&temp_point, sizeof(CadPoint), 1, fp) != 1) {
-                    fprintf(stderr, "Error: Failed to read point data for index %d (at byte %zu)\n", index, bytes_read);
-                    fclose(fp);
-                    return 0;
-                }
-                /* Convert endianness for multi-byte fields */
-                if (is_little_endian()) {
-                    temp_point.nextPoint = swap_int16(temp_point.nextPoint);
-                    temp_point.pointx = swap_double(temp_point.pointx);
-                    temp_point.pointy = swap_double(temp_point.pointy);
-                    temp_point.pointz = swap_double(temp_point.pointz);
-                }
-                data->points[index] = temp_point;
-                if (index >= data->pointCount) data->pointCount = index + 1;
-            } else {
-                fprintf(stderr, "Warning: Point index %d out of bounds (0-%d), skipping\n", index, CAD_MAX_POINTS - 1);
-                /* Skip the data for this invalid index */
-                fseek(fp, sizeof(CadPoint), SEEK_CUR);
+            uint32_t length = read_be_uint32(bytes + pos + 1);
+            uint32_t checksum = read_be_uint32(bytes + pos + 5);
+            const uint8_t* payload = bytes + pos + CAD_JOURNAL_HEADER_SIZE;
+            if (size - pos - CAD_JOURNAL_HEADER_SIZE < length || journal_checksum(payload, length) != checksum) {
+                fprintf(stderr, "Warning: Ignoring incomplete journal segment at byte %zu\n", tag_pos + 1);
+                break;
             }
-            break;
+            if (!decode_stream(payload, length, sink, 1)) return 0;
+            if (sink->stopped) return 1;
+            if (sink->data) sink->data->journalSegments++;
+            pos += CAD_JOURNAL_HEADER_SIZE + length;
+            continue;
         }
-            
+        
+        switch (tag) {
+        case CAD_TAG_OBJECT:  record_size = CAD_OBJECT_RECORD_SIZE;  break;
+        case CAD_TAG_POLYGON: record_size = CAD_POLYGON_RECORD_SIZE; break;
+        case CAD_TAG_POINT:   record_size = CAD_POINT_RECORD_SIZE;   break;
         default:
             /* Unknown tag - this might indicate a different file format */
-            fprintf(stderr, "Error: Unknown tag %d (0x%02X) encountered at byte %zu (expected 0=Object, 1=Polygon, 2=Point)\n", tag, tag, bytes_read);
+            fprintf(stderr, "Error: Unknown tag %d (0x%02X) encountered at byte %zu (expected 0=Object, 1=Polygon, 2=Point)\n", tag, tag, tag_pos + 1);
             fprintf(stderr, "This might indicate the file uses a different format or is corrupted.\n");
-            /* Try to read a few more bytes to see what's in the file */
-            uint8_t peek[16];
-            long pos = ftell(fp);
-            if (fread(peek, 1, sizeof(peek), fp) > 0) {
+            if (tag_pos + 1 < size) {
                 fprintf(stderr, "Next 16 bytes: ");
-                for (int i = 0; i < 16 && i < sizeof(peek); i++) {
-                    fprintf(stderr, "%02X ", peek[i]);
+                for (size_t i = tag_pos + 1; i < size && i < tag_pos + 17; i++) {
+                    fprintf(stderr, "%02X ", bytes[i]);
                 }
                 fprintf(stderr, "\n");
-                fseek(fp, pos, SEEK_SET);
             }
-            fclose(fp);
             return 0;
         }
+        
+        if (size - pos < 1 + sizeof(int16_t)) {
+            fprintf(stderr, "Error: Unexpected end of file while reading record index (at byte %zu)\n", tag_pos + 1);
+            return 0;
+        }
+        /* Indices are stored big-endian */
+        int16_t index = read_be_int16(bytes + pos + 1);
+        pos += 1 + sizeof(int16_t);
+        
+        /* Record streams keep the original limits */
+        int actual_index;
+        if (tag == CAD_TAG_OBJECT) {
+            actual_index = (index >= 0 && index < CAD_LEGACY_MAX_OBJECTS) ? index : -1;
+        } else if (tag == CAD_TAG_POLYGON) {
+            actual_index = resolve_record_index(index, CAD_LEGACY_MAX_POLYGONS, (int)CAD_POLYGON_RECORD_SIZE);
+        } else {
+            actual_index = resolve_record_index(index, CAD_LEGACY_MAX_POINTS, (int)CAD_POINT_RECORD_SIZE);
+        }
+        
+        if (actual_index < 0) {
+            const char* kind = (tag == CAD_TAG_OBJECT) ? "Object" : (tag == CAD_TAG_POLYGON) ? "Polygon" : "Point";
+            int max_count = (tag == CAD_TAG_OBJECT) ? CAD_LEGACY_MAX_OBJECTS : (tag == CAD_TAG_POLYGON) ? CAD_LEGACY_MAX_POLYGONS : CAD_LEGACY_MAX_POINTS;
+            fprintf(stderr, "Warning: %s index %d out of bounds (0-%d), skipping\n", kind, index, max_count - 1);
+            /* Skip the data for this invalid index */
+            pos += record_size;
+            continue;
+        }
+        
+        if (size - pos < record_size) {
+            fprintf(stderr, "Error: Failed to read record data for index %d (at byte %zu)\n", actual_index, tag_pos + 1);
+            return 0;
+        }
+        const uint8_t* record = bytes + pos;
+        pos += record_size;
+        if (in_journal && sink->data) sink->data->journalRecords++;
+        
+        int more;
+        switch (tag) {
+        case CAD_TAG_OBJECT: {
+            CadObject obj;
+            decode_object(record, &obj);
+            more = sink_object(sink, actual_index, &obj);
+            break;
+        }
+        case CAD_TAG_POLYGON: {
+            CadPolygon poly;
+            decode_polygon(record, &poly);
+            more = sink_polygon(sink, actual_index, &poly);
+            break;
+        }
+        default: {
+            CadPoint pt;
+            decode_point(record, &pt);
+            more = sink_point(sink, actual_index, &pt);
+            break;
+        }
+        }
+        if (!more) return 1;
     }
     
-    fclose(fp);
     return 1;
 }
 
-int CadFile_Save(const char* filename, const CadFileData* data) {
-    if (!filename || !data) {
-        fprintf(stderr, "Error: Invalid parameters to CadFile_Save\n");
+/* Pick the decoder from the leading bytes */
+static int decode_image(const uint8_t* bytes, size_t size, RecordSink* sink) {
+    if (is_indexed_image(bytes, size)) {
+        return decode_indexed(bytes, size, sink);
+    }
+    if (is_compact_image(bytes, size)) {
+        return decode_compact(bytes, size, sink);
+    }
+    if (is_compressed_image(bytes, size)) {
+        return decode_compressed(bytes, size, sink);
+    }
+    return decode_stream(bytes, size, sink, 0);
+}
+
+int CadFile_LoadFromBuffer(const void* buffer, size_t size, CadFileData* data) {
+    if (!buffer || !data) {
+        fprintf(stderr, "Error: Invalid parameters to CadFile_LoadFromBuffer\n");
         return 0;
     }
     
-    /* Convert UTF-8 filename to wide string for Windows */
-    wchar_t wfilename[MAX_PATH * 2] = {0};
-    int wlen = MultiByteToWideChar(CP_UTF8, 0, filename, -1, wfilename, sizeof(wfilename) / sizeof(wfilename[0]));
-    if (wlen <= 0) {
-        fprintf(stderr, "Error: Failed to convert filename to wide string: '%s'\n", filename);
+    CadFile_Clear(data);
+    
+    RecordSink sink = { data, NULL, NULL, 0, 0 };
+    return decode_image((const uint8_t*)buffer, size, &sink) && !sink.failed;
+}
+
+int CadFile_Load(const char* filename, CadFileData* data) {
+    if (!filename || !data) {
+        fprintf(stderr, "Error: Invalid parameters to CadFile_Load\n");
         return 0;
     }
     
-    FILE* fp = _wfopen(wfilename, L"wb");
-    if (!fp) {
-        fprintf(stderr, "Error: Could not open file '%s' for writing\n", filename);
+    FileView view;
+    int opened = open_file_view(filename, &view);
+    if (opened < 0) {
+        fprintf(stderr, "Error: File is empty\n");
+        return 0;
+    }
+    if (!opened) {
+        fprintf(stderr, "Error: Could not open file '%s' for reading\n", filename);
         return 0;
     }
     
+    size_t file_size = view.size;
+    int result = CadFile_LoadFromBuffer(view.bytes, file_size, data);
+    close_file_view(&view);
+    
+    if (result) {
+        fprintf(stdout, "Loaded CAD file '%s' (%zu bytes, %d objects, %d polygons, %d points)\n",
+                filename, file_size, data->objectCount, data->polygonCount, data->pointCount);
+    }
+    return result;
+}
+
+/* Size of one tag/index/record triple in the .cad stream */
+#define CAD_TRIPLE_HEADER_SIZE (sizeof(uint8_t) + sizeof(int16_t))
+
+static uint8_t* put_record_header(uint8_t* out, uint8_t tag, int index) {
+    /* Index is stored big-endian */
+    out[0] = tag;
+    out[1] = (uint8_t)((uint16_t)index >> 8);
+    out[2] = (uint8_t)index;
+    return out + CAD_TRIPLE_HEADER_SIZE;
+}
+
+size_t CadFile_GetSaveSize(const CadFileData* data) {
+    if (!data || !CadFile_FitsLegacy(data)) return 0;
+    
+    size_t size = 0;
+    for (int i = 0; i < data->objectCount; i++) {
+        if (data->objects[i].flags != 0) size += CAD_TRIPLE_HEADER_SIZE + CAD_OBJECT_RECORD_SIZE;
+    }
+    for (int i = 0; i < data->polygonCount; i++) {
+        if (data->polygons[i].flags != 0) size += CAD_TRIPLE_HEADER_SIZE + CAD_POLYGON_RECORD_SIZE;
+    }
+    for (int i = 0; i < data->pointCount; i++) {
+        if (data->points[i].flags != 0) size += CAD_TRIPLE_HEADER_SIZE + CAD_POINT_RECORD_SIZE;
+    }
+    return size;
+}
+
+/* Encode one record image in big-endian form; returns the end of the written bytes */
+static uint8_t* encode_object_body(uint8_t* out, const CadObject* obj) {
+    CadCodec_EncodeObjects(out, obj, 1);
+    return out + CAD_OBJECT_RECORD_SIZE;
+}
+
+static uint8_t* encode_polygon_body(uint8_t* out, const CadPolygon* poly) {
+    CadCodec_EncodePolygons(out, poly, 1);
+    return out + CAD_POLYGON_RECORD_SIZE;
+}
+
+static uint8_t* encode_point_body(uint8_t* out, const CadPoint* pt) {
+    CadCodec_EncodePoints(out, pt, 1);
+    return out + CAD_POINT_RECORD_SIZE;
+}
+
+/* Encode one tag/index/record triple */
+static uint8_t* encode_object(uint8_t* out, int index, const CadObject* obj) {
+    return encode_object_body(put_record_header(out, CAD_TAG_OBJECT, index), obj);
+}
+
+static uint8_t* encode_polygon(uint8_t* out, int index, const CadPolygon* poly) {
+    return encode_polygon_body(put_record_header(out, CAD_TAG_POLYGON, index), poly);
+}
+
+static uint8_t* encode_point(uint8_t* out, int index, const CadPoint* pt) {
+    return encode_point_body(put_record_header(out, CAD_TAG_POINT, index), pt);
+}
+
+size_t CadFile_EncodeToBuffer(const CadFileData* data, void* buffer, size_t capacity) {
+    if (!data || !buffer || !CadFile_FitsLegacy(data)) return 0;
+    
+    size_t needed = CadFile_GetSaveSize(data);
+    if (capacity < needed) return 0;
+    
+    uint8_t* out = (uint8_t*)buffer;
+    
     /* Write all objects */
     for (int i = 0; i < data->objectCount; i++) {
-        if (data->objects[i].flags != 0) {
-            uint8_t tag = CAD_TAG_OBJECT;
-            int16_t index = (int16_t)i;
-            
-            /* Convert index to big-endian if needed */
-            if (is_little_endian()) {
-                index = swap_int16(index);
-            }
-            
-            fwrite(&tag, sizeof(uint8_t), 1, fp);
-            fwrite(&index, sizeof(int16_t), 1, fp);
-            
-            /* Convert object to big-endian and write */
-            CadObject obj = data->objects[i];
-            if (is_little_endian()) {
-                obj.parentObject = swap_int16(obj.parentObject);
-                obj.nextBrother = swap_int16(obj.nextBrother);
-                obj.childObject = swap_int16(obj.childObject);
-                obj.firstPolygon = swap_int16(obj.firstPolygon);
-                obj.offsetx = swap_double(obj.offsetx);
-                obj.offsety = swap_double(obj.offsety);
-                obj.offsetz = swap_double(obj.offsetz);
-            }
-            fwrite(&obj, sizeof(CadObject), 1, fp);
-        }
+        if (data->objects[i].flags != 0) out = encode_object(out, i, &data->objects[i]);
     }
     
     /* Write all polygons */
     for (int i = 0; i < data->polygonCount; i++) {
-        if (data->polygons[i].flags != 0) {
-            uint8_t tag = CAD_TAG_POLYGON;
-            int16_t index = (int16_t)i;
-            
-            /* Convert index to big-endian if needed */
-            if (is_little_endian()) {
-                index = swap_int16(index);
-            }
-            
-            fwrite(&tag, sizeof(uint8_t), 1, fp);
-            fwrite(&index, sizeof(int16_t), 1, fp);
-            
-            /* Convert polygon to big-endian and write */
-            CadPolygon poly = data->polygons[i];
-            if (is_little_endian()) {
-                poly.nextPolygon = swap_int16(poly.nextPolygon);
-                poly.firstPoint = swap_int16(poly.firstPoint);
-                poly.animation = swap_int16(poly.animation);
-                poly.both = swap_int16(poly.both);
-            }
-            fwrite(&poly, sizeof(CadPolygon), 1, fp);
-        }
+        if (data->polygons[i].flags != 0) out = encode_polygon(out, i, &data->polygons[i]);
     }
     
     /* Write all points */
     for (int i = 0; i < data->pointCount; i++) {
-        if (data->points[i].flags != 0) {
-            uint8_t tag = CAD_TAG_POINT;
-            int16_t index = (int16_t)i;
-            
-            /* Convert index to big-endian if needed */
-            if (is_little_endian()) {
-                index = swap_int16(index);
-            }
-            
-            fwrite(&tag, sizeof(uint8_t), 1, fp);
-            fwrite(&index, sizeof(int16_t), 1, fp);
-            
-            /* Convert point to big-endian and write */
-            CadPoint pt = data->points[i];
-            if (is_little_endian()) {
-                pt.nextPoint = swap_int16(pt.nextPoint);
-                pt.pointx = swap_double(pt.pointx);
-                pt.pointy = swap_double(pt.pointy);
-                pt.pointz = swap_double(pt.pointz);
-            }
-            fwrite(&pt, sizeof(CadPoint), 1, fp);
-        }
+        if (data->points[i].flags != 0) out = encode_point(out, i, &data->points[i]);
+    }
+    
+    return (size_t)(out - (uint8_t*)buffer);
+}
+
+int CadFile_SaveToBuffer(const CadFileData* data, uint8_t** out_buffer, size_t* out_size) {
+    if (!data || !out_buffer || !out_size) {
+        fprintf(stderr, "Error: Invalid parameters to CadFile_SaveToBuffer\n");
+        return 0;
+    }
+    
+    *out_buffer = NULL;
+    *out_size = 0;
+    
+    if (!CadFile_FitsLegacy(data)) {
+        fprintf(stderr, "Error: Model exceeds the legacy .cad limits (%d objects, %d polygons, %d points)\n",
+                CAD_LEGACY_MAX_OBJECTS, CAD_LEGACY_MAX_POLYGONS, CAD_LEGACY_MAX_POINTS);
+        return 0;
+    }
+    
+    size_t size = CadFile_GetSaveSize(data);
+    /* Always hand back a valid allocation, even for an empty model */
+    uint8_t* buffer = (uint8_t*)malloc(size > 0 ? size : 1);
+    if (!buffer) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 0;
+    }
+    
+    if (size > 0 && CadFile_EncodeToBuffer(data, buffer, size) != size) {
+        free(buffer);
+        return 0;
     }
     
-    fclose(fp);
+    *out_buffer = buffer;
+    *out_size = size;
     return 1;
 }
 
+void CadFile_FreeBuffer(uint8_t* buffer) {
+    free(buffer);
+}
+
+static FILE* open_file_for_writing(const char* filename) {
+#ifdef _WIN32
+    wchar_t wfilename[MAX_PATH * 2] = {0};
+    if (!to_wide_path(filename, wfilename, sizeof(wfilename) / sizeof(wfilename[0]))) return NULL;
+    return _wfopen(wfilename, L"wb");
+#else
+    return fopen(filename, "wb");
+#endif
+}
+
+/* Atomically replace dst with src (both must be on the same volume) */
+static int replace_file(const char* src, const char* dst) {
+#ifdef _WIN32
+    wchar_t wsrc[MAX_PATH * 2] = {0};
+    wchar_t wdst[MAX_PATH * 2] = {0};
+    if (!to_wide_path(src, wsrc, sizeof(wsrc) / sizeof(wsrc[0])) ||
+        !to_wide_path(dst, wdst, sizeof(wdst) / sizeof(wdst[0]))) {
+        return 0;
+    }
+    return MoveFileExW(wsrc, wdst, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(src, dst) == 0;
+#endif
+}
+
+static void remove_file(const char* filename) {
+#ifdef _WIN32
+    wchar_t wfilename[MAX_PATH * 2] = {0};
+    if (to_wide_path(filename, wfilename, sizeof(wfilename) / sizeof(wfilename[0]))) {
+        _wremove(wfilename);
+    }
+#else
+    remove(filename);
+#endif
+}
+
+int CadFile_WriteBufferAtomic(const char* filename, const void* buffer, size_t size) {
+    if (!filename || (!buffer && size > 0)) {
+        fprintf(stderr, "Error: Invalid parameters to CadFile_WriteBufferAtomic\n");
+        return 0;
+    }
+    
+    /* Write next to the target so the final rename stays on one volume */
+    char temp_filename[MAX_PATH * 2];
+    int len = snprintf(temp_filename, sizeof(temp_filename), "%s.tmp", filename);
+    if (len < 0 || len >= (int)sizeof(temp_filename)) {
+        fprintf(stderr, "Error: File name too long: '%s'\n", filename);
+        return 0;
+    }
+    
+    FILE* fp = open_file_for_writing(temp_filename);
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open file '%s' for writing\n", temp_filename);
+        return 0;
+    }
+    
+    int ok = (size == 0) || fwrite(buffer, 1, size, fp) == size;
+    
+    /* Flush to disk before the rename makes the new contents visible */
+    if (ok) ok = fflush(fp) == 0;
+#ifdef _WIN32
+    if (ok) ok = _commit(_fileno(fp)) == 0;
+#else
+    if (ok) ok = fsync(fileno(fp)) == 0;
+#endif
+    if (fclose(fp) != 0) ok = 0;
+    
+    if (!ok) {
+        fprintf(stderr, "Error: Failed to write file '%s'\n", temp_filename);
+        remove_file(temp_filename);
+        return 0;
+    }
+    
+    if (!replace_file(temp_filename, filename)) {
+        fprintf(stderr, "Error: Could not replace '%s' with '%s'\n", filename, temp_filename);
+        remove_file(temp_filename);
+        return 0;
+    }
+    return 1;
+}
+
+int CadFile_SaveAtomic(const char* filename, const CadFileData* data) {
+    if (!filename || !data) {
+        fprintf(stderr, "Error: Invalid parameters to CadFile_SaveAtomic\n");
+        return 0;
+    }
+    
+    uint8_t* buffer;
+    size_t size;
+    if (!CadFile_SaveToBuffer(data, &buffer, &size)) {
+        return 0;
+    }
+    
+    int ok = CadFile_WriteBufferAtomic(filename, buffer, size);
+    CadFile_FreeBuffer(buffer);
+    return ok;
+}
+
+int CadFile_Save(const char* filename, const CadFileData* data) {
+    if (!filename || !data) {
+        fprintf(stderr, "Error: Invalid parameters to CadFile_Save\n");
+        return 0;
+    }
+    
+    uint8_t* buffer;
+    size_t size;
+    if (!CadFile_SaveToBuffer(data, &buffer, &size)) {
+        return 0;
+    }
+    
+    FILE* fp = open_file_for_writing(filename);
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open file '%s' for writing\n", filename);
+        CadFile_FreeBuffer(buffer);
+        return 0;
+    }
+    
+    /* One write for the whole file */
+    int ok = (size == 0) || fwrite(buffer, 1, size, fp) == size;
+    if (fclose(fp) != 0) ok = 0;
+    CadFile_FreeBuffer(buffer);
+    
+    if (!ok) {
+        fprintf(stderr, "Error: Failed to write file '%s'\n", filename);
+        return 0;
+    }
+    return 1;
+}
+
+/* ----------------------------------------------------------------------------
+   Indexed container (v2)
+   Header, then one big-endian uint32 offset per object, polygon and point
+   slot (CAD_V2_NO_RECORD for free slots), then the record images without
+   their tag/index prefix. Journal segments may follow the container.
+   ---------------------------------------------------------------------------- */
+static const uint8_t CAD_V2_MAGIC[4] = { 'C', 'A', 'D', '2' };
+#define CAD_V2_VERSION     2
+#define CAD_V2_HEADER_SIZE 24
+#define CAD_V2_NO_RECORD   0xFFFFFFFFu
+
+typedef struct {
+    uint16_t flags;
+    int objectCount;
+    int polygonCount;
+    int pointCount;
+    const uint8_t* table;
+    const uint8_t* records;
+    size_t recordsSize;
+    size_t end;              /* Byte just past the container */
+} IndexedView;
+
+static inline uint8_t* put_be_uint16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)(value >> 8);
+    out[1] = (uint8_t)value;
+    return out + 2;
+}
+
+static int is_indexed_image(const uint8_t* bytes, size_t size) {
+    return size >= sizeof(CAD_V2_MAGIC) && memcmp(bytes, CAD_V2_MAGIC, sizeof(CAD_V2_MAGIC)) == 0;
+}
+
+static int parse_indexed_header(const uint8_t* bytes, size_t size, IndexedView* view) {
+    memset(view, 0, sizeof(IndexedView));
+    if (size < CAD_V2_HEADER_SIZE) {
+        fprintf(stderr, "Error: Truncated .cad v2 header\n");
+        return 0;
+    }
+    uint16_t version = read_be_uint16(bytes + 4);
+    if (version != CAD_V2_VERSION) {
+        fprintf(stderr, "Error: Unsupported .cad container version %u\n", version);
+        return 0;
+    }
+    view->flags = read_be_uint16(bytes + 6);
+    view->objectCount = read_be_uint16(bytes + 8);
+    view->polygonCount = read_be_uint16(bytes + 10);
+    view->pointCount = read_be_uint16(bytes + 12);
+    uint32_t records_offset = read_be_uint32(bytes + 16);
+    uint32_t records_size = read_be_uint32(bytes + 20);
+    
+    size_t table_size = 4 * (size_t)(view->objectCount + view->polygonCount + view->pointCount);
+    if (view->objectCount > CAD_LEGACY_MAX_OBJECTS || view->polygonCount > CAD_LEGACY_MAX_POLYGONS ||
+        view->pointCount > CAD_LEGACY_MAX_POINTS ||
+        records_offset < CAD_V2_HEADER_SIZE + table_size ||
+        records_offset > size || size - records_offset < records_size) {
+        fprintf(stderr, "Error: Corrupt .cad v2 header\n");
+        return 0;
+    }
+    view->table = bytes + CAD_V2_HEADER_SIZE;
+    view->records = bytes + records_offset;
+    view->recordsSize = records_size;
+    view->end = (size_t)records_offset + records_size;
+    
+    /* A slot pointing past the records means the file is truncated or
+       corrupt; loading it with that slot free would hide the damage */
+    const int counts[3] = { view->objectCount, view->polygonCount, view->pointCount };
+    const size_t sizes[3] = { CAD_OBJECT_RECORD_SIZE, CAD_POLYGON_RECORD_SIZE, CAD_POINT_RECORD_SIZE };
+    const uint8_t* entry = view->table;
+    for (int kind = 0; kind < 3; kind++) {
+        for (int i = 0; i < counts[kind]; i++, entry += 4) {
+            uint32_t offset = read_be_uint32(entry);
+            if (offset == CAD_V2_NO_RECORD) continue;
+            if (offset > records_size || records_size - offset < sizes[kind]) {
+                fprintf(stderr, "Error: Corrupt .cad v2 record table (slot %d of %s)\n", i,
+                        kind == 0 ? "objects" : kind == 1 ? "polygons" : "points");
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static int indexed_slot_exists(const IndexedView* view, uint8_t tag, int index) {
+    int count = (tag == CAD_TAG_OBJECT) ? view->objectCount : (tag == CAD_TAG_POLYGON) ? view->polygonCount : view->pointCount;
+    return index < count;
+}
+
+/* Record image for a slot; NULL for free slots (parse_indexed_header has
+   rejected tables with offsets outside the records) */
+static const uint8_t* indexed_record(const IndexedView* view, uint8_t tag, int index) {
+    int first, count;
+    size_t record_size;
+    switch (tag) {
+    case CAD_TAG_OBJECT:
+        first = 0; count = view->objectCount; record_size = CAD_OBJECT_RECORD_SIZE;
+        break;
+    case CAD_TAG_POLYGON:
+        first = view->objectCount; count = view->polygonCount; record_size = CAD_POLYGON_RECORD_SIZE;
+        break;
+    default:
+        first = view->objectCount + view->polygonCount; count = view->pointCount; record_size = CAD_POINT_RECORD_SIZE;
+        break;
+    }
+    if (index < 0 || index >= count) return NULL;
+    
+    uint32_t offset = read_be_uint32(view->table + 4 * (size_t)(first + index));
+    if (offset == CAD_V2_NO_RECORD) return NULL;
+    if (offset > view->recordsSize || view->recordsSize - offset < record_size) return NULL;
+    return view->records + offset;
+}
+
+/* Number of slots from index on that are all free (record == NULL) or all
+   stored back to back starting at record */
+static int indexed_run(const IndexedView* view, uint8_t tag, int index, const uint8_t* record, size_t record_size) {
+    int run = 1;
+    for (;;) {
+        const uint8_t* next = indexed_record(view, tag, index + run);
+        if (record ? next != record + run * record_size : (next != NULL || !indexed_slot_exists(view, tag, index + run))) break;
+        run++;
+    }
+    return run;
+}
+
+static int decode_indexed(const uint8_t* bytes, size_t size, RecordSink* sink) {
+    IndexedView view;
+    if (!parse_indexed_header(bytes, size, &view)) return 0;
+    
+    const uint8_t* record;
+    int run;
+    if (sink->data) {
+        /* Runs of slots whose records are stored back to back decode in one codec call */
+        CadFileData* data = sink->data;
+        if (!sink_reserve(sink, view.objectCount, view.polygonCount, view.pointCount)) return 1;
+        for (int i = 0; i < view.objectCount; i += run) {
+            record = indexed_record(&view, CAD_TAG_OBJECT, i);
+            run = indexed_run(&view, CAD_TAG_OBJECT, i, record, CAD_OBJECT_RECORD_SIZE);
+            if (record) CadCodec_DecodeObjects(&data->objects[i], record, (size_t)run);
+        }
+        for (int i = 0; i < view.polygonCount; i += run) {
+            record = indexed_record(&view, CAD_TAG_POLYGON, i);
+            run = indexed_run(&view, CAD_TAG_POLYGON, i, record, CAD_POLYGON_RECORD_SIZE);
+            if (record) CadCodec_DecodePolygons(&data->polygons[i], record, (size_t)run);
+        }
+        for (int i = 0; i < view.pointCount; i += run) {
+            record = indexed_record(&view, CAD_TAG_POINT, i);
+            run = indexed_run(&view, CAD_TAG_POINT, i, record, CAD_POINT_RECORD_SIZE);
+            if (record) CadCodec_DecodePoints(&data->points[i], record, (size_t)run);
+        }
+    } else {
+        CadObject obj;
+        CadPolygon poly;
+        CadPoint pt;
+        for (int i = 0; i < view.objectCount; i++) {
+            if ((record = indexed_record(&view, CAD_TAG_OBJECT, i)) == NULL) continue;
+            decode_object(record, &obj);
+            if (!sink_object(sink, i, &obj)) return 1;
+        }
+        for (int i = 0; i < view.polygonCount; i++) {
+            if ((record = indexed_record(&view, CAD_TAG_POLYGON, i)) == NULL) continue;
+            decode_polygon(record, &poly);
+            if (!sink_polygon(sink, i, &poly)) return 1;
+        }
+        for (int i = 0; i < view.pointCount; i++) {
+            if ((record = indexed_record(&view, CAD_TAG_POINT, i)) == NULL) continue;
+            decode_point(record, &pt);
+            if (!sink_point(sink, i, &pt)) return 1;
+        }
+    }
+    sink_counts(sink, view.objectCount, view.polygonCount, view.pointCount);
+    sink_format(sink, CAD_FORMAT_INDEXED);
+    
+    /* Incremental saves append journal segments after the container */
+    return decode_stream(bytes + view.end, size - view.end, sink, 0);
+}
+
+static size_t indexed_save_size(const CadFileData* data) {
+    size_t size = CAD_V2_HEADER_SIZE + 4 * (size_t)(data->objectCount + data->polygonCount + data->pointCount);
+    for (int i = 0; i < data->objectCount; i++) {
+        if (data->objects[i].flags != 0) size += CAD_OBJECT_RECORD_SIZE;
+    }
+    for (int i = 0; i < data->polygonCount; i++) {
+        if (data->polygons[i].flags != 0) size += CAD_POLYGON_RECORD_SIZE;
+    }
+    for (int i = 0; i < data->pointCount; i++) {
+        if (data->points[i].flags != 0) size += CAD_POINT_RECORD_SIZE;
+    }
+    return size;
+}
+
+static size_t encode_indexed(const CadFileData* data, uint8_t* buffer) {
+    size_t table_count = (size_t)(data->objectCount + data->polygonCount + data->pointCount);
+    uint8_t* table = buffer + CAD_V2_HEADER_SIZE;
+    uint8_t* records = table + 4 * table_count;
+    uint8_t* out = records;
+    
+    /* Runs of live slots are encoded with one codec call each */
+    int run;
+    for (int i = 0; i < data->objectCount; i += run) {
+        for (run = 0; i + run < data->objectCount && data->objects[i + run].flags != 0; run++) {
+            table = put_be_uint32(table, (uint32_t)(out - records + run * CAD_OBJECT_RECORD_SIZE));
+        }
+        CadCodec_EncodeObjects(out, &data->objects[i], (size_t)run);
+        out += run * CAD_OBJECT_RECORD_SIZE;
+        if (run == 0) {
+            table = put_be_uint32(table, CAD_V2_NO_RECORD);
+            run = 1;
+        }
+    }
+    for (int i = 0; i < data->polygonCount; i += run) {
+        for (run = 0; i + run < data->polygonCount && data->polygons[i + run].flags != 0; run++) {
+            table = put_be_uint32(table, (uint32_t)(out - records + run * CAD_POLYGON_RECORD_SIZE));
+        }
+        CadCodec_EncodePolygons(out, &data->polygons[i], (size_t)run);
+        out += run * CAD_POLYGON_RECORD_SIZE;
+        if (run == 0) {
+            table = put_be_uint32(table, CAD_V2_NO_RECORD);
+            run = 1;
+        }
+    }
+    for (int i = 0; i < data->pointCount; i += run) {
+        for (run = 0; i + run < data->pointCount && data->points[i + run].flags != 0; run++) {
+            table = put_be_uint32(table, (uint32_t)(out - records + run * CAD_POINT_RECORD_SIZE));
+        }
+        CadCodec_EncodePoints(out, &data->points[i], (size_t)run);
+        out += run * CAD_POINT_RECORD_SIZE;
+        if (run == 0) {
+            table = put_be_uint32(table, CAD_V2_NO_RECORD);
+            run = 1;
+        }
+    }
+    
+    uint8_t* header = buffer;
+    memcpy(header, CAD_V2_MAGIC, sizeof(CAD_V2_MAGIC));
+    header = put_be_uint16(header + 4, CAD_V2_VERSION);
+    header = put_be_uint16(header, 0);
+    header = put_be_uint16(header, (uint16_t)data->objectCount);
+    header = put_be_uint16(header, (uint16_t)data->polygonCount);
+    header = put_be_uint16(header, (uint16_t)data->pointCount);
+    header = put_be_uint16(header, 0);
+    header = put_be_uint32(header, (uint32_t)(records - buffer));
+    put_be_uint32(header, (uint32_t)(out - records));
+    
+    return (size_t)(out - buffer);
+}
+
+/* ----------------------------------------------------------------------------
+   Compact container
+   "CADC", version, coordinate mode, then per kind: live record count and the
+   live records in slot order, each prefixed by the number of free slots
+   skipped. Links are varints relative to a predicted index (0 = -1) and
+   padding is not stored. Coordinates are zigzag varint deltas when every
+   coordinate is an integer in int16 range, big-endian float64 otherwise.
+   ---------------------------------------------------------------------------- */
+static const uint8_t CAD_COMPACT_MAGIC[4] = { 'C', 'A', 'D', 'C' };
+#define CAD_COMPACT_VERSION      1
+#define CAD_COMPACT_INT16_COORDS 0x01
+
+/* Worst case encoded sizes, used to size the output buffer */
+#define CAD_COMPACT_MAX_VARINT   5
+#define CAD_COMPACT_MAX_OBJECT   (CAD_COMPACT_MAX_VARINT * 5 + 2 + 3 * 8)
+#define CAD_COMPACT_MAX_POLYGON  (CAD_COMPACT_MAX_VARINT * 5 + 2 + 3)
+#define CAD_COMPACT_MAX_POINT    (CAD_COMPACT_MAX_VARINT * 2 + 2 + 3 * 8)
+
+/* Smallest encoded sizes (one-byte varints), less the coordinates, used to
+   reject header counts the remaining input cannot hold */
+#define CAD_COMPACT_MIN_OBJECT   (1 + 2 + 4)
+#define CAD_COMPACT_MIN_POLYGON  (1 + 2 + 4 + 3)
+#define CAD_COMPACT_MIN_POINT    (1 + 2 + 1)
+
+/* Free slots cost no record, so they are bounded loosely: up to this many
+   per remaining input byte (one 7-bit varint digit of gap), but always at
+   least CAD_COMPACT_FREE_SLACK (a model whose tail was deleted) */
+#define CAD_COMPACT_FREE_PER_BYTE 128
+#define CAD_COMPACT_FREE_SLACK    65536
+
+static int is_compact_image(const uint8_t* bytes, size_t size) {
+    return size >= sizeof(CAD_COMPACT_MAGIC) && memcmp(bytes, CAD_COMPACT_MAGIC, sizeof(CAD_COMPACT_MAGIC)) == 0;
+}
+
+static inline uint32_t zigzag_encode(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t zigzag_decode(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static uint8_t* put_varint(uint8_t* out, uint32_t value) {
+    while (value >= 0x80) {
+        *out++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+    return out;
+}
+
+/* Link deltas wrap in 32 bits both ways, so no index pair can overflow */
+static uint8_t* put_link(uint8_t* out, CadIndex link, int predicted) {
+    return put_varint(out, link == -1 ? 0 : zigzag_encode((int32_t)((uint32_t)link - (uint32_t)predicted)) + 1);
+}
+
+static uint8_t* put_be_double(uint8_t* out, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (int k = 7; k >= 0; k--) {
+        *out++ = (uint8_t)(bits >> (k * 8));
+    }
+    return out;
+}
+
+static int is_int16_coordinate(double value) {
+    return value >= -32768.0 && value <= 32767.0 && value == (double)(int)value;
+}
+
+/* Integer coordinates only when the round trip is exact */
+static int compact_uses_int16(const CadFileData* data) {
+    for (int i = 0; i < data->objectCount; i++) {
+        const CadObject* obj = &data->objects[i];
+        if (obj->flags == 0) continue;
+        if (!is_int16_coordinate(obj->offsetx) || !is_int16_coordinate(obj->offsety) ||
+            !is_int16_coordinate(obj->offsetz)) return 0;
+    }
+    for (int i = 0; i < data->pointCount; i++) {
+        const CadPoint* pt = &data->points[i];
+        if (pt->flags == 0) continue;
+        if (!is_int16_coordinate(pt->pointx) || !is_int16_coordinate(pt->pointy) ||
+            !is_int16_coordinate(pt->pointz)) return 0;
+    }
+    return 1;
+}
+
+typedef struct {
+    int int16Coords;
+    int previous[3];         /* Last integer coordinate written/read (delta base) */
+} CompactCoords;
+
+static uint8_t* put_coords(uint8_t* out, CompactCoords* coords, double x, double y, double z) {
+    if (!coords->int16Coords) {
+        out = put_be_double(out, x);
+        out = put_be_double(out, y);
+        return put_be_double(out, z);
+    }
+    const int values[3] = { (int)x, (int)y, (int)z };
+    for (int k = 0; k < 3; k++) {
+        out = put_varint(out, zigzag_encode(values[k] - coords->previous[k]));
+        coords->previous[k] = values[k];
+    }
+    return out;
+}
+
+static size_t compact_save_bound(const CadFileData* data) {
+    return sizeof(CAD_COMPACT_MAGIC) + 2 + 6 * CAD_COMPACT_MAX_VARINT +
+           (size_t)data->objectCount * CAD_COMPACT_MAX_OBJECT +
+           (size_t)data->polygonCount * CAD_COMPACT_MAX_POLYGON +
+           (size_t)data->pointCount * CAD_COMPACT_MAX_POINT;
+}
+
+static size_t encode_compact(const CadFileData* data, uint8_t* buffer) {
+    CompactCoords coords;
+    memset(&coords, 0, sizeof(coords));
+    coords.int16Coords = compact_uses_int16(data);
+    
+    uint8_t* out = buffer;
+    memcpy(out, CAD_COMPACT_MAGIC, sizeof(CAD_COMPACT_MAGIC));
+    out += sizeof(CAD_COMPACT_MAGIC);
+    *out++ = CAD_COMPACT_VERSION;
+    *out++ = coords.int16Coords ? CAD_COMPACT_INT16_COORDS : 0;
+    
+    int live = 0, previous = -1;
+    for (int i = 0; i < data->objectCount; i++) live += data->objects[i].flags != 0;
+    out = put_varint(out, (uint32_t)data->objectCount);
+    out = put_varint(out, (uint32_t)live);
+    for (int i = 0; i < data->objectCount; i++) {
+        const CadObject* obj = &data->objects[i];
+        if (obj->flags == 0) continue;
+        out = put_varint(out, (uint32_t)(i - previous - 1));
+        previous = i;
+        *out++ = obj->flags;
+        *out++ = obj->selectFlag;
+        out = put_link(out, obj->parentObject, i);
+        out = put_link(out, obj->nextBrother, i + 1);
+        out = put_link(out, obj->childObject, i + 1);
+        out = put_link(out, obj->firstPolygon, 0);
+        out = put_coords(out, &coords, obj->offsetx, obj->offsety, obj->offsetz);
+    }
+    
+    /* Polygons usually own consecutive point runs, so predict firstPoint from the last one */
+    int predicted_point = 0;
+    live = 0;
+    previous = -1;
+    for (int i = 0; i < data->polygonCount; i++) live += data->polygons[i].flags != 0;
+    out = put_varint(out, (uint32_t)data->polygonCount);
+    out = put_varint(out, (uint32_t)live);
+    for (int i = 0; i < data->polygonCount; i++) {
+        const CadPolygon* poly = &data->polygons[i];
+        if (poly->flags == 0) continue;
+        out = put_varint(out, (uint32_t)(i - previous - 1));
+        previous = i;
+        *out++ = poly->flags;
+        *out++ = poly->selectFlag;
+        out = put_link(out, poly->nextPolygon, i + 1);
+        out = put_link(out, poly->firstPoint, predicted_point);
+        out = put_varint(out, zigzag_encode(poly->animation));
+        out = put_link(out, poly->both, i);
+        *out++ = poly->side;
+        *out++ = poly->color;
+        *out++ = poly->npoints;
+        if (poly->firstPoint != -1) predicted_point = (int)((uint32_t)poly->firstPoint + poly->npoints);
+    }
+    
+    live = 0;
+    previous = -1;
+    for (int i = 0; i < data->pointCount; i++) live += data->points[i].flags != 0;
+    out = put_varint(out, (uint32_t)data->pointCount);
+    out = put_varint(out, (uint32_t)live);
+    for (int i = 0; i < data->pointCount; i++) {
+        const CadPoint* pt = &data->points[i];
+        if (pt->flags == 0) continue;
+        out = put_varint(out, (uint32_t)(i - previous - 1));
+        previous = i;
+        *out++ = pt->flags;
+        *out++ = pt->selectFlag;
+        out = put_link(out, pt->nextPoint, i + 1);
+        out = put_coords(out, &coords, pt->pointx, pt->pointy, pt->pointz);
+    }
+    
+    return (size_t)(out - buffer);
+}
+
+/* Bounds-checked reader; ok drops to 0 on the first overrun */
+typedef struct {
+    const uint8_t* pos;
+    const uint8_t* end;
+    int ok;
+} CompactReader;
+
+static uint8_t get_byte(CompactReader* in) {
+    if (in->pos >= in->end) {
+        in->ok = 0;
+        return 0;
+    }
+    return *in->pos++;
+}
+
+static uint32_t get_varint(CompactReader* in) {
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        uint8_t byte = get_byte(in);
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    in->ok = 0;
+    return 0;
+}
+
+static CadIndex get_link(CompactReader* in, int predicted) {
+    uint32_t value = get_varint(in);
+    return value == 0 ? -1 : (CadIndex)((uint32_t)predicted + (uint32_t)zigzag_decode(value - 1));
+}
+
+static double get_be_double(CompactReader* in) {
+    double value = 0.0;
+    if (in->end - in->pos < (ptrdiff_t)sizeof(double)) {
+        in->ok = 0;
+        in->pos = in->end;
+        return value;
+    }
+    uint64_t bits = 0;
+    for (int k = 0; k < 8; k++) {
+        bits = (bits << 8) | *in->pos++;
+    }
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static void get_coords(CompactReader* in, CompactCoords* coords, double* x, double* y, double* z) {
+    if (!coords->int16Coords) {
+        *x = get_be_double(in);
+        *y = get_be_double(in);
+        *z = get_be_double(in);
+        return;
+    }
+    double* values[3] = { x, y, z };
+    for (int k = 0; k < 3; k++) {
+        /* Summed wide and range-checked, so a corrupt delta cannot overflow */
+        int64_t value = (int64_t)coords->previous[k] + zigzag_decode(get_varint(in));
+        if (value < -32768 || value > 32767) {
+            in->ok = 0;
+            value = 0;
+        }
+        coords->previous[k] = (int)value;
+        *values[k] = (double)value;
+    }
+}
+
+/* Reads the slot count and live count for one record kind, then returns the
+   slot count (-1 if it does not fit max_count, or if the rest of the input
+   is too short for that many records of at least min_record bytes) */
+static int get_record_counts(CompactReader* in, int max_count, size_t min_record, int* live) {
+    uint32_t count = get_varint(in);
+    *live = (int)get_varint(in);
+    if (!in->ok || count > (uint32_t)max_count || *live < 0 || *live > (int)count) return -1;
+    
+    size_t left = (size_t)(in->end - in->pos);
+    if ((size_t)*live > left / min_record) return -1;
+    size_t free_slots = (size_t)(count - (uint32_t)*live);
+    if (free_slots > CAD_COMPACT_FREE_SLACK && free_slots > left * CAD_COMPACT_FREE_PER_BYTE) return -1;
+    return (int)count;
+}
+
+/* Next live slot index, or -1 if the gap runs past count */
+static int get_slot(CompactReader* in, int* previous, int count) {
+    uint32_t gap = get_varint(in);
+    if (!in->ok || gap >= (uint32_t)(count - *previous - 1)) return -1;
+    *previous += (int)gap + 1;
+    return *previous;
+}
+
+static int decode_compact(const uint8_t* bytes, size_t size, RecordSink* sink) {
+    CompactReader in = { bytes + sizeof(CAD_COMPACT_MAGIC), bytes + size, 1 };
+    
+    uint8_t version = get_byte(&in);
+    uint8_t mode = get_byte(&in);
+    if (in.ok && version != CAD_COMPACT_VERSION) {
+        fprintf(stderr, "Error: Unsupported compact .cad version %u\n", version);
+        return 0;
+    }
+    
+    CompactCoords coords;
+    memset(&coords, 0, sizeof(coords));
+    coords.int16Coords = (mode & CAD_COMPACT_INT16_COORDS) != 0;
+    size_t coords_size = coords.int16Coords ? 3 : 3 * sizeof(double);
+    
+    int live, previous = -1;
+    int count = get_record_counts(&in, CAD_MAX_SLOTS, CAD_COMPACT_MIN_OBJECT + coords_size, &live);
+    if (count < 0) goto corrupt;
+    int object_count = count;
+    for (int n = 0; n < live; n++) {
+        int i = get_slot(&in, &previous, count);
+        if (i < 0) goto corrupt;
+        CadObject obj;
+        memset(&obj, 0, sizeof(obj));
+        obj.flags = get_byte(&in);
+        obj.selectFlag = get_byte(&in);
+        obj.parentObject = get_link(&in, i);
+        obj.nextBrother = get_link(&in, i + 1);
+        obj.childObject = get_link(&in, i + 1);
+        obj.firstPolygon = get_link(&in, 0);
+        get_coords(&in, &coords, &obj.offsetx, &obj.offsety, &obj.offsetz);
+        if (!in.ok) goto corrupt;
+        if (!sink_object(sink, i, &obj)) return 1;
+    }
+    
+    int predicted_point = 0;
+    previous = -1;
+    count = get_record_counts(&in, CAD_MAX_SLOTS, CAD_COMPACT_MIN_POLYGON, &live);
+    if (count < 0) goto corrupt;
+    int polygon_count = count;
+    for (int n = 0; n < live; n++) {
+        int i = get_slot(&in, &previous, count);
+        if (i < 0) goto corrupt;
+        CadPolygon poly;
+        memset(&poly, 0, sizeof(poly));
+        poly.flags = get_byte(&in);
+        poly.selectFlag = get_byte(&in);
+        poly.nextPolygon = get_link(&in, i + 1);
+        poly.firstPoint = get_link(&in, predicted_point);
+        poly.animation = (int16_t)zigzag_decode(get_varint(&in));
+        poly.both = get_link(&in, i);
+        poly.side = get_byte(&in);
+        poly.color = get_byte(&in);
+        poly.npoints = get_byte(&in);
+        if (poly.firstPoint != -1) predicted_point = (int)((uint32_t)poly.firstPoint + poly.npoints);
+        if (!in.ok) goto corrupt;
+        if (!sink_polygon(sink, i, &poly)) return 1;
+    }
+    
+    previous = -1;
+    count = get_record_counts(&in, CAD_MAX_SLOTS, CAD_COMPACT_MIN_POINT + coords_size, &live);
+    if (count < 0) goto corrupt;
+    int point_count = count;
+    for (int n = 0; n < live; n++) {
+        int i = get_slot(&in, &previous, count);
+        if (i < 0) goto corrupt;
+        CadPoint pt;
+        memset(&pt, 0, sizeof(pt));
+        pt.flags = get_byte(&in);
+        pt.selectFlag = get_byte(&in);
+        pt.nextPoint = get_link(&in, i + 1);
+        get_coords(&in, &coords, &pt.pointx, &pt.pointy, &pt.pointz);
+        if (!in.ok) goto corrupt;
+        if (!sink_point(sink, i, &pt)) return 1;
+    }
+    
+    sink_counts(sink, object_count, polygon_count, point_count);
+    sink_format(sink, CAD_FORMAT_COMPACT);
+    
+    /* Incremental saves append journal segments after the container */
+    return decode_stream(in.pos, (size_t)(in.end - in.pos), sink, 0);
+    
+corrupt:
+    fprintf(stderr, "Error: Corrupt or truncated compact .cad data\n");
+    return 0;
+}
+
+/* ----------------------------------------------------------------------------
+   Compressed container
+   "CADZ", version, reserved byte, big-endian uncompressed size, then the
+   inner image (any of the formats above) in CAD_LZ_BLOCK_SIZE blocks. Each
+   block is a big-endian uint32 size - high bit set when the block is stored
+   uncompressed - followed by its bytes.
+   ---------------------------------------------------------------------------- */
+static const uint8_t CAD_LZ_MAGIC[4] = { 'C', 'A', 'D', 'Z' };
+#define CAD_LZ_VERSION      1
+#define CAD_LZ_HEADER_SIZE  (4 + 1 + 1 + 4)
+#define CAD_LZ_BLOCK_SIZE   65536
+#define CAD_LZ_STORED       0x80000000u
+#define CAD_LZ_MAX_IMAGE    CAD_COMPRESSED_MAX_IMAGE
+
+static int is_compressed_image(const uint8_t* bytes, size_t size) {
+    return size >= sizeof(CAD_LZ_MAGIC) && memcmp(bytes, CAD_LZ_MAGIC, sizeof(CAD_LZ_MAGIC)) == 0;
+}
+
+static int compress_image(const uint8_t* image, size_t image_size, uint8_t** out_buffer, size_t* out_size) {
+    /* Never write a container the loader refuses (the size field is 32-bit too) */
+    if (image_size > CAD_LZ_MAX_IMAGE) {
+        fprintf(stderr, "Error: Model too large to save compressed (%zu byte image, limit %u)\n",
+                image_size, CAD_LZ_MAX_IMAGE);
+        return 0;
+    }
+    
+    size_t blocks = (image_size + CAD_LZ_BLOCK_SIZE - 1) / CAD_LZ_BLOCK_SIZE;
+    size_t capacity = CAD_LZ_HEADER_SIZE + blocks * (4 + CadLz_CompressBound(CAD_LZ_BLOCK_SIZE));
+    uint8_t* buffer = (uint8_t*)malloc(capacity);
+    if (!buffer) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 0;
+    }
+    
+    uint8_t* out = buffer;
+    memcpy(out, CAD_LZ_MAGIC, sizeof(CAD_LZ_MAGIC));
+    out += sizeof(CAD_LZ_MAGIC);
+    *out++ = CAD_LZ_VERSION;
+    *out++ = 0;
+    out = put_be_uint32(out, (uint32_t)image_size);
+    
+    for (size_t pos = 0; pos < image_size; pos += CAD_LZ_BLOCK_SIZE) {
+        size_t raw = image_size - pos < CAD_LZ_BLOCK_SIZE ? image_size - pos : CAD_LZ_BLOCK_SIZE;
+        size_t packed = CadLz_Compress(image + pos, raw, out + 4, CadLz_CompressBound(raw));
+        if (packed == 0 || packed >= raw) {
+            /* Incompressible - store it */
+            out = put_be_uint32(out, (uint32_t)raw | CAD_LZ_STORED);
+            memcpy(out, image + pos, raw);
+            out += raw;
+        } else {
+            out = put_be_uint32(out, (uint32_t)packed);
+            out += packed;
+        }
+    }
+    
+    *out_buffer = buffer;
+    *out_size = (size_t)(out - buffer);
+    return 1;
+}
+
+static int decode_compressed(const uint8_t* bytes, size_t size, RecordSink* sink) {
+    if (size < CAD_LZ_HEADER_SIZE || bytes[4] != CAD_LZ_VERSION) {
+        fprintf(stderr, "Error: Unsupported or truncated compressed .cad header\n");
+        return 0;
+    }
+    uint32_t image_size = read_be_uint32(bytes + 6);
+    if (image_size > CAD_LZ_MAX_IMAGE) {
+        fprintf(stderr, "Error: Corrupt compressed .cad header\n");
+        return 0;
+    }
+    
+    uint8_t* image = (uint8_t*)malloc(image_size ? image_size : 1);
+    if (!image) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 0;
+    }
+    
+    size_t pos = CAD_LZ_HEADER_SIZE;
+    int ok = 1;
+    for (size_t done = 0; ok && done < image_size; done += CAD_LZ_BLOCK_SIZE) {
+        size_t raw = image_size - done < CAD_LZ_BLOCK_SIZE ? image_size - done : CAD_LZ_BLOCK_SIZE;
+        if (size - pos < 4) {
+            ok = 0;
+            break;
+        }
+        uint32_t header = read_be_uint32(bytes + pos);
+        size_t packed = header & ~CAD_LZ_STORED;
+        pos += 4;
+        if (size - pos < packed) {
+            ok = 0;
+        } else if (header & CAD_LZ_STORED) {
+            ok = packed == raw;
+            if (ok) memcpy(image + done, bytes + pos, raw);
+        } else {
+            ok = CadLz_Decompress(bytes + pos, packed, image + done, raw);
+        }
+        pos += packed;
+    }
+    
+    if (!ok) {
+        fprintf(stderr, "Error: Corrupt or truncated compressed .cad data\n");
+    } else if (is_compressed_image(image, image_size)) {
+        fprintf(stderr, "Error: Nested compressed .cad data\n");
+        ok = 0;
+    } else {
+        ok = decode_image(image, image_size, sink);
+    }
+    free(image);
+    if (!ok) return 0;
+    if (sink->stopped) return 1;
+    
+    if (sink->data) sink->data->format |= CAD_FORMAT_COMPRESSED;
+    
+    /* Incremental saves append journal segments after the container */
+    return decode_stream(bytes + pos, size - pos, sink, 0);
+}
+
+int CadFile_SaveToBufferEx(const CadFileData* data, CadFileFormat format, uint8_t** out_buffer, size_t* out_size) {
+    if (!data || !out_buffer || !out_size) {
+        fprintf(stderr, "Error: Invalid parameters to CadFile_SaveToBufferEx\n");
+        return 0;
+    }
+    
+    *out_buffer = NULL;
+    *out_size = 0;
+    
+    CadFileFormat container = (CadFileFormat)(format & ~CAD_FORMAT_COMPRESSED);
+    if (container != CAD_FORMAT_COMPACT && !CadFile_FitsLegacy(data)) {
+        /* Only the compact container has links wider than 16 bits */
+        fprintf(stderr, "Warning: Model exceeds the legacy .cad limits, saving in the compact format\n");
+        container = CAD_FORMAT_COMPACT;
+    }
+    uint8_t* image = NULL;
+    size_t image_size = 0;
+    
+    if (container == CAD_FORMAT_LEGACY) {
+        if (!CadFile_SaveToBuffer(data, &image, &image_size)) return 0;
+    } else {
+        size_t capacity = (container == CAD_FORMAT_COMPACT) ? compact_save_bound(data) : indexed_save_size(data);
+        image = (uint8_t*)malloc(capacity);
+        if (!image) {
+            fprintf(stderr, "Error: Memory allocation failed\n");
+            return 0;
+        }
+        image_size = (container == CAD_FORMAT_COMPACT) ? encode_compact(data, image) : encode_indexed(data, image);
+    }
+    
+    if (!(format & CAD_FORMAT_COMPRESSED)) {
+        *out_buffer = image;
+        *out_size = image_size;
+        return 1;
+    }
+    
+    int result = compress_image(image, image_size, out_buffer, out_size);
+    free(image);
+    return result;
+}
+
+int CadFile_SaveEx(const char* filename, const CadFileData* data, CadFileFormat format) {
+    if (!filename || !data) {
+        fprintf(stderr, "Error: Invalid parameters to CadFile_SaveEx\n");
+        return 0;
+    }
+    
+    uint8_t* buffer = NULL;
+    size_t size = 0;
+    if (!CadFile_SaveToBufferEx(data, format, &buffer, &size)) {
+        return 0;
+    }
+    int result = CadFile_WriteBufferAtomic(filename, buffer, size);
+    CadFile_FreeBuffer(buffer);
+    return result;
+}
+
+static int format_name_equals(const char* name, size_t len, const char* expected) {
+    if (strlen(expected) != len) return 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = name[i];
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+        if (c != expected[i]) return 0;
+    }
+    return 1;
+}
+
+int CadFile_ParseFormat(const char* name, CadFileFormat* out_format) {
+    if (!name || !out_format) return 0;
+    
+    size_t len = strlen(name);
+    int compressed = 0;
+    if (len > 2 && name[len - 2] == '+' && (name[len - 1] == 'z' || name[len - 1] == 'Z')) {
+        compressed = 1;
+        len -= 2;
+    }
+    
+    CadFileFormat format;
+    if (format_name_equals(name, len, "legacy")) format = CAD_FORMAT_LEGACY;
+    else if (format_name_equals(name, len, "indexed")) format = CAD_FORMAT_INDEXED;
+    else if (format_name_equals(name, len, "compact")) format = CAD_FORMAT_COMPACT;
+    else return 0;
+    
+    *out_format = (CadFileFormat)(format | (compressed ? CAD_FORMAT_COMPRESSED : 0));
+    return 1;
+}
+
+/* Where CadFile_LoadObject reads records from: the v2 offset table when the
+   file has one, otherwise a fully decoded legacy image */
+typedef struct {
+    const IndexedView* view;
+    const CadFileData* decoded;
+} RecordSource;
+
+static int source_object(const RecordSource* src, int index, CadObject* obj) {
+    if (index < 0) return 0;
+    if (src->view) {
+        const uint8_t* record = indexed_record(src->view, CAD_TAG_OBJECT, index);
+        if (!record) return 0;
+        decode_object(record, obj);
+    } else {
+        if (index >= src->decoded->objectCount) return 0;
+        *obj = src->decoded->objects[index];
+    }
+    return obj->flags != 0;
+}
+
+static int source_polygon(const RecordSource* src, int index, CadPolygon* poly) {
+    if (index < 0) return 0;
+    if (src->view) {
+        const uint8_t* record = indexed_record(src->view, CAD_TAG_POLYGON, index);
+        if (!record) return 0;
+        decode_polygon(record, poly);
+    } else {
+        if (index >= src->decoded->polygonCount) return 0;
+        *poly = src->decoded->polygons[index];
+    }
+    return poly->flags != 0;
+}
+
+static int source_point(const RecordSource* src, int index, CadPoint* pt) {
+    if (index < 0) return 0;
+    if (src->view) {
+        const uint8_t* record = indexed_record(src->view, CAD_TAG_POINT, index);
+        if (!record) return 0;
+        decode_point(record, pt);
+    } else {
+        if (index >= src->decoded->pointCount) return 0;
+        *pt = src->decoded->points[index];
+    }
+    return pt->flags != 0;
+}
+
+/* Has slot index of the table already been copied? */
+#define SLOT_TAKEN(table, count, index) ((index) < (count) && (table)[index].flags != 0)
+
+/* Copy an object, its polygon chain with their point chains, then its children.
+   Slots already copied end a chain, which also guards against link cycles.
+   Returns 0 if the tables could not grow. */
+static int load_object_subtree(const RecordSource* src, int index, CadFileData* data) {
+    CadObject obj;
+    if (!source_object(src, index, &obj) || SLOT_TAKEN(data->objects, data->objectCount, index)) return 1;
+    if (!CadFile_Reserve(data, index + 1, 0, 0)) return 0;
+    data->objects[index] = obj;
+    if (index >= data->objectCount) data->objectCount = index + 1;
+    
+    CadPolygon poly;
+    for (int p = obj.firstPolygon; source_polygon(src, p, &poly) && !SLOT_TAKEN(data->polygons, data->polygonCount, p);
+         p = poly.nextPolygon) {
+        if (!CadFile_Reserve(data, 0, p + 1, 0)) return 0;
+        data->polygons[p] = poly;
+        if (p >= data->polygonCount) data->polygonCount = p + 1;
+        
+        CadPoint pt;
+        for (int q = poly.firstPoint; source_point(src, q, &pt) && !SLOT_TAKEN(data->points, data->pointCount, q);
+             q = pt.nextPoint) {
+            if (!CadFile_Reserve(data, 0, 0, q + 1)) return 0;
+            data->points[q] = pt;
+            if (q >= data->pointCount) data->pointCount = q + 1;
+        }
+    }
+    
+    CadObject child;
+    for (int c = obj.childObject; source_object(src, c, &child); c = child.nextBrother) {
+        if (SLOT_TAKEN(data->objects, data->objectCount, c)) break;
+        if (!load_object_subtree(src, c, data)) return 0;
+    }
+    return 1;
+}
+
+int CadFile_LoadObject(const char* filename, int objectIndex, CadFileData* data) {
+    if (!filename || !data || objectIndex < 0 || objectIndex >= CAD_MAX_SLOTS) {
+        fprintf(stderr, "Error: Invalid parameters to CadFile_LoadObject\n");
+        return 0;
+    }
+    
+    CadFile_Clear(data);
+    
+    FileView file;
+    int opened = open_file_view(filename, &file);
+    if (opened <= 0) {
+        fprintf(stderr, "Error: Could not open file '%s' for reading\n", filename);
+        return 0;
+    }
+    
+    int result = 0;
+    IndexedView view;
+    RecordSource src = { NULL, NULL };
+    CadFileData decoded;
+    CadFile_Init(&decoded);
+    
+    if (is_indexed_image(file.bytes, file.size) && parse_indexed_header(file.bytes, file.size, &view) &&
+        view.end == file.size) {
+        /* Random access through the offset table - nothing else is decoded */
+        src.view = &view;
+    } else if (CadFile_LoadFromBuffer(file.bytes, file.size, &decoded)) {
+        /* Legacy stream, or a v2 file with journal segments to replay */
+        src.decoded = &decoded;
+    }
+    
+    if ((src.view || src.decoded) && load_object_subtree(&src, objectIndex, data)) {
+        result = SLOT_TAKEN(data->objects, data->objectCount, objectIndex);
+        if (!result) {
+            fprintf(stderr, "Error: Object %d not found in '%s'\n", objectIndex, filename);
+        }
+    }
+    
+    CadFile_Free(&decoded);
+    close_file_view(&file);
+    return result;
+}
+
+/* ----------------------------------------------------------------------------
+   Streaming record access
+   ---------------------------------------------------------------------------- */
+
+int CadFile_ForEachRecord(const char* filename, const CadRecordVisitor* visitor, void* user) {
+    if (!filename || !visitor) {
+        fprintf(stderr, "Error: Invalid parameters to CadFile_ForEachRecord\n");
+        return 0;
+    }
+    
+    FileView view;
+    int opened = open_file_view(filename, &view);
+    if (opened < 0) return 1;   /* Empty file - no records */
+    if (!opened) {
+        fprintf(stderr, "Error: Could not open file '%s' for reading\n", filename);
+        return 0;
+    }
+    
+    RecordSink sink = { NULL, visitor, user, 0, 0 };
+    int result = decode_image(view.bytes, view.size, &sink);
+    close_file_view(&view);
+    return result;
+}
+
+/* Live flags of the slots seen so far, grown as indices appear */
+typedef struct {
+    uint8_t* live;
+    int capacity;
+} LiveSlots;
+
+/* Live slots seen so far; journal segments may revive or delete a slot */
+typedef struct {
+    CadFileStats* stats;
+    LiveSlots objects;
+    LiveSlots polygons;
+    LiveSlots points;
+    int hasBounds;
+    int failed;
+} StatsScan;
+
+static int count_live(StatsScan* scan, LiveSlots* slots, int index, uint8_t flags, int* count) {
+    if (!grow_table((void**)&slots->live, &slots->capacity, index + 1, 1)) {
+        scan->failed = 1;
+        return 0;
+    }
+    int now = flags != 0;
+    *count += now - slots->live[index];
+    slots->live[index] = (uint8_t)now;
+    return 1;
+}
+
+static int stats_object(void* user, int index, const CadObject* obj) {
+    StatsScan* scan = (StatsScan*)user;
+    return count_live(scan, &scan->objects, index, obj->flags, &scan->stats->objectCount);
+}
+
+static int stats_polygon(void* user, int index, const CadPolygon* poly) {
+    StatsScan* scan = (StatsScan*)user;
+    if (!count_live(scan, &scan->polygons, index, poly->flags, &scan->stats->polygonCount)) return 0;
+    if (poly->flags != 0 && !scan->stats->colorUsed[poly->color]) {
+        scan->stats->colorUsed[poly->color] = 1;
+        scan->stats->colorCount++;
+    }
+    return 1;
+}
+
+static int stats_point(void* user, int index, const CadPoint* pt) {
+    StatsScan* scan = (StatsScan*)user;
+    CadFileStats* stats = scan->stats;
+    if (!count_live(scan, &scan->points, index, pt->flags, &stats->pointCount)) return 0;
+    if (pt->flags == 0) return 1;
+    
+    if (!scan->hasBounds) {
+        stats->minx = stats->maxx = pt->pointx;
+        stats->miny = stats->maxy = pt->pointy;
+        stats->minz = stats->maxz = pt->pointz;
+        scan->hasBounds = 1;
+        return 1;
+    }
+    if (pt->pointx < stats->minx) stats->minx = pt->pointx;
+    if (pt->pointy < stats->miny) stats->miny = pt->pointy;
+    if (pt->pointz < stats->minz) stats->minz = pt->pointz;
+    if (pt->pointx > stats->maxx) stats->maxx = pt->pointx;
+    if (pt->pointy > stats->maxy) stats->maxy = pt->pointy;
+    if (pt->pointz > stats->maxz) stats->maxz = pt->pointz;
+    return 1;
+}
+
+int CadFile_GetStats(const char* filename, CadFileStats* stats) {
+    if (!filename || !stats) return 0;
+    
+    memset(stats, 0, sizeof(CadFileStats));
+    
+    StatsScan scan;
+    memset(&scan, 0, sizeof(scan));
+    scan.stats = stats;
+    
+    CadRecordVisitor visitor = { stats_object, stats_polygon, stats_point };
+    int result = CadFile_ForEachRecord(filename, &visitor, &scan) && !scan.failed;
+    free(scan.objects.live);
+    free(scan.polygons.live);
+    free(scan.points.live);
+    return result;
+}
+
+/* ----------------------------------------------------------------------------
+   Journaled saves
+   ---------------------------------------------------------------------------- */
+
+static int max_int(int a, int b) { return a > b ? a : b; }
+
+/* Slots whose record differs between base and data (deleted slots included).
+   A slot past one side's count is free there. */
+static const uint8_t free_record[sizeof(CadObject) > sizeof(CadPoint) ? sizeof(CadObject) : sizeof(CadPoint)];
+
+static int object_changed(const CadFileData* base, const CadFileData* data, int i) {
+    const void* a = i < base->objectCount ? (const void*)&base->objects[i] : free_record;
+    const void* b = i < data->objectCount ? (const void*)&data->objects[i] : free_record;
+    return memcmp(a, b, sizeof(CadObject)) != 0;
+}
+
+static int polygon_changed(const CadFileData* base, const CadFileData* data, int i) {
+    const void* a = i < base->polygonCount ? (const void*)&base->polygons[i] : free_record;
+    const void* b = i < data->polygonCount ? (const void*)&data->polygons[i] : free_record;
+    return memcmp(a, b, sizeof(CadPolygon)) != 0;
+}
+
+static int point_changed(const CadFileData* base, const CadFileData* data, int i) {
+    const void* a = i < base->pointCount ? (const void*)&base->points[i] : free_record;
+    const void* b = i < data->pointCount ? (const void*)&data->points[i] : free_record;
+    return memcmp(a, b, sizeof(CadPoint)) != 0;
+}
+
+int CadFile_AppendJournal(const char* filename, const CadFileData* base, const CadFileData* data) {
+    if (!filename || !base || !data) {
+        fprintf(stderr, "Error: Invalid parameters to CadFile_AppendJournal\n");
+        return -1;
+    }
+    if (!CadFile_FitsLegacy(base) || !CadFile_FitsLegacy(data)) {
+        /* Journal records are tag/index/record triples with 16-bit indices */
+        fprintf(stderr, "Error: Model exceeds the legacy .cad limits, journaling needs a full save\n");
+        return -1;
+    }
+    
+    int object_end = max_int(base->objectCount, data->objectCount);
+    int polygon_end = max_int(base->polygonCount, data->polygonCount);
+    int point_end = max_int(base->pointCount, data->pointCount);
+    
+    /* Size the segment */
+    size_t payload_size = 0;
+    int records = 0;
+    for (int i = 0; i < object_end; i++) {
+        if (object_changed(base, data, i)) { payload_size += CAD_TRIPLE_HEADER_SIZE + CAD_OBJECT_RECORD_SIZE; records++; }
+    }
+    for (int i = 0; i < polygon_end; i++) {
+        if (polygon_changed(base, data, i)) { payload_size += CAD_TRIPLE_HEADER_SIZE + CAD_POLYGON_RECORD_SIZE; records++; }
+    }
+    for (int i = 0; i < point_end; i++) {
+        if (point_changed(base, data, i)) { payload_size += CAD_TRIPLE_HEADER_SIZE + CAD_POINT_RECORD_SIZE; records++; }
+    }
+    if (records == 0) return 0;
+    
+    uint8_t* segment = (uint8_t*)malloc(CAD_JOURNAL_HEADER_SIZE + payload_size);
+    if (!segment) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return -1;
+    }
+    
+    /* Deleted slots are written with flags == 0 so replay clears them */
+    uint8_t* payload = segment + CAD_JOURNAL_HEADER_SIZE;
+    uint8_t* out = payload;
+    CadObject no_object;
+    CadPolygon no_polygon;
+    CadPoint no_point;
+    memset(&no_object, 0, sizeof(no_object));
+    memset(&no_polygon, 0, sizeof(no_polygon));
+    memset(&no_point, 0, sizeof(no_point));
+    for (int i = 0; i < object_end; i++) {
+        if (object_changed(base, data, i)) out = encode_object(out, i, i < data->objectCount ? &data->objects[i] : &no_object);
+    }
+    for (int i = 0; i < polygon_end; i++) {
+        if (polygon_changed(base, data, i)) out = encode_polygon(out, i, i < data->polygonCount ? &data->polygons[i] : &no_polygon);
+    }
+    for (int i = 0; i < point_end; i++) {
+        if (point_changed(base, data, i)) out = encode_point(out, i, i < data->pointCount ? &data->points[i] : &no_point);
+    }
+    
+    segment[0] = CAD_TAG_JOURNAL;
+    put_be_uint32(segment + 1, (uint32_t)payload_size);
+    put_be_uint32(segment + 5, journal_checksum(payload, payload_size));
+    
+    FILE* fp;
+#ifdef _WIN32
+    wchar_t wfilename[MAX_PATH * 2] = {0};
+    fp = to_wide_path(filename, wfilename, sizeof(wfilename) / sizeof(wfilename[0])) ? _wfopen(wfilename, L"ab") : NULL;
+#else
+    fp = fopen(filename, "ab");
+#endif
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open file '%s' for appending\n", filename);
+        free(segment);
+        return -1;
+    }
+    
+    size_t segment_size = CAD_JOURNAL_HEADER_SIZE + payload_size;
+    int ok = fwrite(segment, 1, segment_size, fp) == segment_size;
+    if (ok) ok = fflush(fp) == 0;
+#ifdef _WIN32
+    if (ok) ok = _commit(_fileno(fp)) == 0;
+#else
+    if (ok) ok = fsync(fileno(fp)) == 0;
+#endif
+    if (fclose(fp) != 0) ok = 0;
+    free(segment);
+    
+    if (!ok) {
+        fprintf(stderr, "Error: Failed to append journal to '%s'\n", filename);
+        return -1;
+    }
+    return records;
+}
+
+int CadFile_Compact(const char* filename) {
+    if (!filename) return 0;
+    
+    CadFileData data;
+    CadFile_Init(&data);
+    
+    int ok = CadFile_Load(filename, &data);
+    if (ok && data.journalSegments > 0) {
+        ok = CadFile_SaveEx(filename, &data, data.format);
+    }
+    CadFile_Free(&data);
+    return ok;
+}
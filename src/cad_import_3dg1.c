@@ -19,10 +19,8 @@
 #endif
 #endif
 
-/* Import CAD data from Fundoshi-Kun format (.3dg1) */
-int CadImport_3DG1(CadCore* core, const char* filename) {
-    if (!core || !filename) return 0;
-    
+/* Read a whole file into a NUL-terminated buffer (free with free) */
+static char* read_text_file(const char* filename, size_t* out_size) {
     FILE* fp = NULL;
 
 #ifdef _WIN32
@@ -32,30 +30,80 @@ int CadImport_3DG1(CadCore* core, const char* filename) {
         wchar_t* wfilename = (wchar_t*)calloc(wlen, sizeof(wchar_t));
         if (wfilename) {
             MultiByteToWideChar(CP_UTF8, 0, filename, -1, wfilename, wlen);
-            fp = _wfopen(wfilename, L"r");
+            fp = _wfopen(wfilename, L"rb");
             free(wfilename);
         }
     }
     if (!fp) {
-        fp = fopen(filename, "r");
+        fp = fopen(filename, "rb");
     }
 #else
-    fp = fopen(filename, "r");
+    fp = fopen(filename, "rb");
 #endif
     
     if (!fp) {
         fprintf(stderr, "Error: Could not open file '%s' for reading\n", filename);
-        return 0;
+        return NULL;
+    }
+    
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char* text = (size >= 0) ? (char*)malloc((size_t)size + 1) : NULL;
+    if (!text || fread(text, 1, (size_t)size, fp) != (size_t)size) {
+        fprintf(stderr, "Error: Could not read file '%s'\n", filename);
+        free(text);
+        fclose(fp);
+        return NULL;
     }
+    fclose(fp);
+    text[size] = '\0';
+    *out_size = (size_t)size;
+    return text;
+}
+
+/* fgets over a memory buffer: copy the next line (with its newline) into line */
+static int read_line(const char** cursor, const char* end, char* line, size_t cap) {
+    const char* p = *cursor;
+    if (p >= end) return 0;
+    size_t n = 0;
+    while (p < end && n + 1 < cap) {
+        char c = *p++;
+        line[n++] = c;
+        if (c == '\n') break;
+    }
+    line[n] = '\0';
+    *cursor = p;
+    return 1;
+}
+
+/* Import CAD data from Fundoshi-Kun format (.3dg1) */
+int CadImport_3DG1(CadCore* core, const char* filename) {
+    if (!core || !filename) return 0;
+    
+    size_t size = 0;
+    char* text = read_text_file(filename, &size);
+    if (!text) return 0;
+    
+    int result = CadImport_3DG1FromBuffer(core, text, size);
+    free(text);
+    return result;
+}
+
+/* Import 3DG1 text that is already in memory (must be NUL-terminated at size) */
+static int import_3dg1(CadCore* core, const char* text, size_t size) {
+    if (!core || !text) return 0;
+    
+    const char* text_end = text + size;
+    const char* cursor = text;
 
     /* Clear existing data */
     CadCore_Clear(core);
 
     /* Read magic header */
     char magic[16];
-    if (!fgets(magic, sizeof(magic), fp)) {
-        fprintf(stderr, "Error: Could not read header from '%s'\n", filename);
-        fclose(fp);
+    if (!read_line(&cursor, text_end, magic, sizeof(magic))) {
+        fprintf(stderr, "Error: Could not read 3DG1 header\n");
         return 0;
     }
     
@@ -67,48 +115,51 @@ int CadImport_3DG1(CadCore* core, const char* filename) {
     
     if (strcmp(magic, "3DG1") != 0) {
         fprintf(stderr, "Error: Invalid file format - expected '3DG1', got '%s'\n", magic);
-        fclose(fp);
         return 0;
     }
 
     /* Read vertex count */
-    int vertex_count = 0;
-    if (fscanf(fp, "%d", &vertex_count) != 1) {
+    char* parse_end;
+    int vertex_count = (int)strtol(cursor, &parse_end, 10);
+    if (parse_end == cursor) {
         fprintf(stderr, "Error: Could not read vertex count\n");
-        fclose(fp);
         return 0;
     }
+    cursor = parse_end;
     
-    if (vertex_count <= 0 || vertex_count > CAD_MAX_POINTS) {
+    if (vertex_count <= 0 || vertex_count > CAD_MAX_SLOTS) {
         fprintf(stderr, "Error: Invalid vertex count: %d\n", vertex_count);
-        fclose(fp);
         return 0;
     }
     
     fprintf(stdout, "Importing 3DG1: %d vertices\n", vertex_count);
 
     /* Read vertices */
-    int16_t* point_indices = (int16_t*)malloc(vertex_count * sizeof(int16_t));
+    CadIndex* point_indices = (CadIndex*)malloc((size_t)vertex_count * sizeof(CadIndex));
     if (!point_indices) {
         fprintf(stderr, "Error: Memory allocation failed\n");
-        fclose(fp);
         return 0;
     }
     
     for (int i = 0; i < vertex_count; i++) {
-        double x, y, z;
-        if (fscanf(fp, "%lf %lf %lf", &x, &y, &z) != 3) {
+        double xyz[3];
+        int got = 0;
+        for (; got < 3; got++) {
+            xyz[got] = strtod(cursor, &parse_end);
+            if (parse_end == cursor) break;
+            cursor = parse_end;
+        }
+        if (got != 3) {
             fprintf(stderr, "Error: Could not read vertex %d\n", i);
             free(point_indices);
-            fclose(fp);
             return 0;
         }
+        double x = xyz[0], y = xyz[1], z = xyz[2];
         
-        int16_t pt_idx = CadCore_AddPoint(core, x, y, z);
+        CadIndex pt_idx = CadCore_AddPoint(core, x, y, z);
         if (pt_idx < 0) {
             fprintf(stderr, "Error: Failed to add point %d\n", i);
             free(point_indices);
-            fclose(fp);
             return 0;
         }
         point_indices[i] = pt_idx;
@@ -119,7 +170,7 @@ int CadImport_3DG1(CadCore* core, const char* filename) {
     char line[1024];
     
     /* Skip to faces section (skip blank lines) */
-    while (fgets(line, sizeof(line), fp)) {
+    while (read_line(&cursor, text_end, line, sizeof(line))) {
         /* Skip empty lines and whitespace-only lines */
         char* p = line;
         while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
@@ -178,8 +229,8 @@ int CadImport_3DG1(CadCore* core, const char* filename) {
         if (!valid) continue;
         
         /* Create polygon - each polygon gets its own copy of points */
-        int16_t first_point = INVALID_INDEX;
-        int16_t prev_point = INVALID_INDEX;
+        CadIndex first_point = INVALID_INDEX;
+        CadIndex prev_point = INVALID_INDEX;
         
         for (int i = 0; i < count; i++) {
             /* Get original point coordinates */
@@ -187,7 +238,7 @@ int CadImport_3DG1(CadCore* core, const char* filename) {
             if (!orig) continue;
             
             /* Create new point for this polygon */
-            int16_t new_pt = CadCore_AddPoint(core, orig->pointx, orig->pointy, orig->pointz);
+            CadIndex new_pt = CadCore_AddPoint(core, orig->pointx, orig->pointy, orig->pointz);
             if (new_pt == INVALID_INDEX) continue;
             
             if (first_point == INVALID_INDEX) {
@@ -195,8 +246,7 @@ int CadImport_3DG1(CadCore* core, const char* filename) {
             }
             
             if (prev_point != INVALID_INDEX) {
-                CadPoint* prev = CadCore_GetPoint(core, prev_point);
-                if (prev) prev->nextPoint = new_pt;
+                CadCore_SetNextPoint(core, prev_point, new_pt);
             }
             
             prev_point = new_pt;
@@ -204,13 +254,12 @@ int CadImport_3DG1(CadCore* core, const char* filename) {
         
         /* Close the chain */
         if (prev_point != INVALID_INDEX) {
-            CadPoint* last = CadCore_GetPoint(core, prev_point);
-            if (last) last->nextPoint = INVALID_INDEX;
+            CadCore_SetNextPoint(core, prev_point, INVALID_INDEX);
         }
         
         /* Add polygon */
         if (first_point != INVALID_INDEX) {
-            int16_t poly_idx = CadCore_AddPolygon(core, first_point, (uint8_t)color, (uint8_t)count);
+            CadIndex poly_idx = CadCore_AddPolygon(core, first_point, (uint8_t)color, (uint8_t)count);
             if (poly_idx >= 0) {
                 face_count++;
             }
@@ -218,8 +267,15 @@ int CadImport_3DG1(CadCore* core, const char* filename) {
     }
     
     free(point_indices);
-    fclose(fp);
     
     fprintf(stdout, "Imported 3DG1: %d vertices, %d faces\n", vertex_count, face_count);
     return 1;
 }
+
+/* The records are added in one batch */
+int CadImport_3DG1FromBuffer(CadCore* core, const char* text, size_t size) {
+    CadCore_BeginBatch(core);
+    int result = import_3dg1(core, text, size);
+    CadCore_CommitBatch(core);
+    return result;
+}
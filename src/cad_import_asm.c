@@ -0,0 +1,1282 @@
+#define _CRT_SECURE_NO_WARNINGS
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "cad_import_asm.h"
+#include "cad_core.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#define PATH_SEP "\\"
+#else
+/* glob rather than dirent: include/dirent.h is the Win32 shim */
+#include <glob.h>
+#define PATH_SEP "/"
+#endif
+
+/* ----------------------------------------------------------------------------
+   Text helpers
+   ---------------------------------------------------------------------------- */
+
+static int ascii_icmp(const char* a, const char* b) {
+    while (*a && tolower((unsigned char)*a) == tolower((unsigned char)*b)) {
+        a++;
+        b++;
+    }
+    return tolower((unsigned char)*a) - tolower((unsigned char)*b);
+}
+
+static int ascii_nicmp(const char* a, const char* b, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        int d = tolower((unsigned char)a[i]) - tolower((unsigned char)b[i]);
+        if (d != 0 || a[i] == '\0') return d;
+    }
+    return 0;
+}
+
+/* Lower-case copy of a line (truncated to cap - 1 characters) */
+static void lower_copy(char* out, size_t cap, const char* line) {
+    strncpy(out, line, cap - 1);
+    out[cap - 1] = '\0';
+    for (int k = 0; out[k]; k++) {
+        out[k] = (char)tolower((unsigned char)out[k]);
+    }
+}
+
+/* Read a whole file into a NUL-terminated buffer (free with free) */
+static char* read_file(const char* filepath, size_t* out_size) {
+    FILE* f = fopen(filepath, "rb");
+    if (!f) return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size < 0) {
+        fclose(f);
+        return NULL;
+    }
+
+    char* content = (char*)malloc((size_t)size + 1);
+    if (!content) {
+        fclose(f);
+        return NULL;
+    }
+    size_t got = fread(content, 1, (size_t)size, f);
+    fclose(f);
+    content[got] = '\0';
+    *out_size = got;
+    return content;
+}
+
+/* ----------------------------------------------------------------------------
+   Constant resolver for ASM symbolic constants
+   ---------------------------------------------------------------------------- */
+
+#define MAX_CONSTANTS 4096
+#define MAX_CONST_NAME 64
+
+typedef struct {
+    char name[MAX_CONST_NAME];
+    int value;
+    int resolved;  /* 1 if value is final, 0 if needs resolution */
+} AsmConstant;
+
+struct CadAsmConstants {
+    const CadAsmConstants* base;  /* Looked up when a name is not defined here */
+    AsmConstant* constants;
+    int count;
+    int capacity;
+};
+
+CadAsmConstants* CadAsmConstants_Create(void) {
+    return (CadAsmConstants*)calloc(1, sizeof(CadAsmConstants));
+}
+
+CadAsmConstants* CadAsmConstants_CreateOverlay(const CadAsmConstants* base) {
+    CadAsmConstants* table = CadAsmConstants_Create();
+    if (table) table->base = base;
+    return table;
+}
+
+void CadAsmConstants_Destroy(CadAsmConstants* table) {
+    if (!table) return;
+    free(table->constants);
+    free(table);
+}
+
+void CadAsmConstants_Clear(CadAsmConstants* table) {
+    if (table) table->count = 0;
+}
+
+int CadAsmConstants_GetCount(const CadAsmConstants* table) {
+    return table ? table->count : 0;
+}
+
+static int constants_find(const CadAsmConstants* table, const char* name) {
+    if (!table) return -1;
+    for (int i = 0; i < table->count; i++) {
+        if (ascii_icmp(table->constants[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void constants_add(CadAsmConstants* table, const char* name, int value) {
+    if (!table) return;
+
+    /* Check if already exists */
+    int idx = constants_find(table, name);
+    if (idx >= 0) {
+        table->constants[idx].value = value;
+        table->constants[idx].resolved = 1;
+        return;
+    }
+
+    if (table->count == table->capacity) {
+        if (table->capacity >= MAX_CONSTANTS) return;
+        int cap = table->capacity ? table->capacity * 2 : 64;
+        if (cap > MAX_CONSTANTS) cap = MAX_CONSTANTS;
+        AsmConstant* grown = (AsmConstant*)realloc(table->constants, (size_t)cap * sizeof(AsmConstant));
+        if (!grown) return;
+        table->constants = grown;
+        table->capacity = cap;
+    }
+
+    strncpy(table->constants[table->count].name, name, MAX_CONST_NAME - 1);
+    table->constants[table->count].name[MAX_CONST_NAME - 1] = '\0';
+    table->constants[table->count].value = value;
+    table->constants[table->count].resolved = 1;
+    table->count++;
+}
+
+static int constants_get(const CadAsmConstants* table, const char* name, int* out_value) {
+    /* Innermost table first, so shape-local values shadow global ones */
+    for (; table; table = table->base) {
+        int idx = constants_find(table, name);
+        if (idx >= 0 && table->constants[idx].resolved) {
+            *out_value = table->constants[idx].value;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Copy an identifier starting at *p into name and advance *p past it */
+static void read_name(const char** p, char* name) {
+    int name_len = 0;
+    while (isalnum((unsigned char)**p) || **p == '_') {
+        if (name_len < MAX_CONST_NAME - 1) {
+            name[name_len++] = **p;
+        }
+        (*p)++;
+    }
+    name[name_len] = '\0';
+}
+
+/* Parse a value that may be a number, constant name, or expression */
+static int parse_const_value(const CadAsmConstants* table, const char* str, int* out_value) {
+    if (!str || !out_value) return 0;
+
+    /* Skip leading whitespace */
+    while (*str == ' ' || *str == '\t') str++;
+
+    /* Check for negated constant: -constantname */
+    if (*str == '-' && isalpha((unsigned char)str[1])) {
+        /* It's a negated constant like -size */
+        str++; /* skip the minus */
+        char const_name[MAX_CONST_NAME];
+        read_name(&str, const_name);
+
+        int val;
+        if (!constants_get(table, const_name, &val)) {
+            return 0; /* Can't resolve */
+        }
+        *out_value = -val;
+        return 1;
+    }
+
+    /* If it starts with a digit or minus followed by digit, it's a number */
+    if (isdigit((unsigned char)*str) || (*str == '-' && isdigit((unsigned char)str[1]))) {
+        char* end;
+        long val = strtol(str, &end, 10);
+
+        /* Check for operators in the expression */
+        while (*end == '+' || *end == '-' || *end == '*') {
+            char op = *end++;
+            while (*end == ' ' || *end == '\t') end++;
+
+            /* Next part could be a number or constant */
+            long next_val;
+            if (isdigit((unsigned char)*end) || (*end == '-' && isdigit((unsigned char)end[1]))) {
+                next_val = strtol(end, &end, 10);
+            } else {
+                /* It's a constant name - extract it */
+                char const_name[MAX_CONST_NAME];
+                const char* name_pos = end;
+                read_name(&name_pos, const_name);
+                end = (char*)name_pos;
+
+                int const_val;
+                if (!constants_get(table, const_name, &const_val)) {
+                    return 0; /* Can't resolve */
+                }
+                next_val = const_val;
+            }
+
+            if (op == '+') val += next_val;
+            else if (op == '-') val -= next_val;
+            else if (op == '*') val *= next_val;
+        }
+
+        *out_value = (int)val;
+        return 1;
+    }
+
+    /* It starts with a letter - it's a constant name or expression starting with constant */
+    char const_name[MAX_CONST_NAME];
+    const char* p = str;
+    read_name(&p, const_name);
+
+    int val;
+    if (!constants_get(table, const_name, &val)) {
+        return 0; /* Can't resolve */
+    }
+
+    /* Check for operators after the constant */
+    while (*p == ' ' || *p == '\t') p++;
+    while (*p == '+' || *p == '-' || *p == '*') {
+        char op = *p++;
+        while (*p == ' ' || *p == '\t') p++;
+
+        long next_val;
+        if (isdigit((unsigned char)*p) || (*p == '-' && isdigit((unsigned char)p[1]))) {
+            char* end;
+            next_val = strtol(p, &end, 10);
+            p = end;
+        } else {
+            /* Another constant */
+            read_name(&p, const_name);
+
+            int const_val;
+            if (!constants_get(table, const_name, &const_val)) {
+                return 0;
+            }
+            next_val = const_val;
+        }
+
+        if (op == '+') val += (int)next_val;
+        else if (op == '-') val -= (int)next_val;
+        else if (op == '*') val *= (int)next_val;
+    }
+
+    *out_value = val;
+    return 1;
+}
+
+/* Parse a single line for constant definition */
+static void parse_constant_line(CadAsmConstants* table, const char* line) {
+    /* Format: name equ value  OR  name = value */
+    char line_copy[512];
+    strncpy(line_copy, line, sizeof(line_copy) - 1);
+    line_copy[sizeof(line_copy) - 1] = '\0';
+
+    /* Skip leading whitespace */
+    const char* p = line_copy;
+    while (*p == ' ' || *p == '\t') p++;
+
+    /* Skip comments */
+    if (*p == ';' || *p == '\0' || *p == '\n' || *p == '\r') return;
+
+    /* Extract name */
+    char name[MAX_CONST_NAME];
+    read_name(&p, name);
+    if (name[0] == '\0') return;
+
+    /* Skip whitespace */
+    while (*p == ' ' || *p == '\t') p++;
+
+    /* Check for 'equ' or '=' */
+    if (ascii_nicmp(p, "equ", 3) == 0 && (p[3] == ' ' || p[3] == '\t')) {
+        p += 3;
+    } else if (*p == '=') {
+        p++;
+    } else {
+        return;
+    }
+
+    /* Skip whitespace */
+    while (*p == ' ' || *p == '\t') p++;
+    char* value_str = line_copy + (p - line_copy);
+
+    /* Remove trailing comment */
+    char* comment = strchr(value_str, ';');
+    if (comment) *comment = '\0';
+
+    /* Remove trailing whitespace */
+    int len = (int)strlen(value_str);
+    while (len > 0 && (value_str[len-1] == ' ' || value_str[len-1] == '\t' ||
+                       value_str[len-1] == '\n' || value_str[len-1] == '\r')) {
+        value_str[--len] = '\0';
+    }
+
+    /* Try to parse the value */
+    int value;
+    if (parse_const_value(table, value_str, &value)) {
+        constants_add(table, name, value);
+    }
+}
+
+void CadAsmConstants_LoadText(CadAsmConstants* table, const char* text, size_t size) {
+    if (!table || !text) return;
+
+    char* content = (char*)malloc(size + 1);
+    if (!content) return;
+    memcpy(content, text, size);
+    content[size] = '\0';
+
+    /* Parse line by line - do multiple passes to resolve dependencies */
+    for (int pass = 0; pass < 3; pass++) {
+        const char* line = content;
+        const char* end = content + size;
+        while (line < end) {
+            const char* next = (const char*)memchr(line, '\n', (size_t)(end - line));
+            size_t len = next ? (size_t)(next - line) : (size_t)(end - line);
+            char buf[512];
+            if (len >= sizeof(buf)) len = sizeof(buf) - 1;
+            memcpy(buf, line, len);
+            buf[len] = '\0';
+            parse_constant_line(table, buf);
+            if (!next) break;
+            line = next + 1;
+        }
+    }
+
+    free(content);
+}
+
+/* Load constants from an INC/ASM file (missing files are skipped) */
+static void load_constants_from_file(CadAsmConstants* table, const char* filepath) {
+    size_t size = 0;
+    char* content = read_file(filepath, &size);
+    if (!content) return;
+    CadAsmConstants_LoadText(table, content, size);
+    free(content);
+}
+
+void CadAsmConstants_LoadFolder(CadAsmConstants* table, const char* shapes_folder) {
+    if (!table || !shapes_folder) return;
+    CadAsmConstants_Clear(table);
+
+    /* Build path to INC folder - go up one level from SHAPES */
+    char inc_path[512];
+    strncpy(inc_path, shapes_folder, sizeof(inc_path) - 16);
+    inc_path[sizeof(inc_path) - 16] = '\0';
+
+    /* Remove trailing slash if present */
+    int len = (int)strlen(inc_path);
+    while (len > 0 && (inc_path[len-1] == '/' || inc_path[len-1] == '\\')) {
+        inc_path[--len] = '\0';
+    }
+
+    /* Go up one directory (from SHAPES to SF) */
+    char* last_sep = strrchr(inc_path, '\\');
+    char* last_slash = strrchr(inc_path, '/');
+    if (last_slash > last_sep) last_sep = last_slash;
+    if (last_sep) {
+        *last_sep = '\0';
+        strcat(inc_path, PATH_SEP "INC");
+    } else {
+        strcat(inc_path, PATH_SEP ".." PATH_SEP "INC");
+    }
+
+    fprintf(stdout, "CadAsmConstants_LoadFolder: Looking for INC folder at '%s'\n", inc_path);
+
+    char filepath[600];
+
+    /* Load INC files in order of dependency (most basic first) */
+    const char* inc_files[] = {
+        "STRATEQU.INC",  /* Shape-related constants */
+        "VARS.INC",      /* Variables */
+        "STRUCTS.INC",   /* Structure definitions */
+        "MACROS.INC",    /* Macros */
+        NULL
+    };
+
+    for (int f = 0; inc_files[f] != NULL; f++) {
+        snprintf(filepath, sizeof(filepath), "%s" PATH_SEP "%s", inc_path, inc_files[f]);
+        load_constants_from_file(table, filepath);
+    }
+
+    /* Also load constants from shape ASM files (they define some local constants) */
+    const char* shape_files[] = {
+        "SHAPES.ASM",
+        "SHAPES2.ASM",
+        "SHAPES3.ASM",
+        "SHAPES4.ASM",
+        "SHAPES5.ASM",
+        "SHAPES6.ASM",
+        "KSHAPES.ASM",
+        "PSHAPES.ASM",
+        "USHAPES.ASM",
+        NULL
+    };
+
+    for (int f = 0; shape_files[f] != NULL; f++) {
+        snprintf(filepath, sizeof(filepath), "%s" PATH_SEP "%s", shapes_folder, shape_files[f]);
+        load_constants_from_file(table, filepath);
+    }
+
+    fprintf(stdout, "CadAsmConstants_LoadFolder: Loaded %d constants\n", table->count);
+}
+
+/* ----------------------------------------------------------------------------
+   Shape parsing
+   ---------------------------------------------------------------------------- */
+
+/* Simple JSON parser to extract shape-to-file mapping from Shapes.SFEOPTIM */
+static int find_shape_file_in_json(const char* json_content, const char* shape_name,
+                                   char* filename, size_t cap) {
+    if (!json_content || !shape_name) return 0;
+
+    /* Build search pattern: "SHAPE_NAME":" */
+    char pattern[512];
+    snprintf(pattern, sizeof(pattern), "\"%s\":\"", shape_name);
+
+    /* Find the pattern in JSON */
+    const char* pos = strstr(json_content, pattern);
+    if (!pos) return 0;
+
+    /* Skip past the pattern to get to the filename */
+    pos += strlen(pattern);
+
+    /* Extract filename until closing quote */
+    size_t i = 0;
+    while (*pos && *pos != '"' && i < cap - 1) {
+        filename[i++] = *pos++;
+    }
+    filename[i] = '\0';
+    return i > 0;
+}
+
+/* Helper: Create a polygon with its own point chain (points are copied, not shared) */
+/* max_vertices: maximum valid vertex index (for bounds checking) */
+static CadIndex create_polygon_with_points_safe(CadCore* core, double vertices[][3], const int vertex_indices[],
+                                               int num_vertices, uint8_t color, int max_vertices) {
+    if (!core || num_vertices < 2 || num_vertices > 12) return INVALID_INDEX;
+
+    /* Create new points for this polygon and link them */
+    CadIndex first_point = INVALID_INDEX;
+    CadIndex prev_point = INVALID_INDEX;
+
+    for (int i = 0; i < num_vertices; i++) {
+        int v_idx = vertex_indices[i];
+        /* Bounds check to prevent crashes */
+        if (v_idx < 0 || v_idx >= max_vertices) {
+            fprintf(stderr, "create_polygon_with_points: vertex index %d out of bounds (max %d)\n", v_idx, max_vertices);
+            return INVALID_INDEX;
+        }
+        CadIndex new_pt = CadCore_AddPoint(core, vertices[v_idx][0], vertices[v_idx][1], vertices[v_idx][2]);
+        if (new_pt == INVALID_INDEX) return INVALID_INDEX;
+
+        if (first_point == INVALID_INDEX) {
+            first_point = new_pt;
+        }
+
+        if (prev_point != INVALID_INDEX) {
+            CadCore_SetNextPoint(core, prev_point, new_pt);
+        }
+
+        prev_point = new_pt;
+    }
+
+    /* Mark last point as end of chain */
+    if (prev_point != INVALID_INDEX) {
+        CadCore_SetNextPoint(core, prev_point, -1);
+    }
+
+    /* Create the polygon */
+    return CadCore_AddPolygon(core, first_point, color, (uint8_t)num_vertices);
+}
+
+/* Parse "color, viz, nx, ny, nz, v0, ..., v(n-1)" after a FaceN keyword */
+static int parse_face_values(const char* line, int nverts, int* color, int* verts) {
+    const char* num_start = line;
+    while (*num_start == ' ' || *num_start == '\t') num_start++;
+
+    /* color, viz, nx, ny, nz, then the vertex indices */
+    int values[5 + 5];
+    char* parse_pos = (char*)num_start;
+    for (int v = 0; v < 5 + nverts; v++) {
+        if (v > 0) {
+            while (*parse_pos == ' ' || *parse_pos == '\t') parse_pos++;
+            if (*parse_pos == ',') parse_pos++;
+            while (*parse_pos == ' ' || *parse_pos == '\t') parse_pos++;
+        }
+        values[v] = (int)strtol(parse_pos, &parse_pos, 10);
+    }
+
+    *color = values[0];
+    for (int v = 0; v < nverts; v++) {
+        verts[v] = values[5 + v];
+    }
+    return parse_pos > num_start;
+}
+
+/* Split a normalized copy of the text into lines (content is modified in place) */
+static char** split_lines(char* content, size_t size, int* out_count) {
+    int line_count = 0;
+    int line_capacity = 1000;
+    char** lines = (char**)malloc(line_capacity * sizeof(char*));
+    if (!lines) return NULL;
+
+    char* line_start = content;
+    for (size_t i = 0; i <= size; i++) {
+        if (content[i] == '\n' || content[i] == '\0') {
+            if (line_count >= line_capacity) {
+                line_capacity *= 2;
+                char** grown = (char**)realloc(lines, line_capacity * sizeof(char*));
+                if (!grown) {
+                    free(lines);
+                    return NULL;
+                }
+                lines = grown;
+            }
+            content[i] = '\0';
+            lines[line_count++] = line_start;
+            line_start = &content[i + 1];
+        }
+    }
+    *out_count = line_count;
+    return lines;
+}
+
+/* Copy text, turning \r\n and lone \r into \n */
+static char* normalize_text(const char* text, size_t size, size_t* out_size) {
+    char* content = (char*)malloc(size + 1);
+    if (!content) return NULL;
+
+    size_t n = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (text[i] == '\r') {
+            if (i + 1 < size && text[i + 1] == '\n') continue;
+            content[n++] = '\n';
+        } else {
+            content[n++] = text[i];
+        }
+    }
+    content[n] = '\0';
+    *out_size = n;
+    return content;
+}
+
+/* ----------------------------------------------------------------------------
+   Parsed source file
+   The text is normalized, split into lines and lower-cased once; every
+   shape imported from it reuses that work.
+   ---------------------------------------------------------------------------- */
+
+struct CadAsmSource {
+    char* content;       /* Normalized text, split into lines in place */
+    char* lower;         /* Lower-case copy, split the same way */
+    char** lines;
+    char** lower_lines;  /* lower_lines[i] is lines[i] in lower case */
+    int line_count;
+    char** shape_names;  /* Labels of the ShapeHdr lines, in file order */
+    int* shape_lines;    /* Line index of each ShapeHdr */
+    int shape_count;
+};
+
+/* Index the "<name><ws>shapehdr ..." lines */
+static int index_shapes(CadAsmSource* source) {
+    int capacity = 0;
+    for (int i = 0; i < source->line_count; i++) {
+        const char* lower = source->lower_lines[i];
+        const char* p = lower;
+        while (*p == ' ' || *p == '\t') p++;
+        const char* name_start = p;
+        while (isalnum((unsigned char)*p) || *p == '_') p++;
+        size_t name_len = (size_t)(p - name_start);
+        if (name_len == 0 || (*p != ' ' && *p != '\t')) continue;
+        while (*p == ' ' || *p == '\t') p++;
+        if (strncmp(p, "shapehdr", 8) != 0) continue;
+
+        if (source->shape_count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            char** names = (char**)realloc(source->shape_names, (size_t)capacity * sizeof(char*));
+            if (!names) return 0;
+            source->shape_names = names;
+            int* lines = (int*)realloc(source->shape_lines, (size_t)capacity * sizeof(int));
+            if (!lines) return 0;
+            source->shape_lines = lines;
+        }
+        /* Keep the label's original case */
+        char* name = (char*)malloc(name_len + 1);
+        if (!name) return 0;
+        memcpy(name, source->lines[i] + (name_start - lower), name_len);
+        name[name_len] = '\0';
+        source->shape_names[source->shape_count] = name;
+        source->shape_lines[source->shape_count] = i;
+        source->shape_count++;
+    }
+    return 1;
+}
+
+CadAsmSource* CadAsmSource_Create(const char* text, size_t size) {
+    if (!text) return NULL;
+
+    CadAsmSource* source = (CadAsmSource*)calloc(1, sizeof(CadAsmSource));
+    if (!source) return NULL;
+
+    size_t content_size = 0;
+    source->content = normalize_text(text, size, &content_size);
+    source->lower = source->content ? (char*)malloc(content_size + 1) : NULL;
+    if (!source->lower) {
+        fprintf(stderr, "CadAsmSource_Create: Memory allocation failed\n");
+        CadAsmSource_Destroy(source);
+        return NULL;
+    }
+    for (size_t i = 0; i <= content_size; i++) {
+        source->lower[i] = (char)tolower((unsigned char)source->content[i]);
+    }
+
+    int lower_count = 0;
+    source->lines = split_lines(source->content, content_size, &source->line_count);
+    source->lower_lines = split_lines(source->lower, content_size, &lower_count);
+    if (!source->lines || !source->lower_lines || !index_shapes(source)) {
+        fprintf(stderr, "CadAsmSource_Create: Failed to allocate memory for lines\n");
+        CadAsmSource_Destroy(source);
+        return NULL;
+    }
+    return source;
+}
+
+CadAsmSource* CadAsmSource_Load(const char* filename) {
+    size_t size = 0;
+    char* content = read_file(filename, &size);
+    if (!content) {
+        fprintf(stderr, "CadAsmSource_Load: Could not read file '%s'\n", filename);
+        return NULL;
+    }
+    CadAsmSource* source = CadAsmSource_Create(content, size);
+    free(content);
+    return source;
+}
+
+void CadAsmSource_Destroy(CadAsmSource* source) {
+    if (!source) return;
+    for (int i = 0; i < source->shape_count; i++) {
+        free(source->shape_names[i]);
+    }
+    free(source->shape_names);
+    free(source->shape_lines);
+    free(source->lines);
+    free(source->lower_lines);
+    free(source->lower);
+    free(source->content);
+    free(source);
+}
+
+int CadAsmSource_GetShapeCount(const CadAsmSource* source) {
+    return source ? source->shape_count : 0;
+}
+
+const char* CadAsmSource_GetShapeName(const CadAsmSource* source, int index) {
+    if (!source || index < 0 || index >= source->shape_count) return NULL;
+    return source->shape_names[index];
+}
+
+/* Read the points and faces section names from "name shapehdr points,0,faces,..." */
+static int find_shape_header(const CadAsmSource* source, const char* shape_name,
+                             char* points_section, char* faces_section) {
+    for (int s = 0; s < source->shape_count; s++) {
+        if (ascii_icmp(source->shape_names[s], shape_name) != 0) continue;
+        int i = source->shape_lines[s];
+
+        /* Parse the ShapeHdr parameters */
+        const char* params = strstr(source->lower_lines[i], "shapehdr") + 8;
+        while (*params == ' ' || *params == '\t') params++;
+
+        /* Extract points section name (first parameter before comma) */
+        const char* comma1 = strchr(params, ',');
+        if (comma1) {
+            int len = (int)(comma1 - params);
+            if (len > 0 && len < 256) {
+                memcpy(points_section, params, len);
+                points_section[len] = '\0';
+                /* Trim whitespace */
+                while (len > 0 && (points_section[len-1] == ' ' || points_section[len-1] == '\t')) {
+                    points_section[--len] = '\0';
+                }
+            }
+
+            /* Skip to third parameter (faces section) */
+            /* Format: points,0,faces,... */
+            const char* comma2 = strchr(comma1 + 1, ',');
+            if (comma2) {
+                const char* faces_param = comma2 + 1;
+                while (*faces_param == ' ' || *faces_param == '\t') faces_param++;
+                const char* comma3 = strchr(faces_param, ',');
+                if (comma3) {
+                    int flen = (int)(comma3 - faces_param);
+                    if (flen > 0 && flen < 256) {
+                        memcpy(faces_section, faces_param, flen);
+                        faces_section[flen] = '\0';
+                        while (flen > 0 && (faces_section[flen-1] == ' ' || faces_section[flen-1] == '\t')) {
+                            faces_section[--flen] = '\0';
+                        }
+                    }
+                }
+            }
+        }
+        return i;
+    }
+    return -1;
+}
+
+/* Lower-case line with leading whitespace skipped */
+static const char* stripped_lower(const CadAsmSource* source, int i) {
+    const char* stripped = source->lower_lines[i];
+    while (*stripped == ' ' || *stripped == '\t') stripped++;
+    return stripped;
+}
+
+/* Parse one pb/pw/pbd2/pwd2 line into vertices (mirrored sections add +x and -x) */
+static void parse_point_line(const CadAsmConstants* constants, const char* line, const char* line_lower,
+                             int in_mirrored_section, double vertices[][3], int* vertex_count) {
+    /* Regex pattern: r'p[wb]d?2?\s+(-?\d+)\s*,\s*(-?\d+)\s*,\s*(-?\d+)'
+       pbd2/pwd2 divide coordinates by 2 */
+    const char* pbd2_pos = strstr(line_lower, "pbd2");
+    const char* pwd2_pos = strstr(line_lower, "pwd2");
+    const char* pb_pos = strstr(line_lower, "pb");
+    const char* pw_pos = strstr(line_lower, "pw");
+    const char* point_pos = NULL;
+    int divide_by_2 = 0;
+    int skip_len = 2; /* Default: pb/pw are 2 chars */
+
+    /* Check for pbd2/pwd2 first (they also contain pb/pw) */
+    if (pbd2_pos && (pbd2_pos == line_lower || pbd2_pos[-1] == ' ' || pbd2_pos[-1] == '\t')) {
+        point_pos = pbd2_pos;
+        divide_by_2 = 1;
+        skip_len = 4;
+    } else if (pwd2_pos && (pwd2_pos == line_lower || pwd2_pos[-1] == ' ' || pwd2_pos[-1] == '\t')) {
+        point_pos = pwd2_pos;
+        divide_by_2 = 1;
+        skip_len = 4;
+    } else if (pb_pos && (!pw_pos || pb_pos < pw_pos)) {
+        /* Make sure it's pb, not pbd2 */
+        if (pb_pos[2] != 'd') point_pos = pb_pos;
+    } else if (pw_pos) {
+        /* Make sure it's pw, not pwd2 */
+        if (pw_pos[2] != 'd') point_pos = pw_pos;
+    }
+    if (!point_pos) return;
+
+    /* Make sure point directive is at start of a word */
+    if (point_pos != line_lower && point_pos[-1] != ' ' && point_pos[-1] != '\t' &&
+        point_pos[-1] != '\n' && point_pos[-1] != '\r') {
+        return;
+    }
+
+    /* Skip directive and any whitespace after it - use original line for parsing */
+    const char* coord_start = line + (point_pos - line_lower) + skip_len;
+    while (*coord_start == ' ' || *coord_start == '\t') coord_start++;
+
+    /* Split into three comma-separated parts */
+    char coord_buf[256];
+    strncpy(coord_buf, coord_start, sizeof(coord_buf) - 1);
+    coord_buf[sizeof(coord_buf) - 1] = '\0';
+
+    /* Remove trailing comment */
+    char* comment = strchr(coord_buf, ';');
+    if (comment) *comment = '\0';
+
+    /* Split by comma */
+    char* x_str = coord_buf;
+    char* y_str = strchr(x_str, ',');
+    char* z_str = NULL;
+    if (y_str) {
+        *y_str++ = '\0';
+        while (*y_str == ' ' || *y_str == '\t') y_str++;
+        z_str = strchr(y_str, ',');
+        if (z_str) {
+            *z_str++ = '\0';
+            while (*z_str == ' ' || *z_str == '\t') z_str++;
+        }
+    }
+    if (!y_str || !z_str) return;
+
+    /* Try to parse each coordinate using constant resolver */
+    int x, y, z;
+    int x_ok = parse_const_value(constants, x_str, &x);
+    int y_ok = parse_const_value(constants, y_str, &y);
+    int z_ok = parse_const_value(constants, z_str, &z);
+    if (!x_ok || !y_ok || !z_ok) {
+        fprintf(stderr, "CadImport_AsmShape: Could not resolve point: x=%s(%s) y=%s(%s) z=%s(%s)\n",
+                x_str, x_ok ? "ok" : "FAIL", y_str, y_ok ? "ok" : "FAIL", z_str, z_ok ? "ok" : "FAIL");
+        return;
+    }
+
+    /* Apply divide by 2 for pbd2/pwd2 */
+    if (divide_by_2) {
+        x /= 2;
+        y /= 2;
+        z /= 2;
+    }
+    /* Negate Y to convert from SNES coordinate system (Y down) to OpenGL (Y up) */
+    y = -y;
+
+    if (in_mirrored_section) {
+        /* Mirrored point - add both +x and -x versions */
+        if (*vertex_count < 8190) {
+            vertices[*vertex_count][0] = x;
+            vertices[*vertex_count][1] = y;
+            vertices[*vertex_count][2] = z;
+            (*vertex_count)++;
+            vertices[*vertex_count][0] = -x;
+            vertices[*vertex_count][1] = y;
+            vertices[*vertex_count][2] = z;
+            (*vertex_count)++;
+        }
+    } else if (*vertex_count < 8191) {
+        vertices[*vertex_count][0] = x;
+        vertices[*vertex_count][1] = y;
+        vertices[*vertex_count][2] = z;
+        (*vertex_count)++;
+    }
+}
+
+#define ASM_MAX_VERTICES 8192
+
+static int import_shape(CadCore* core, const CadAsmSource* source,
+                        const char* shape_name, const CadAsmConstants* constants) {
+    if (!core || !source || !shape_name) {
+        fprintf(stderr, "CadImport_AsmShapeFromSource: Invalid parameters\n");
+        return 0;
+    }
+    char** lines = source->lines;
+    char** lower_lines = source->lower_lines;
+    int line_count = source->line_count;
+
+    char shape_name_lower[256];
+    lower_copy(shape_name_lower, sizeof(shape_name_lower), shape_name);
+
+    /* First, find the ShapeHdr line to extract actual _P and _F section names */
+    char actual_points_section[256] = {0};
+    char actual_faces_section[256] = {0};
+    int shapehdr_line = find_shape_header(source, shape_name,
+                                          actual_points_section, actual_faces_section);
+    if (shapehdr_line >= 0) {
+        fprintf(stdout, "Found ShapeHdr for %s at line %d: points='%s', faces='%s'\n",
+                shape_name, shapehdr_line, actual_points_section, actual_faces_section);
+    }
+
+    /* If no ShapeHdr found, fall back to default naming */
+    char shape_p[260];
+    char shape_f[260];
+    if (actual_points_section[0]) {
+        strcpy(shape_p, actual_points_section);
+    } else {
+        snprintf(shape_p, sizeof(shape_p), "%s_p", shape_name_lower);
+    }
+    if (actual_faces_section[0]) {
+        strcpy(shape_f, actual_faces_section);
+    } else {
+        snprintf(shape_f, sizeof(shape_f), "%s_f", shape_name_lower);
+    }
+
+    /* Now find the actual sections */
+    int points_start = -1;
+    int faces_start = -1;
+    size_t shape_p_len = strlen(shape_p);
+    size_t shape_f_len = strlen(shape_f);
+    for (int i = 0; i < line_count; i++) {
+        const char* stripped = stripped_lower(source, i);
+
+        /* Look for points section */
+        if (points_start == -1 && strncmp(stripped, shape_p, shape_p_len) == 0) {
+            char after_p = stripped[shape_p_len];
+            if (after_p == '\0' || after_p == ' ' || after_p == '\t') {
+                points_start = i;
+            }
+        }
+        /* Look for faces section */
+        if (faces_start == -1 && strncmp(stripped, shape_f, shape_f_len) == 0) {
+            char after_f = stripped[shape_f_len];
+            if (!isdigit((unsigned char)after_f)) {
+                faces_start = i;
+            }
+        }
+    }
+
+    if (points_start == -1) {
+        /* Shape not in this text (normal when searching several files) */
+        return 0;
+    }
+
+    /* The text defines the shape: replace the current model */
+    CadCore_Clear(core);
+
+    if (faces_start == -1) {
+        fprintf(stderr, "WARNING: Could not find faces section '%s' for shape: %s (will continue without faces)\n",
+                shape_f, shape_name);
+    }
+
+    /* Parse points - build vertex array first. Local constants go into an
+       overlay so the shared table is never written (and can be shared
+       between threads) */
+    double (*vertices)[3] = (double (*)[3])malloc(ASM_MAX_VERTICES * sizeof(*vertices));
+    CadAsmConstants* locals = CadAsmConstants_CreateOverlay(constants);
+    if (!vertices || !locals) {
+        fprintf(stderr, "CadImport_AsmShapeFromSource: Memory allocation failed\n");
+        free(vertices);
+        CadAsmConstants_Destroy(locals);
+        return 0;
+    }
+    int vertex_count = 0;
+    int in_mirrored_section = 0;
+
+    /* First, parse local constants from between ShapeHdr and the first Points directive */
+    /* Local constants can appear BEFORE the points section label (e.g., d = 5 before Lcube_P) */
+    int const_scan_start = (shapehdr_line >= 0) ? shapehdr_line : (points_start > 10 ? points_start - 10 : 0);
+    for (int i = const_scan_start; i < line_count && i < points_start + 20; i++) {
+        const char* line = lines[i];
+
+        /* Check if we hit a Points directive - stop scanning for constants */
+        const char* line_lower = lower_lines[i];
+        if (strstr(line_lower, "pointsb") || strstr(line_lower, "pointsw") ||
+            strstr(line_lower, "pointsxb") || strstr(line_lower, "pointsxw")) {
+            break;
+        }
+
+        /* Look for local constant definition: name = expression */
+        const char* eq = strchr(line, '=');
+        if (!eq) continue;
+
+        /* Extract name (before =) */
+        char name[MAX_CONST_NAME];
+        int name_len = 0;
+        const char* p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        while (p < eq && (isalnum((unsigned char)*p) || *p == '_')) {
+            if (name_len < MAX_CONST_NAME - 1) {
+                name[name_len++] = *p;
+            }
+            p++;
+        }
+        name[name_len] = '\0';
+
+        /* Skip if name is empty or starts with a directive */
+        if (name_len > 0 && ascii_icmp(name, "equ") != 0 && ascii_icmp(name, "set") != 0) {
+            int value;
+            if (parse_const_value(locals, eq + 1, &value)) {
+                constants_add(locals, name, value);
+            }
+        }
+    }
+
+    for (int i = points_start; i < line_count; i++) {
+        const char* line_lower = lower_lines[i];
+
+        /* Check for EndPoints - stop parsing points */
+        if (strstr(line_lower, "endpoints")) break;
+
+        /* Pointsb/Pointsw (non-mirrored) come first, PointsXb/PointsXw (mirrored) after */
+        if (strstr(line_lower, "pointsb") && !strstr(line_lower, "pointsxb")) {
+            in_mirrored_section = 0;
+            continue;
+        }
+        if (strstr(line_lower, "pointsxb")) {
+            in_mirrored_section = 1;
+            continue;
+        }
+        if (strstr(line_lower, "pointsw") && !strstr(line_lower, "pointsxw")) {
+            in_mirrored_section = 0;
+            continue;
+        }
+        if (strstr(line_lower, "pointsxw")) {
+            in_mirrored_section = 1;
+            continue;
+        }
+
+        /* Parse point: pb x,y,z, pw x,y,z, pbd2 x,y,z, pwd2 x,y,z */
+        parse_point_line(locals, lines[i], line_lower, in_mirrored_section, vertices, &vertex_count);
+    }
+
+    /* Note: Points are created per-polygon by create_polygon_with_points_safe() */
+    fprintf(stdout, "Loaded %d vertices for shape: %s\n", vertex_count, shape_name);
+
+    /* Parse faces - scan from faces_start until EndShape
+       Also need to check for shape_f1, shape_f2, etc. sections */
+    int face_count = 0;
+    int face_sections[32];
+    int face_section_count = 0;
+
+    /* Only process faces if we found a valid faces section */
+    if (faces_start < 0) {
+        faces_start = line_count; /* Prevent any face parsing loops */
+    }
+
+    /* Find where this shape ends (EndShape) to limit our search */
+    int shape_end = line_count;
+    for (int i = faces_start; i < line_count; i++) {
+        const char* line_lower = lower_lines[i];
+        if (strstr(line_lower, "endshape")) {
+            shape_end = i + 1;
+            break;
+        }
+    }
+
+    /* Look for ALL face sections (shape_f, shape_f1, shape_f2, etc.) WITHIN this shape only */
+    for (int i = faces_start; i < shape_end && face_section_count < 32; i++) {
+        const char* stripped = stripped_lower(source, i);
+
+        /* Check if this line starts with shape_f (could be shape_f, shape_f1, shape_f2, etc.) */
+        if (strncmp(stripped, shape_f, shape_f_len) == 0) {
+            /* Accept if: end of string, whitespace, or a digit (for f1, f2, etc.) */
+            char after_f = stripped[shape_f_len];
+            if (after_f == '\0' || after_f == ' ' || after_f == '\t' || isdigit((unsigned char)after_f)) {
+                face_sections[face_section_count++] = i;
+            }
+        }
+    }
+
+    /* Parse faces from all face sections */
+    int found = 0;
+    for (int section_idx = 0; section_idx < face_section_count; section_idx++) {
+        int section_start = face_sections[section_idx];
+
+        /* Determine where this section ends - either at Fend/EndShape, or at the start of the next face section */
+        int section_end = line_count;
+        if (section_idx + 1 < face_section_count) {
+            section_end = face_sections[section_idx + 1];
+        }
+        for (int i = section_start; i < section_end; i++) {
+            const char* line_lower = lower_lines[i];
+            if (strstr(line_lower, "endshape") || strstr(line_lower, "fend")) {
+                section_end = i + 1; /* Stop after this line */
+                break;
+            }
+        }
+
+        /* Skip the label line and look for "Faces" keyword or actual face definitions */
+        int actual_start = section_start;
+        for (int i = section_start; i < section_end; i++) {
+            const char* line_lower = lower_lines[i];
+            if (strstr(line_lower, "faces") || strstr(line_lower, "face3") ||
+                strstr(line_lower, "face4") || strstr(line_lower, "face5")) {
+                actual_start = i;
+                break;
+            }
+        }
+
+        for (int i = actual_start; i < section_end; i++) {
+            const char* line_lower = lower_lines[i];
+
+            /* Check for EndShape or Fend - stop parsing this section */
+            if (strstr(line_lower, "endshape") || strstr(line_lower, "fend")) break;
+
+            /* Face2: line; Face3: triangle; Face4/Face5 are split into a
+               triangle fan (v0,v1,v2), (v0,v2,v3), (v0,v3,v4).
+               Format: FaceN color, viz, nx, ny, nz, v0, ..., v(N-1) */
+            for (int n = 2; n <= 5; n++) {
+                char keyword[8];
+                snprintf(keyword, sizeof(keyword), "face%d", n);
+                const char* face_pos = strstr(line_lower, keyword);
+                if (!face_pos) continue;
+
+                int color;
+                int verts[5];
+                if (!parse_face_values(face_pos + 5, n, &color, verts)) continue;
+
+                int valid = 1;
+                for (int v = 0; v < n; v++) {
+                    if (verts[v] < 0 || verts[v] >= vertex_count) valid = 0;
+                }
+                if (!valid) continue;
+
+                if (n == 2) {
+                    if (create_polygon_with_points_safe(core, vertices, verts, 2, (uint8_t)color, vertex_count) != INVALID_INDEX) {
+                        face_count++;
+                    }
+                    continue;
+                }
+                for (int t = 1; t + 1 < n; t++) {
+                    int tri_verts[3] = { verts[0], verts[t], verts[t + 1] };
+                    if (create_polygon_with_points_safe(core, vertices, tri_verts, 3, (uint8_t)color, vertex_count) != INVALID_INDEX) {
+                        face_count++;
+                    }
+                }
+            }
+
+            /* Check for EndShape */
+            if (strstr(line_lower, "endshape")) {
+                found = 1;
+                break;
+            }
+        }
+    }
+
+    fprintf(stdout, "Loaded %d faces for shape: %s\n", face_count, shape_name);
+
+    /* Check if we successfully parsed the shape */
+    if (vertex_count > 0) {
+        found = 1;
+        fprintf(stdout, "Successfully parsed shape: %s (vertices: %d, polygons: %d)\n",
+                shape_name, vertex_count, core->data.polygonCount);
+    }
+
+    free(vertices);
+    CadAsmConstants_Destroy(locals);
+    return found;
+}
+
+/* The shape's points and faces are added in one batch */
+int CadImport_AsmShapeFromSource(CadCore* core, const CadAsmSource* source,
+                                 const char* shape_name, const CadAsmConstants* constants) {
+    CadCore_BeginBatch(core);
+    int found = import_shape(core, source, shape_name, constants);
+    CadCore_CommitBatch(core);
+    return found;
+}
+
+int CadImport_AsmShapeFromBuffer(CadCore* core, const char* text, size_t size,
+                                 const char* shape_name, const CadAsmConstants* constants) {
+    CadAsmSource* source = CadAsmSource_Create(text, size);
+    if (!source) return 0;
+    int found = CadImport_AsmShapeFromSource(core, source, shape_name, constants);
+    CadAsmSource_Destroy(source);
+    return found;
+}
+
+/* ----------------------------------------------------------------------------
+   Folder lookup
+   ---------------------------------------------------------------------------- */
+
+/* Try one ASM file (returns 1 once the shape was imported) */
+static int try_asm_file(CadCore* core, const char* folder_path, const char* file_name,
+                        const char* shape_name, const CadAsmConstants* constants) {
+    char file_path[520];
+    snprintf(file_path, sizeof(file_path), "%s" PATH_SEP "%s", folder_path, file_name);
+
+    size_t size = 0;
+    char* content = read_file(file_path, &size);
+    if (!content) {
+        fprintf(stderr, "CadImport_AsmShape: Could not read file '%s'\n", file_path);
+        return 0;
+    }
+    if (size == 0) {
+        fprintf(stderr, "CadImport_AsmShape: File '%s' is empty\n", file_name);
+        free(content);
+        return 0;
+    }
+
+    int found = CadImport_AsmShapeFromBuffer(core, content, size, shape_name, constants);
+    free(content);
+    return found;
+}
+
+int CadImport_AsmShape(CadCore* core, const char* shape_name, const char* folder_path,
+                       const CadAsmConstants* constants) {
+    if (!core || !shape_name || !folder_path) {
+        fprintf(stderr, "CadImport_AsmShape: Invalid parameters\n");
+        return 0;
+    }
+
+    fprintf(stdout, "CadImport_AsmShape: Looking for shape '%s' in folder '%s'\n", shape_name, folder_path);
+
+    /* Clear existing CAD data */
+    CadCore_Clear(core);
+
+    /* Try to load the JSON mapping file first */
+    char json_path[520];
+    snprintf(json_path, sizeof(json_path), "%s" PATH_SEP "Shapes.SFEOPTIM", folder_path);
+
+    char target_buf[64];
+    const char* target_filename = NULL;
+    size_t json_size = 0;
+    char* json_content = read_file(json_path, &json_size);
+    if (json_content) {
+        if (find_shape_file_in_json(json_content, shape_name, target_buf, sizeof(target_buf))) {
+            target_filename = target_buf;
+            fprintf(stdout, "CadImport_AsmShape: Found shape '%s' in file '%s' (from JSON mapping)\n",
+                    shape_name, target_filename);
+        }
+        free(json_content);
+    }
+
+    /* Find the ASM file containing this shape */
+    int found = 0;
+#ifdef _WIN32
+    char search_path[520];
+    snprintf(search_path, sizeof(search_path), "%s\\*.asm", folder_path);
+
+    WIN32_FIND_DATAA find_data;
+    HANDLE hFind = FindFirstFileA(search_path, &find_data);
+    if (hFind == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "CadImport_AsmShape: No ASM files found in folder '%s'\n", folder_path);
+        return 0;
+    }
+    do {
+        if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+        /* If we have a target filename from JSON, skip files that don't match */
+        if (target_filename && strcmp(find_data.cFileName, target_filename) != 0) continue;
+        found = try_asm_file(core, folder_path, find_data.cFileName, shape_name, constants);
+    } while (!found && FindNextFileA(hFind, &find_data));
+    FindClose(hFind);
+#else
+    char pattern[520];
+    snprintf(pattern, sizeof(pattern), "%s/*.[aA][sS][mM]", folder_path);
+
+    glob_t matches;
+    if (glob(pattern, 0, NULL, &matches) != 0) {
+        fprintf(stderr, "CadImport_AsmShape: No ASM files found in folder '%s'\n", folder_path);
+        return 0;
+    }
+    for (size_t i = 0; !found && i < matches.gl_pathc; i++) {
+        const char* name = strrchr(matches.gl_pathv[i], '/');
+        name = name ? name + 1 : matches.gl_pathv[i];
+        if (target_filename && strcmp(name, target_filename) != 0) continue;
+        found = try_asm_file(core, folder_path, name, shape_name, constants);
+    }
+    globfree(&matches);
+#endif
+
+    return found;
+}
+
+int CadAsm_FirstShapeName(const char* text, size_t size, char* name, size_t cap) {
+    if (!text || !name || cap == 0) return 0;
+
+    const char* p = text;
+    const char* end = text + size;
+    while (p < end) {
+        const char* nl = (const char*)memchr(p, '\n', (size_t)(end - p));
+        const char* line_end = nl ? nl : end;
+
+        /* "<name><ws>shapehdr ..." */
+        const char* q = p;
+        while (q < line_end && (*q == ' ' || *q == '\t')) q++;
+        const char* name_start = q;
+        while (q < line_end && (isalnum((unsigned char)*q) || *q == '_')) q++;
+        size_t name_len = (size_t)(q - name_start);
+        const char* ws = q;
+        while (q < line_end && (*q == ' ' || *q == '\t')) q++;
+        if (name_len > 0 && q > ws && line_end - q >= 8 && ascii_nicmp(q, "shapehdr", 8) == 0) {
+            if (name_len >= cap) name_len = cap - 1;
+            memcpy(name, name_start, name_len);
+            name[name_len] = '\0';
+            return 1;
+        }
+        p = nl ? nl + 1 : end;
+    }
+    return 0;
+}
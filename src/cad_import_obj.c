@@ -20,10 +20,8 @@
 #endif
 #endif
 
-/* Import CAD data from Wavefront OBJ format (.obj) */
-int CadImport_OBJ(CadCore* core, const char* filename) {
-    if (!core || !filename) return 0;
-    
+/* Read a whole file into a NUL-terminated buffer (free with free) */
+static char* read_text_file(const char* filename, size_t* out_size) {
     FILE* fp = NULL;
 
 #ifdef _WIN32
@@ -33,39 +31,85 @@ int CadImport_OBJ(CadCore* core, const char* filename) {
         wchar_t* wfilename = (wchar_t*)calloc(wlen, sizeof(wchar_t));
         if (wfilename) {
             MultiByteToWideChar(CP_UTF8, 0, filename, -1, wfilename, wlen);
-            fp = _wfopen(wfilename, L"r");
+            fp = _wfopen(wfilename, L"rb");
             free(wfilename);
         }
     }
     if (!fp) {
-        fp = fopen(filename, "r");
+        fp = fopen(filename, "rb");
     }
 #else
-    fp = fopen(filename, "r");
+    fp = fopen(filename, "rb");
 #endif
     
     if (!fp) {
         fprintf(stderr, "Error: Could not open file '%s' for reading\n", filename);
-        return 0;
+        return NULL;
     }
+    
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char* text = (size >= 0) ? (char*)malloc((size_t)size + 1) : NULL;
+    if (!text || fread(text, 1, (size_t)size, fp) != (size_t)size) {
+        fprintf(stderr, "Error: Could not read file '%s'\n", filename);
+        free(text);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+    text[size] = '\0';
+    *out_size = (size_t)size;
+    return text;
+}
+
+/* fgets over a memory buffer: copy the next line (with its newline) into line */
+static int read_line(const char** cursor, const char* end, char* line, size_t cap) {
+    const char* p = *cursor;
+    if (p >= end) return 0;
+    size_t n = 0;
+    while (p < end && n + 1 < cap) {
+        char c = *p++;
+        line[n++] = c;
+        if (c == '\n') break;
+    }
+    line[n] = '\0';
+    *cursor = p;
+    return 1;
+}
+
+/* Import CAD data from Wavefront OBJ format (.obj) */
+int CadImport_OBJ(CadCore* core, const char* filename) {
+    if (!core || !filename) return 0;
+    
+    size_t size = 0;
+    char* text = read_text_file(filename, &size);
+    if (!text) return 0;
+    
+    int result = CadImport_OBJFromBuffer(core, text, size);
+    free(text);
+    return result;
+}
+
+/* Import OBJ text that is already in memory */
+static int import_obj(CadCore* core, const char* text, size_t size) {
+    if (!core || (!text && size > 0)) return 0;
+    
+    const char* text_end = text + size;
+    const char* cursor = text;
 
     /* Clear existing data */
     CadCore_Clear(core);
 
     /* Read vertices first, then faces */
-    double* vertices = (double*)malloc(CAD_MAX_POINTS * 3 * sizeof(double));
-    if (!vertices) {
-        fprintf(stderr, "Error: Memory allocation failed\n");
-        fclose(fp);
-        return 0;
-    }
-    
+    double* vertices = NULL;
+    int vertex_capacity = 0;
     int vertex_count = 0;
     int face_count = 0;
     char line[1024];
     
     /* First pass: read all vertices */
-    while (fgets(line, sizeof(line), fp) && vertex_count < CAD_MAX_POINTS) {
+    while (read_line(&cursor, text_end, line, sizeof(line))) {
         /* Skip whitespace */
         char* p = line;
         while (*p == ' ' || *p == '\t') p++;
@@ -80,6 +124,16 @@ int CadImport_OBJ(CadCore* core, const char* filename) {
             
             double x, y, z;
             if (sscanf(p, "%lf %lf %lf", &x, &y, &z) == 3) {
+                if (vertex_count == vertex_capacity) {
+                    int grown = vertex_capacity ? vertex_capacity * 2 : 1024;
+                    double* bigger = grown <= CAD_MAX_SLOTS ? (double*)realloc(vertices, (size_t)grown * 3 * sizeof(double)) : NULL;
+                    if (!bigger) {
+                        fprintf(stderr, "Warning: Too many vertices, ignoring the rest\n");
+                        break;
+                    }
+                    vertices = bigger;
+                    vertex_capacity = grown;
+                }
                 vertices[vertex_count * 3 + 0] = x;
                 vertices[vertex_count * 3 + 1] = y;
                 vertices[vertex_count * 3 + 2] = z;
@@ -91,23 +145,21 @@ int CadImport_OBJ(CadCore* core, const char* filename) {
     if (vertex_count == 0) {
         fprintf(stderr, "Error: No vertices found in OBJ file\n");
         free(vertices);
-        fclose(fp);
         return 0;
     }
     
     fprintf(stdout, "Importing OBJ: %d vertices\n", vertex_count);
     
     /* Add vertices to CAD system */
-    int16_t* point_indices = (int16_t*)malloc(vertex_count * sizeof(int16_t));
+    CadIndex* point_indices = (CadIndex*)malloc((size_t)vertex_count * sizeof(CadIndex));
     if (!point_indices) {
         fprintf(stderr, "Error: Memory allocation failed\n");
         free(vertices);
-        fclose(fp);
         return 0;
     }
     
     for (int i = 0; i < vertex_count; i++) {
-        int16_t pt_idx = CadCore_AddPoint(core, 
+        CadIndex pt_idx = CadCore_AddPoint(core, 
             vertices[i * 3 + 0],
             vertices[i * 3 + 1],
             vertices[i * 3 + 2]);
@@ -121,9 +173,9 @@ int CadImport_OBJ(CadCore* core, const char* filename) {
     free(vertices);
     
     /* Second pass: read faces */
-    rewind(fp);
+    cursor = text;
     
-    while (fgets(line, sizeof(line), fp) && face_count < CAD_MAX_POLYGONS) {
+    while (read_line(&cursor, text_end, line, sizeof(line))) {
         /* Skip whitespace */
         char* p = line;
         while (*p == ' ' || *p == '\t') p++;
@@ -198,8 +250,8 @@ int CadImport_OBJ(CadCore* core, const char* filename) {
             }
             
             /* Create polygon - each polygon gets its own copy of points */
-            int16_t first_point = INVALID_INDEX;
-            int16_t prev_point = INVALID_INDEX;
+            CadIndex first_point = INVALID_INDEX;
+            CadIndex prev_point = INVALID_INDEX;
             
             for (int i = 0; i < count; i++) {
                 /* Get original point coordinates */
@@ -207,7 +259,7 @@ int CadImport_OBJ(CadCore* core, const char* filename) {
                 if (!orig) continue;
                 
                 /* Create new point for this polygon */
-                int16_t new_pt = CadCore_AddPoint(core, orig->pointx, orig->pointy, orig->pointz);
+                CadIndex new_pt = CadCore_AddPoint(core, orig->pointx, orig->pointy, orig->pointz);
                 if (new_pt == INVALID_INDEX) {
                     fprintf(stderr, "Warning: Failed to add point for face (limit reached)\n");
                     break;
@@ -218,8 +270,7 @@ int CadImport_OBJ(CadCore* core, const char* filename) {
                 }
                 
                 if (prev_point != INVALID_INDEX) {
-                    CadPoint* prev = CadCore_GetPoint(core, prev_point);
-                    if (prev) prev->nextPoint = new_pt;
+                    CadCore_SetNextPoint(core, prev_point, new_pt);
                 }
                 
                 prev_point = new_pt;
@@ -227,13 +278,12 @@ int CadImport_OBJ(CadCore* core, const char* filename) {
             
             /* Close the chain */
             if (prev_point != INVALID_INDEX) {
-                CadPoint* last = CadCore_GetPoint(core, prev_point);
-                if (last) last->nextPoint = INVALID_INDEX;
+                CadCore_SetNextPoint(core, prev_point, INVALID_INDEX);
             }
             
             /* Add polygon with default color */
             if (first_point != INVALID_INDEX) {
-                int16_t poly_idx = CadCore_AddPolygon(core, first_point, 0, (uint8_t)count);
+                CadIndex poly_idx = CadCore_AddPolygon(core, first_point, 0, (uint8_t)count);
                 if (poly_idx >= 0) {
                     face_count++;
                 } else {
@@ -245,7 +295,6 @@ int CadImport_OBJ(CadCore* core, const char* filename) {
     }
     
     free(point_indices);
-    fclose(fp);
     
     fprintf(stdout, "Imported OBJ: %d vertices, %d faces\n", vertex_count, face_count);
     
@@ -255,3 +304,11 @@ int CadImport_OBJ(CadCore* core, const char* filename) {
     
     return (face_count > 0) ? 1 : 0;
 }
+
+/* The records are added in one batch */
+int CadImport_OBJFromBuffer(CadCore* core, const char* text, size_t size) {
+    CadCore_BeginBatch(core);
+    int result = import_obj(core, text, size);
+    CadCore_CommitBatch(core);
+    return result;
+}
@@ -0,0 +1,156 @@
+#include "cad_lz.h"
+#include <stdint.h>
+#include <string.h>
+
+/* ----------------------------------------------------------------------------
+   Block layout
+   token (literal length << 4 | match length - CAD_LZ_MIN_MATCH), extra
+   literal length bytes, literals, 16-bit little-endian offset, extra match
+   length bytes. A nibble of 15 continues with bytes that add 255 until one
+   is smaller. The last sequence carries literals only.
+   ---------------------------------------------------------------------------- */
+#define CAD_LZ_MIN_MATCH    4
+#define CAD_LZ_MAX_OFFSET   65535
+#define CAD_LZ_HASH_BITS    12
+#define CAD_LZ_LAST_LITERALS 5     /* Matches stop this far from the end */
+
+static inline uint32_t read_u32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t hash_u32(uint32_t value) {
+    return (value * 2654435761u) >> (32 - CAD_LZ_HASH_BITS);
+}
+
+size_t CadLz_CompressBound(size_t srcSize) {
+    return srcSize + srcSize / 255 + 16;
+}
+
+static uint8_t* put_length(uint8_t* out, size_t length) {
+    while (length >= 255) {
+        *out++ = 255;
+        length -= 255;
+    }
+    *out++ = (uint8_t)length;
+    return out;
+}
+
+size_t CadLz_Compress(const void* src, size_t srcSize, void* dst, size_t dstCapacity) {
+    if (!src || !dst || dstCapacity < CadLz_CompressBound(srcSize)) return 0;
+    
+    const uint8_t* in = (const uint8_t*)src;
+    const uint8_t* in_end = in + srcSize;
+    const uint8_t* anchor = in;            /* Start of pending literals */
+    uint8_t* out = (uint8_t*)dst;
+    
+    /* Positions (+1, so 0 means empty) of the last 4-byte sequence with each hash */
+    uint32_t table[1 << CAD_LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+    
+    if (srcSize > CAD_LZ_MIN_MATCH + CAD_LZ_LAST_LITERALS) {
+        const uint8_t* match_limit = in_end - CAD_LZ_LAST_LITERALS;
+        const uint8_t* ip = in;
+        
+        while (ip + CAD_LZ_MIN_MATCH <= match_limit) {
+            uint32_t sequence = read_u32(ip);
+            uint32_t h = hash_u32(sequence);
+            const uint8_t* ref = table[h] ? in + table[h] - 1 : NULL;
+            table[h] = (uint32_t)(ip - in) + 1;
+            
+            if (!ref || ip - ref > CAD_LZ_MAX_OFFSET || read_u32(ref) != sequence) {
+                ip++;
+                continue;
+            }
+            
+            /* Extend the match forward */
+            const uint8_t* match_end = ip + CAD_LZ_MIN_MATCH;
+            const uint8_t* ref_end = ref + CAD_LZ_MIN_MATCH;
+            while (match_end < match_limit && *match_end == *ref_end) {
+                match_end++;
+                ref_end++;
+            }
+            
+            size_t literals = (size_t)(ip - anchor);
+            size_t match_length = (size_t)(match_end - ip) - CAD_LZ_MIN_MATCH;
+            size_t offset = (size_t)(ip - ref);
+            
+            uint8_t* token = out++;
+            *token = (uint8_t)(((literals < 15 ? literals : 15) << 4) | (match_length < 15 ? match_length : 15));
+            if (literals >= 15) out = put_length(out, literals - 15);
+            memcpy(out, anchor, literals);
+            out += literals;
+            *out++ = (uint8_t)offset;
+            *out++ = (uint8_t)(offset >> 8);
+            if (match_length >= 15) out = put_length(out, match_length - 15);
+            
+            ip = match_end;
+            anchor = ip;
+        }
+    }
+    
+    /* Trailing literals */
+    size_t literals = (size_t)(in_end - anchor);
+    *out++ = (uint8_t)((literals < 15 ? literals : 15) << 4);
+    if (literals >= 15) out = put_length(out, literals - 15);
+    memcpy(out, anchor, literals);
+    out += literals;
+    
+    return (size_t)(out - (uint8_t*)dst);
+}
+
+/* Reads a continued length; returns 0 if the input runs out */
+static int get_length(const uint8_t** in, const uint8_t* in_end, size_t* length) {
+    uint8_t byte;
+    do {
+        if (*in >= in_end) return 0;
+        byte = *(*in)++;
+        *length += byte;
+    } while (byte == 255);
+    return 1;
+}
+
+int CadLz_Decompress(const void* src, size_t srcSize, void* dst, size_t dstSize) {
+    if (!src || !dst) return 0;
+    
+    const uint8_t* in = (const uint8_t*)src;
+    const uint8_t* in_end = in + srcSize;
+    uint8_t* out = (uint8_t*)dst;
+    uint8_t* out_end = out + dstSize;
+    
+    while (in < in_end) {
+        uint8_t token = *in++;
+        
+        size_t literals = token >> 4;
+        if (literals == 15 && !get_length(&in, in_end, &literals)) return 0;
+        if (literals > (size_t)(in_end - in) || literals > (size_t)(out_end - out)) return 0;
+        memcpy(out, in, literals);
+        in += literals;
+        out += literals;
+        
+        /* The last sequence has no match */
+        if (in == in_end) break;
+        
+        if (in_end - in < 2) return 0;
+        size_t offset = (size_t)in[0] | ((size_t)in[1] << 8);
+        in += 2;
+        if (offset == 0 || offset > (size_t)(out - (uint8_t*)dst)) return 0;
+        
+        size_t match_length = token & 15;
+        if (match_length == 15 && !get_length(&in, in_end, &match_length)) return 0;
+        match_length += CAD_LZ_MIN_MATCH;
+        if (match_length > (size_t)(out_end - out)) return 0;
+        
+        const uint8_t* ref = out - offset;
+        if (offset >= match_length) {
+            memcpy(out, ref, match_length);
+            out += match_length;
+        } else {
+            /* Overlapping copy repeats the last offset bytes */
+            for (size_t i = 0; i < match_length; i++) *out++ = *ref++;
+        }
+    }
+    
+    return out == out_end;
+}
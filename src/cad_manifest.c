@@ -0,0 +1,324 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "cad_manifest.h"
+#include "cad_file.h"
+#include "cad_thread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#ifdef _WIN32
+#include <windows.h>
+#ifndef CP_UTF8
+#define CP_UTF8 65001
+#endif
+#endif
+#ifndef MAX_PATH
+#define MAX_PATH 260
+#endif
+
+#define MANIFEST_HEADER "# cad manifest v1\n"
+
+typedef struct {
+    char* input;
+    char* output;
+    uint64_t contentHash;
+    uint64_t configHash;
+} ManifestEntry;
+
+struct CadManifest {
+    char* filename;
+    ManifestEntry* entries;
+    int count;
+    int capacity;
+    int* slots;              /* Open-addressing index into entries (-1 = empty) */
+    int slotCount;           /* Power of two, kept at least twice count */
+    CadMutex* lock;
+};
+
+/* ----------------------------------------------------------------------------
+   Hashing
+   ---------------------------------------------------------------------------- */
+
+uint64_t CadManifest_HashBytes(const void* bytes, size_t size, uint64_t hash) {
+    const uint8_t* p = (const uint8_t*)bytes;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t CadManifest_HashString(const char* text, uint64_t hash) {
+    return text ? CadManifest_HashBytes(text, strlen(text), hash) : hash;
+}
+
+static FILE* open_file_utf8(const char* filename, const char* mode) {
+#ifdef _WIN32
+    wchar_t wfilename[MAX_PATH * 2] = {0};
+    wchar_t wmode[8] = {0};
+    if (!MultiByteToWideChar(CP_UTF8, 0, filename, -1, wfilename, MAX_PATH * 2)) return NULL;
+    if (!MultiByteToWideChar(CP_UTF8, 0, mode, -1, wmode, 8)) return NULL;
+    return _wfopen(wfilename, wmode);
+#else
+    return fopen(filename, mode);
+#endif
+}
+
+int CadManifest_HashFile(const char* filename, uint64_t* out_hash) {
+    if (!filename || !out_hash) return 0;
+
+    FILE* fp = open_file_utf8(filename, "rb");
+    if (!fp) return 0;
+
+    uint8_t chunk[64 * 1024];
+    uint64_t hash = CAD_MANIFEST_HASH_SEED;
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+        hash = CadManifest_HashBytes(chunk, got, hash);
+    }
+    int ok = !ferror(fp);
+    fclose(fp);
+    if (ok) *out_hash = hash;
+    return ok;
+}
+
+/* ----------------------------------------------------------------------------
+   Entry table
+   ---------------------------------------------------------------------------- */
+
+static char* dup_string(const char* s, size_t len) {
+    char* copy = (char*)malloc(len + 1);
+    if (!copy) return NULL;
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+/* Slot holding input, or the empty slot where it would go */
+static int find_slot(const CadManifest* m, const char* input) {
+    size_t mask = (size_t)m->slotCount - 1;
+    size_t i = (size_t)CadManifest_HashString(input, CAD_MANIFEST_HASH_SEED) & mask;
+    while (m->slots[i] >= 0 && strcmp(m->entries[m->slots[i]].input, input) != 0) {
+        i = (i + 1) & mask;
+    }
+    return (int)i;
+}
+
+static int grow_index(CadManifest* m) {
+    int slotCount = m->slotCount ? m->slotCount * 2 : 64;
+    int* slots = (int*)malloc((size_t)slotCount * sizeof(int));
+    if (!slots) return 0;
+    for (int i = 0; i < slotCount; i++) slots[i] = -1;
+
+    free(m->slots);
+    m->slots = slots;
+    m->slotCount = slotCount;
+    for (int e = 0; e < m->count; e++) {
+        m->slots[find_slot(m, m->entries[e].input)] = e;
+    }
+    return 1;
+}
+
+/* Insert or replace the entry for input (caller holds the lock) */
+static int put_entry(CadManifest* m, const char* input, size_t inputLen,
+                     const char* output, size_t outputLen,
+                     uint64_t contentHash, uint64_t configHash) {
+    if ((m->count + 1) * 2 > m->slotCount && !grow_index(m)) return 0;
+
+    char* key = dup_string(input, inputLen);
+    char* out = dup_string(output, outputLen);
+    if (!key || !out) {
+        free(key);
+        free(out);
+        return 0;
+    }
+
+    int slot = find_slot(m, key);
+    if (m->slots[slot] >= 0) {
+        ManifestEntry* e = &m->entries[m->slots[slot]];
+        free(key);
+        free(e->output);
+        e->output = out;
+        e->contentHash = contentHash;
+        e->configHash = configHash;
+        return 1;
+    }
+
+    if (m->count == m->capacity) {
+        int cap = m->capacity ? m->capacity * 2 : 64;
+        ManifestEntry* entries = (ManifestEntry*)realloc(m->entries, (size_t)cap * sizeof(ManifestEntry));
+        if (!entries) {
+            free(key);
+            free(out);
+            return 0;
+        }
+        m->entries = entries;
+        m->capacity = cap;
+    }
+    ManifestEntry* e = &m->entries[m->count];
+    e->input = key;
+    e->output = out;
+    e->contentHash = contentHash;
+    e->configHash = configHash;
+    m->slots[slot] = m->count++;
+    return 1;
+}
+
+/* ----------------------------------------------------------------------------
+   Load / save
+   ---------------------------------------------------------------------------- */
+
+/* Parse "<hex> <hex> <input>\t<output>" (returns 0 for malformed lines) */
+static int parse_line(CadManifest* m, const char* line, size_t len) {
+    char hex[17];
+    uint64_t hashes[2];
+    const char* p = line;
+    const char* end = line + len;
+
+    for (int h = 0; h < 2; h++) {
+        if (end - p < 17 || p[16] != ' ') return 0;
+        memcpy(hex, p, 16);
+        hex[16] = '\0';
+        char* stop;
+        hashes[h] = strtoull(hex, &stop, 16);
+        if (*stop != '\0') return 0;
+        p += 17;
+    }
+
+    const char* tab = (const char*)memchr(p, '\t', (size_t)(end - p));
+    if (!tab || tab == p || tab + 1 == end) return 0;
+    return put_entry(m, p, (size_t)(tab - p), tab + 1, (size_t)(end - tab - 1), hashes[0], hashes[1]);
+}
+
+CadManifest* CadManifest_Load(const char* filename) {
+    if (!filename) {
+        fprintf(stderr, "Error: Invalid parameters to CadManifest_Load\n");
+        return NULL;
+    }
+
+    CadManifest* m = (CadManifest*)calloc(1, sizeof(CadManifest));
+    if (!m) return NULL;
+    m->filename = dup_string(filename, strlen(filename));
+    m->lock = CadMutex_Create();
+    if (!m->filename || !m->lock || !grow_index(m)) {
+        CadManifest_Destroy(m);
+        return NULL;
+    }
+
+    FILE* fp = open_file_utf8(filename, "rb");
+    if (!fp) return m;       /* First run: nothing cached yet */
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char* text = size > 0 ? (char*)malloc((size_t)size) : NULL;
+    if (size < 0 || (size > 0 && (!text || fread(text, 1, (size_t)size, fp) != (size_t)size))) {
+        fprintf(stderr, "Error: Could not read manifest '%s'\n", filename);
+        free(text);
+        fclose(fp);
+        CadManifest_Destroy(m);
+        return NULL;
+    }
+    fclose(fp);
+
+    int skipped = 0;
+    const char* p = text;
+    const char* end = text + size;
+    while (p < end) {
+        const char* nl = (const char*)memchr(p, '\n', (size_t)(end - p));
+        const char* lineEnd = nl ? nl : end;
+        size_t len = (size_t)(lineEnd - p);
+        if (len > 0 && p[len - 1] == '\r') len--;
+        if (len > 0 && p[0] != '#' && !parse_line(m, p, len)) skipped++;
+        p = nl ? nl + 1 : end;
+    }
+    free(text);
+
+    /* Dropping a bad entry only costs a rebuild of that input */
+    if (skipped) {
+        fprintf(stderr, "Warning: Ignored %d malformed line(s) in manifest '%s'\n", skipped, filename);
+    }
+    return m;
+}
+
+int CadManifest_Save(const CadManifest* m) {
+    if (!m) return 0;
+
+    CadMutex_Lock(m->lock);
+    size_t size = strlen(MANIFEST_HEADER);
+    for (int i = 0; i < m->count; i++) {
+        size += 34 + strlen(m->entries[i].input) + 1 + strlen(m->entries[i].output) + 1;
+    }
+    char* text = (char*)malloc(size + 1);
+    if (!text) {
+        CadMutex_Unlock(m->lock);
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 0;
+    }
+
+    size_t used = (size_t)sprintf(text, "%s", MANIFEST_HEADER);
+    for (int i = 0; i < m->count; i++) {
+        const ManifestEntry* e = &m->entries[i];
+        used += (size_t)sprintf(text + used, "%016" PRIx64 " %016" PRIx64 " %s\t%s\n",
+                                e->contentHash, e->configHash, e->input, e->output);
+    }
+    CadMutex_Unlock(m->lock);
+
+    int ok = CadFile_WriteBufferAtomic(m->filename, text, used);
+    free(text);
+    return ok;
+}
+
+void CadManifest_Destroy(CadManifest* m) {
+    if (!m) return;
+    for (int i = 0; i < m->count; i++) {
+        free(m->entries[i].input);
+        free(m->entries[i].output);
+    }
+    free(m->entries);
+    free(m->slots);
+    free(m->filename);
+    CadMutex_Destroy(m->lock);
+    free(m);
+}
+
+/* ----------------------------------------------------------------------------
+   Queries
+   ---------------------------------------------------------------------------- */
+
+int CadManifest_IsCurrent(CadManifest* m, const char* input,
+                          uint64_t contentHash, uint64_t configHash, const char* output) {
+    if (!m || !input || !output) return 0;
+
+    CadMutex_Lock(m->lock);
+    int slot = find_slot(m, input);
+    int current = 0;
+    if (m->slots[slot] >= 0) {
+        const ManifestEntry* e = &m->entries[m->slots[slot]];
+        current = e->contentHash == contentHash && e->configHash == configHash &&
+                  strcmp(e->output, output) == 0;
+    }
+    CadMutex_Unlock(m->lock);
+    if (!current) return 0;
+
+    /* An output deleted since the last run has to be rebuilt */
+    FILE* fp = open_file_utf8(output, "rb");
+    if (!fp) return 0;
+    fclose(fp);
+    return 1;
+}
+
+int CadManifest_Update(CadManifest* m, const char* input,
+                       uint64_t contentHash, uint64_t configHash, const char* output) {
+    if (!m || !input || !output) return 0;
+
+    CadMutex_Lock(m->lock);
+    int ok = put_entry(m, input, strlen(input), output, strlen(output), contentHash, configHash);
+    CadMutex_Unlock(m->lock);
+    return ok;
+}
+
+int CadManifest_GetCount(const CadManifest* m) {
+    return m ? m->count : 0;
+}
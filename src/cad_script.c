@@ -0,0 +1,353 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "cad_script.h"
+#include "cad_core.h"
+#include "cad_file.h"
+#include "cad_import_obj.h"
+#include "cad_import_3dg1.h"
+#include "cad_import_asm.h"
+#include "cad_export_obj.h"
+#include "cad_export_3dg1.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define SCRIPT_MAX_ARGS 8
+#define SCRIPT_ARG_CAP 1024
+
+/* Tokenizer state for one command */
+typedef struct {
+    char args[SCRIPT_MAX_ARGS][SCRIPT_ARG_CAP];
+    int argc;
+    int len;        /* Length of the argument being built */
+    int inToken;    /* An argument has been started (possibly empty "") */
+    int failed;     /* A tokenizer error was already reported */
+} ScriptCommand;
+
+static int word_equals(const char* a, const char* b) {
+    while (*a && tolower((unsigned char)*a) == tolower((unsigned char)*b)) {
+        a++;
+        b++;
+    }
+    return *a == '\0' && *b == '\0';
+}
+
+/* Case-insensitive check of the file extension (without the dot) */
+static int has_extension(const char* path, const char* ext) {
+    const char* dot = strrchr(path, '.');
+    if (!dot || strchr(dot, '/') || strchr(dot, '\\')) return 0;
+    return word_equals(dot + 1, ext);
+}
+
+/* ----------------------------------------------------------------------------
+   Tokenizer
+   ---------------------------------------------------------------------------- */
+
+static void command_reset(ScriptCommand* cmd) {
+    cmd->argc = 0;
+    cmd->len = 0;
+    cmd->inToken = 0;
+    cmd->failed = 0;
+}
+
+static void command_putc(ScriptCommand* cmd, char c, const char* name, int line) {
+    if (cmd->failed) return;
+    if (cmd->argc >= SCRIPT_MAX_ARGS) {
+        fprintf(stderr, "Error: %s:%d: Too many arguments\n", name, line);
+        cmd->failed = 1;
+        return;
+    }
+    if (cmd->len + 1 >= SCRIPT_ARG_CAP) {
+        fprintf(stderr, "Error: %s:%d: Argument too long\n", name, line);
+        cmd->failed = 1;
+        return;
+    }
+    cmd->args[cmd->argc][cmd->len++] = c;
+    cmd->inToken = 1;
+}
+
+static void command_end_token(ScriptCommand* cmd) {
+    if (!cmd->inToken || cmd->failed) return;
+    cmd->args[cmd->argc][cmd->len] = '\0';
+    cmd->argc++;
+    cmd->len = 0;
+    cmd->inToken = 0;
+}
+
+/* Expand $name / ${name} at *p (pointing at '$') into the current argument */
+static const char* expand_var(ScriptCommand* cmd, const char* p, const char* end,
+                              const CadScriptVar* vars, int var_count, const char* name, int line) {
+    char var[64];
+    int n = 0;
+    int braced = (p + 1 < end && p[1] == '{');
+    p += braced ? 2 : 1;
+    while (p < end && (isalnum((unsigned char)*p) || *p == '_')) {
+        if (n < (int)sizeof(var) - 1) var[n++] = *p;
+        p++;
+    }
+    var[n] = '\0';
+    if (braced) {
+        if (p < end && *p == '}') {
+            p++;
+        } else {
+            n = 0;
+        }
+    }
+    if (n == 0) {
+        if (!cmd->failed) fprintf(stderr, "Error: %s:%d: Bad variable reference\n", name, line);
+        cmd->failed = 1;
+        return p;
+    }
+
+    for (int i = 0; i < var_count; i++) {
+        if (strcmp(vars[i].name, var) == 0) {
+            for (const char* v = vars[i].value; *v; v++) {
+                command_putc(cmd, *v, name, line);
+            }
+            cmd->inToken = 1;
+            return p;
+        }
+    }
+    if (!cmd->failed) fprintf(stderr, "Error: %s:%d: Undefined variable '$%s'\n", name, line, var);
+    cmd->failed = 1;
+    return p;
+}
+
+/* ----------------------------------------------------------------------------
+   Commands
+   ---------------------------------------------------------------------------- */
+
+static int cmd_load(CadCore* core, int argc, char** argv, const char* name, int line) {
+    if (argc == 4 && word_equals(argv[1], "shape")) {
+        CadAsmConstants* constants = CadAsmConstants_Create();
+        if (!constants) {
+            fprintf(stderr, "Error: %s:%d: Memory allocation failed\n", name, line);
+            return 0;
+        }
+        CadAsmConstants_LoadFolder(constants, argv[3]);
+        int ok = CadImport_AsmShape(core, argv[2], argv[3], constants);
+        CadAsmConstants_Destroy(constants);
+        if (!ok) {
+            fprintf(stderr, "Error: %s:%d: Could not load shape '%s' from '%s'\n", name, line, argv[2], argv[3]);
+        }
+        return ok;
+    }
+    if (argc != 2) {
+        fprintf(stderr, "Error: %s:%d: Usage: load <file> | load shape <name> <folder>\n", name, line);
+        return 0;
+    }
+
+    const char* path = argv[1];
+    int ok;
+    if (has_extension(path, "obj")) {
+        ok = CadImport_OBJ(core, path);
+    } else if (has_extension(path, "3dg1") || has_extension(path, "txt")) {
+        ok = CadImport_3DG1(core, path);
+    } else {
+        ok = CadCore_LoadFile(core, path);
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: %s:%d: Could not load '%s'\n", name, line, path);
+    }
+    return ok;
+}
+
+static int cmd_save(CadCore* core, int argc, char** argv, const char* name, int line) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Error: %s:%d: Usage: save <file> [legacy|indexed|compact[+z]]\n", name, line);
+        return 0;
+    }
+    if (argc == 3 && !CadFile_ParseFormat(argv[2], &core->data.format)) {
+        fprintf(stderr, "Error: %s:%d: Unknown container format '%s'\n", name, line, argv[2]);
+        return 0;
+    }
+    if (!CadCore_SaveFile(core, argv[1])) {
+        fprintf(stderr, "Error: %s:%d: Could not save '%s'\n", name, line, argv[1]);
+        return 0;
+    }
+    return 1;
+}
+
+static int cmd_export(CadCore* core, int argc, char** argv, const char* name, int line) {
+    if (argc != 3) {
+        fprintf(stderr, "Error: %s:%d: Usage: export 3dg1|obj <file>\n", name, line);
+        return 0;
+    }
+    int ok;
+    if (word_equals(argv[1], "3dg1")) {
+        ok = CadExport_3DG1(core, argv[2]);
+    } else if (word_equals(argv[1], "obj")) {
+        ok = CadExport_OBJ(core, argv[2]);
+    } else {
+        fprintf(stderr, "Error: %s:%d: Unknown export format '%s'\n", name, line, argv[1]);
+        return 0;
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: %s:%d: Could not export '%s'\n", name, line, argv[2]);
+    }
+    return ok;
+}
+
+/* Merge menu commands ("<kind> merge", "polygon sort") */
+static int cmd_merge(CadCore* core, const char* kind, const char* name, int line) {
+    if (word_equals(kind, "grid")) {
+        fprintf(stdout, "%s:%d: Grid merge: %d coordinates rounded\n", name, line, CadCore_GridMerge(core));
+    } else if (word_equals(kind, "point")) {
+        fprintf(stdout, "%s:%d: Point merge: %d points removed\n", name, line, CadCore_PointMerge(core));
+    } else if (word_equals(kind, "all")) {
+        /* Grid first so point merge compares rounded values */
+        int rounded = CadCore_GridMerge(core);
+        int removed = CadCore_PointMerge(core);
+        fprintf(stdout, "%s:%d: All merge: %d coordinates rounded, %d points removed\n",
+                name, line, rounded, removed);
+    } else {
+        fprintf(stderr, "Error: %s:%d: Unknown merge '%s'\n", name, line, kind);
+        return 0;
+    }
+    return 1;
+}
+
+static int run_command(CadCore* core, int argc, char** argv, const char* name, int line) {
+    const char* verb = argv[0];
+
+    if (word_equals(verb, "load")) return cmd_load(core, argc, argv, name, line);
+    if (word_equals(verb, "save")) return cmd_save(core, argc, argv, name, line);
+    if (word_equals(verb, "export")) return cmd_export(core, argc, argv, name, line);
+
+    if (word_equals(verb, "clear") && argc == 1) {
+        CadCore_Clear(core);
+        return 1;
+    }
+    if (word_equals(verb, "select") && argc == 2) {
+        if (word_equals(argv[1], "all")) {
+            CadCore_SelectAll(core);
+            return 1;
+        }
+        if (word_equals(argv[1], "none")) {
+            CadCore_ClearSelection(core);
+            return 1;
+        }
+    }
+    if (argc == 2 && word_equals(argv[1], "merge")) {
+        return cmd_merge(core, verb, name, line);
+    }
+    if (argc == 2 && word_equals(verb, "polygon") && (word_equals(argv[1], "sort") || word_equals(argv[1], "merge"))) {
+        /* Same as the menu: not implemented yet, so it leaves the model alone */
+        fprintf(stderr, "Warning: %s:%d: 'polygon %s' is not implemented yet, skipped\n", name, line, argv[1]);
+        return 1;
+    }
+    if (word_equals(verb, "stats") && argc == 1) {
+        fprintf(stdout, "%s:%d: %d objects, %d polygons, %d points%s\n", name, line,
+                CadCore_GetActiveObjectCount(core), CadCore_GetActivePolygonCount(core),
+                CadCore_GetActivePointCount(core), CadCore_IsFullyMerged(core) ? " (merged)" : "");
+        return 1;
+    }
+    if (word_equals(verb, "echo")) {
+        fprintf(stdout, "%s:%d:", name, line);
+        for (int i = 1; i < argc; i++) fprintf(stdout, " %s", argv[i]);
+        fprintf(stdout, "\n");
+        return 1;
+    }
+
+    fprintf(stderr, "Error: %s:%d: Unknown command '%s'", name, line, verb);
+    for (int i = 1; i < argc; i++) fprintf(stderr, " %s", argv[i]);
+    fprintf(stderr, "\n");
+    return 0;
+}
+
+/* Finish the command being tokenized and run it */
+static int flush_command(CadCore* core, ScriptCommand* cmd, const char* name, int line, int inQuotes) {
+    if (inQuotes && !cmd->failed) {
+        fprintf(stderr, "Error: %s:%d: Unterminated quote\n", name, line);
+        cmd->failed = 1;
+    }
+    command_end_token(cmd);
+    if (cmd->failed) return 0;
+    if (cmd->argc == 0) return 1;
+
+    char* argv[SCRIPT_MAX_ARGS] = { 0 };
+    for (int i = 0; i < cmd->argc; i++) argv[i] = cmd->args[i];
+    return run_command(core, cmd->argc, argv, name, line);
+}
+
+/* ----------------------------------------------------------------------------
+   Public API
+   ---------------------------------------------------------------------------- */
+
+int CadScript_Run(CadCore* core, const char* text, size_t size, const char* name,
+                  const CadScriptVar* vars, int var_count) {
+    if (!core || !text) return 0;
+    if (!name) name = "script";
+
+    ScriptCommand* cmd = (ScriptCommand*)malloc(sizeof(ScriptCommand));
+    if (!cmd) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 0;
+    }
+    command_reset(cmd);
+
+    const char* p = text;
+    const char* end = text + size;
+    int line = 1;
+    int commandLine = 1;
+    int inQuotes = 0;
+    int ok = 1;
+
+    while (ok && p < end) {
+        char c = *p;
+        if (c == '\n' || (!inQuotes && c == ';')) {
+            ok = flush_command(core, cmd, name, commandLine, inQuotes);
+            command_reset(cmd);
+            inQuotes = 0;
+            if (c == '\n') line++;
+            commandLine = line;
+            p++;
+        } else if (!inQuotes && c == '#') {
+            while (p < end && *p != '\n') p++;
+        } else if (c == '"') {
+            inQuotes = !inQuotes;
+            cmd->inToken = 1;
+            p++;
+        } else if (c == '$') {
+            p = expand_var(cmd, p, end, vars, var_count, name, line);
+        } else if (!inQuotes && (c == ' ' || c == '\t' || c == '\r')) {
+            command_end_token(cmd);
+            p++;
+        } else {
+            command_putc(cmd, c, name, line);
+            p++;
+        }
+    }
+    if (ok) ok = flush_command(core, cmd, name, commandLine, inQuotes);
+
+    free(cmd);
+    return ok;
+}
+
+int CadScript_RunFile(CadCore* core, const char* filename,
+                      const CadScriptVar* vars, int var_count) {
+    if (!core || !filename) return 0;
+
+    FILE* fp = fopen(filename, "rb");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open script '%s'\n", filename);
+        return 0;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char* text = (size >= 0) ? (char*)malloc((size_t)size + 1) : NULL;
+    if (!text || fread(text, 1, (size_t)size, fp) != (size_t)size) {
+        fprintf(stderr, "Error: Could not read script '%s'\n", filename);
+        free(text);
+        fclose(fp);
+        return 0;
+    }
+    fclose(fp);
+    text[size] = '\0';
+
+    int ok = CadScript_Run(core, text, (size_t)size, filename, vars, var_count);
+    free(text);
+    return ok;
+}
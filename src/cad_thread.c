@@ -0,0 +1,130 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "cad_thread.h"
+#include <stdlib.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+struct CadThread {
+    CadThreadFunc func;
+    void* arg;
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+};
+
+struct CadMutex {
+#ifdef _WIN32
+    CRITICAL_SECTION cs;
+#else
+    pthread_mutex_t mutex;
+#endif
+};
+
+/* ----------------------------------------------------------------------------
+   Threads
+   ---------------------------------------------------------------------------- */
+
+#ifdef _WIN32
+static unsigned __stdcall thread_trampoline(void* arg) {
+    CadThread* thread = (CadThread*)arg;
+    thread->func(thread->arg);
+    return 0;
+}
+#else
+static void* thread_trampoline(void* arg) {
+    CadThread* thread = (CadThread*)arg;
+    thread->func(thread->arg);
+    return NULL;
+}
+#endif
+
+CadThread* CadThread_Create(CadThreadFunc func, void* arg) {
+    if (!func) return NULL;
+    
+    CadThread* thread = (CadThread*)calloc(1, sizeof(CadThread));
+    if (!thread) return NULL;
+    thread->func = func;
+    thread->arg = arg;
+    
+#ifdef _WIN32
+    thread->handle = (HANDLE)_beginthreadex(NULL, 0, thread_trampoline, thread, 0, NULL);
+    if (!thread->handle) {
+        free(thread);
+        return NULL;
+    }
+#else
+    if (pthread_create(&thread->handle, NULL, thread_trampoline, thread) != 0) {
+        free(thread);
+        return NULL;
+    }
+#endif
+    return thread;
+}
+
+void CadThread_Join(CadThread* thread) {
+    if (!thread) return;
+#ifdef _WIN32
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+#else
+    pthread_join(thread->handle, NULL);
+#endif
+    free(thread);
+}
+
+/* ----------------------------------------------------------------------------
+   Mutexes
+   ---------------------------------------------------------------------------- */
+
+CadMutex* CadMutex_Create(void) {
+    CadMutex* mutex = (CadMutex*)calloc(1, sizeof(CadMutex));
+    if (!mutex) return NULL;
+#ifdef _WIN32
+    InitializeCriticalSection(&mutex->cs);
+#else
+    if (pthread_mutex_init(&mutex->mutex, NULL) != 0) {
+        free(mutex);
+        return NULL;
+    }
+#endif
+    return mutex;
+}
+
+void CadMutex_Destroy(CadMutex* mutex) {
+    if (!mutex) return;
+#ifdef _WIN32
+    DeleteCriticalSection(&mutex->cs);
+#else
+    pthread_mutex_destroy(&mutex->mutex);
+#endif
+    free(mutex);
+}
+
+void CadMutex_Lock(CadMutex* mutex) {
+    if (!mutex) return;
+#ifdef _WIN32
+    EnterCriticalSection(&mutex->cs);
+#else
+    pthread_mutex_lock(&mutex->mutex);
+#endif
+}
+
+void CadMutex_Unlock(CadMutex* mutex) {
+    if (!mutex) return;
+#ifdef _WIN32
+    LeaveCriticalSection(&mutex->cs);
+#else
+    pthread_mutex_unlock(&mutex->mutex);
+#endif
+}
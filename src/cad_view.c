@@ -154,6 +154,49 @@ void CadView_ProjectPoint(const CadView* view, double x, double y, double z,
     *out_y = (int)(viewport_h / 2 - py); /* Flip Y for screen coordinates */
 }
 
+/* Same arithmetic as CadView_ProjectPoint, with the rotation terms and the
+   view switch hoisted out of the loop */
+void CadView_ProjectPoints(const CadView* view, const double* xs, const double* ys, const double* zs,
+                           int count, double* out_x, double* out_y, int viewport_w, int viewport_h) {
+    if (!view || !xs || !ys || !zs || !out_x || !out_y) return;
+    
+    const int half_w = viewport_w / 2;
+    const int half_h = viewport_h / 2;
+    const double zoom = view->zoom;
+    const double pan_x = view->pan_x;
+    const double pan_y = view->pan_y;
+    
+    if (view->type == CAD_VIEW_3D) {
+        double rx = view->rot_x * M_PI / 180.0;
+        double ry = view->rot_y * M_PI / 180.0;
+        const double cos_rx = cos(rx), sin_rx = sin(rx);
+        const double cos_ry = cos(ry), sin_ry = sin(ry);
+        for (int i = 0; i < count; i++) {
+            double y1 = ys[i] * cos_rx - zs[i] * sin_rx;
+            double z1 = ys[i] * sin_rx + zs[i] * cos_rx;
+            double px = xs[i] * cos_ry + z1 * sin_ry;
+            out_x[i] = half_w + (px * zoom + pan_x);
+            out_y[i] = half_h - (y1 * zoom + pan_y);
+        }
+        return;
+    }
+    
+    /* Orthographic views just pick the horizontal and vertical streams */
+    const double* hs = xs;
+    const double* vs = ys;
+    double v_sign = 1.0;
+    switch (view->type) {
+    case CAD_VIEW_TOP:   hs = xs; vs = zs; v_sign = -1.0; break;
+    case CAD_VIEW_FRONT: hs = xs; vs = ys; break;
+    case CAD_VIEW_RIGHT: hs = zs; vs = ys; break;
+    default: break;
+    }
+    for (int i = 0; i < count; i++) {
+        out_x[i] = half_w + (hs[i] * zoom + pan_x);
+        out_y[i] = half_h - (v_sign * vs[i] * zoom + pan_y);
+    }
+}
+
 /* ----------------------------------------------------------------------------
    Rendering
    ---------------------------------------------------------------------------- */
@@ -207,8 +250,8 @@ void CadView_Render(const CadView* view, const CadCore* core,
             CadPolygon* poly = CadCore_GetPolygon((CadCore*)core, i);
             if (!poly || poly->flags == 0) continue;
 
-            int16_t point_idx = poly->firstPoint;
-            if (point_idx < 0 || point_idx >= CAD_MAX_POINTS) continue;
+            CadIndex point_idx = poly->firstPoint;
+            if (point_idx < 0 || point_idx >= data->pointCount) continue;
             if (poly->npoints < 2) continue;
 
             #define MAX_STACK_POINTS 64
@@ -233,34 +276,12 @@ void CadView_Render(const CadView* view, const CadCore* core,
                 }
             }
 
-            int16_t current = point_idx;
-            int count = 0;
-            int16_t visited[64]; /* Track visited points to detect cycles (smaller array) */
-            int visited_count = 0;
-            
-            while (current >= 0 && current < CAD_MAX_POINTS && count < npoints) {
-                /* Check for cycles (only check if we have room to track) */
-                if (visited_count < 64) {
-                    int already_visited = 0;
-                    for (int v = 0; v < visited_count; v++) {
-                        if (visited[v] == current) {
-                            already_visited = 1;
-                            break;
-                        }
-                    }
-                    if (already_visited) break;
-                    visited[visited_count++] = current;
-                }
-                
-                CadPoint* pt = CadCore_GetPoint((CadCore*)core, current);
-                if (!pt || pt->flags == 0) break; /* Invalid point */
-
+            int count;
+            const CadIndex* points = CadCore_GetPolygonPoints((CadCore*)core, i, &count);
+            for (int j = 0; j < count; j++) {
+                const CadPoint* pt = &data->points[points[j]];
                 CadView_ProjectPoint(view, pt->pointx, pt->pointy, pt->pointz,
-                                     &x_coords[count], &y_coords[count], viewport_w, viewport_h);
-
-                current = pt->nextPoint;
-                count++;
-                if (count > 1000) break; /* Safety limit */
+                                     &x_coords[j], &y_coords[j], viewport_w, viewport_h);
             }
 
             if (count >= 2) {
@@ -372,8 +393,8 @@ void CadView_Render(const CadView* view, const CadCore* core,
         CadPolygon* poly = CadCore_GetPolygon((CadCore*)core, i);
         if (!poly || poly->flags == 0) continue;
 
-        int16_t point_idx = poly->firstPoint;
-        if (point_idx < 0 || point_idx >= CAD_MAX_POINTS) continue;
+        CadIndex point_idx = poly->firstPoint;
+        if (point_idx < 0 || point_idx >= data->pointCount) continue;
         if (poly->npoints < 2) continue;
 
         #define MAX_STACK_POINTS 64
@@ -404,30 +425,13 @@ void CadView_Render(const CadView* view, const CadCore* core,
             }
         }
 
-        int16_t current = point_idx;
-        int count = 0;
-        int16_t visited[64]; /* Track visited points to detect cycles (smaller array) */
-        int visited_count = 0;
-
-        while (current >= 0 && current < CAD_MAX_POINTS && count < npoints) {
-            /* Check for cycles (only check if we have room to track) */
-            if (visited_count < 64) {
-                int already_visited = 0;
-                for (int v = 0; v < visited_count; v++) {
-                    if (visited[v] == current) {
-                        already_visited = 1;
-                        break;
-                    }
-                }
-                if (already_visited) break;
-                visited[visited_count++] = current;
-            }
-            
-            CadPoint* pt = CadCore_GetPoint((CadCore*)core, current);
-            if (!pt || pt->flags == 0) break; /* Invalid point */
+        int count;
+        const CadIndex* points = CadCore_GetPolygonPoints((CadCore*)core, i, &count);
+        for (int j = 0; j < count; j++) {
+            const CadPoint* pt = &data->points[points[j]];
 
             CadView_ProjectPoint(view, pt->pointx, pt->pointy, pt->pointz,
-                                 &x_coords[count], &y_coords[count], viewport_w, viewport_h);
+                                 &x_coords[j], &y_coords[j], viewport_w, viewport_h);
 
             /* View-space-ish depth (your existing approach) */
             double px, py, pz;
@@ -448,11 +452,7 @@ void CadView_Render(const CadView* view, const CadCore* core,
                 }
             }
 
-            z_coords[count] = pz;
-
-            current = pt->nextPoint;
-            count++;
-            if (count > 1000) break;
+            z_coords[j] = pz;
         }
 
         if (count == 2) {
@@ -602,11 +602,11 @@ void CadView_Render(const CadView* view, const CadCore* core,
    Point selection - find nearest point to screen coordinates
    ---------------------------------------------------------------------------- */
 
-int16_t CadView_FindNearestPoint(const CadView* view, const CadCore* core,
-                                 int screen_x, int screen_y,
-                                 int viewport_x, int viewport_y,
-                                 int viewport_w, int viewport_h,
-                                 int threshold_pixels) {
+CadIndex CadView_FindNearestPoint(const CadView* view, const CadCore* core,
+                                  int screen_x, int screen_y,
+                                  int viewport_x, int viewport_y,
+                                  int viewport_w, int viewport_h,
+                                  int threshold_pixels) {
     if (!view || !core) return -1;
     
     /* Convert screen coordinates to viewport-relative coordinates */
@@ -619,28 +619,39 @@ int16_t CadView_FindNearestPoint(const CadView* view, const CadCore* core,
     }
     
     /* Find nearest point by projecting all points and finding closest in screen space */
-    int16_t nearest_idx = -1;
+    const CadPointStreams* streams = CadCore_GetPointStreams((CadCore*)core);
+    if (!streams) return -1;
+    
+    CadIndex nearest_idx = -1;
     double nearest_dist_sq = (double)(threshold_pixels * threshold_pixels);
     
-    for (int i = 0; i < core->data.pointCount && i < CAD_MAX_POINTS; i++) {
-        const CadPoint* pt = &core->data.points[i];
-        if (pt->flags == 0) continue; /* Skip invalid points */
-        
-        /* Project point to screen coordinates (CadView_ProjectPoint already applies zoom/pan) */
-        int proj_x, proj_y;
-        CadView_ProjectPoint(view, pt->pointx, pt->pointy, pt->pointz, 
-                            &proj_x, &proj_y, viewport_w, viewport_h);
-        
-        /* Calculate distance squared in screen space (viewport-relative) */
-        double dx = (double)vp_x - (double)proj_x;
-        double dy = (double)vp_y - (double)proj_y;
-        double dist_sq = dx * dx + dy * dy;
+    #define PROJECT_BLOCK 256
+    double screen_x_block[PROJECT_BLOCK];
+    double screen_y_block[PROJECT_BLOCK];
+    for (int base = 0; base < streams->count; base += PROJECT_BLOCK) {
+        int n = streams->count - base < PROJECT_BLOCK ? streams->count - base : PROJECT_BLOCK;
+        CadView_ProjectPoints(view, streams->x + base, streams->y + base, streams->z + base, n,
+                              screen_x_block, screen_y_block, viewport_w, viewport_h);
         
-        if (dist_sq < nearest_dist_sq) {
-            nearest_dist_sq = dist_sq;
-            nearest_idx = (int16_t)i;
+        for (int k = 0; k < n; k++) {
+            if (streams->flags[base + k] == 0) continue; /* Skip invalid points */
+            
+            /* Truncate like CadView_ProjectPoint (which already applies zoom/pan) */
+            int proj_x = (int)screen_x_block[k];
+            int proj_y = (int)screen_y_block[k];
+            
+            /* Calculate distance squared in screen space (viewport-relative) */
+            double dx = (double)vp_x - (double)proj_x;
+            double dy = (double)vp_y - (double)proj_y;
+            double dist_sq = dx * dx + dy * dy;
+            
+            if (dist_sq < nearest_dist_sq) {
+                nearest_dist_sq = dist_sq;
+                nearest_idx = (CadIndex)(base + k);
+            }
         }
     }
+    #undef PROJECT_BLOCK
     
     return nearest_idx;
 }
@@ -655,39 +666,38 @@ int CadView_FindPointsAtLocation(const CadView* view, const CadCore* core,
                                  int viewport_w, int viewport_h,
                                  int threshold_pixels,
                                  double world_threshold,
-                                 int16_t* out_indices, int max_count) {
+                                 CadIndex* out_indices, int max_count) {
     if (!view || !core || !out_indices || max_count <= 0) return 0;
     
     /* First, find the nearest point */
-    int16_t nearest_idx = CadView_FindNearestPoint(view, core, screen_x, screen_y,
-                                                   viewport_x, viewport_y,
-                                                   viewport_w, viewport_h,
+    CadIndex nearest_idx = CadView_FindNearestPoint(view, core, screen_x, screen_y,
+                                                    viewport_x, viewport_y,
+                                                    viewport_w, viewport_h,
                                                    threshold_pixels);
     
     if (nearest_idx < 0) return 0;
     
     /* Get the world coordinates of the nearest point */
-    const CadPoint* nearest_pt = &core->data.points[nearest_idx];
-    if (nearest_pt->flags == 0) return 0;
+    const CadPointStreams* streams = CadCore_GetPointStreams((CadCore*)core);
+    if (!streams || streams->flags[nearest_idx] == 0) return 0;
     
-    double ref_x = nearest_pt->pointx;
-    double ref_y = nearest_pt->pointy;
-    double ref_z = nearest_pt->pointz;
+    double ref_x = streams->x[nearest_idx];
+    double ref_y = streams->y[nearest_idx];
+    double ref_z = streams->z[nearest_idx];
     
     /* Find all points within world_threshold distance of this point */
     int count = 0;
-    for (int i = 0; i < core->data.pointCount && i < CAD_MAX_POINTS && count < max_count; i++) {
-        const CadPoint* pt = &core->data.points[i];
-        if (pt->flags == 0) continue; /* Skip invalid points */
+    for (int i = 0; i < streams->count && count < max_count; i++) {
+        if (streams->flags[i] == 0) continue; /* Skip invalid points */
         
         /* Calculate 3D distance */
-        double dx = pt->pointx - ref_x;
-        double dy = pt->pointy - ref_y;
-        double dz = pt->pointz - ref_z;
+        double dx = streams->x[i] - ref_x;
+        double dy = streams->y[i] - ref_y;
+        double dz = streams->z[i] - ref_z;
         double dist_sq = dx * dx + dy * dy + dz * dz;
         
         if (dist_sq <= world_threshold * world_threshold) {
-            out_indices[count++] = (int16_t)i;
+            out_indices[count++] = (CadIndex)i;
         }
     }
     
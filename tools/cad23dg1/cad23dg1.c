@@ -1,56 +1,1619 @@
 /* Simple CLI converter: .cad -> .txt
  * Usage: cad23dg1 <input.cad> [output.txt]
+ *        cad23dg1 -d <dir> [-o outdir] [-p pattern] [-j threads] [-m manifest] [-f]
+ *        cad23dg1 -c [-from fmt] [-to fmt] [-shape name] [-I dir] [-merge kind] [-format fmt] <input|-> <output|->
+ *        cad23dg1 -r [-j threads] <script>... [-- input...]
+ *        cad23dg1 -a <shapesdir> [-o outdir] [-to cad,3dg1,obj] [-j threads]
+ *        cad23dg1 -audit <dir> [-o report.json] [-I shapesdir] [-j threads]
  */
 // A little CLI frontend so I can use the existing components to convert Iwamoto 3D-CAD files to Fundoshi-Kun format - Sunlit
 
+#define _CRT_SECURE_NO_WARNINGS
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 
 #include "cad_file.h"
 #include "cad_export_3dg1.h"
+#include "cad_export_obj.h"
+#include "cad_import_3dg1.h"
+#include "cad_import_obj.h"
+#include "cad_import_asm.h"
 #include "cad_core.h"
+#include "cad_thread.h"
+#include "cad_manifest.h"
+#include "cad_script.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#define PATH_BUF 1024
+
+/* Replace the extension of inpath with .txt */
+static void make_output_path(const char* inpath, char* outpath, size_t cap) {
+    const char* dot = strrchr(inpath, '.');
+    const char* slash = strrchr(inpath, '/');
+    const char* bslash = strrchr(inpath, '\\');
+    if (bslash > slash) slash = bslash;
+    if (dot && slash && dot < slash) dot = NULL;
+
+    size_t len = dot ? (size_t)(dot - inpath) : strlen(inpath);
+    if (len > cap - 5) len = cap - 5;
+    memcpy(outpath, inpath, len);
+    memcpy(outpath + len, ".txt", 5);
+}
+
+/* A heap CadCore ready for use (NULL if out of memory); every mode gets its
+   core here so none can skip CadCore_Init or CadCore_Destroy */
+static CadCore* create_core(void) {
+    CadCore* core = (CadCore*)malloc(sizeof(CadCore));
+    if (core) CadCore_Init(core);
+    return core;
+}
+
+static void destroy_core(CadCore* core) {
+    if (!core) return;
+    CadCore_Destroy(core);
+    free(core);
+}
+
+/* ----------------------------------------------------------------------------
+   Platform helpers
+   ---------------------------------------------------------------------------- */
+
+static int cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+static double now_seconds(void) {
+#ifdef _WIN32
+    return (double)GetTickCount64() / 1000.0;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#endif
+}
+
+/* Create a directory (0 if it neither exists nor could be made) */
+static int make_dir(const char* path) {
+#ifdef _WIN32
+    wchar_t wpath[PATH_BUF];
+    if (!MultiByteToWideChar(CP_UTF8, 0, path, -1, wpath, PATH_BUF)) return 0;
+    if (CreateDirectoryW(wpath, NULL)) return 1;
+    return GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+    struct stat st;
+    if (mkdir(path, 0777) == 0) return 1;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+/* Create every missing directory leading up to the file at path */
+static int make_parent_dirs(const char* path) {
+    char buf[PATH_BUF];
+    size_t len = strlen(path);
+    if (len >= sizeof(buf)) return 0;
+    memcpy(buf, path, len + 1);
+    for (size_t i = 1; i < len; i++) {
+        if (buf[i] != '/' && buf[i] != '\\') continue;
+        if (buf[i - 1] == '/' || buf[i - 1] == '\\' || buf[i - 1] == ':') continue;
+        char c = buf[i];
+        buf[i] = '\0';
+        int ok = make_dir(buf);
+        buf[i] = c;
+        if (!ok) return 0;
+    }
+    return 1;
+}
+
+/* ----------------------------------------------------------------------------
+   Batch job list
+   ---------------------------------------------------------------------------- */
+
+typedef struct {
+    char* input;
+    char* output;
+    int status;              /* 0 = converted, 1 = unchanged, 2 = load failed, 3 = export failed */
+} BatchJob;
+
+typedef struct {
+    BatchJob* jobs;
+    int count;
+    int capacity;
+} BatchList;
+
+static int batch_add(BatchList* list, const char* input, const char* output) {
+    if (list->count == list->capacity) {
+        int cap = list->capacity ? list->capacity * 2 : 64;
+        BatchJob* jobs = (BatchJob*)realloc(list->jobs, (size_t)cap * sizeof(BatchJob));
+        if (!jobs) return 0;
+        list->jobs = jobs;
+        list->capacity = cap;
+    }
+    BatchJob* job = &list->jobs[list->count];
+    job->input = (char*)malloc(strlen(input) + 1);
+    job->output = (char*)malloc(strlen(output) + 1);
+    if (!job->input || !job->output) {
+        free(job->input);
+        free(job->output);
+        return 0;
+    }
+    strcpy(job->input, input);
+    strcpy(job->output, output);
+    job->status = 0;
+    list->count++;
+    return 1;
+}
+
+static void batch_free(BatchList* list) {
+    for (int i = 0; i < list->count; i++) {
+        free(list->jobs[i].input);
+        free(list->jobs[i].output);
+    }
+    free(list->jobs);
+    memset(list, 0, sizeof(*list));
+}
+
+/* Case-insensitive wildcard match supporting '*' and '?' */
+static int match_pattern(const char* pattern, const char* name) {
+    const char* star = NULL;
+    const char* resume = NULL;
+    while (*name) {
+        if (*pattern == '*') {
+            star = pattern++;
+            resume = name;
+        } else if (*pattern == '?' ||
+                   tolower((unsigned char)*pattern) == tolower((unsigned char)*name)) {
+            pattern++;
+            name++;
+        } else if (star) {
+            pattern = star + 1;
+            name = ++resume;
+        } else {
+            return 0;
+        }
+    }
+    while (*pattern == '*') pattern++;
+    return *pattern == '\0';
+}
+
+static int join_path(char* out, size_t cap, const char* dir, const char* name) {
+    int n = snprintf(out, cap, "%s/%s", dir, name);
+    return n > 0 && (size_t)n < cap;
+}
+
+/* Visit one directory entry: recurse into directories, queue matching files.
+   outdir mirrors the input tree (NULL = write next to each input). */
+static int collect_tree(BatchList* list, const char* dir, const char* outdir, const char* pattern);
+
+static int collect_entry(BatchList* list, const char* dir, const char* outdir,
+                         const char* pattern, const char* name, int isDir) {
+    char path[PATH_BUF];
+    char outsub[PATH_BUF];
+
+    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) return 1;
+    if (!join_path(path, sizeof(path), dir, name)) {
+        fprintf(stderr, "Error: Path too long: %s/%s\n", dir, name);
+        return 0;
+    }
+    if (outdir && !join_path(outsub, sizeof(outsub), outdir, name)) {
+        fprintf(stderr, "Error: Path too long: %s/%s\n", outdir, name);
+        return 0;
+    }
+
+    if (isDir) {
+        return collect_tree(list, path, outdir ? outsub : NULL, pattern);
+    }
+    if (!match_pattern(pattern, name)) return 1;
+
+    /* Output directories are only created for files that are queued, so an
+       outdir inside the input tree never gets mirrored into itself */
+    if (outdir && !make_parent_dirs(outsub)) {
+        fprintf(stderr, "Error: Could not create directory for '%s'\n", outsub);
+        return 0;
+    }
+
+    char outpath[PATH_BUF];
+    make_output_path(outdir ? outsub : path, outpath, sizeof(outpath));
+    return batch_add(list, path, outpath);
+}
+
+static int collect_tree(BatchList* list, const char* dir, const char* outdir, const char* pattern) {
+    int ok = 1;
+#ifdef _WIN32
+    wchar_t wquery[PATH_BUF];
+    char query[PATH_BUF];
+    if (!join_path(query, sizeof(query), dir, "*") ||
+        !MultiByteToWideChar(CP_UTF8, 0, query, -1, wquery, PATH_BUF)) {
+        fprintf(stderr, "Error: Could not open directory '%s'\n", dir);
+        return 0;
+    }
+    WIN32_FIND_DATAW fd;
+    HANDLE find = FindFirstFileW(wquery, &fd);
+    if (find == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "Error: Could not open directory '%s'\n", dir);
+        return 0;
+    }
+    do {
+        char name[PATH_BUF];
+        if (!WideCharToMultiByte(CP_UTF8, 0, fd.cFileName, -1, name, PATH_BUF, NULL, NULL)) continue;
+        int isDir = (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        if (!collect_entry(list, dir, outdir, pattern, name, isDir)) ok = 0;
+    } while (FindNextFileW(find, &fd));
+    FindClose(find);
+#else
+    DIR* d = opendir(dir);
+    if (!d) {
+        fprintf(stderr, "Error: Could not open directory '%s'\n", dir);
+        return 0;
+    }
+    struct dirent* ent;
+    while ((ent = readdir(d)) != NULL) {
+        char path[PATH_BUF];
+        struct stat st;
+        if (!join_path(path, sizeof(path), dir, ent->d_name) || stat(path, &st) != 0) continue;
+        if (!collect_entry(list, dir, outdir, pattern, ent->d_name, S_ISDIR(st.st_mode))) ok = 0;
+    }
+    closedir(d);
+#endif
+    return ok;
+}
+
+/* ----------------------------------------------------------------------------
+   Thread pool
+   Each worker owns one CadCore and reuses it for every file it converts.
+   ---------------------------------------------------------------------------- */
+
+typedef struct {
+    BatchList* list;
+    CadMutex* lock;
+    int next;                /* Next job to hand out (guarded by lock) */
+    CadManifest* manifest;   /* Conversion cache (NULL = convert everything) */
+    uint64_t configHash;     /* Exporter version and options */
+    int force;               /* Reconvert even when the manifest says unchanged */
+} BatchQueue;
+
+static void batch_worker(void* arg) {
+    BatchQueue* queue = (BatchQueue*)arg;
+    CadCore* core = create_core();
+    if (!core) return;       /* Jobs this worker would have taken go to the others */
+
+    for (;;) {
+        CadMutex_Lock(queue->lock);
+        int index = queue->next++;
+        CadMutex_Unlock(queue->lock);
+        if (index >= queue->list->count) break;
+
+        BatchJob* job = &queue->list->jobs[index];
+        uint64_t contentHash = 0;
+        if (queue->manifest) {
+            if (!CadManifest_HashFile(job->input, &contentHash)) {
+                fprintf(stderr, "Failed to read CAD file '%s'\n", job->input);
+                job->status = 2;
+                continue;
+            }
+            if (!queue->force && CadManifest_IsCurrent(queue->manifest, job->input,
+                                                       contentHash, queue->configHash, job->output)) {
+                job->status = 1;
+                continue;
+            }
+        }
+
+        /* Drop the previous file and the indexes built over it */
+        CadCore_Clear(core);
+        if (!CadFile_Load(job->input, &core->data)) {
+            fprintf(stderr, "Failed to load CAD file '%s'\n", job->input);
+            job->status = 2;
+        } else if (!CadExport_3DG1(core, job->output)) {
+            fprintf(stderr, "Failed to export Fundoshi-Kun file '%s'\n", job->output);
+            job->status = 3;
+        } else if (queue->manifest) {
+            CadManifest_Update(queue->manifest, job->input, contentHash, queue->configHash, job->output);
+        }
+    }
+    destroy_core(core);
+}
+
+/* Run worker(queue) on threads threads and wait for all of them */
+static void run_pool(CadThreadFunc worker, void* queue, int threads) {
+    if (threads < 1) threads = 1;
+
+    CadThread** pool = (CadThread**)calloc((size_t)threads, sizeof(CadThread*));
+    int started = 0;
+    if (pool) {
+        for (int i = 0; i < threads; i++) {
+            pool[i] = CadThread_Create(worker, queue);
+            if (pool[i]) started++;
+        }
+    }
+    /* No worker could start: run the jobs on this thread instead */
+    if (started == 0) worker(queue);
+    for (int i = 0; pool && i < threads; i++) {
+        CadThread_Join(pool[i]);
+    }
+    free(pool);
+}
+
+/* Convert every file in list on up to threads workers */
+static int run_batch(BatchList* list, int threads, CadManifest* manifest, int force) {
+    BatchQueue queue;
+    queue.list = list;
+    queue.next = 0;
+    queue.manifest = manifest;
+    queue.force = force;
+    /* Outputs only depend on the exporter; add options here if it grows any */
+    char config[64];
+    snprintf(config, sizeof(config), "3dg1 v%d", CAD_EXPORT_3DG1_VERSION);
+    queue.configHash = CadManifest_HashString(config, CAD_MANIFEST_HASH_SEED);
+    queue.lock = CadMutex_Create();
+    if (!queue.lock) {
+        fprintf(stderr, "Error: Could not create mutex\n");
+        return 0;
+    }
+
+    run_pool(batch_worker, &queue, threads < list->count ? threads : list->count);
+    CadMutex_Destroy(queue.lock);
+
+    /* A worker that could not allocate its CadCore leaves jobs unclaimed */
+    return queue.next >= list->count;
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "Usage: %s <input.cad> [output.txt]\n", argv0);
+    fprintf(stderr, "       %s -d <dir> [-o outdir] [-p pattern] [-j threads] [-m manifest] [-f]\n", argv0);
+    fprintf(stderr, "  -d  convert every file under dir that matches pattern (default *.cad)\n");
+    fprintf(stderr, "  -o  write outputs into outdir, mirroring the input tree\n");
+    fprintf(stderr, "  -j  worker threads (default: number of CPU cores)\n");
+    fprintf(stderr, "  -m  conversion cache; unchanged inputs are skipped\n");
+    fprintf(stderr, "      (default <outdir or dir>/cad23dg1.manifest, \"none\" to disable)\n");
+    fprintf(stderr, "  -f  reconvert every file and refresh the cache\n");
+    fprintf(stderr, "       %s -c [options] <input|-> <output|->\n", argv0);
+    fprintf(stderr, "  -c  convert one file in memory; \"-\" reads stdin or writes stdout\n");
+    fprintf(stderr, "  -from cad|obj|3dg1|asm  input format (default: detected from content)\n");
+    fprintf(stderr, "  -to cad|obj|3dg1        output format (default: output extension, else 3dg1)\n");
+    fprintf(stderr, "  -shape name   ASM shape to import (default: first ShapeHdr)\n");
+    fprintf(stderr, "  -I dir        ASM shapes folder whose ../INC holds the constants\n");
+    fprintf(stderr, "  -merge grid|point|all   merge before writing\n");
+    fprintf(stderr, "  -format legacy|indexed|compact[+z]  .cad container (default: as loaded)\n");
+    fprintf(stderr, "       %s -r [-j threads] <script>... [-- input...]\n", argv0);
+    fprintf(stderr, "  -r  run command scripts in parallel, once per input if any are given\n");
+    fprintf(stderr, "      (inputs are available to scripts as $in, $stem, $name and $dir)\n");
+    fprintf(stderr, "       %s -a <shapesdir> [-o outdir] [-to cad,3dg1,obj] [-j threads]\n", argv0);
+    fprintf(stderr, "  -a  export every ShapeHdr shape in the *.asm files under shapesdir\n");
+    fprintf(stderr, "      (constants come from shapesdir/../INC; default output 3dg1)\n");
+    fprintf(stderr, "       %s -audit <dir> [-o report.json] [-I shapesdir] [-j threads]\n", argv0);
+    fprintf(stderr, "  -audit  check every .cad/.3dg1/.asm shape under dir against the SuperFX\n");
+    fprintf(stderr, "          limits and write a JSON report (stdout by default); exit code 2\n");
+    fprintf(stderr, "          if any shape fails\n");
+}
+
+static int batch_main(int argc, char** argv) {
+    const char* dir = NULL;
+    const char* outdir = NULL;
+    const char* pattern = "*.cad";
+    const char* manifestPath = NULL;
+    int threads = 0;
+    int force = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "-d") == 0) dir = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "-o") == 0) outdir = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "-p") == 0) pattern = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "-j") == 0) threads = atoi(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "-m") == 0) manifestPath = argv[++i];
+        else if (strcmp(argv[i], "-f") == 0) force = 1;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!dir) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (threads <= 0) threads = cpu_count();
+
+    double start = now_seconds();
+    BatchList list;
+    memset(&list, 0, sizeof(list));
+    int scanned = collect_tree(&list, dir, outdir, pattern);
+
+    char defaultManifest[PATH_BUF];
+    CadManifest* manifest = NULL;
+    if (!manifestPath) {
+        if (join_path(defaultManifest, sizeof(defaultManifest), outdir ? outdir : dir, "cad23dg1.manifest")) {
+            manifestPath = defaultManifest;
+        }
+    } else if (strcmp(manifestPath, "none") == 0) {
+        manifestPath = NULL;
+    }
+    if (manifestPath && list.count > 0) {
+        if (outdir) make_parent_dirs(manifestPath);
+        manifest = CadManifest_Load(manifestPath);
+        if (!manifest) fprintf(stderr, "Warning: Converting without a cache\n");
+    }
+
+    if (list.count > 0 && !run_batch(&list, threads, manifest, force)) {
+        fprintf(stderr, "Error: Batch stopped before every file was converted\n");
+        scanned = 0;
+    }
+    if (manifest) {
+        if (!CadManifest_Save(manifest)) {
+            fprintf(stderr, "Warning: Could not write manifest '%s'\n", manifestPath);
+        }
+        CadManifest_Destroy(manifest);
+    }
+
+    int unchanged = 0, loadFailed = 0, exportFailed = 0;
+    for (int i = 0; i < list.count; i++) {
+        if (list.jobs[i].status == 1) unchanged++;
+        else if (list.jobs[i].status == 2) loadFailed++;
+        else if (list.jobs[i].status == 3) exportFailed++;
+    }
+    int converted = list.count - unchanged - loadFailed - exportFailed;
+
+    fprintf(stdout, "\nBatch summary: %d file(s) matched '%s' under '%s'\n", list.count, pattern, dir);
+    fprintf(stdout, "  converted:     %d\n", converted);
+    fprintf(stdout, "  unchanged:     %d\n", unchanged);
+    fprintf(stdout, "  load failed:   %d\n", loadFailed);
+    fprintf(stdout, "  export failed: %d\n", exportFailed);
+    fprintf(stdout, "  threads:       %d\n", threads < list.count ? threads : (list.count ? list.count : 1));
+    fprintf(stdout, "  elapsed:       %.2f s\n", now_seconds() - start);
+    for (int i = 0; i < list.count; i++) {
+        if (list.jobs[i].status >= 2) {
+            fprintf(stdout, "  FAILED: %s\n", list.jobs[i].input);
+        }
+    }
+
+    batch_free(&list);
+    if (!scanned) return 1;
+    return (loadFailed || exportFailed) ? 2 : 0;
+}
+
+/* ----------------------------------------------------------------------------
+   Convert mode: any supported input to any supported output, in memory.
+   "-" reads stdin / writes stdout so conversions compose in pipelines.
+   ---------------------------------------------------------------------------- */
+
+typedef enum {
+    FMT_UNKNOWN = 0,
+    FMT_CAD,
+    FMT_OBJ,
+    FMT_3DG1,
+    FMT_ASM
+} ConvertFormat;
+
+static const char* format_name(ConvertFormat format) {
+    switch (format) {
+    case FMT_CAD:  return "cad";
+    case FMT_OBJ:  return "obj";
+    case FMT_3DG1: return "3dg1";
+    case FMT_ASM:  return "asm";
+    default:       return "unknown";
+    }
+}
+
+static int name_equals(const char* a, const char* b) {
+    while (*a && tolower((unsigned char)*a) == tolower((unsigned char)*b)) {
+        a++;
+        b++;
+    }
+    return *a == '\0' && *b == '\0';
+}
+
+static ConvertFormat parse_format(const char* name) {
+    if (name_equals(name, "cad")) return FMT_CAD;
+    if (name_equals(name, "obj")) return FMT_OBJ;
+    if (name_equals(name, "3dg1") || name_equals(name, "txt")) return FMT_3DG1;
+    if (name_equals(name, "asm")) return FMT_ASM;
+    return FMT_UNKNOWN;
+}
+
+/* Output format implied by a file name (.txt is what this tool always wrote) */
+static ConvertFormat format_from_extension(const char* path) {
+    const char* dot = strrchr(path, '.');
+    if (!dot || strchr(dot, '/') || strchr(dot, '\\')) return FMT_UNKNOWN;
+    return parse_format(dot + 1);
+}
+
+/* Does some line of the text start with prefix? */
+static int has_line_prefix(const char* text, size_t size, const char* prefix) {
+    size_t plen = strlen(prefix);
+    const char* p = text;
+    const char* end = text + size;
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        if ((size_t)(end - p) >= plen && memcmp(p, prefix, plen) == 0) return 1;
+        const char* nl = (const char*)memchr(p, '\n', (size_t)(end - p));
+        if (!nl) break;
+        p = nl + 1;
+    }
+    return 0;
+}
+
+static int contains_nocase(const char* text, size_t size, const char* word) {
+    size_t wlen = strlen(word);
+    for (size_t i = 0; i + wlen <= size; i++) {
+        size_t k = 0;
+        while (k < wlen && tolower((unsigned char)text[i + k]) == word[k]) k++;
+        if (k == wlen) return 1;
+    }
+    return 0;
+}
+
+/* Identify the input by its content rather than its name */
+static ConvertFormat sniff_format(const char* data, size_t size) {
+    if (size >= 4 && (memcmp(data, "CAD2", 4) == 0 || memcmp(data, "CADC", 4) == 0 ||
+                      memcmp(data, "CADZ", 4) == 0)) {
+        return FMT_CAD;
+    }
+    if (size >= 4 && memcmp(data, "3DG1", 4) == 0) return FMT_3DG1;
+    /* Legacy .cad: a binary stream that opens with a record tag byte */
+    if (size > 0 && (uint8_t)data[0] <= CAD_TAG_JOURNAL) return FMT_CAD;
+    if (contains_nocase(data, size, "shapehdr")) return FMT_ASM;
+    if (has_line_prefix(data, size, "v ") && has_line_prefix(data, size, "f ")) return FMT_OBJ;
+    return FMT_UNKNOWN;
+}
+
+/* Read a whole stream into a NUL-terminated buffer (free with free) */
+static char* read_stream(FILE* fp, size_t* out_size) {
+    size_t cap = 1 << 16;
+    size_t size = 0;
+    char* data = (char*)malloc(cap + 1);
+    if (!data) return NULL;
+
+    for (;;) {
+        if (size == cap) {
+            char* grown = (char*)realloc(data, cap * 2 + 1);
+            if (!grown) {
+                free(data);
+                return NULL;
+            }
+            data = grown;
+            cap *= 2;
+        }
+        size_t got = fread(data + size, 1, cap - size, fp);
+        size += got;
+        if (got == 0) break;
+    }
+    if (ferror(fp)) {
+        free(data);
+        return NULL;
+    }
+    data[size] = '\0';
+    *out_size = size;
+    return data;
+}
+
+/* Hand the real stdout to the caller as a binary data stream and point
+   fd 1 at stderr, so status lines printed by the library can't corrupt it */
+static FILE* claim_stdout(void) {
+    fflush(stdout);
+#ifdef _WIN32
+    int fd = _dup(_fileno(stdout));
+    if (fd < 0) return NULL;
+    _setmode(fd, _O_BINARY);
+    FILE* out = _fdopen(fd, "wb");
+    if (out) _dup2(_fileno(stderr), _fileno(stdout));
+#else
+    int fd = dup(fileno(stdout));
+    if (fd < 0) return NULL;
+    FILE* out = fdopen(fd, "wb");
+    if (out) dup2(fileno(stderr), fileno(stdout));
+#endif
+    if (!out) fprintf(stderr, "Error: Could not open stdout for writing\n");
+    return out;
+}
+
+static int load_input(CadCore* core, ConvertFormat format, const char* data, size_t size,
+                      const char* inpath, const char* shape, const char* incdir) {
+    switch (format) {
+    case FMT_CAD:
+        return CadFile_LoadFromBuffer(data, size, &core->data);
+    case FMT_OBJ:
+        return CadImport_OBJFromBuffer(core, data, size);
+    case FMT_3DG1:
+        return CadImport_3DG1FromBuffer(core, data, size);
+    case FMT_ASM: {
+        char name[256];
+        if (shape) {
+            strncpy(name, shape, sizeof(name) - 1);
+            name[sizeof(name) - 1] = '\0';
+        } else if (!CadAsm_FirstShapeName(data, size, name, sizeof(name))) {
+            fprintf(stderr, "Error: No ShapeHdr found in '%s'\n", inpath);
+            return 0;
+        }
+
+        CadAsmConstants* constants = CadAsmConstants_Create();
+        if (!constants) return 0;
+        /* INC constants come from -I, else from the folder next to the input */
+        char folder[PATH_BUF];
+        if (incdir) {
+            CadAsmConstants_LoadFolder(constants, incdir);
+        } else if (strcmp(inpath, "-") != 0) {
+            strncpy(folder, inpath, sizeof(folder) - 1);
+            folder[sizeof(folder) - 1] = '\0';
+            char* sep = strrchr(folder, '/');
+            char* bsep = strrchr(folder, '\\');
+            if (bsep > sep) sep = bsep;
+            if (sep) *sep = '\0';
+            else strcpy(folder, ".");
+            CadAsmConstants_LoadFolder(constants, folder);
+        }
+        CadAsmConstants_LoadText(constants, data, size);
+
+        int ok = CadImport_AsmShapeFromBuffer(core, data, size, name, constants);
+        if (!ok) fprintf(stderr, "Error: Shape '%s' not found in '%s'\n", name, inpath);
+        CadAsmConstants_Destroy(constants);
+        return ok;
+    }
+    default:
+        return 0;
+    }
+}
+
+static int write_output(CadCore* core, ConvertFormat format, const char* outpath, FILE* stream,
+                        const CadFileFormat* cadFormat) {
+    switch (format) {
+    case FMT_CAD: {
+        CadFileFormat container = cadFormat ? *cadFormat : core->data.format;
+        if (!stream) return CadFile_SaveEx(outpath, &core->data, container);
+
+        uint8_t* buffer = NULL;
+        size_t size = 0;
+        if (!CadFile_SaveToBufferEx(&core->data, container, &buffer, &size)) return 0;
+        int ok = fwrite(buffer, 1, size, stream) == size;
+        CadFile_FreeBuffer(buffer);
+        return ok;
+    }
+    case FMT_OBJ:
+        /* Materials need a second file, so a streamed OBJ carries none */
+        return stream ? CadExport_OBJStream(core, stream, NULL, NULL) : CadExport_OBJ(core, outpath);
+    case FMT_3DG1:
+        return stream ? CadExport_3DG1Stream(core, stream) : CadExport_3DG1(core, outpath);
+    case FMT_ASM:
+        fprintf(stderr, "Error: ASM shapes can be read but not written\n");
+        return 0;
+    default:
+        return 0;
+    }
+}
+
+static int convert_main(int argc, char** argv) {
+    ConvertFormat from = FMT_UNKNOWN;
+    ConvertFormat to = FMT_UNKNOWN;
+    const char* shape = NULL;
+    const char* incdir = NULL;
+    const char* merge = NULL;
+    CadFileFormat cadFormat = CAD_FORMAT_LEGACY;
+    int hasCadFormat = 0;
+    const char* paths[2] = { NULL, NULL };
+    int pathCount = 0;
+
+    for (int i = 2; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "-from") == 0) from = parse_format(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "-to") == 0) to = parse_format(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "-shape") == 0) shape = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "-I") == 0) incdir = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "-merge") == 0) merge = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "-format") == 0) {
+            if (!CadFile_ParseFormat(argv[++i], &cadFormat)) {
+                usage(argv[0]);
+                return 1;
+            }
+            hasCadFormat = 1;
+        }
+        else if ((argv[i][0] != '-' || strcmp(argv[i], "-") == 0) && pathCount < 2) paths[pathCount++] = argv[i];
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (pathCount != 2 ||
+        (merge && strcmp(merge, "grid") != 0 && strcmp(merge, "point") != 0 && strcmp(merge, "all") != 0)) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char* inpath = paths[0];
+    const char* outpath = paths[1];
+    int toStdout = strcmp(outpath, "-") == 0;
+    if (to == FMT_UNKNOWN && hasCadFormat) to = FMT_CAD;
+    if (to == FMT_UNKNOWN) to = toStdout ? FMT_3DG1 : format_from_extension(outpath);
+    if (to == FMT_UNKNOWN) to = FMT_3DG1;
+
+    FILE* stream = NULL;
+    if (toStdout && (stream = claim_stdout()) == NULL) return 3;
+
+    /* Read the whole input up front: formats are sniffed from content and
+       stdin can't be rewound */
+    size_t size = 0;
+    char* data = NULL;
+    if (strcmp(inpath, "-") == 0) {
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        data = read_stream(stdin, &size);
+    } else {
+        FILE* fp = fopen(inpath, "rb");
+        if (fp) {
+            data = read_stream(fp, &size);
+            fclose(fp);
+        }
+    }
+    if (!data) {
+        fprintf(stderr, "Error: Could not read '%s'\n", inpath);
+        if (stream) fclose(stream);
+        return 2;
+    }
+    if (from == FMT_UNKNOWN) from = sniff_format(data, size);
+    if (from == FMT_UNKNOWN) {
+        fprintf(stderr, "Error: Could not detect the format of '%s' (use -from)\n", inpath);
+        free(data);
+        if (stream) fclose(stream);
+        return 2;
+    }
+
+    CadCore* core = create_core();
+    if (!core) {
+        fprintf(stderr, "Out of memory\n");
+        free(data);
+        if (stream) fclose(stream);
+        return 2;
+    }
+
+    int result = 0;
+    if (!load_input(core, from, data, size, inpath, shape, incdir)) {
+        fprintf(stderr, "Failed to load %s input '%s'\n", format_name(from), inpath);
+        result = 2;
+    }
+    free(data);
+
+    if (result == 0 && merge) {
+        /* Grid first so point merge compares rounded coordinates */
+        if (strcmp(merge, "point") != 0) {
+            fprintf(stdout, "Grid merge: %d coordinates rounded\n", CadCore_GridMerge(core));
+        }
+        if (strcmp(merge, "grid") != 0) {
+            fprintf(stdout, "Point merge: %d points removed\n", CadCore_PointMerge(core));
+        }
+    }
+
+    if (result == 0) {
+        int ok = write_output(core, to, outpath, stream, hasCadFormat ? &cadFormat : NULL);
+        if (stream && fflush(stream) != 0) ok = 0;
+        if (!ok) {
+            fprintf(stderr, "Failed to write %s output '%s'\n", format_name(to), outpath);
+            result = 3;
+        } else {
+            fprintf(stdout, "Converted %s (%s) -> %s (%s): %d points, %d polygons\n",
+                    inpath, format_name(from), outpath, format_name(to),
+                    CadCore_GetActivePointCount(core), CadCore_GetActivePolygonCount(core));
+        }
+    }
+
+    if (stream && fclose(stream) != 0 && result == 0) result = 3;
+    destroy_core(core);
+    return result;
+}
+
+/* ----------------------------------------------------------------------------
+   Script mode: run command scripts (see cad_script.h) on worker threads,
+   optionally once per input file with $in, $stem, $name and $dir set
+   ---------------------------------------------------------------------------- */
+
+typedef struct {
+    const char* script;
+    const char* input;       /* Model the script runs on (NULL if none) */
+    int ok;
+} ScriptJob;
+
+typedef struct {
+    ScriptJob* jobs;
+    int count;
+    CadMutex* lock;
+    int next;                /* Next job to hand out (guarded by lock) */
+} ScriptQueue;
+
+static void script_worker(void* arg) {
+    ScriptQueue* queue = (ScriptQueue*)arg;
+    CadCore* core = create_core();
+    if (!core) return;       /* Jobs this worker would have taken go to the others */
+
+    for (;;) {
+        CadMutex_Lock(queue->lock);
+        int index = queue->next++;
+        CadMutex_Unlock(queue->lock);
+        if (index >= queue->count) break;
+
+        ScriptJob* job = &queue->jobs[index];
+        CadCore_Clear(core);
+        if (!job->input) {
+            job->ok = CadScript_RunFile(core, job->script, NULL, 0);
+            continue;
+        }
+
+        /* in = path, stem = path without extension, dir = folder, name = file stem */
+        char stem[PATH_BUF];
+        char dir[PATH_BUF];
+        strncpy(stem, job->input, sizeof(stem) - 1);
+        stem[sizeof(stem) - 1] = '\0';
+        strcpy(dir, stem);
+        char* sep = strrchr(dir, '/');
+        char* bsep = strrchr(dir, '\\');
+        if (bsep > sep) sep = bsep;
+        const char* name = stem + (sep ? (size_t)(sep - dir) + 1 : 0);
+        if (sep) *sep = '\0';
+        else strcpy(dir, ".");
+        char* dot = strrchr(name, '.');
+        if (dot) *dot = '\0';
+
+        CadScriptVar vars[4] = {
+            { "in", job->input },
+            { "stem", stem },
+            { "name", name },
+            { "dir", dir }
+        };
+        job->ok = CadScript_RunFile(core, job->script, vars, 4);
+    }
+    destroy_core(core);
+}
+
+static int script_main(int argc, char** argv) {
+    int threads = 0;
+    int scriptCount = 0;
+    int inputCount = 0;
+    const char** scripts = (const char**)calloc((size_t)argc, sizeof(char*));
+    const char** inputs = (const char**)calloc((size_t)argc, sizeof(char*));
+    if (!scripts || !inputs) {
+        fprintf(stderr, "Out of memory\n");
+        free(scripts);
+        free(inputs);
+        return 1;
+    }
+
+    int afterDashes = 0;
+    for (int i = 2; i < argc; i++) {
+        if (afterDashes) inputs[inputCount++] = argv[i];
+        else if (strcmp(argv[i], "--") == 0) afterDashes = 1;
+        else if (i + 1 < argc && strcmp(argv[i], "-j") == 0) threads = atoi(argv[++i]);
+        else if (argv[i][0] != '-') scripts[scriptCount++] = argv[i];
+        else {
+            scriptCount = 0;
+            break;
+        }
+    }
+    if (scriptCount == 0 || (afterDashes && inputCount == 0)) {
+        usage(argv[0]);
+        free(scripts);
+        free(inputs);
+        return 1;
+    }
+    if (threads <= 0) threads = cpu_count();
+
+    /* Every script runs once per input (or once, with no inputs) */
+    int runs = inputCount > 0 ? inputCount : 1;
+    ScriptQueue queue;
+    queue.count = scriptCount * runs;
+    queue.next = 0;
+    queue.jobs = (ScriptJob*)calloc((size_t)queue.count, sizeof(ScriptJob));
+    queue.lock = CadMutex_Create();
+    if (!queue.jobs || !queue.lock) {
+        fprintf(stderr, "Error: Could not set up %d script run(s)\n", queue.count);
+        free(queue.jobs);
+        if (queue.lock) CadMutex_Destroy(queue.lock);
+        free(scripts);
+        free(inputs);
+        return 1;
+    }
+    for (int s = 0; s < scriptCount; s++) {
+        for (int r = 0; r < runs; r++) {
+            ScriptJob* job = &queue.jobs[s * runs + r];
+            job->script = scripts[s];
+            job->input = inputCount > 0 ? inputs[r] : NULL;
+        }
+    }
+
+    double start = now_seconds();
+    run_pool(script_worker, &queue, threads < queue.count ? threads : queue.count);
+    CadMutex_Destroy(queue.lock);
+
+    int failed = 0;
+    for (int i = 0; i < queue.count; i++) {
+        if (!queue.jobs[i].ok) failed++;
+    }
+    fprintf(stdout, "\nScript summary: %d run(s) of %d script(s)\n", queue.count, scriptCount);
+    fprintf(stdout, "  succeeded: %d\n", queue.count - failed);
+    fprintf(stdout, "  failed:    %d\n", failed);
+    fprintf(stdout, "  threads:   %d\n", threads < queue.count ? threads : queue.count);
+    fprintf(stdout, "  elapsed:   %.2f s\n", now_seconds() - start);
+    for (int i = 0; i < queue.count; i++) {
+        if (!queue.jobs[i].ok) {
+            if (queue.jobs[i].input) {
+                fprintf(stdout, "  FAILED: %s on %s\n", queue.jobs[i].script, queue.jobs[i].input);
+            } else {
+                fprintf(stdout, "  FAILED: %s\n", queue.jobs[i].script);
+            }
+        }
+    }
+
+    free(queue.jobs);
+    free(scripts);
+    free(inputs);
+    return failed ? 2 : 0;
+}
+
+/* ----------------------------------------------------------------------------
+   Shape library mode: export every shape of an ASM folder. Each file is
+   parsed once and the constant table is loaded once; both are shared
+   read-only by the workers.
+   ---------------------------------------------------------------------------- */
+
+#define OUT_CAD  1
+#define OUT_3DG1 2
+#define OUT_OBJ  4
+
+typedef struct {
+    const CadAsmSource* source;
+    const char* name;
+    const char* file;
+    int ok;
+} ShapeJob;
+
+typedef struct {
+    BatchList* files;
+    CadAsmSource** sources;  /* Parsed files (NULL if a file could not be read) */
+    ShapeJob* shapes;
+    int shapeCount;
+    const CadAsmConstants* constants;
+    const char* outdir;
+    int outputs;             /* OUT_* mask */
+    CadMutex* lock;
+    int next;                /* Next job to hand out (guarded by lock) */
+} ShapeQueue;
+
+static int shape_next(ShapeQueue* queue) {
+    CadMutex_Lock(queue->lock);
+    int index = queue->next++;
+    CadMutex_Unlock(queue->lock);
+    return index;
+}
+
+static void parse_worker(void* arg) {
+    ShapeQueue* queue = (ShapeQueue*)arg;
+    for (;;) {
+        int index = shape_next(queue);
+        if (index >= queue->files->count) break;
+        queue->sources[index] = CadAsmSource_Load(queue->files->jobs[index].input);
+    }
+}
+
+static void shape_worker(void* arg) {
+    ShapeQueue* queue = (ShapeQueue*)arg;
+    CadCore* core = create_core();
+    if (!core) return;       /* Jobs this worker would have taken go to the others */
+
+    for (;;) {
+        int index = shape_next(queue);
+        if (index >= queue->shapeCount) break;
+
+        ShapeJob* job = &queue->shapes[index];
+        if (!CadImport_AsmShapeFromSource(core, job->source, job->name, queue->constants)) {
+            fprintf(stderr, "Failed to import shape '%s' from '%s'\n", job->name, job->file);
+            continue;
+        }
+
+        char path[PATH_BUF];
+        char file[PATH_BUF];
+        job->ok = 1;
+        if (queue->outputs & OUT_CAD) {
+            snprintf(file, sizeof(file), "%s.cad", job->name);
+            if (!join_path(path, sizeof(path), queue->outdir, file) || !CadFile_Save(path, &core->data)) job->ok = 0;
+        }
+        if (queue->outputs & OUT_3DG1) {
+            snprintf(file, sizeof(file), "%s.3dg1", job->name);
+            if (!join_path(path, sizeof(path), queue->outdir, file) || !CadExport_3DG1(core, path)) job->ok = 0;
+        }
+        if (queue->outputs & OUT_OBJ) {
+            snprintf(file, sizeof(file), "%s.obj", job->name);
+            if (!join_path(path, sizeof(path), queue->outdir, file) || !CadExport_OBJ(core, path)) job->ok = 0;
+        }
+        if (!job->ok) fprintf(stderr, "Failed to write shape '%s'\n", job->name);
+    }
+    destroy_core(core);
+}
+
+/* Parse "cad,3dg1,obj" into an OUT_* mask (0 if a name is unknown) */
+static int parse_outputs(const char* list) {
+    int mask = 0;
+    char name[16];
+    while (*list) {
+        size_t len = strcspn(list, ",");
+        if (len == 0 || len >= sizeof(name)) return 0;
+        memcpy(name, list, len);
+        name[len] = '\0';
+        ConvertFormat format = parse_format(name);
+        if (format == FMT_CAD) mask |= OUT_CAD;
+        else if (format == FMT_3DG1) mask |= OUT_3DG1;
+        else if (format == FMT_OBJ) mask |= OUT_OBJ;
+        else return 0;
+        list += len;
+        if (*list == ',') list++;
+    }
+    return mask;
+}
+
+static int library_main(int argc, char** argv) {
+    const char* dir = NULL;
+    const char* outdir = NULL;
+    int outputs = OUT_3DG1;
+    int threads = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "-a") == 0) dir = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "-o") == 0) outdir = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "-j") == 0) threads = atoi(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "-to") == 0) outputs = parse_outputs(argv[++i]);
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!dir || !outputs) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (!outdir) outdir = dir;
+    if (threads <= 0) threads = cpu_count();
+
+    double start = now_seconds();
+    char probe[PATH_BUF];
+    if (!join_path(probe, sizeof(probe), outdir, "x") || !make_parent_dirs(probe)) {
+        fprintf(stderr, "Error: Could not create directory '%s'\n", outdir);
+        return 1;
+    }
+
+    BatchList files;
+    memset(&files, 0, sizeof(files));
+    collect_tree(&files, dir, NULL, "*.asm");
+
+    ShapeQueue queue;
+    memset(&queue, 0, sizeof(queue));
+    queue.files = &files;
+    queue.outdir = outdir;
+    queue.outputs = outputs;
+    queue.lock = CadMutex_Create();
+    queue.sources = (CadAsmSource**)calloc((size_t)files.count + 1, sizeof(CadAsmSource*));
+    CadAsmConstants* constants = CadAsmConstants_Create();
+    if (!queue.lock || !queue.sources || !constants) {
+        fprintf(stderr, "Error: Could not set up the export\n");
+        if (queue.lock) CadMutex_Destroy(queue.lock);
+        free(queue.sources);
+        CadAsmConstants_Destroy(constants);
+        batch_free(&files);
+        return 1;
+    }
+    CadAsmConstants_LoadFolder(constants, dir);
+    queue.constants = constants;
+
+    /* Parse every file once */
+    run_pool(parse_worker, &queue, threads < files.count ? threads : files.count);
+
+    /* One job per shape; a name defined by two files is exported once */
+    int total = 0;
+    int unreadable = 0;
+    for (int f = 0; f < files.count; f++) {
+        if (queue.sources[f]) total += CadAsmSource_GetShapeCount(queue.sources[f]);
+        else unreadable++;
+    }
+    queue.shapes = (ShapeJob*)calloc((size_t)total + 1, sizeof(ShapeJob));
+    int duplicates = 0;
+    for (int f = 0; queue.shapes && f < files.count; f++) {
+        for (int s = 0; s < CadAsmSource_GetShapeCount(queue.sources[f]); s++) {
+            const char* name = CadAsmSource_GetShapeName(queue.sources[f], s);
+            int seen = 0;
+            for (int k = 0; k < queue.shapeCount && !seen; k++) {
+                seen = name_equals(queue.shapes[k].name, name);
+            }
+            if (seen) {
+                fprintf(stderr, "Warning: Shape '%s' in '%s' was already defined, skipped\n",
+                        name, files.jobs[f].input);
+                duplicates++;
+                continue;
+            }
+            ShapeJob* job = &queue.shapes[queue.shapeCount++];
+            job->source = queue.sources[f];
+            job->name = name;
+            job->file = files.jobs[f].input;
+        }
+    }
+
+    queue.next = 0;
+    run_pool(shape_worker, &queue, threads < queue.shapeCount ? threads : queue.shapeCount);
+
+    int failed = 0;
+    for (int i = 0; i < queue.shapeCount; i++) {
+        if (!queue.shapes[i].ok) failed++;
+    }
+    fprintf(stdout, "\nShape library summary: %d file(s), %d shape(s) under '%s'\n", files.count, total, dir);
+    fprintf(stdout, "  exported:   %d\n", queue.shapeCount - failed);
+    fprintf(stdout, "  failed:     %d\n", failed);
+    fprintf(stdout, "  duplicates: %d\n", duplicates);
+    fprintf(stdout, "  unreadable: %d\n", unreadable);
+    fprintf(stdout, "  threads:    %d\n", threads < queue.shapeCount ? threads : (queue.shapeCount ? queue.shapeCount : 1));
+    fprintf(stdout, "  elapsed:    %.2f s\n", now_seconds() - start);
+    for (int i = 0; i < queue.shapeCount; i++) {
+        if (!queue.shapes[i].ok) {
+            fprintf(stdout, "  FAILED: %s (%s)\n", queue.shapes[i].name, queue.shapes[i].file);
+        }
+    }
+
+    free(queue.shapes);
+    for (int f = 0; f < files.count; f++) {
+        CadAsmSource_Destroy(queue.sources[f]);
+    }
+    free(queue.sources);
+    CadAsmConstants_Destroy(constants);
+    CadMutex_Destroy(queue.lock);
+    batch_free(&files);
+    return (failed || unreadable) ? 2 : 0;
+}
+
+/* ----------------------------------------------------------------------------
+   Audit mode: check every .cad/.3dg1/.asm shape under a folder against the
+   SuperFX limits and write a JSON report for CI
+   ---------------------------------------------------------------------------- */
+
+#define PB_MIN (-128)
+#define PB_MAX 127
+#define PW_MIN (-32768)
+#define PW_MAX 32767
+
+typedef struct {
+    char* shape;             /* ASM shape name (NULL for single-model files) */
+    int loaded;
+    int points;              /* Live points */
+    int uniquePoints;        /* Distinct grid positions used by faces */
+    int polygons;
+    int objects;
+    int oversizedFaces;      /* Faces with more than CAD_MAX_FACE_POINTS vertices */
+    int offGridPoints;       /* Points failing CadCore_IsPointOnGrid */
+    int unmergedPolygons;    /* Polygons failing CadCore_IsPolygonMerged */
+    int coordinatesMerged;   /* CadCore_AreCoordinatesMerged */
+    int pointsMerged;        /* CadCore_ArePointsMerged */
+    int outsideByte;         /* Points that need pw (a coordinate outside pb range) */
+    int outsideWord;         /* Points that fit neither pb nor pw */
+} ShapeAudit;
+
+typedef struct {
+    const char* path;
+    ConvertFormat format;
+    int readFailed;
+    ShapeAudit* shapes;
+    int shapeCount;
+} FileAudit;
+
+typedef struct {
+    FileAudit* files;
+    int count;
+    const CadAsmConstants* constants;
+    CadMutex* lock;
+    int next;                /* Next job to hand out (guarded by lock) */
+} AuditQueue;
+
+/* A shape passes when it loads and needs no merge, split or rescale */
+static int audit_passed(const ShapeAudit* a) {
+    return a->loaded && a->oversizedFaces == 0 && a->coordinatesMerged &&
+           a->pointsMerged && a->outsideWord == 0;
+}
+
+static int compare_grid_points(const void* a, const void* b) {
+    const int* p = (const int*)a;
+    const int* q = (const int*)b;
+    for (int i = 0; i < 3; i++) {
+        if (p[i] != q[i]) return p[i] < q[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+static void audit_core(CadCore* core, ShapeAudit* a) {
+    a->points = CadCore_GetActivePointCount(core);
+    a->polygons = CadCore_GetActivePolygonCount(core);
+    a->objects = CadCore_GetActiveObjectCount(core);
+    a->coordinatesMerged = CadCore_AreCoordinatesMerged(core);
+    a->pointsMerged = CadCore_ArePointsMerged(core);
+
+    for (int i = 0; i < core->data.pointCount; i++) {
+        CadPoint* pt = &core->data.points[i];
+        if (pt->flags == 0) continue;
+        if (!CadCore_IsPointOnGrid(core, i)) a->offGridPoints++;
+
+        /* Range of the value pb/pw would store */
+        int xyz[3] = {
+            CadCore_ConvertCoordinate(pt->pointx),
+            CadCore_ConvertCoordinate(pt->pointy),
+            CadCore_ConvertCoordinate(pt->pointz)
+        };
+        int byteOk = 1, wordOk = 1;
+        for (int k = 0; k < 3; k++) {
+            if (xyz[k] < PB_MIN || xyz[k] > PB_MAX) byteOk = 0;
+            if (xyz[k] < PW_MIN || xyz[k] > PW_MAX) wordOk = 0;
+        }
+        if (!byteOk) a->outsideByte++;
+        if (!wordOk) a->outsideWord++;
+    }
+
+    /* Distinct positions of face vertices: the shape's own point list */
+    size_t capacity = 1;
+    for (int p = 0; p < core->data.polygonCount; p++) {
+        if (core->data.polygons[p].flags != 0) capacity += core->data.polygons[p].npoints;
+    }
+    int* grid = (int*)malloc(capacity * 3 * sizeof(int));
+    int used = 0;
+    for (int p = 0; p < core->data.polygonCount; p++) {
+        CadPolygon* poly = &core->data.polygons[p];
+        if (poly->flags == 0) continue;
+        if (poly->npoints > CAD_MAX_FACE_POINTS) a->oversizedFaces++;
+        if (!CadCore_IsPolygonMerged(core, p)) a->unmergedPolygons++;
+
+        int count;
+        const CadIndex* points = CadCore_GetPolygonPoints(core, p, &count);
+        for (int k = 0; grid && k < count && (size_t)used < capacity; k++) {
+            CadPoint* pt = &core->data.points[points[k]];
+            grid[used * 3 + 0] = CadCore_ConvertCoordinate(pt->pointx);
+            grid[used * 3 + 1] = CadCore_ConvertCoordinate(pt->pointy);
+            grid[used * 3 + 2] = CadCore_ConvertCoordinate(pt->pointz);
+            used++;
+        }
+    }
+    if (grid) {
+        qsort(grid, (size_t)used, 3 * sizeof(int), compare_grid_points);
+        for (int i = 0; i < used; i++) {
+            if (i == 0 || compare_grid_points(&grid[i * 3], &grid[(i - 1) * 3]) != 0) a->uniquePoints++;
+        }
+        free(grid);
+    }
+}
+
+/* Faces of more than CAD_MAX_FACE_POINTS vertices: the 3DG1 importer drops
+   them, so count them in the text */
+static int count_oversized_3dg1_faces(const char* text) {
+    const char* p = text;
+    char* end;
+    if (strncmp(p, "3DG1", 4) != 0) return 0;
+    p += 4;
+    long vertices = strtol(p, &end, 10);
+    p = end;
+    for (long i = 0; i < vertices * 3; i++) {
+        strtod(p, &end);
+        if (end == p) return 0;
+        p = end;
+    }
+
+    int oversized = 0;
+    while (*p) {
+        long count = strtol(p, &end, 10);
+        if (end != p && count > CAD_MAX_FACE_POINTS) oversized++;
+        p = strchr(end, '\n');
+        if (!p) break;
+        p++;
+    }
+    return oversized;
+}
+
+/* Directory order varies between runs and platforms; the report should not */
+static int compare_file_audits(const void* a, const void* b) {
+    return strcmp(((const FileAudit*)a)->path, ((const FileAudit*)b)->path);
+}
+
+static int add_shape(FileAudit* file, const char* name) {
+    ShapeAudit* grown = (ShapeAudit*)realloc(file->shapes, (size_t)(file->shapeCount + 1) * sizeof(ShapeAudit));
+    if (!grown) return 0;
+    file->shapes = grown;
+    ShapeAudit* a = &file->shapes[file->shapeCount++];
+    memset(a, 0, sizeof(*a));
+    if (name) {
+        a->shape = (char*)malloc(strlen(name) + 1);
+        if (a->shape) strcpy(a->shape, name);
+    }
+    return 1;
+}
+
+/* The audit never writes to the input tree: files are only read into the
+   (cleared) core, never loaded through CadCore_LoadFile, which would make
+   the file a journaled-save target of the core */
+static void audit_file(CadCore* core, FileAudit* file, const CadAsmConstants* constants) {
+    if (file->format == FMT_ASM) {
+        CadAsmSource* source = CadAsmSource_Load(file->path);
+        if (!source) {
+            file->readFailed = 1;
+            return;
+        }
+        for (int s = 0; s < CadAsmSource_GetShapeCount(source); s++) {
+            const char* name = CadAsmSource_GetShapeName(source, s);
+            if (!add_shape(file, name)) break;
+            ShapeAudit* a = &file->shapes[file->shapeCount - 1];
+            a->loaded = CadImport_AsmShapeFromSource(core, source, name, constants);
+            if (a->loaded) audit_core(core, a);
+        }
+        CadAsmSource_Destroy(source);
+        return;
+    }
+
+    if (!add_shape(file, NULL)) {
+        file->readFailed = 1;
+        return;
+    }
+    ShapeAudit* a = &file->shapes[0];
+    if (file->format == FMT_CAD) {
+        a->loaded = CadFile_Load(file->path, &core->data);
+        if (a->loaded) audit_core(core, a);
+        return;
+    }
+
+    FILE* fp = fopen(file->path, "rb");
+    size_t size = 0;
+    char* text = fp ? read_stream(fp, &size) : NULL;
+    if (fp) fclose(fp);
+    if (!text) {
+        file->readFailed = 1;
+        return;
+    }
+    a->loaded = CadImport_3DG1FromBuffer(core, text, size);
+    if (a->loaded) {
+        audit_core(core, a);
+        a->oversizedFaces += count_oversized_3dg1_faces(text);
+    }
+    free(text);
+}
+
+static void audit_worker(void* arg) {
+    AuditQueue* queue = (AuditQueue*)arg;
+    CadCore* core = create_core();
+    if (!core) return;       /* Jobs this worker would have taken go to the others */
+
+    for (;;) {
+        CadMutex_Lock(queue->lock);
+        int index = queue->next++;
+        CadMutex_Unlock(queue->lock);
+        if (index >= queue->count) break;
+
+        CadCore_Clear(core);
+        audit_file(core, &queue->files[index], queue->constants);
+    }
+    destroy_core(core);
+}
+
+static void json_string(FILE* fp, const char* s) {
+    fputc('"', fp);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') fprintf(fp, "\\%c", c);
+        else if (c < 0x20) fprintf(fp, "\\u%04x", c);
+        else fputc(c, fp);
+    }
+    fputc('"', fp);
+}
+
+static void write_audit_json(FILE* fp, const char* dir, const FileAudit* files, int count,
+                             int shapes, int failed, int unreadable) {
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"root\": ");
+    json_string(fp, dir);
+    fprintf(fp, ",\n");
+    fprintf(fp, "  \"limits\": { \"maxFacePoints\": %d, \"pb\": [%d, %d], \"pw\": [%d, %d] },\n",
+            CAD_MAX_FACE_POINTS, PB_MIN, PB_MAX, PW_MIN, PW_MAX);
+    fprintf(fp, "  \"summary\": { \"files\": %d, \"shapes\": %d, \"failed\": %d, \"unreadable\": %d },\n",
+            count, shapes, failed, unreadable);
+    fprintf(fp, "  \"shapes\": [");
+
+    int first = 1;
+    for (int f = 0; f < count; f++) {
+        const FileAudit* file = &files[f];
+        if (file->readFailed) {
+            fprintf(fp, "%s\n    { \"file\": ", first ? "" : ",");
+            json_string(fp, file->path);
+            fprintf(fp, ", \"format\": \"%s\", \"loaded\": false, \"passed\": false }", format_name(file->format));
+            first = 0;
+            continue;
+        }
+        for (int s = 0; s < file->shapeCount; s++) {
+            const ShapeAudit* a = &file->shapes[s];
+            fprintf(fp, "%s\n    { \"file\": ", first ? "" : ",");
+            json_string(fp, file->path);
+            first = 0;
+            if (a->shape) {
+                fprintf(fp, ", \"shape\": ");
+                json_string(fp, a->shape);
+            }
+            if (!a->loaded) {
+                fprintf(fp, ", \"format\": \"%s\", \"loaded\": false, \"passed\": false }",
+                        format_name(file->format));
+                continue;
+            }
+            fprintf(fp, ", \"format\": \"%s\", \"loaded\": true, \"passed\": %s,\n",
+                    format_name(file->format), audit_passed(a) ? "true" : "false");
+            fprintf(fp, "      \"points\": %d, \"uniquePoints\": %d, \"faces\": %d, \"objects\": %d,\n",
+                    a->points, a->uniquePoints, a->polygons, a->objects);
+            fprintf(fp, "      \"oversizedFaces\": %d, \"coordinatesMerged\": %s, \"offGridPoints\": %d,\n",
+                    a->oversizedFaces, a->coordinatesMerged ? "true" : "false", a->offGridPoints);
+            fprintf(fp, "      \"pointsMerged\": %s, \"facesWithDuplicatePoints\": %d,\n",
+                    a->pointsMerged ? "true" : "false", a->unmergedPolygons);
+            fprintf(fp, "      \"pointsOutsidePb\": %d, \"pointsOutsidePw\": %d }", a->outsideByte, a->outsideWord);
+        }
+    }
+    fprintf(fp, "%s]\n}\n", first ? "" : "\n  ");
+}
+
+static int audit_main(int argc, char** argv) {
+    const char* dir = NULL;
+    const char* reportPath = NULL;
+    const char* incdir = NULL;
+    int threads = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "-audit") == 0) dir = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "-o") == 0) reportPath = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "-I") == 0) incdir = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "-j") == 0) threads = atoi(argv[++i]);
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!dir) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (threads <= 0) threads = cpu_count();
+
+    /* The report may go to stdout, so keep status lines off it */
+    FILE* report = NULL;
+    if (!reportPath || strcmp(reportPath, "-") == 0) {
+        report = claim_stdout();
+    } else {
+        report = fopen(reportPath, "wb");
+        if (!report) fprintf(stderr, "Error: Could not open '%s' for writing\n", reportPath);
+    }
+    if (!report) return 1;
+
+    BatchList list;
+    memset(&list, 0, sizeof(list));
+    int scanned = collect_tree(&list, dir, NULL, "*.cad") &&
+                  collect_tree(&list, dir, NULL, "*.3dg1") &&
+                  collect_tree(&list, dir, NULL, "*.asm");
+
+    AuditQueue queue;
+    memset(&queue, 0, sizeof(queue));
+    queue.count = list.count;
+    queue.files = (FileAudit*)calloc((size_t)list.count + 1, sizeof(FileAudit));
+    queue.lock = CadMutex_Create();
+    CadAsmConstants* constants = CadAsmConstants_Create();
+    if (!queue.files || !queue.lock || !constants) {
+        fprintf(stderr, "Error: Could not set up the audit\n");
+        free(queue.files);
+        if (queue.lock) CadMutex_Destroy(queue.lock);
+        CadAsmConstants_Destroy(constants);
+        batch_free(&list);
+        fclose(report);
+        return 1;
+    }
+    int hasAsm = 0;
+    for (int i = 0; i < list.count; i++) {
+        queue.files[i].path = list.jobs[i].input;
+        queue.files[i].format = format_from_extension(list.jobs[i].input);
+        if (queue.files[i].format == FMT_ASM) hasAsm = 1;
+    }
+    qsort(queue.files, (size_t)queue.count, sizeof(FileAudit), compare_file_audits);
+    if (hasAsm) CadAsmConstants_LoadFolder(constants, incdir ? incdir : dir);
+    queue.constants = constants;
+
+    run_pool(audit_worker, &queue, threads < queue.count ? threads : queue.count);
+
+    int shapes = 0, failed = 0, unreadable = 0;
+    for (int f = 0; f < queue.count; f++) {
+        if (queue.files[f].readFailed) {
+            unreadable++;
+            continue;
+        }
+        for (int s = 0; s < queue.files[f].shapeCount; s++) {
+            shapes++;
+            if (!audit_passed(&queue.files[f].shapes[s])) failed++;
+        }
+    }
+    write_audit_json(report, dir, queue.files, queue.count, shapes, failed, unreadable);
+    int writeOk = fflush(report) == 0;
+    if (fclose(report) != 0) writeOk = 0;
+    if (!writeOk) fprintf(stderr, "Error: Could not write the audit report\n");
+
+    fprintf(stderr, "Audit: %d file(s), %d shape(s), %d over budget, %d unreadable\n",
+            queue.count, shapes, failed, unreadable);
+
+    for (int f = 0; f < queue.count; f++) {
+        for (int s = 0; s < queue.files[f].shapeCount; s++) {
+            free(queue.files[f].shapes[s].shape);
+        }
+        free(queue.files[f].shapes);
+    }
+    free(queue.files);
+    CadMutex_Destroy(queue.lock);
+    CadAsmConstants_Destroy(constants);
+    batch_free(&list);
+    if (!scanned || !writeOk) return 1;
+    return (failed || unreadable) ? 2 : 0;
+}
 
 int main(int argc, char** argv) {
     if (argc < 2) {
-        fprintf(stderr, "Usage: %s <input.cad> [output.txt]\n", argc > 0 ? argv[0] : "cad23dg1");
+        usage(argc > 0 ? argv[0] : "cad23dg1");
         return 1;
     }
+    if (strcmp(argv[1], "-c") == 0) {
+        return convert_main(argc, argv);
+    }
+    if (strcmp(argv[1], "-r") == 0) {
+        return script_main(argc, argv);
+    }
+    if (strcmp(argv[1], "-a") == 0) {
+        return library_main(argc, argv);
+    }
+    if (strcmp(argv[1], "-audit") == 0) {
+        return audit_main(argc, argv);
+    }
+    if (argv[1][0] == '-') {
+        return batch_main(argc, argv);
+    }
 
     const char* inpath = argv[1];
-    char outpath[1024];
+    char outpath[PATH_BUF];
 
     if (argc >= 3) {
         strncpy(outpath, argv[2], sizeof(outpath) - 1);
         outpath[sizeof(outpath) - 1] = '\0';
     } else {
         /* generate output filename by replacing extension with .txt */
-        const char* dot = strrchr(inpath, '.');
-        if (dot) {
-            size_t len = (size_t)(dot - inpath);
-            if (len >= sizeof(outpath)) len = sizeof(outpath) - 1;
-            memcpy(outpath, inpath, len);
-            outpath[len] = '\0';
-            strcat(outpath, ".txt");
-        } else {
-            strncpy(outpath, inpath, sizeof(outpath) - 1);
-            outpath[sizeof(outpath) - 1] = '\0';
-            strcat(outpath, ".txt");
-        }
+        make_output_path(inpath, outpath, sizeof(outpath));
     }
 
-    CadCore core;
-    memset(&core, 0, sizeof(core));
+    CadCore* core = create_core();
+    if (!core) {
+        fprintf(stderr, "Out of memory\n");
+        return 2;
+    }
 
-    if (!CadFile_Load(inpath, &core.data)) {
+    if (!CadFile_Load(inpath, &core->data)) {
         fprintf(stderr, "Failed to load CAD file '%s'\n", inpath);
+        destroy_core(core);
         return 2;
     }
 
-    if (!CadExport_3DG1(&core, outpath)) {
+    if (!CadExport_3DG1(core, outpath)) {
         fprintf(stderr, "Failed to export Fundoshi-Kun file '%s'\n", outpath);
+        destroy_core(core);
         return 3;
     }
 
+    destroy_core(core);
     return 0;
 }
@@ -1,18 +1,25 @@
 # Makefile to build my little command line frontend for the components I've cherrypicked
-# replaces gcc -Iinclude src/cad_file.c src/cad_export_3dg1.c cad23dg1.c -o cad23dg1.exe
+# replaces gcc -iquote include src/cad_file.c src/cad_lz.c src/cad_codec.c src/cad_thread.c src/cad_manifest.c src/cad_core.c src/cad_import_obj.c src/cad_import_3dg1.c src/cad_import_asm.c src/cad_export_obj.c src/cad_export_3dg1.c src/cad_script.c cad23dg1.c -o cad23dg1.exe
 
 CC := gcc
 CFLAGS := -O2 -Wall
-INCLUDES := -Iinclude
-SRCS := src/cad_file.c src/cad_export_3dg1.c cad23dg1.c
+# -iquote, not -I: include/dirent.h is the Win32 shim and must not shadow the
+# system <dirent.h> the tool uses on other platforms
+INCLUDES := -iquote include
+SRCS := src/cad_file.c src/cad_lz.c src/cad_codec.c src/cad_thread.c src/cad_manifest.c src/cad_core.c src/cad_import_obj.c src/cad_import_3dg1.c src/cad_import_asm.c src/cad_export_obj.c src/cad_export_3dg1.c src/cad_script.c cad23dg1.c
 TARGET := cad23dg1.exe
+ifeq ($(OS),Windows_NT)
+LDLIBS :=
+else
+LDLIBS := -pthread -lm
+endif
 
 .PHONY: all clean
 
 all: $(TARGET)
 
 $(TARGET): $(SRCS)
-	$(CC) $(CFLAGS) $(INCLUDES) $(SRCS) -o $(TARGET)
+	$(CC) $(CFLAGS) $(INCLUDES) $(SRCS) -o $(TARGET) $(LDLIBS)
 
 clean:
 	-@rm -f $(TARGET)
\ No newline at end of file
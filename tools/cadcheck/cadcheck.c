@@ -0,0 +1,643 @@
+/* Derived index checker: random edits against CadCore_CheckIndexes
+ * Usage: cadcheck [-n ops] [-s seed] [input.cad...]
+ *        cadcheck -z
+ *
+ * Runs ops random core operations, from an empty model or from each input
+ * in turn, and after every one rebuilds the core's derived indexes from the
+ * records and compares them with the ones it kept up to date. It also diffs
+ * the records against a copy taken before the operation: every record that
+ * changed must lie in a range the change notifications and the dirty ranges
+ * reported. Runs of operations are also wrapped in (sometimes nested)
+ * batches, which must hold every notification back to the outermost commit
+ * and bring the indexes live before it back. Exits 1 at the first
+ * operation that leaves anything out of step.
+ * Build with cadcheck.mak, which defines CAD_CHECK_INDEXES.
+ *
+ * With -z it instead saves models whose image is just under and just over
+ * CAD_COMPRESSED_MAX_IMAGE in the compressed container: the first has to
+ * load back unchanged, the second has to fail to save (and still save and
+ * load uncompressed).
+ */
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cad_core.h"
+
+#ifndef CAD_CHECK_INDEXES
+#error "cadcheck needs CAD_CHECK_INDEXES (build it with cadcheck.mak)"
+#endif
+
+/* ----------------------------------------------------------------------------
+   Random numbers (own generator so a seed replays the same run everywhere)
+   ---------------------------------------------------------------------------- */
+
+static uint32_t rng_state = 1;
+
+static uint32_t rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/* 0 .. n-1 (0 when n <= 0) */
+static int rng_below(int n) {
+    return n > 0 ? (int)(rng_next() % (uint32_t)n) : 0;
+}
+
+/* A coordinate on a half grid, so points collide and some are off grid */
+static double rng_coord(void) {
+    return (double)(rng_below(17) - 8) * 0.5;
+}
+
+/* Mostly a slot in use, sometimes one past the table or a negative index */
+static CadIndex rng_slot(int count) {
+    int pick = rng_below(20);
+    if (pick == 0) return INVALID_INDEX;
+    if (pick == 1) return (CadIndex)count;
+    return (CadIndex)rng_below(count);
+}
+
+/* ----------------------------------------------------------------------------
+   Change coverage
+   ---------------------------------------------------------------------------- */
+
+static const char* kind_names[CAD_CHANGE_KINDS] = {
+    "points", "polygons", "objects", "point selection", "polygon selection"
+};
+
+/* Union of the ranges the subscription was told about */
+typedef struct {
+    CadIndex first[CAD_CHANGE_KINDS];
+    CadIndex last[CAD_CHANGE_KINDS];
+} NotedChanges;
+
+static void noted_reset(NotedChanges* noted) {
+    for (int kind = 0; kind < CAD_CHANGE_KINDS; kind++) {
+        noted->first[kind] = INVALID_INDEX;
+        noted->last[kind] = INVALID_INDEX;
+    }
+}
+
+static void on_change(void* user, CadChangeKind kind, CadIndex first, CadIndex last) {
+    NotedChanges* noted = (NotedChanges*)user;
+    if (noted->first[kind] == INVALID_INDEX || first < noted->first[kind]) noted->first[kind] = first;
+    if (noted->last[kind] == INVALID_INDEX || last > noted->last[kind]) noted->last[kind] = last;
+}
+
+/* The records and selection as they were before an operation */
+typedef struct {
+    CadPoint* points;
+    CadPolygon* polygons;
+    CadObject* objects;
+    int pointCount;
+    int polygonCount;
+    int objectCount;
+    CadBitset pointSelection;
+    CadBitset polygonSelection;
+    uint32_t generation[CAD_CHANGE_KINDS];
+} Snapshot;
+
+static void snapshot_init(Snapshot* snap) {
+    memset(snap, 0, sizeof(Snapshot));
+    CadBitset_Init(&snap->pointSelection);
+    CadBitset_Init(&snap->polygonSelection);
+}
+
+static void snapshot_free(Snapshot* snap) {
+    free(snap->points);
+    free(snap->polygons);
+    free(snap->objects);
+    CadBitset_Free(&snap->pointSelection);
+    CadBitset_Free(&snap->polygonSelection);
+}
+
+static void* copy_table(void* old, const void* records, int count, size_t size) {
+    void* copy = realloc(old, (size_t)(count > 0 ? count : 1) * size);
+    if (!copy) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        exit(1);
+    }
+    if (count > 0) memcpy(copy, records, (size_t)count * size);
+    return copy;
+}
+
+/* Take the snapshot and clear the dirty ranges, so both they and the
+   notifications cover just what happens next */
+static void snapshot_take(Snapshot* snap, CadCore* core) {
+    snap->pointCount = core->data.pointCount;
+    snap->polygonCount = core->data.polygonCount;
+    snap->objectCount = core->data.objectCount;
+    snap->points = (CadPoint*)copy_table(snap->points, core->data.points, snap->pointCount, sizeof(CadPoint));
+    snap->polygons = (CadPolygon*)copy_table(snap->polygons, core->data.polygons, snap->polygonCount, sizeof(CadPolygon));
+    snap->objects = (CadObject*)copy_table(snap->objects, core->data.objects, snap->objectCount, sizeof(CadObject));
+    CadBitset_Clear(&snap->pointSelection);
+    CadBitset_Union(&snap->pointSelection, &core->selection.points);
+    CadBitset_Clear(&snap->polygonSelection);
+    CadBitset_Union(&snap->polygonSelection, &core->selection.polygons);
+    for (int kind = 0; kind < CAD_CHANGE_KINDS; kind++) {
+        snap->generation[kind] = CadCore_GetGeneration(core, (CadChangeKind)kind);
+        CadCore_ClearDirtyRange(core, (CadChangeKind)kind);
+    }
+}
+
+/* Slots past a table read as the zeroed records free slots hold; selection
+   flags are covered by the selection kinds */
+static int same_point(const CadPoint* a, const CadPoint* b) {
+    return a->flags == b->flags && a->nextPoint == b->nextPoint &&
+           a->pointx == b->pointx && a->pointy == b->pointy && a->pointz == b->pointz;
+}
+
+static int same_polygon(const CadPolygon* a, const CadPolygon* b) {
+    return a->flags == b->flags && a->nextPolygon == b->nextPolygon && a->firstPoint == b->firstPoint &&
+           a->animation == b->animation && a->both == b->both && a->side == b->side &&
+           a->color == b->color && a->npoints == b->npoints;
+}
+
+static int same_object(const CadObject* a, const CadObject* b) {
+    return a->flags == b->flags && a->parentObject == b->parentObject &&
+           a->nextBrother == b->nextBrother && a->childObject == b->childObject &&
+           a->firstPolygon == b->firstPolygon && a->offsetx == b->offsetx &&
+           a->offsety == b->offsety && a->offsetz == b->offsetz;
+}
+
+static int record_changed(const Snapshot* snap, CadCore* core, int kind, int i) {
+    static const CadPoint no_point;
+    static const CadPolygon no_polygon;
+    static const CadObject no_object;
+    switch (kind) {
+    case CAD_CHANGE_POINTS:
+        return !same_point(i < snap->pointCount ? &snap->points[i] : &no_point,
+                           i < core->data.pointCount ? &core->data.points[i] : &no_point);
+    case CAD_CHANGE_POLYGONS:
+        return !same_polygon(i < snap->polygonCount ? &snap->polygons[i] : &no_polygon,
+                             i < core->data.polygonCount ? &core->data.polygons[i] : &no_polygon);
+    case CAD_CHANGE_OBJECTS:
+        return !same_object(i < snap->objectCount ? &snap->objects[i] : &no_object,
+                            i < core->data.objectCount ? &core->data.objects[i] : &no_object);
+    case CAD_CHANGE_POINT_SELECTION:
+        return CadBitset_Test(&snap->pointSelection, i) != CadBitset_Test(&core->selection.points, i);
+    default:
+        return CadBitset_Test(&snap->polygonSelection, i) != CadBitset_Test(&core->selection.polygons, i);
+    }
+}
+
+/* Every record that differs from the snapshot must be in the range noted
+   for its kind and in the dirty range, with the generation bumped. Returns
+   0 (after reporting it) at the first one that is not. */
+static int check_coverage(const Snapshot* snap, CadCore* core, const NotedChanges* noted) {
+    int slots[CAD_CHANGE_KINDS];
+    slots[CAD_CHANGE_POINTS] = slots[CAD_CHANGE_POINT_SELECTION] =
+        snap->pointCount > core->data.pointCount ? snap->pointCount : core->data.pointCount;
+    slots[CAD_CHANGE_POLYGONS] = slots[CAD_CHANGE_POLYGON_SELECTION] =
+        snap->polygonCount > core->data.polygonCount ? snap->polygonCount : core->data.polygonCount;
+    slots[CAD_CHANGE_OBJECTS] =
+        snap->objectCount > core->data.objectCount ? snap->objectCount : core->data.objectCount;
+
+    for (int kind = 0; kind < CAD_CHANGE_KINDS; kind++) {
+        CadIndex dirtyFirst, dirtyLast;
+        CadCore_GetDirtyRange(core, (CadChangeKind)kind, &dirtyFirst, &dirtyLast);
+        for (int i = 0; i < slots[kind]; i++) {
+            if (!record_changed(snap, core, kind, i)) continue;
+            if (noted->first[kind] == INVALID_INDEX || i < noted->first[kind] || i > noted->last[kind]) {
+                fprintf(stderr, "Error: %s %d changed without a notification covering it\n", kind_names[kind], i);
+                return 0;
+            }
+            if (dirtyFirst == INVALID_INDEX || i < dirtyFirst || i > dirtyLast) {
+                fprintf(stderr, "Error: %s %d changed outside the dirty range\n", kind_names[kind], i);
+                return 0;
+            }
+            if (CadCore_GetGeneration(core, (CadChangeKind)kind) == snap->generation[kind]) {
+                fprintf(stderr, "Error: %s %d changed without a new generation\n", kind_names[kind], i);
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/* ----------------------------------------------------------------------------
+   Operations
+   ---------------------------------------------------------------------------- */
+
+/* Query every derived index so the checks cover them while they are live */
+static void use_indexes(CadCore* core) {
+    CadCore_GetModelStats(core);
+    CadCore_IsFullyMerged(core);
+    CadCore_GetPolygonVertices(core);
+    CadCore_GetPointStreams(core);
+    CadCore_IsPointConnected(core, 0);
+}
+
+static const CadBitset* random_point_set(CadCore* core, CadBitset* set) {
+    CadBitset_Clear(set);
+    for (int i = 0; i < core->data.pointCount; i++) {
+        if (rng_below(4) == 0) CadBitset_Set(set, i);
+    }
+    return set;
+}
+
+/* Apply one random operation; returns its name for the report */
+static const char* random_op(CadCore* core, CadBitset* scratch) {
+    int points = core->data.pointCount;
+    int polygons = core->data.polygonCount;
+    int objects = core->data.objectCount;
+
+    switch (rng_below(20)) {
+    case 0:
+    case 1:
+    case 2:
+        CadCore_AddPoint(core, rng_coord(), rng_coord(), rng_coord());
+        return "AddPoint";
+    case 3:
+        CadCore_DeletePoint(core, rng_slot(points));
+        return "DeletePoint";
+    case 4:
+        CadCore_SetPointPosition(core, rng_slot(points), rng_coord(), rng_coord(), rng_coord());
+        return "SetPointPosition";
+    case 5:
+        CadCore_SetNextPoint(core, rng_slot(points), rng_slot(points));
+        return "SetNextPoint";
+    case 6: {
+        const CadBitset* set = random_point_set(core, scratch);
+        CadCore_TranslatePoints(core, set, 0.5 * rng_below(3), 0.0, -0.5 * rng_below(2));
+        return "TranslatePoints";
+    }
+    case 7:
+    case 8: {
+        /* Now and then longer than the adjacency walk covers */
+        uint8_t npoints = (uint8_t)(rng_below(10) == 0 ? 60 + rng_below(20) : 2 + rng_below(5));
+        CadCore_AddPolygon(core, rng_slot(points), (uint8_t)rng_below(16), npoints);
+        return "AddPolygon";
+    }
+    case 9:
+        CadCore_DeletePolygon(core, rng_slot(polygons));
+        return "DeletePolygon";
+    case 10:
+    case 11:
+        CadCore_AddPointToPolygon(core, rng_slot(polygons), rng_slot(points));
+        return "AddPointToPolygon";
+    case 12:
+        CadCore_AddObject(core, objects > 0 ? rng_slot(objects) : INVALID_INDEX,
+                          rng_coord(), rng_coord(), rng_coord());
+        return "AddObject";
+    case 13:
+        CadCore_DeleteObject(core, rng_slot(objects));
+        return "DeleteObject";
+    case 14:
+        if (rng_below(2)) {
+            CadCore_SelectPoint(core, rng_slot(points));
+        } else {
+            CadCore_DeselectPoint(core, rng_slot(points));
+        }
+        return "Select/DeselectPoint";
+    case 15:
+        if (rng_below(2)) {
+            CadCore_SelectPolygon(core, rng_slot(polygons));
+        } else {
+            CadCore_DeselectPolygon(core, rng_slot(polygons));
+        }
+        return "Select/DeselectPolygon";
+    case 16:
+        switch (rng_below(3)) {
+        case 0: CadCore_SelectAll(core); return "SelectAll";
+        case 1: CadCore_InvertSelection(core); return "InvertSelection";
+        default: CadCore_ClearSelection(core); return "ClearSelection";
+        }
+    case 17:
+        if (rng_below(8) == 0) {
+            CadCore_GridMerge(core);
+            return "GridMerge";
+        }
+        CadCore_SetPointPosition(core, rng_slot(points), rng_coord(), rng_coord(), rng_coord());
+        return "SetPointPosition";
+    case 18:
+        if (rng_below(8) == 0) {
+            CadCore_PointMerge(core);
+            return "PointMerge";
+        }
+        CadCore_SetNextPoint(core, rng_slot(points), INVALID_INDEX);
+        return "SetNextPoint";
+    default:
+        use_indexes(core);
+        return "(queries)";
+    }
+}
+
+/* The derived indexes that are live, one bit each */
+static int live_indexes(const CadCore* core) {
+    return (core->pointStreams.valid ? 1 : 0) | (core->adjacency.valid ? 2 : 0) |
+           (core->polygonVertices.valid ? 4 : 0) | (core->stats.valid ? 8 : 0);
+}
+
+static int noted_anything(const NotedChanges* noted) {
+    for (int kind = 0; kind < CAD_CHANGE_KINDS; kind++) {
+        if (noted->first[kind] != INVALID_INDEX) return 1;
+    }
+    return 0;
+}
+
+typedef struct {
+    CadCore* core;
+    const char* label;
+    CadBitset scratch;
+    NotedChanges noted;
+    long done;               /* Operations applied so far */
+    long ops;
+} Run;
+
+/* Whether a point edit must update the adjacency and merge state in place:
+   they are live and every polygon's walk is complete */
+static int point_edits_in_place(const CadCore* core) {
+    return core->adjacency.valid && core->adjacency.longPolygons == 0 &&
+           core->adjacency.danglingWalks == 0 && core->stats.valid && core->stats.unmergedValid;
+}
+
+static int point_edit(const char* op) {
+    return strcmp(op, "AddPoint") == 0 || strcmp(op, "DeletePoint") == 0 ||
+           strcmp(op, "SetPointPosition") == 0 || strcmp(op, "SetNextPoint") == 0 ||
+           strcmp(op, "TranslatePoints") == 0;
+}
+
+/* One operation, then the index checks; inside a batch nothing may be
+   notified yet */
+static int step(Run* run) {
+    int in_place = point_edits_in_place(run->core);
+    const char* op = random_op(run->core, &run->scratch);
+    long i = run->done++;
+    if (CadCore_CheckIndexes(run->core) != 0) {
+        printf("%s: indexes out of step after operation %ld (%s)\n", run->label, i, op);
+        return 0;
+    }
+    if (in_place && point_edit(op) &&
+        !(run->core->adjacency.valid && run->core->stats.valid && run->core->stats.unmergedValid)) {
+        printf("%s: operation %ld (%s) dropped the adjacency or merge state\n", run->label, i, op);
+        return 0;
+    }
+    if (CadCore_IsBatching(run->core) && noted_anything(&run->noted)) {
+        printf("%s: operation %ld (%s) notified during a batch\n", run->label, i, op);
+        return 0;
+    }
+    return 1;
+}
+
+/* A batch of up to 40 operations, nesting up to 3 deep */
+static int batch(Run* run, int depth) {
+    int ok = 1;
+    CadCore_BeginBatch(run->core);
+    for (int n = 1 + rng_below(40); ok && n > 0 && run->done < run->ops; n--) {
+        ok = (depth < 3 && rng_below(15) == 0) ? batch(run, depth + 1) : step(run);
+    }
+    CadCore_CommitBatch(run->core);
+    if (ok && CadCore_CheckIndexes(run->core) != 0) {
+        printf("%s: indexes out of step after committing a batch at operation %ld\n", run->label, run->done);
+        ok = 0;
+    }
+    return ok;
+}
+
+/* Run ops operations; returns 0 at the first one that leaves an index out
+   of step or a change unreported */
+static int run_ops(CadCore* core, const char* label, long ops) {
+    Run run;
+    run.core = core;
+    run.label = label;
+    run.done = 0;
+    run.ops = ops;
+    CadBitset_Init(&run.scratch);
+    Snapshot snap;
+    snapshot_init(&snap);
+    int subscription = CadCore_Subscribe(core, on_change, &run.noted);
+    int ok = subscription != 0;
+
+    use_indexes(core);
+    if (ok && CadCore_CheckIndexes(core) != 0) {
+        printf("%s: indexes out of step before the first operation\n", label);
+        ok = 0;
+    }
+    while (ok && run.done < ops) {
+        snapshot_take(&snap, core);
+        noted_reset(&run.noted);
+        long first = run.done;
+        int batched = rng_below(20) == 0;
+        int live = live_indexes(core);
+
+        ok = batched ? batch(&run, 0) : step(&run);
+        if (!ok) break;
+        if (batched && (live_indexes(core) & live) != live) {
+            printf("%s: batch at operation %ld left indexes %d of %d live\n",
+                   label, first, live_indexes(core) & live, live);
+            ok = 0;
+        } else if (!check_coverage(&snap, core, &run.noted)) {
+            printf("%s: change not reported by operation %ld%s\n", label, first,
+                   batched ? " (batch)" : "");
+            ok = 0;
+        }
+    }
+
+    CadCore_Unsubscribe(core, subscription);
+    snapshot_free(&snap);
+    CadBitset_Free(&run.scratch);
+    return ok;
+}
+
+/* ----------------------------------------------------------------------------
+   Loading
+   ---------------------------------------------------------------------------- */
+
+/* What a subscription heard while a file loaded */
+typedef struct {
+    const CadCore* core;
+    int calls[CAD_CHANGE_KINDS];
+    CadIndex first[CAD_CHANGE_KINDS];
+    CadIndex last[CAD_CHANGE_KINDS];
+    int slots[CAD_CHANGE_KINDS];  /* Table size at the last call */
+} LoadNotes;
+
+static int table_slots(const CadCore* core, int kind) {
+    switch (kind) {
+    case CAD_CHANGE_POINTS:
+    case CAD_CHANGE_POINT_SELECTION:
+        return core->data.pointCount;
+    case CAD_CHANGE_POLYGONS:
+    case CAD_CHANGE_POLYGON_SELECTION:
+        return core->data.polygonCount;
+    default:
+        return core->data.objectCount;
+    }
+}
+
+static void on_load_change(void* user, CadChangeKind kind, CadIndex first, CadIndex last) {
+    LoadNotes* notes = (LoadNotes*)user;
+    notes->calls[kind]++;
+    notes->first[kind] = first;
+    notes->last[kind] = last;
+    notes->slots[kind] = table_slots(notes->core, kind);
+}
+
+/* Load a file, checking each table is reported once, after the load, over
+   every slot it had before or has now */
+static int load_checked(CadCore* core, const char* filename) {
+    LoadNotes notes;
+    memset(&notes, 0, sizeof(notes));
+    notes.core = core;
+    int before[CAD_CHANGE_KINDS];
+    for (int kind = 0; kind < CAD_CHANGE_KINDS; kind++) before[kind] = table_slots(core, kind);
+
+    int subscription = CadCore_Subscribe(core, on_load_change, &notes);
+    int loaded = subscription != 0 && CadCore_LoadFile(core, filename);
+    CadCore_Unsubscribe(core, subscription);
+    if (!loaded) return 0;
+
+    for (int kind = 0; kind < CAD_CHANGE_KINDS; kind++) {
+        int after = table_slots(core, kind);
+        int slots = before[kind] > after ? before[kind] : after;
+        int calls = slots > 0 ? 1 : 0;
+        if (notes.calls[kind] != calls ||
+            (calls && (notes.first[kind] != 0 || notes.last[kind] != slots - 1 || notes.slots[kind] != after))) {
+            printf("%s: loading reported %s %d times, last as %d..%d with %d slots loaded; expected %d, 0..%d, %d\n",
+                   filename, kind_names[kind], notes.calls[kind], notes.first[kind], notes.last[kind],
+                   notes.slots[kind], calls, slots - 1, after);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* ----------------------------------------------------------------------------
+   Compressed image limit
+   ---------------------------------------------------------------------------- */
+
+/* count live points with fractional coordinates, so the compact image
+   keeps them as doubles and grows by the same size per point */
+static int fill_points(CadFileData* data, int count) {
+    if (!CadFile_Reserve(data, 0, 0, count)) return 0;
+    for (int i = data->pointCount; i < count; i++) {
+        CadPoint* pt = &data->points[i];
+        pt->flags = 1;
+        pt->nextPoint = INVALID_INDEX;
+        pt->pointx = i + 0.5;
+        pt->pointy = -0.25;
+        pt->pointz = 0.75;
+    }
+    data->pointCount = count;
+    return 1;
+}
+
+static size_t image_size(CadFileData* data, int count) {
+    uint8_t* buffer;
+    size_t size;
+    if (!fill_points(data, count) || !CadFile_SaveToBufferEx(data, CAD_FORMAT_COMPACT, &buffer, &size)) {
+        return 0;
+    }
+    CadFile_FreeBuffer(buffer);
+    return size;
+}
+
+/* Save data in format and load it back; returns 1 if the save worked and
+   the load matched, 0 if the save failed, -1 if the load did not match */
+static int round_trip(const CadFileData* data, CadFileFormat format) {
+    uint8_t* buffer;
+    size_t size;
+    if (!CadFile_SaveToBufferEx(data, format, &buffer, &size)) return 0;
+
+    CadFileData loaded;
+    CadFile_Init(&loaded);
+    int same = CadFile_LoadFromBuffer(buffer, size, &loaded) && CadFile_Equal(data, &loaded);
+    CadFile_Free(&loaded);
+    CadFile_FreeBuffer(buffer);
+    return same ? 1 : -1;
+}
+
+static int check_compressed_limit(void) {
+    const size_t cap = CAD_COMPRESSED_MAX_IMAGE;
+    CadFileData data;
+    CadFile_Init(&data);
+
+    /* Estimate the point count at the cap, then step to the exact edge */
+    int probe = (int)(cap / 64);
+    size_t small = image_size(&data, probe);
+    size_t large = image_size(&data, 2 * probe);
+    if (small == 0 || large <= small) {
+        CadFile_Free(&data);
+        return 0;
+    }
+    int over = probe + (int)((cap - small) / ((large - small) / (size_t)probe));
+    while (image_size(&data, over) <= cap) over++;
+    while (over > 1 && image_size(&data, over - 1) > cap) over--;
+
+    int ok = 1;
+    fill_points(&data, over - 1);
+    if (round_trip(&data, CAD_FORMAT_COMPACT | CAD_FORMAT_COMPRESSED) != 1) {
+        printf("%d points (%zu byte image) did not round trip compressed\n", over - 1, image_size(&data, over - 1));
+        ok = 0;
+    }
+    fill_points(&data, over);
+    if (round_trip(&data, CAD_FORMAT_COMPACT | CAD_FORMAT_COMPRESSED) != 0) {
+        printf("%d points (image over the cap) saved compressed\n", over);
+        ok = 0;
+    } else if (round_trip(&data, CAD_FORMAT_COMPACT) != 1) {
+        printf("%d points did not round trip uncompressed\n", over);
+        ok = 0;
+    }
+    if (ok) printf("Compressed saves stop at the %zu byte image cap (%d points)\n", cap, over - 1);
+
+    CadFile_Free(&data);
+    return ok;
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "Usage: %s [-n ops] [-s seed] [input.cad...]\n", argv0);
+    fprintf(stderr, "       %s -z\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    long ops = 20000;
+    uint32_t seed = 1;
+    int first_input = argc;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            ops = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-z") == 0) {
+            return check_compressed_limit() ? 0 : 1;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            first_input = i;
+            break;
+        }
+    }
+    rng_state = seed ? seed : 1;
+
+    CadCore* core = (CadCore*)malloc(sizeof(CadCore));
+    if (!core) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 1;
+    }
+    CadCore_Init(core);
+
+    int ok = 1;
+    if (first_input >= argc) {
+        ok = run_ops(core, "(empty model)", ops);
+    }
+    for (int i = first_input; ok && i < argc; i++) {
+        if (!load_checked(core, argv[i])) {
+            ok = 0;
+            break;
+        }
+        ok = run_ops(core, argv[i], ops);
+    }
+
+    CadCore_Destroy(core);
+    free(core);
+    if (ok) printf("All derived indexes matched a rebuild (seed %u)\n", (unsigned)seed);
+    return ok ? 0 : 1;
+}
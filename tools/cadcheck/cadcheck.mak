@@ -0,0 +1,25 @@
+# Makefile for the derived index checker (run it from the repository root)
+# replaces gcc -DCAD_CHECK_INDEXES -iquote include src/cad_file.c src/cad_lz.c src/cad_codec.c src/cad_thread.c src/cad_core.c tools/cadcheck/cadcheck.c -o cadcheck.exe
+
+CC := gcc
+CFLAGS := -O1 -g -Wall
+# CadCore_CheckIndexes only exists in builds that define this
+DEFINES := -DCAD_CHECK_INDEXES
+INCLUDES := -iquote include
+SRCS := src/cad_file.c src/cad_lz.c src/cad_codec.c src/cad_thread.c src/cad_core.c tools/cadcheck/cadcheck.c
+TARGET := cadcheck.exe
+ifeq ($(OS),Windows_NT)
+LDLIBS :=
+else
+LDLIBS := -pthread -lm
+endif
+
+.PHONY: all clean
+
+all: $(TARGET)
+
+$(TARGET): $(SRCS)
+	$(CC) $(CFLAGS) $(DEFINES) $(INCLUDES) $(SRCS) -o $(TARGET) $(LDLIBS)
+
+clean:
+	-@rm -f $(TARGET)